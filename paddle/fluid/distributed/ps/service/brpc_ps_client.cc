@@ -19,6 +19,7 @@
 #include <string>
 
 #include "paddle/fluid/distributed/ps/service/coordinator_client.h"
+#include "paddle/fluid/distributed/ps/service/sparse_value_codec.h"
 #include "paddle/fluid/framework/archive.h"
 #include "paddle/fluid/string/split.h"
 
@@ -78,6 +79,20 @@ DEFINE_int32(pserver_sparse_table_shard_num,
              1000,
              "sparse table shard for save & load");
 
+DEFINE_int32(pserver_pull_cache_size_mb,
+             0,
+             "size of the cache of pulled values per sparse table, 0 for no "
+             "cache");
+
+DEFINE_int32(pserver_pull_cache_staleness,
+             0,
+             "max pushes of the sparse table a cached pull value may miss");
+
+DEFINE_bool(pserver_pull_cache_lfu,
+            true,
+            "cache a pull value over the LRU one only if it is pulled more "
+            "often, else always");
+
 inline size_t get_sparse_shard(uint32_t shard_num,
                                uint32_t server_num,
                                uint64_t key) {
@@ -87,6 +102,16 @@ inline size_t get_sparse_shard(uint32_t shard_num,
   return (key % shard_num) / local_shard_num;
 }
 
+// the second param of a sparse pull or push, if its values are compressed
+inline void AddCompressTypeParam(const SparseValueCodec &codec,
+                                 PsRequestMessage *request) {
+  if (codec.compressed()) {
+    uint32_t compress_type = codec.type();
+    request->add_params(reinterpret_cast<char *>(&compress_type),
+                        sizeof(uint32_t));
+  }
+}
+
 void DownpourPsClientService::service(
     ::google::protobuf::RpcController *controller,
     const PsRequestMessage *request,
@@ -342,6 +367,14 @@ int32_t BrpcPsClient::Initialize() {
       _push_sparse_task_queue_map[table_id] =
           paddle::framework::MakeChannel<SparseAsyncTask *>();
       _push_sparse_merge_count_map[table_id] = 0;
+      _push_codec_states[table_id].reset(new PushCodecState());
+      if (FLAGS_pserver_pull_cache_size_mb > 0) {
+        _pull_caches[table_id].reset(new SparsePullCache(
+            static_cast<size_t>(FLAGS_pserver_pull_cache_size_mb) << 20,
+            GetTableAccessor(table_id)->GetAccessorInfo().select_size,
+            FLAGS_pserver_pull_cache_staleness,
+            FLAGS_pserver_pull_cache_lfu));
+      }
     }
   }
 
@@ -728,9 +761,85 @@ void BrpcPsClient::FinalizeWorker() {
   _server.Stop(1000);
   _server.Join();
   _server_started = false;
+  for (auto &cache : _pull_caches) {
+    auto stat = cache.second->Stat();
+    VLOG(0) << "BrpcPsClient pull cache of table " << cache.first
+            << " hit: " << stat.hit << " miss: " << stat.miss
+            << " hit_ratio: " << stat.hit_ratio()
+            << " expire: " << stat.expire << " evict: " << stat.evict
+            << " reject: " << stat.reject << " entries: " << stat.entries;
+  }
   VLOG(0) << "BrpcPsClient::FinalizeWorker done";
 }
 
+SparsePullCacheStat BrpcPsClient::PullCacheStat(size_t table_id) {
+  auto *cache = GetPullCache(table_id);
+  return cache == nullptr ? SparsePullCacheStat() : cache->Stat();
+}
+
+SparseValueCodec BrpcPsClient::PushCodec(size_t table_id,
+                                         ValueAccessor *accessor) {
+  auto codec = SparseValueCodec::ForPush(accessor);
+  auto it = _push_codec_states.find(table_id);
+  if (!codec.compressed() || it == _push_codec_states.end()) {
+    return SparseValueCodec::ForPush(accessor, VALUE_FP32);
+  }
+  auto &state = *(it->second);
+  std::call_once(state.negotiated, [&]() {
+    state.accepted = NegotiatePushCodec(table_id, codec);
+    if (state.accepted) {
+      VLOG(0) << "push sparse table " << table_id << " in compress type "
+              << codec.type();
+    } else {
+      LOG(WARNING) << "servers do not accept compress type " << codec.type()
+                   << " for the push of sparse table " << table_id
+                   << ", push in float";
+    }
+  });
+  return state.accepted ? codec
+                        : SparseValueCodec::ForPush(accessor, VALUE_FP32);
+}
+
+bool BrpcPsClient::NegotiatePushCodec(size_t table_id,
+                                      const SparseValueCodec &codec) {
+  size_t request_call_num = _server_channels.size();
+  std::atomic<bool> accepted{true};
+  DownpourBrpcClosure *closure = new DownpourBrpcClosure(
+      request_call_num, [request_call_num, &codec, &accepted](void *done) {
+        auto *closure = reinterpret_cast<DownpourBrpcClosure *>(done);
+        for (size_t i = 0; i < request_call_num; ++i) {
+          // servers before the codecs answer an empty push without echo
+          const auto &res_data = closure->response(i)->data();
+          uint32_t type = VALUE_FP32;
+          if (closure->check_response(i, PS_PUSH_SPARSE_TABLE) == 0 &&
+              res_data.size() == sizeof(uint32_t)) {
+            memcpy(&type, res_data.data(), sizeof(uint32_t));
+          }
+          if (type != static_cast<uint32_t>(codec.type())) {
+            accepted = false;
+          }
+        }
+        closure->set_promise_value(0);
+      });
+  auto promise = std::make_shared<std::promise<int32_t>>();
+  closure->add_promise(promise);
+  std::future<int> fut = promise->get_future();
+  uint32_t kv_size = 0;
+  for (size_t i = 0; i < request_call_num; ++i) {
+    auto *request = closure->request(i);
+    request->set_cmd_id(PS_PUSH_SPARSE_TABLE);
+    request->set_table_id(table_id);
+    request->set_client_id(_client_id);
+    request->add_params(reinterpret_cast<char *>(&kv_size), sizeof(uint32_t));
+    AddCompressTypeParam(codec, request);
+    PsService_Stub rpc_stub(GetSparseChannel(i));
+    rpc_stub.service(
+        closure->cntl(i), closure->request(i), closure->response(i), closure);
+  }
+  fut.wait();
+  return accepted;
+}
+
 std::future<int32_t> BrpcPsClient::StopServer() {
   return SendCmd(-1, PS_STOP_SERVER, {});
 }
@@ -1007,6 +1116,9 @@ std::future<int32_t> BrpcPsClient::PushSparseRawGradient(
     size_t num,
     void *done) {
   auto *accessor = GetTableAccessor(table_id);
+  if (auto *cache = GetPullCache(table_id)) {
+    cache->OnPush(keys, num);
+  }
   // 发送RPC请求
   DownpourBrpcClosure *closure = reinterpret_cast<DownpourBrpcClosure *>(done);
   auto promise = std::make_shared<std::promise<int32_t>>();
@@ -1035,12 +1147,13 @@ std::future<int32_t> BrpcPsClient::PushSparseRawGradient(
     value_ptrs[pserver_idx].push_back(update_values[i]);
   }
 
+  auto codec = PushCodec(table_id, accessor);
   for (size_t shard_idx = 0; shard_idx < request_call_num; ++shard_idx) {
     auto kvs = ids[shard_idx];
     auto value_ptr = value_ptrs[shard_idx];
 
     size_t kv_size = kvs.size();
-    uint32_t value_size = accessor->GetAccessorInfo().update_size;
+    uint32_t value_size = codec.encoded_size();
 
     // 发送RPC请求
     auto *push_request = closure->request(shard_idx);
@@ -1048,6 +1161,7 @@ std::future<int32_t> BrpcPsClient::PushSparseRawGradient(
     push_request->set_table_id(table_id);
     push_request->set_client_id(_client_id);
     push_request->add_params((char *)&kv_size, sizeof(uint32_t));  // NOLINT
+    AddCompressTypeParam(codec, push_request);
     auto *push_data = push_request->mutable_data();
     push_data->resize(kv_size * (sizeof(uint64_t) + value_size));
     char *push_data_ptr = const_cast<char *>(push_data->data());
@@ -1055,7 +1169,7 @@ std::future<int32_t> BrpcPsClient::PushSparseRawGradient(
     push_data_ptr += kv_size * sizeof(uint64_t);
 
     for (size_t i = 0; i < kv_size; ++i) {
-      memcpy(push_data_ptr, value_ptr[i], value_size);
+      codec.Encode(value_ptr[i], push_data_ptr);
       push_data_ptr += value_size;
     }
     PsService_Stub rpc_stub(GetSparseChannel(shard_idx));
@@ -1142,6 +1256,30 @@ std::future<int32_t> BrpcPsClient::PullSparse(float **select_values,
       std::make_shared<CostTimer>("pserver_client_pull_sparse_local");
   size_t request_call_num = _server_channels.size();
 
+  // the values of the cached keys are copied, the others are pulled and
+  // cached as of the step the pull is sent at
+  auto *cache = GetPullCache(table_id);
+  uint64_t cache_step = 0;
+  std::vector<uint64_t> miss_keys;
+  std::vector<float *> miss_values;
+  if (cache != nullptr) {
+    cache_step = cache->step();
+    for (size_t i = 0; i < num; ++i) {
+      if (!cache->Get(keys[i], select_values[i])) {
+        miss_keys.push_back(keys[i]);
+        miss_values.push_back(select_values[i]);
+      }
+    }
+    if (miss_keys.empty()) {
+      std::promise<int32_t> promise;
+      promise.set_value(0);
+      return promise.get_future();
+    }
+    keys = miss_keys.data();
+    select_values = miss_values.data();
+    num = miss_keys.size();
+  }
+
   auto shard_sorted_kvs = std::make_shared<
       std::vector<std::vector<std::pair<uint64_t, float *>>>>();
   shard_sorted_kvs->resize(request_call_num);
@@ -1164,16 +1302,29 @@ std::future<int32_t> BrpcPsClient::PullSparse(float **select_values,
   auto *accessor = GetTableAccessor(table_id);
 
   size_t value_size = accessor->GetAccessorInfo().select_size;
+  auto codec = SparseValueCodec::ForPull(accessor);
 
   DownpourBrpcClosure *closure = new DownpourBrpcClosure(
-      request_call_num, [shard_sorted_kvs, value_size](void *done) {
+      request_call_num,
+      [shard_sorted_kvs, value_size, codec, cache, cache_step](void *done) {
         int ret = 0;
         auto *closure = reinterpret_cast<DownpourBrpcClosure *>(done);
+        std::vector<char> encoded(codec.encoded_size());
         for (size_t i = 0; i < shard_sorted_kvs->size(); ++i) {
           if (closure->check_response(i, PS_PULL_SPARSE_TABLE) != 0) {
             ret = -1;
             break;
           }
+          // the values are in float unless the server echoes the type
+          bool compressed = false;
+          const auto &res_data = closure->response(i)->data();
+          if (codec.compressed() && res_data.size() == sizeof(uint32_t)) {
+            uint32_t type = 0;
+            memcpy(&type, res_data.data(), sizeof(uint32_t));
+            compressed = type == static_cast<uint32_t>(codec.type());
+          }
+          size_t res_value_size =
+              compressed ? codec.encoded_size() : value_size;
 
           auto &request_kvs = shard_sorted_kvs->at(i);
           auto &res_io_buffer = closure->cntl(i)->response_attachment();
@@ -1190,13 +1341,21 @@ std::future<int32_t> BrpcPsClient::PullSparse(float **select_values,
             } else {
               last_key = kv_pair->first;
               last_value_data = kv_pair->second;
-              if (value_size !=
-                  io_buffer_itr.copy_and_forward(
-                      reinterpret_cast<void *>(last_value_data), value_size)) {
+              void *res_value = compressed
+                                    ? reinterpret_cast<void *>(encoded.data())
+                                    : reinterpret_cast<void *>(last_value_data);
+              if (res_value_size !=
+                  io_buffer_itr.copy_and_forward(res_value, res_value_size)) {
                 LOG(WARNING) << "res data is lack or not in format";
                 ret = -1;
                 break;
               }
+              if (compressed) {
+                codec.Decode(encoded.data(), last_value_data);
+              }
+              if (cache != nullptr) {
+                cache->Put(last_key, last_value_data, cache_step);
+              }
             }
           }
         }
@@ -1250,6 +1409,7 @@ std::future<int32_t> BrpcPsClient::PullSparse(float **select_values,
       closure->request(i)->set_client_id(_client_id);
       closure->request(i)->add_params((char *)&kv_request_count,  // NOLINT
                                       sizeof(uint32_t));
+      AddCompressTypeParam(codec, closure->request(i));
       PsService_Stub rpc_stub(GetCmdChannel(i));
       closure->cntl(i)->set_log_id(butil::gettimeofday_ms());
       rpc_stub.service(
@@ -1409,7 +1569,11 @@ std::future<int32_t> BrpcPsClient::PushSparseRawGradientPartial(
     void *done,
     int pserver_idx) {
   auto *accessor = GetTableAccessor(table_id);
-  size_t value_size = accessor->GetAccessorInfo().update_size;
+  if (auto *cache = GetPullCache(table_id)) {
+    cache->OnPush(keys, num);
+  }
+  auto codec = PushCodec(table_id, accessor);
+  size_t value_size = codec.encoded_size();
   DownpourBrpcClosure *closure = reinterpret_cast<DownpourBrpcClosure *>(done);
   auto promise = std::make_shared<std::promise<int32_t>>();
   closure->add_promise(promise);
@@ -1421,13 +1585,14 @@ std::future<int32_t> BrpcPsClient::PushSparseRawGradientPartial(
   push_request->set_table_id(table_id);
   push_request->set_client_id(_client_id);
   push_request->add_params((char *)&num, sizeof(uint32_t));  // NOLINT
+  AddCompressTypeParam(codec, push_request);
   auto *push_data = push_request->mutable_data();
   push_data->resize(num * (sizeof(uint64_t) + value_size));
   char *push_data_ptr = const_cast<char *>(push_data->data());
   memcpy(push_data_ptr, keys, num * sizeof(uint64_t));
   push_data_ptr += num * sizeof(uint64_t);
   for (uint32_t i = 0; i < num; ++i) {
-    memcpy(push_data_ptr, update_values[i], value_size);
+    codec.Encode(update_values[i], push_data_ptr);
     push_data_ptr += value_size;
   }
   PsService_Stub rpc_stub(GetSparseChannel(pserver_idx));
@@ -1530,6 +1695,9 @@ std::future<int32_t> BrpcPsClient::PushSparse(size_t table_id,
                                               size_t num) {
   auto push_timer = std::make_shared<CostTimer>("pserver_client_push_sparse");
   CostTimer parse_timer("pserver_client_push_sparse_parse");
+  if (auto *cache = GetPullCache(table_id)) {
+    cache->OnPush(keys, num);
+  }
   int push_sparse_async_num = _push_sparse_task_queue_map[table_id]->Size();
   while (push_sparse_async_num > FLAGS_pserver_max_async_call_num) {
     //    LOG(INFO) << "PushSparse Waiting for async_call_num comsume,
@@ -1857,8 +2025,10 @@ int BrpcPsClient::PushSparseAsyncShardPush(
   push_request->set_client_id(_client_id);
   push_request->add_params(reinterpret_cast<char *>(&merged_kv_count),
                            sizeof(uint32_t));  // NOLINT
+  auto codec = PushCodec(table_id, accessor);
+  AddCompressTypeParam(codec, push_request);
   auto *push_data = push_request->mutable_data();
-  int update_size = accessor->GetAccessorInfo().update_size;
+  int update_size = codec.encoded_size();
   push_data->resize(merged_kv_count * (sizeof(uint64_t) + update_size));
   char *push_data_ptr = const_cast<char *>(push_data->data());
   memcpy(push_data_ptr,
@@ -1868,9 +2038,8 @@ int BrpcPsClient::PushSparseAsyncShardPush(
   for (size_t i = 0; i < merged_kv_count; ++i) {
     const char *task_data_ptr = merged_value_list[i].data();
 
-    memcpy(push_data_ptr,
-           (float *)(task_data_ptr),  // NOLINT
-           update_size);
+    codec.Encode(reinterpret_cast<const float *>(task_data_ptr),
+                 push_data_ptr);
     push_data_ptr += update_size;
   }
   PsService_Stub rpc_stub(GetSparseChannel(shard_idx));
@@ -16,7 +16,9 @@
 
 #include <ThreadPool.h>
 
+#include <atomic>
 #include <memory>
+#include <mutex>  // NOLINT
 #include <string>
 #include <vector>
 
@@ -26,6 +28,7 @@
 #include "paddle/fluid/distributed/ps/service/brpc_utils.h"
 #include "paddle/fluid/distributed/ps/service/ps_client.h"
 #include "paddle/fluid/distributed/ps/service/sendrecv.pb.h"
+#include "paddle/fluid/distributed/ps/service/sparse_pull_cache.h"
 #include "paddle/fluid/framework/channel.h"
 #include "paddle/fluid/framework/lod_tensor.h"
 #include "paddle/fluid/framework/scope.h"
@@ -310,6 +313,10 @@ class BrpcPsClient : public PSClient {
   void PrintQueueSize();
   void PrintQueueSizeThread();
 
+  // the hits and misses of the pull cache of the table, all zero when it
+  // has no cache
+  SparsePullCacheStat PullCacheStat(size_t table_id);
+
  protected:
   virtual size_t GetServerNums() { return _server_channels.size(); }
   inline brpc::Channel *GetSparseChannel(size_t server_id) {
@@ -361,6 +368,32 @@ class BrpcPsClient : public PSClient {
       _push_sparse_task_queue_map;
   std::unordered_map<uint32_t, uint32_t> _push_sparse_merge_count_map;
 
+  // the caches of sparse pull values, built in Initialize and read only
+  // after, so looked up without a lock
+  std::unordered_map<uint32_t, std::unique_ptr<SparsePullCache>>
+      _pull_caches;
+  inline SparsePullCache *GetPullCache(size_t table_id) {
+    auto it = _pull_caches.find(table_id);
+    return it == _pull_caches.end() ? nullptr : it->second.get();
+  }
+
+  // Whether the servers of a sparse table decode its push compress type,
+  // negotiated by the first push of the table.
+  struct PushCodecState {
+    std::once_flag negotiated;
+    bool accepted = false;
+  };
+  // built in Initialize
+  std::unordered_map<uint32_t, std::unique_ptr<PushCodecState>>
+      _push_codec_states;
+  // the codec of the pushes of the table, float unless the servers accept
+  // its compress type, as a server of an old version would read the encoded
+  // rows as floats
+  SparseValueCodec PushCodec(size_t table_id, ValueAccessor *accessor);
+  // sends an empty push in codec to every server, which echo the compress
+  // type if they decode it, and returns whether all of them did
+  bool NegotiatePushCodec(size_t table_id, const SparseValueCodec &codec);
+
   std::thread _print_thread;
 
   int PushSparseAsyncShardMerge(
@@ -18,6 +18,7 @@
 
 #include "butil/object_pool.h"
 #include "paddle/fluid/distributed/common/cost_timer.h"
+#include "paddle/fluid/distributed/ps/service/sparse_value_codec.h"
 #include "paddle/fluid/distributed/ps/table/depends/sparse_utils.h"
 #include "paddle/fluid/distributed/ps/table/table.h"
 #include "paddle/fluid/framework/archive.h"
@@ -495,6 +496,21 @@ int32_t BrpcPsService::PullGeoParam(Table *table,
   return 0;
 }
 
+// the compress type of the values of a sparse pull or push, in the second
+// param of the request if they are compressed
+static ValueCompressType CompressTypeParam(const PsRequestMessage &request) {
+  if (request.params_size() < 2 ||
+      request.params(1).size() != sizeof(uint32_t)) {
+    return VALUE_FP32;
+  }
+  uint32_t compress_type =
+      *(reinterpret_cast<const uint32_t *>(request.params(1).c_str()));
+  if (!ValueCompressType_IsValid(compress_type)) {
+    return VALUE_FP32;
+  }
+  return static_cast<ValueCompressType>(compress_type);
+}
+
 int32_t BrpcPsService::PullSparse(Table *table,
                                   const PsRequestMessage &request,
                                   PsResponseMessage &response,
@@ -543,8 +559,26 @@ int32_t BrpcPsService::PullSparse(Table *table,
   table->Pull(table_context);
   // table->PullSparse(res_data->data(), value);
 
-  cntl->response_attachment().append(reinterpret_cast<char *>(res_data->data()),
-                                     res_data->size() * sizeof(float));
+  auto codec = SparseValueCodec::ForPull(table->ValueAccesor(),
+                                         CompressTypeParam(request));
+  if (codec.compressed() && codec.value_size() == dim * sizeof(float)) {
+    thread_local std::string encoded;
+    encoded.resize(num * codec.encoded_size());
+    for (uint32_t i = 0; i < num; ++i) {
+      codec.Encode(res_data->data() + i * dim,
+                   const_cast<char *>(encoded.data()) +
+                       i * codec.encoded_size());
+    }
+    cntl->response_attachment().append(encoded.data(), encoded.size());
+    // tells the client the values are compressed
+    uint32_t compress_type = codec.type();
+    response.set_data(reinterpret_cast<char *>(&compress_type),
+                      sizeof(uint32_t));
+  } else {
+    cntl->response_attachment().append(
+        reinterpret_cast<char *>(res_data->data()),
+        res_data->size() * sizeof(float));
+  }
   butil::return_object(res_data);
   return 0;
 }
@@ -556,6 +590,15 @@ int32_t BrpcPsService::PushSparse(Table *table,
   platform::RecordEvent record_event(
       "PsService->PushSparse", platform::TracerEventType::Communication, 1);
   CHECK_TABLE_EXIST(table, request, response)
+  auto codec = SparseValueCodec::ForPush(table->ValueAccesor(),
+                                         CompressTypeParam(request));
+  if (codec.compressed()) {
+    // tells the client the values are decoded in the compress type, which
+    // it asks by an empty push before compressing its pushes
+    uint32_t compress_type = codec.type();
+    response.set_data(reinterpret_cast<char *>(&compress_type),
+                      sizeof(uint32_t));
+  }
   auto &push_data = request.data();
   if (push_data.size() < 1) {
     // set_response_code(response, 0, "push sparse data is empty");
@@ -582,6 +625,20 @@ int32_t BrpcPsService::PushSparse(Table *table,
   table_context.push_context.values =
       (const float *)(push_data.data() + sizeof(uint64_t) * num);
   table_context.num = num;
+  if (codec.compressed()) {
+    if (push_data.size() < num * (sizeof(uint64_t) + codec.encoded_size())) {
+      set_response_code(response, -1, "push sparse data is not in format");
+      return 0;
+    }
+    thread_local std::vector<float> values;
+    size_t dim = codec.value_size() / sizeof(float);
+    values.resize(num * dim);
+    const char *encoded = push_data.data() + sizeof(uint64_t) * num;
+    for (uint32_t i = 0; i < num; ++i) {
+      codec.Decode(encoded + i * codec.encoded_size(), values.data() + i * dim);
+    }
+    table_context.push_context.values = values.data();
+  }
   // const uint64_t *keys = (const uint64_t *)push_data.data();
   // const float *values = (const float *)(push_data.data() + sizeof(uint64_t) *
   // num);
@@ -502,12 +502,18 @@ void AsyncCommunicator::SendByCommunicator() {
       auto &check_queue = send_varname_to_queue_[varnames[0]];
       std::vector<std::vector<std::shared_ptr<Variable>>> vars;
       vars.resize(var_nums);
+      auto state_iter = sparse_send_states_.find(varnames[0]);
+      SparseSendState *state = state_iter == sparse_send_states_.end()
+                                   ? nullptr
+                                   : state_iter->second.get();
+      // take what is queued, but wait only for the window of a sparse table
+      int window = state ? state->merge_window : max_merge_var_num_;
       int merged_var_num = 0;
       int wait_times = 0;
       while (merged_var_num < max_merge_var_num_) {
         if (check_queue->Size() == 0) {
           VLOG(4) << "wait_times -> " << wait_times;
-          if (wait_times >= send_wait_times_) {
+          if (merged_var_num >= window || wait_times >= send_wait_times_) {
             break;
           }
           std::this_thread::sleep_for(std::chrono::milliseconds(10));
@@ -525,6 +531,15 @@ void AsyncCommunicator::SendByCommunicator() {
       }
       if (merged_var_num == 0) return;
 
+      if (state != nullptr) {
+        SendSparseMerged(ctx, vars[0], state);
+        AdaptMergeWindow(state, merged_var_num, check_queue->Size());
+        if (independent_recv_) {
+          grad_num_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return;
+      }
+
       for (size_t i = 0; i < var_nums; i++) {
         auto &var_name = varnames[i];
         if (var_name == STEP_COUNTER) {
@@ -563,6 +578,100 @@ void AsyncCommunicator::SendByCommunicator() {
   return;
 }
 
+void AsyncCommunicator::SendSparseMerged(
+    const CommContext &ctx,
+    const std::vector<std::shared_ptr<Variable>> &vars,
+    SparseSendState *state) {
+  platform::RecordEvent record_event("Communicator->SendSparseMerged",
+                                     platform::TracerEventType::Communication,
+                                     1);
+  double start = GetCurrentUS();
+  std::vector<const phi::SelectedRows *> inputs;
+  inputs.reserve(vars.size());
+  size_t input_rows = 0;
+  for (auto &var : vars) {
+    inputs.push_back(&var->Get<phi::SelectedRows>());
+    input_rows += inputs.back()->rows().size();
+  }
+  // the buffers of cur were pushed before the pending push was issued
+  int cur = state->cur;
+  auto &keys = state->keys[cur];
+  auto &values = state->values[cur];
+  auto &rows = state->rows[cur];
+  state->merger.Merge(inputs, false, &keys, &values);
+  size_t width = keys.empty() ? 0 : values.size() / keys.size();
+  rows.resize(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    rows[i] = values.data() + i * width;
+  }
+  double merge_us = GetCurrentUS() - start;
+  VLOG(3) << "merge " << ctx.origin_varnames[0] << " of " << vars.size()
+          << " grads, " << input_rows << " rows to " << keys.size()
+          << " rows, bytes to send " << input_rows * (8 + width * 4)
+          << " -> " << keys.size() * (8 + width * 4) << ", " << merge_us
+          << " us";
+
+  if (state->pending.valid()) {
+    state->pending.wait();
+  }
+  state->merge_us = merge_us;
+  state->send_us = 0;
+  size_t request_call_num = _worker_ptr->GetServerNums();
+  int64_t issue_us = GetCurrentUS();
+  ++_async_call_num;
+  DownpourBrpcClosure *closure = new DownpourBrpcClosure(
+      request_call_num, [this, request_call_num, state, issue_us](void *done) {
+        int ret = 0;
+        auto *closure = (DownpourBrpcClosure *)done;  // NOLINT
+        for (size_t i = 0; i < request_call_num; ++i) {
+          if (closure->check_response(i, PS_PUSH_SPARSE_TABLE) != 0) {
+            ret = -1;
+            break;
+          }
+        }
+        state->send_us = GetCurrentUS() - issue_us;
+        closure->set_promise_value(ret);
+        --_async_call_num;
+      });
+  state->pending = _worker_ptr->PushSparseRawGradient(
+      ctx.table_id, keys.data(), rows.data(), keys.size(), closure);
+  // a local client pushes in the call and never runs the closure
+  int64_t call_us = GetCurrentUS() - issue_us;
+  if (state->send_us < call_us) {
+    state->send_us = call_us;
+  }
+  state->cur = 1 - cur;
+}
+
+void AsyncCommunicator::AdaptMergeWindow(SparseSendState *state,
+                                         int merged_var_num,
+                                         size_t queue_size) {
+  int window = state->merge_window;
+  if (merged_var_num < window) {
+    // waited in vain, the trainer is slower than the pushes
+    window = std::max(window / 2, 1);
+  } else if (queue_size >= static_cast<size_t>(window) ||
+             state->send_us > state->merge_us) {
+    // merging more gradients sends each hot feasign fewer times
+    window = std::min(window * 2, max_merge_var_num_);
+  }
+  if (window != state->merge_window) {
+    VLOG(3) << "merge window " << state->merge_window << " -> " << window
+            << ", queue size " << queue_size << ", send " << state->send_us
+            << " us, merge " << state->merge_us << " us";
+    state->merge_window = window;
+  }
+}
+
+void AsyncCommunicator::WaitSparseSends() {
+  for (auto &iter : sparse_send_states_) {
+    auto &state = iter.second;
+    if (state->pending.valid()) {
+      state->pending.wait();
+    }
+  }
+}
+
 void AsyncCommunicator::PushDensePostProcessing() {
   if (independent_recv_) {
     grad_num_.fetch_add(1, std::memory_order_relaxed);
@@ -582,6 +691,7 @@ void AsyncCommunicator::MainThread() {
     SendByCommunicator();
     RpcProfilerControl();
   }
+  WaitSparseSends();
   VLOG(1) << "communicator stopped, send thread exit";
 }
 
@@ -809,6 +919,18 @@ void AsyncCommunicator::InitImpl(const RpcCtxMap &send_varname_to_ctx,
     }
   }
   send_threadpool_.reset(new ::ThreadPool(thread_pool_size_));
+  if (FLAGS_communicator_adaptive_merge) {
+    merge_threadpool_.reset(new ::ThreadPool(thread_pool_size_));
+    for (auto &iter : send_varname_to_ctx_) {
+      auto &ctx = iter.second;
+      if (!ctx.is_sparse || ctx.is_tensor_table ||
+          ctx.origin_varnames.size() != 1) {
+        continue;
+      }
+      sparse_send_states_[ctx.origin_varnames[0]].reset(
+          new SparseSendState(merge_threadpool_.get(), thread_pool_size_));
+    }
+  }
 }
 
 AsyncCommunicator::~AsyncCommunicator() {
@@ -19,6 +19,7 @@ limitations under the License. */
 
 #include <atomic>
 #include <deque>
+#include <future>  // NOLINT
 #include <map>
 #include <memory>
 #include <numeric>
@@ -31,6 +32,7 @@ limitations under the License. */
 
 #include "gflags/gflags.h"
 #include "paddle/fluid/distributed/ps/service/communicator/communicator_common.h"
+#include "paddle/fluid/distributed/ps/service/communicator/sparse_grad_merger.h"
 #include "paddle/fluid/distributed/ps/service/coordinator_client.h"
 #include "paddle/fluid/distributed/ps/service/ps_client.h"
 #include "paddle/fluid/framework/channel.h"
@@ -53,6 +55,7 @@ struct CommContext;
 }  // namespace paddle
 
 DECLARE_bool(communicator_is_sgd_optimizer);
+DECLARE_bool(communicator_adaptive_merge);
 
 namespace paddle {
 namespace distributed {
@@ -517,6 +520,40 @@ class AsyncCommunicator : public Communicator {
 
   std::unique_ptr<Scope> send_scope_;  // an independent scope
   std::atomic_uint grad_num_{0};  // the num of gradient sent since last recv
+
+  // The pushes of a sparse table. The gradients are merged into one of the
+  // two buffers while the push of the other one is in flight.
+  struct SparseSendState {
+    SparseSendState(::ThreadPool *pool, int thread_num)
+        : merger(pool, thread_num) {}
+
+    SparseGradMerger merger;
+    // the number of gradients waited for before a push, which grows to
+    // max_merge_var_num_ while the gradients queue up or the push takes
+    // longer than the merge, and shrinks when the queue runs dry
+    int merge_window = 1;
+    int cur = 0;
+    std::vector<uint64_t> keys[2];
+    std::vector<float> values[2];
+    std::vector<const float *> rows[2];
+    std::future<int32_t> pending;
+    double merge_us = 0;
+    // set by the closure of the push
+    std::atomic<int64_t> send_us{0};
+  };
+
+  // merges vars and pushes them without waiting for the push
+  void SendSparseMerged(const CommContext &ctx,
+                        const std::vector<std::shared_ptr<Variable>> &vars,
+                        SparseSendState *state);
+  void AdaptMergeWindow(SparseSendState *state,
+                        int merged_var_num,
+                        size_t queue_size);
+  void WaitSparseSends();
+
+  std::unordered_map<std::string, std::unique_ptr<SparseSendState>>
+      sparse_send_states_;
+  std::unique_ptr<::ThreadPool> merge_threadpool_{nullptr};
 };
 
 class HalfAsyncCommunicator : public AsyncCommunicator {
@@ -0,0 +1,237 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/distributed/ps/service/communicator/sparse_grad_merger.h"
+
+#include <algorithm>
+#include <cstring>
+#include <future>  // NOLINT
+
+#include "paddle/fluid/platform/enforce.h"
+#include "paddle/phi/kernels/funcs/jit/kernels.h"
+
+namespace paddle {
+namespace distributed {
+
+namespace {
+
+// fewer pairs are merged by one thread
+constexpr size_t kParallelPairNum = 1 << 16;
+// fewer pairs of a partition are sorted by comparison
+constexpr size_t kRadixSortPairNum = 64;
+
+inline size_t PartitionOf(uint64_t key, size_t part_num) {
+  // the ids of a slot often share the high bits, mix them in
+  return ((key * 0x9E3779B97F4A7C15ULL) >> 32) % part_num;
+}
+
+}  // namespace
+
+SparseGradMerger::SparseGradMerger(::ThreadPool *pool, int thread_num)
+    : pool_(pool), thread_num_(std::max(thread_num, 1)) {}
+
+void SparseGradMerger::Merge(
+    const std::vector<const phi::SelectedRows *> &inputs,
+    bool average,
+    std::vector<uint64_t> *keys,
+    std::vector<float> *values) {
+  keys->clear();
+  values->clear();
+  int64_t width = -1;
+  size_t total = 0;
+  for (auto *input : inputs) {
+    if (input->rows().empty()) {
+      continue;
+    }
+    int64_t input_width = input->value().numel() / input->rows().size();
+    if (width < 0) {
+      width = input_width;
+    }
+    PADDLE_ENFORCE_EQ(width,
+                      input_width,
+                      platform::errors::InvalidArgument(
+                          "All inputs should have the same row width, "
+                          "expect %d but got %d.",
+                          width,
+                          input_width));
+    total += input->rows().size();
+  }
+  if (total == 0) {
+    return;
+  }
+
+  size_t part_num = 1;
+  if (pool_ != nullptr && thread_num_ > 1 && total >= kParallelPairNum) {
+    part_num = thread_num_;
+  }
+  pairs_.resize(total);
+  tmp_.resize(total);
+  part_begin_.assign(part_num + 1, 0);
+  if (part_num == 1) {
+    size_t i = 0;
+    for (auto *input : inputs) {
+      const float *data = input->value().data<float>();
+      for (auto id : input->rows()) {
+        pairs_[i++] = {static_cast<uint64_t>(id), data};
+        data += width;
+      }
+    }
+  } else {
+    for (auto *input : inputs) {
+      for (auto id : input->rows()) {
+        ++part_begin_[PartitionOf(static_cast<uint64_t>(id), part_num) + 1];
+      }
+    }
+    for (size_t p = 0; p < part_num; ++p) {
+      part_begin_[p + 1] += part_begin_[p];
+    }
+    std::vector<size_t> pos(part_begin_.begin(), part_begin_.end() - 1);
+    for (auto *input : inputs) {
+      const float *data = input->value().data<float>();
+      for (auto id : input->rows()) {
+        uint64_t key = static_cast<uint64_t>(id);
+        pairs_[pos[PartitionOf(key, part_num)]++] = {key, data};
+        data += width;
+      }
+    }
+  }
+  part_begin_[part_num] = total;
+
+  float scale = average ? 1.0f / inputs.size() : 1.0f;
+  if (part_num == 1) {
+    SortPartition(0);
+    size_t num = CountPartition(0);
+    keys->resize(num);
+    values->resize(num * width);
+    ReducePartition(0, 0, width, scale, keys->data(), values->data());
+    return;
+  }
+
+  std::vector<std::future<void>> tasks;
+  for (size_t p = 0; p < part_num; ++p) {
+    tasks.emplace_back(pool_->enqueue([this, p] { SortPartition(p); }));
+  }
+  for (auto &task : tasks) {
+    task.wait();
+  }
+  std::vector<size_t> offsets(part_num + 1, 0);
+  for (size_t p = 0; p < part_num; ++p) {
+    offsets[p + 1] = offsets[p] + CountPartition(p);
+  }
+  keys->resize(offsets[part_num]);
+  values->resize(offsets[part_num] * width);
+  tasks.clear();
+  for (size_t p = 0; p < part_num; ++p) {
+    tasks.emplace_back(pool_->enqueue([&, p] {
+      ReducePartition(
+          p, offsets[p], width, scale, keys->data(), values->data());
+    }));
+  }
+  for (auto &task : tasks) {
+    task.wait();
+  }
+}
+
+void SparseGradMerger::SortPartition(size_t part) {
+  KeyRow *src = pairs_.data() + part_begin_[part];
+  KeyRow *dst = tmp_.data() + part_begin_[part];
+  size_t n = part_begin_[part + 1] - part_begin_[part];
+  // stable, so the rows of a key are added in the order of the inputs
+  if (n < kRadixSortPairNum) {
+    std::stable_sort(src, src + n, [](const KeyRow &a, const KeyRow &b) {
+      return a.key < b.key;
+    });
+    return;
+  }
+
+  // the histograms of all the 8 bytes in one pass
+  std::vector<size_t> counts(8 * 256, 0);
+  uint64_t all_and = ~0ULL;
+  uint64_t all_or = 0;
+  for (size_t i = 0; i < n; ++i) {
+    uint64_t key = src[i].key;
+    all_and &= key;
+    all_or |= key;
+    for (int b = 0; b < 8; ++b) {
+      ++counts[b * 256 + ((key >> (8 * b)) & 0xFF)];
+    }
+  }
+  uint64_t varying = all_and ^ all_or;
+  for (int b = 0; b < 8; ++b) {
+    int shift = 8 * b;
+    // a byte of the same value in all keys leaves the order as it is
+    if (((varying >> shift) & 0xFF) == 0) {
+      continue;
+    }
+    size_t *count = counts.data() + b * 256;
+    size_t sum = 0;
+    for (int d = 0; d < 256; ++d) {
+      size_t c = count[d];
+      count[d] = sum;
+      sum += c;
+    }
+    for (size_t i = 0; i < n; ++i) {
+      dst[count[(src[i].key >> shift) & 0xFF]++] = src[i];
+    }
+    std::swap(src, dst);
+  }
+  if (src != pairs_.data() + part_begin_[part]) {
+    memcpy(dst, src, n * sizeof(KeyRow));
+  }
+}
+
+size_t SparseGradMerger::CountPartition(size_t part) const {
+  size_t num = 0;
+  for (size_t i = part_begin_[part]; i < part_begin_[part + 1]; ++i) {
+    if (i == part_begin_[part] || pairs_[i].key != pairs_[i - 1].key) {
+      ++num;
+    }
+  }
+  return num;
+}
+
+void SparseGradMerger::ReducePartition(size_t part,
+                                       size_t offset,
+                                       int64_t width,
+                                       float scale,
+                                       uint64_t *keys,
+                                       float *values) const {
+  auto add = phi::jit::KernelFuncs<phi::jit::VAddTuple<float>,
+                                   phi::CPUPlace>::Cache()
+                 .At(width);
+  size_t begin = part_begin_[part];
+  size_t end = part_begin_[part + 1];
+  size_t out = offset;
+  for (size_t i = begin; i < end; ++out) {
+    uint64_t key = pairs_[i].key;
+    float *row = values + out * width;
+    keys[out] = key;
+    memcpy(row, pairs_[i].row, width * sizeof(float));
+    for (++i; i < end && pairs_[i].key == key; ++i) {
+      add(pairs_[i].row, row, row, width);
+    }
+  }
+  if (scale != 1.0f) {
+    // the kernels are cached by their attribute, so scale by rows
+    auto scal = phi::jit::KernelFuncs<phi::jit::VScalTuple<float>,
+                                      phi::CPUPlace>::Cache()
+                    .At(width);
+    for (size_t i = offset; i < out; ++i) {
+      scal(&scale, values + i * width, values + i * width, width);
+    }
+  }
+}
+
+}  // namespace distributed
+}  // namespace paddle
@@ -0,0 +1,75 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <ThreadPool.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "paddle/phi/core/selected_rows.h"
+
+namespace paddle {
+namespace distributed {
+
+// Merges the float SelectedRows gradients of a sparse table into one row
+// per feasign, the rows of the same feasign summed, or averaged over the
+// inputs as MergeAverage, for the push of the communicator.
+//
+// The feasigns are sorted with a radix sort on their (key, row) pairs,
+// which skips the bytes all the keys share, so ids of a small range sort
+// in a pass or two, and the rows of each run of a key are added by the jit
+// VAdd kernel. Unlike MergeAdd the output is not sorted by key: with more
+// than one thread the pairs are partitioned by key and the partitions are
+// sorted and reduced in parallel on pool, one after another in the output.
+// The pool can be shared by the mergers of the tables, a merger itself is
+// used by one thread at a time.
+class SparseGradMerger {
+ public:
+  explicit SparseGradMerger(::ThreadPool *pool = nullptr, int thread_num = 1);
+
+  // keys gets the merged feasigns and values their rows, keys->size() rows
+  // of the width of the inputs
+  void Merge(const std::vector<const phi::SelectedRows *> &inputs,
+             bool average,
+             std::vector<uint64_t> *keys,
+             std::vector<float> *values);
+
+ private:
+  struct KeyRow {
+    uint64_t key;
+    const float *row;
+  };
+
+  void SortPartition(size_t part);
+  size_t CountPartition(size_t part) const;
+  void ReducePartition(size_t part,
+                       size_t offset,
+                       int64_t width,
+                       float scale,
+                       uint64_t *keys,
+                       float *values) const;
+
+  ::ThreadPool *pool_;
+  int thread_num_;
+  // the pairs of the partitions, partition i in
+  // [part_begin_[i], part_begin_[i + 1]) of pairs_, tmp_ is for the sort
+  std::vector<KeyRow> pairs_;
+  std::vector<KeyRow> tmp_;
+  std::vector<size_t> part_begin_;
+};
+
+}  // namespace distributed
+}  // namespace paddle
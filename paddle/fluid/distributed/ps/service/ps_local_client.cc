@@ -13,8 +13,24 @@
 // limitations under the License.
 
 #include "paddle/fluid/distributed/ps/service/ps_local_client.h"
+
+#include <algorithm>
+
+#include "paddle/fluid/distributed/ps/table/memory_sparse_table.h"
 #include "paddle/fluid/distributed/ps/table/table.h"
 
+DEFINE_bool(pserver_local_shard_parallel,
+            true,
+            "pull and push the sparse tables of PsLocalClient shard by shard "
+            "on the caller and a shared pool, instead of on the shard threads "
+            "of the table");
+DEFINE_int32(pserver_local_thread_num,
+             16,
+             "threads of the pool PsLocalClient runs shards of a request on");
+DEFINE_int32(pserver_local_min_keys_per_task,
+             4096,
+             "min keys of the shards PsLocalClient runs in a pool task");
+
 namespace paddle {
 namespace distributed {
 int32_t PsLocalClient::Initialize() {
@@ -28,9 +44,98 @@ int32_t PsLocalClient::Initialize() {
                       _config.fs_client_param());
     _table_map[downpour_param.downpour_table_param(i).table_id()].reset(table);
   }
+  if (FLAGS_pserver_local_shard_parallel) {
+    for (auto& it : _table_map) {
+      auto* table = dynamic_cast<MemorySparseTable*>(it.second.get());
+      if (table != nullptr && table->SupportShardAccess()) {
+        _shard_tables[it.first] = table;
+      }
+    }
+    if (!_shard_tables.empty()) {
+      _shard_pool.reset(
+          new ::ThreadPool(std::max(FLAGS_pserver_local_thread_num, 1)));
+    }
+  }
   return 0;
 }
 
+void PsLocalClient::RunByShard(
+    MemorySparseTable* table,
+    const uint64_t* keys,
+    size_t num,
+    const std::function<void(int, const std::pair<uint64_t, int>*, size_t)>&
+        fn) {
+  thread_local std::vector<std::vector<std::pair<uint64_t, int>>>
+      local_shard_keys;
+  thread_local std::vector<int> local_shards;
+  // the pool threads have thread locals of their own
+  auto* shard_keys = &local_shard_keys;
+  auto* shards = &local_shards;
+  shard_keys->resize(std::max<size_t>(shard_keys->size(),
+                                      table->LocalShardNum()));
+  shards->clear();
+  for (size_t i = 0; i < num; ++i) {
+    int shard_id = table->LocalShardOf(keys[i]);
+    auto& keys_of_shard = (*shard_keys)[shard_id];
+    if (keys_of_shard.empty()) {
+      shards->push_back(shard_id);
+    }
+    keys_of_shard.push_back({keys[i], static_cast<int>(i)});
+  }
+
+  // the shards in [begin, end) of the tasks
+  std::vector<std::pair<size_t, size_t>> ranges;
+  size_t min_keys =
+      static_cast<size_t>(std::max(FLAGS_pserver_local_min_keys_per_task, 1));
+  size_t begin = 0;
+  size_t task_keys = 0;
+  for (size_t i = 0; i < shards->size(); ++i) {
+    task_keys += (*shard_keys)[(*shards)[i]].size();
+    if (task_keys >= min_keys || i + 1 == shards->size()) {
+      ranges.push_back({begin, i + 1});
+      begin = i + 1;
+      task_keys = 0;
+    }
+  }
+  auto run = [shard_keys, shards, &fn](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      int shard_id = (*shards)[i];
+      auto& keys_of_shard = (*shard_keys)[shard_id];
+      fn(shard_id, keys_of_shard.data(), keys_of_shard.size());
+    }
+  };
+  std::vector<std::future<void>> tasks;
+  for (size_t i = 1; i < ranges.size(); ++i) {
+    auto range = ranges[i];
+    tasks.push_back(_shard_pool->enqueue(
+        [&run, range]() { run(range.first, range.second); }));
+  }
+  if (!ranges.empty()) {
+    run(ranges[0].first, ranges[0].second);
+  }
+  for (auto& task : tasks) {
+    task.wait();
+  }
+  for (int shard_id : *shards) {
+    (*shard_keys)[shard_id].clear();
+  }
+}
+
+void PsLocalClient::PushSparseByShard(MemorySparseTable* table,
+                                      const uint64_t* keys,
+                                      const float** update_values,
+                                      size_t num) {
+  RunByShard(table,
+             keys,
+             num,
+             [table, update_values](int shard_id,
+                                    const std::pair<uint64_t, int>* shard_keys,
+                                    size_t shard_key_num) {
+               table->PushSparseShard(
+                   shard_id, shard_keys, shard_key_num, update_values);
+             });
+}
+
 ::std::future<int32_t> PsLocalClient::Shrink(uint32_t table_id,
                                              const std::string threshold) {
   return done();
@@ -236,6 +341,19 @@ int32_t PsLocalClient::Initialize() {
   // auto local_timer =
   // std::make_shared<CostTimer>("pslib_downpour_client_pull_sparse_local");
   // 将key拆分到各shard请求，并记录原始对应value指针
+  if (auto* shard_table = GetShardTable(table_id)) {
+    RunByShard(shard_table,
+               keys,
+               num,
+               [shard_table, select_values](
+                   int shard_id,
+                   const std::pair<uint64_t, int>* shard_keys,
+                   size_t shard_key_num) {
+                 shard_table->PullSparsePtrShard(
+                     shard_id, shard_keys, shard_key_num, select_values);
+               });
+    return done();
+  }
   auto* table_ptr = GetTable(table_id);
 
   TableContext table_context;
@@ -282,6 +400,11 @@ int32_t PsLocalClient::Initialize() {
     size_t num,
     void* callback) {
   PSClientClosure* closure = reinterpret_cast<PSClientClosure*>(callback);
+  if (auto* shard_table = GetShardTable(table_id)) {
+    PushSparseByShard(shard_table, keys, update_values, num);
+    delete closure;
+    return done();
+  }
   auto* table_ptr = GetTable(table_id);
 
   TableContext table_context;
@@ -301,6 +424,10 @@ int32_t PsLocalClient::Initialize() {
                                                  const uint64_t* keys,
                                                  const float** update_values,
                                                  size_t num) {
+  if (auto* shard_table = GetShardTable(table_id)) {
+    PushSparseByShard(shard_table, keys, update_values, num);
+    return done();
+  }
   auto* table_ptr = GetTable(table_id);
 
   TableContext table_context;
@@ -12,6 +12,11 @@
 // limitations under the License.
 
 #pragma once
+#include <ThreadPool.h>
+
+#include <functional>
+#include <utility>
+
 #include "brpc/channel.h"
 #include "brpc/controller.h"
 #include "brpc/server.h"
@@ -21,6 +26,7 @@ namespace paddle {
 namespace distributed {
 
 class Table;
+class MemorySparseTable;
 
 class PsLocalClient : public PSClient {
  public:
@@ -232,6 +238,29 @@ class PsLocalClient : public PSClient {
   bool _flushing = false;
 
  private:
+  // Runs fn(shard_id, keys, num) for the shards of the keys of a request,
+  // the keys given as {key, index} pairs. The shards are grouped into tasks
+  // of at least FLAGS_pserver_local_min_keys_per_task keys on _shard_pool,
+  // the caller thread runs the first task and only waits for its own tasks.
+  void RunByShard(
+      MemorySparseTable* table,
+      const uint64_t* keys,
+      size_t num,
+      const std::function<void(int, const std::pair<uint64_t, int>*, size_t)>&
+          fn);
+  void PushSparseByShard(MemorySparseTable* table,
+                         const uint64_t* keys,
+                         const float** update_values,
+                         size_t num);
+  inline MemorySparseTable* GetShardTable(size_t table_id) {
+    auto itr = _shard_tables.find(table_id);
+    return itr == _shard_tables.end() ? nullptr : itr->second;
+  }
+
+  // the tables pulled and pushed shard by shard by the client
+  std::unordered_map<uint32_t, MemorySparseTable*> _shard_tables;
+  std::shared_ptr<::ThreadPool> _shard_pool;
+
   float _mae = 0;
   float _mse = 0;
   uint16_t _push_times = 0;
@@ -0,0 +1,149 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/distributed/ps/service/sparse_pull_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+namespace paddle {
+namespace distributed {
+
+SparsePullCache::SparsePullCache(size_t capacity_bytes,
+                                 size_t value_size,
+                                 uint32_t staleness,
+                                 bool lfu_admission)
+    : _dim(value_size / sizeof(float)),
+      _staleness(staleness),
+      _lfu_admission(lfu_admission),
+      _shards(new Shard[kShardNum]) {
+  _shard_capacity = std::max<size_t>(
+      capacity_bytes / (value_size + kEntryOverhead) / kShardNum, 1);
+  for (size_t i = 0; i < kShardNum; ++i) {
+    // the values are allocated as the shard fills up
+    _shards[i].sketch.Init(_shard_capacity);
+  }
+}
+
+size_t SparsePullCache::ShardOf(uint64_t key) {
+  // the feasigns of a slot may share the low bits, so mix them
+  return ((key * 0x9E3779B97F4A7C15ULL) >> 32) % kShardNum;
+}
+
+bool SparsePullCache::Get(uint64_t key, float *value) {
+  Shard &shard = _shards[ShardOf(key)];
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  shard.sketch.Increment(key);
+  auto it = shard.map.find(key);
+  if (it == shard.map.end()) {
+    ++shard.stat.miss;
+    return false;
+  }
+  Iter entry = it->second;
+  if (!Fresh(*entry)) {
+    Remove(&shard, entry);
+    ++shard.stat.expire;
+    ++shard.stat.miss;
+    return false;
+  }
+  ++shard.stat.hit;
+  shard.lru.splice(shard.lru.begin(), shard.lru, entry);
+  memcpy(value,
+         shard.values.data() + entry->slot * _dim,
+         _dim * sizeof(float));
+  return true;
+}
+
+void SparsePullCache::Put(uint64_t key, const float *value, uint64_t step) {
+  // a push may have gone out while the value was pulled
+  if (this->step() - step > _staleness) {
+    return;
+  }
+  Shard &shard = _shards[ShardOf(key)];
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.map.find(key);
+  Iter entry;
+  if (it != shard.map.end()) {
+    entry = it->second;
+    if (entry->step > step) {
+      return;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, entry);
+  } else {
+    size_t slot = 0;
+    if (!shard.free_slots.empty()) {
+      slot = shard.free_slots.back();
+      shard.free_slots.pop_back();
+    } else if (shard.map.size() < _shard_capacity) {
+      slot = shard.values.size() / _dim;
+      shard.values.resize(shard.values.size() + _dim);
+    } else {
+      Iter victim = std::prev(shard.lru.end());
+      if (_lfu_admission && Fresh(*victim) &&
+          shard.sketch.Frequency(key) <= shard.sketch.Frequency(victim->key)) {
+        ++shard.stat.reject;
+        return;
+      }
+      slot = victim->slot;
+      shard.map.erase(victim->key);
+      shard.lru.erase(victim);
+      ++shard.stat.evict;
+    }
+    shard.lru.push_front(Entry{key, step, slot});
+    entry = shard.lru.begin();
+    shard.map[key] = entry;
+  }
+  entry->step = step;
+  memcpy(shard.values.data() + entry->slot * _dim,
+         value,
+         _dim * sizeof(float));
+}
+
+void SparsePullCache::OnPush(const uint64_t *keys, size_t num) {
+  _step.fetch_add(1, std::memory_order_acq_rel);
+  for (size_t i = 0; i < num; ++i) {
+    Shard &shard = _shards[ShardOf(keys[i])];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.map.find(keys[i]);
+    if (it != shard.map.end() && !Fresh(*it->second)) {
+      Remove(&shard, it->second);
+      ++shard.stat.expire;
+    }
+  }
+}
+
+void SparsePullCache::Remove(Shard *shard, Iter entry) {
+  shard->free_slots.push_back(entry->slot);
+  shard->map.erase(entry->key);
+  shard->lru.erase(entry);
+}
+
+SparsePullCacheStat SparsePullCache::Stat() const {
+  SparsePullCacheStat stat;
+  for (size_t i = 0; i < kShardNum; ++i) {
+    Shard &shard = _shards[i];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    stat.hit += shard.stat.hit;
+    stat.miss += shard.stat.miss;
+    stat.expire += shard.stat.expire;
+    stat.evict += shard.stat.evict;
+    stat.reject += shard.stat.reject;
+    stat.entries += shard.map.size();
+  }
+  return stat;
+}
+
+}  // namespace distributed
+}  // namespace paddle
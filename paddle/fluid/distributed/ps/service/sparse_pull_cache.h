@@ -0,0 +1,113 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <unordered_map>
+#include <vector>
+
+#include "paddle/fluid/distributed/ps/table/depends/tiny_lfu_cache.h"
+
+namespace paddle {
+namespace distributed {
+
+struct SparsePullCacheStat {
+  uint64_t hit = 0;
+  uint64_t miss = 0;
+  uint64_t expire = 0;  // entries found but too stale
+  uint64_t evict = 0;   // entries dropped for a new one
+  uint64_t reject = 0;  // new entries dropped by the frequency filter
+  uint64_t entries = 0;
+
+  double hit_ratio() const {
+    return hit + miss == 0 ? 0.0 : static_cast<double>(hit) / (hit + miss);
+  }
+};
+
+// The pulled values of a sparse table, cached by a worker to serve the pulls
+// of hot feasigns without a round trip to the servers.
+//
+// A step of the cache is a push of the table by the worker, and a value is
+// served for staleness steps after the pull which fetched it, so it misses
+// the updates of at most staleness pushes of the worker. A push drops the
+// pushed feasigns that are out of the bound, the others expire when they
+// are read. The entries are in LRU order, and with lfu_admission a new
+// entry only replaces the LRU one of a full cache if the FrequencySketch
+// counts more reads of its feasign.
+//
+// Thread safe, the entries are sharded by feasign with a lock per shard.
+class SparsePullCache {
+ public:
+  SparsePullCache(size_t capacity_bytes,
+                  size_t value_size,
+                  uint32_t staleness,
+                  bool lfu_admission);
+
+  uint64_t step() const { return _step.load(std::memory_order_acquire); }
+
+  // copies the cached value of key into value, if it is not too stale
+  bool Get(uint64_t key, float *value);
+
+  // caches the value of key pulled at step
+  void Put(uint64_t key, const float *value, uint64_t step);
+
+  // a push of the keys, which starts the next step
+  void OnPush(const uint64_t *keys, size_t num);
+
+  SparsePullCacheStat Stat() const;
+
+ private:
+  static const size_t kShardNum = 64;
+  // bookkeeping bytes charged per entry on top of the value
+  static const size_t kEntryOverhead = 64;
+
+  struct Entry {
+    uint64_t key;
+    uint64_t step;
+    size_t slot;  // of the value in the values of the shard
+  };
+  typedef std::list<Entry>::iterator Iter;
+
+  struct Shard {
+    std::mutex mutex;
+    std::list<Entry> lru;  // front is the most recent
+    std::unordered_map<uint64_t, Iter> map;
+    std::vector<float> values;
+    std::vector<size_t> free_slots;
+    FrequencySketch sketch;
+    SparsePullCacheStat stat;
+  };
+
+  static size_t ShardOf(uint64_t key);
+  bool Fresh(const Entry &entry) const {
+    return step() - entry.step <= _staleness;
+  }
+  void Remove(Shard *shard, Iter entry);
+
+  size_t _dim;
+  size_t _shard_capacity;  // entries
+  uint32_t _staleness;
+  bool _lfu_admission;
+  std::atomic<uint64_t> _step{0};
+  std::unique_ptr<Shard[]> _shards;
+};
+
+}  // namespace distributed
+}  // namespace paddle
@@ -0,0 +1,163 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/distributed/ps/service/sparse_value_codec.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "paddle/phi/common/float16.h"
+
+namespace paddle {
+namespace distributed {
+
+namespace {
+
+// bfloat16 of the float rounded to the nearest even, phi::dtype::bfloat16
+// truncates on cpu
+inline uint16_t FloatToBF16(float value) {
+  uint32_t bits = 0;
+  memcpy(&bits, &value, sizeof(bits));
+  if ((bits & 0x7FFFFFFF) > 0x7F800000) {
+    // a quiet nan
+    return static_cast<uint16_t>((bits >> 16) | 0x40);
+  }
+  bits += 0x7FFF + ((bits >> 16) & 1);
+  return static_cast<uint16_t>(bits >> 16);
+}
+
+inline float BF16ToFloat(uint16_t value) {
+  uint32_t bits = static_cast<uint32_t>(value) << 16;
+  float result = 0;
+  memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+}  // namespace
+
+SparseValueCodec::SparseValueCodec(ValueCompressType type,
+                                   size_t dim,
+                                   size_t tail_dim)
+    : type_(type), dim_(dim), tail_dim_(std::min(tail_dim, dim)) {
+  head_dim_ = dim_ - tail_dim_;
+  encoded_size_ = head_dim_ * sizeof(float);
+  switch (type_) {
+    case VALUE_FP16:
+    case VALUE_BF16:
+      encoded_size_ += tail_dim_ * sizeof(uint16_t);
+      break;
+    case VALUE_INT8:
+      encoded_size_ += sizeof(float) + tail_dim_ * sizeof(int8_t);
+      break;
+    default:
+      type_ = VALUE_FP32;
+      encoded_size_ += tail_dim_ * sizeof(float);
+      break;
+  }
+}
+
+SparseValueCodec SparseValueCodec::ForPull(ValueAccessor *accessor) {
+  return ForPull(accessor,
+                 accessor->GetAccessorParameter().pull_compress_type());
+}
+
+SparseValueCodec SparseValueCodec::ForPull(ValueAccessor *accessor,
+                                           ValueCompressType type) {
+  return SparseValueCodec(
+      type,
+      accessor->GetAccessorInfo().select_size / sizeof(float),
+      accessor->GetAccessorParameter().embedx_dim());
+}
+
+SparseValueCodec SparseValueCodec::ForPush(ValueAccessor *accessor) {
+  return ForPush(accessor,
+                 accessor->GetAccessorParameter().push_compress_type());
+}
+
+SparseValueCodec SparseValueCodec::ForPush(ValueAccessor *accessor,
+                                           ValueCompressType type) {
+  return SparseValueCodec(
+      type,
+      accessor->GetAccessorInfo().update_size / sizeof(float),
+      accessor->GetAccessorParameter().embedx_dim());
+}
+
+void SparseValueCodec::Encode(const float *value, char *out) const {
+  if (type_ == VALUE_FP32) {
+    memcpy(out, value, dim_ * sizeof(float));
+    return;
+  }
+  memcpy(out, value, head_dim_ * sizeof(float));
+  out += head_dim_ * sizeof(float);
+  const float *tail = value + head_dim_;
+  if (type_ == VALUE_FP16) {
+    uint16_t *dst = reinterpret_cast<uint16_t *>(out);
+    for (size_t i = 0; i < tail_dim_; ++i) {
+      dst[i] = phi::dtype::float16(tail[i]).x;
+    }
+  } else if (type_ == VALUE_BF16) {
+    uint16_t *dst = reinterpret_cast<uint16_t *>(out);
+    for (size_t i = 0; i < tail_dim_; ++i) {
+      dst[i] = FloatToBF16(tail[i]);
+    }
+  } else {
+    float max_abs = 0;
+    for (size_t i = 0; i < tail_dim_; ++i) {
+      max_abs = std::max(max_abs, std::fabs(tail[i]));
+    }
+    float scale = max_abs / 127;
+    memcpy(out, &scale, sizeof(scale));
+    int8_t *dst = reinterpret_cast<int8_t *>(out + sizeof(scale));
+    float inv_scale = scale > 0 ? 1 / scale : 0;
+    for (size_t i = 0; i < tail_dim_; ++i) {
+      // rounds half away from zero, which vectorizes unlike lrint
+      float q = tail[i] * inv_scale;
+      dst[i] = static_cast<int8_t>(q + (q < 0 ? -0.5f : 0.5f));
+    }
+  }
+}
+
+void SparseValueCodec::Decode(const char *data, float *value) const {
+  if (type_ == VALUE_FP32) {
+    memcpy(value, data, dim_ * sizeof(float));
+    return;
+  }
+  memcpy(value, data, head_dim_ * sizeof(float));
+  data += head_dim_ * sizeof(float);
+  float *tail = value + head_dim_;
+  if (type_ == VALUE_FP16) {
+    const uint16_t *src = reinterpret_cast<const uint16_t *>(data);
+    for (size_t i = 0; i < tail_dim_; ++i) {
+      phi::dtype::float16 half;
+      half.x = src[i];
+      tail[i] = static_cast<float>(half);
+    }
+  } else if (type_ == VALUE_BF16) {
+    const uint16_t *src = reinterpret_cast<const uint16_t *>(data);
+    for (size_t i = 0; i < tail_dim_; ++i) {
+      tail[i] = BF16ToFloat(src[i]);
+    }
+  } else {
+    float scale = 0;
+    memcpy(&scale, data, sizeof(scale));
+    const int8_t *src = reinterpret_cast<const int8_t *>(data + sizeof(scale));
+    for (size_t i = 0; i < tail_dim_; ++i) {
+      tail[i] = src[i] * scale;
+    }
+  }
+}
+
+}  // namespace distributed
+}  // namespace paddle
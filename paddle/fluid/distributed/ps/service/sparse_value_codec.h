@@ -0,0 +1,73 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <cstddef>
+
+#include "paddle/fluid/distributed/ps/table/accessor.h"
+#include "paddle/fluid/distributed/the_one_ps.pb.h"
+
+namespace paddle {
+namespace distributed {
+
+// The wire format of the rows of a sparse table, as pulled or pushed by
+// BrpcPsClient. A row of dim floats is sent as its head fields, such as
+// show and click, in float, and its embedx tail of tail_dim floats in the
+// compress type of the table accessor:
+//   VALUE_FP32  the floats as they are
+//   VALUE_FP16  IEEE half floats
+//   VALUE_BF16  bfloat16, rounded to the nearest
+//   VALUE_INT8  a float scale of max(|x|) / 127 and the int8 x / scale
+//
+// The client puts the type into the request, so a server decodes what it
+// gets and a server of an old version, which answers a pull in float, is
+// told by the type not echoed in the response. Such a server would read
+// compressed pushes as floats, so before the first push of a table the
+// client sends an empty push in its type and pushes in float unless every
+// server echoes the type.
+class SparseValueCodec {
+ public:
+  SparseValueCodec(ValueCompressType type, size_t dim, size_t tail_dim);
+
+  // the codecs of the pulled values and pushed gradients of the accessor
+  static SparseValueCodec ForPull(ValueAccessor *accessor);
+  static SparseValueCodec ForPull(ValueAccessor *accessor,
+                                  ValueCompressType type);
+  static SparseValueCodec ForPush(ValueAccessor *accessor);
+  static SparseValueCodec ForPush(ValueAccessor *accessor,
+                                  ValueCompressType type);
+
+  ValueCompressType type() const { return type_; }
+  bool compressed() const { return type_ != VALUE_FP32; }
+
+  // the bytes of a row decoded and encoded
+  size_t value_size() const { return dim_ * sizeof(float); }
+  size_t encoded_size() const { return encoded_size_; }
+
+  void Encode(const float *value, char *out) const;
+  void Decode(const char *data, float *value) const;
+
+ private:
+  ValueCompressType type_;
+  size_t dim_;
+  size_t head_dim_;
+  size_t tail_dim_;
+  size_t encoded_size_;
+};
+
+}  // namespace distributed
+}  // namespace paddle
@@ -91,6 +91,10 @@ class ValueAccessor {
 
   virtual AccessorInfo GetAccessorInfo() { return _accessor_info; }
 
+  const TableAccessorParameter& GetAccessorParameter() const {
+    return _config;
+  }
+
   virtual bool NeedExtendMF(float* value) { return false; }
   virtual bool HasMF(size_t size) { return false; }
   // converter for save
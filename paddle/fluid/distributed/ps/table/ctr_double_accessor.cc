@@ -251,40 +251,54 @@ int32_t CtrDoubleAccessor::Merge(float** update_values,
 int32_t CtrDoubleAccessor::Update(float** update_values,
                                   const float** push_values,
                                   size_t num) {
-  for (size_t value_item = 0; value_item < num; ++value_item) {
-    float* update_value = update_values[value_item];
-    const float* push_value = push_values[value_item];
-    float push_show = push_value[CtrDoublePushValue::ShowIndex()];
-    float push_click = push_value[CtrDoublePushValue::ClickIndex()];
-    float slot = push_value[CtrDoublePushValue::SlotIndex()];
-    *reinterpret_cast<double*>(update_value +
-                               CtrDoubleFeatureValue::ShowIndex()) +=
-        static_cast<double>(push_show);
-    *reinterpret_cast<double*>(update_value +
-                               CtrDoubleFeatureValue::ClickIndex()) +=
-        static_cast<double>(push_click);
-    update_value[CtrDoubleFeatureValue::SlotIndex()] = slot;
-    update_value[CtrDoubleFeatureValue::DeltaScoreIndex()] +=
-        (push_show - push_click) * _config.ctr_accessor_param().nonclk_coeff() +
-        push_click * _config.ctr_accessor_param().click_coeff();
-    // (push_show - push_click) * _config.ctr_accessor_param().nonclk_coeff() +
-    // push_click * _config.ctr_accessor_param().click_coeff();
-    update_value[CtrDoubleFeatureValue::UnseenDaysIndex()] = 0;
-    if (!_show_scale) {
-      push_show = 1;
+  const size_t batch_size = SparseValueSGDRule::kUpdateBatchSize;
+  float push_shows[batch_size];
+  for (size_t begin = 0; begin < num; begin += batch_size) {
+    size_t batch = num - begin < batch_size ? num - begin : batch_size;
+    for (size_t item = 0; item < batch; ++item) {
+      float* update_value = update_values[begin + item];
+      const float* push_value = push_values[begin + item];
+      float push_show = push_value[CtrDoublePushValue::ShowIndex()];
+      float push_click = push_value[CtrDoublePushValue::ClickIndex()];
+      float slot = push_value[CtrDoublePushValue::SlotIndex()];
+      *reinterpret_cast<double*>(update_value +
+                                 CtrDoubleFeatureValue::ShowIndex()) +=
+          static_cast<double>(push_show);
+      *reinterpret_cast<double*>(update_value +
+                                 CtrDoubleFeatureValue::ClickIndex()) +=
+          static_cast<double>(push_click);
+      update_value[CtrDoubleFeatureValue::SlotIndex()] = slot;
+      update_value[CtrDoubleFeatureValue::DeltaScoreIndex()] +=
+          (push_show - push_click) *
+              _config.ctr_accessor_param().nonclk_coeff() +
+          push_click * _config.ctr_accessor_param().click_coeff();
+      // (push_show - push_click) *
+      //     _config.ctr_accessor_param().nonclk_coeff() +
+      // push_click * _config.ctr_accessor_param().click_coeff();
+      update_value[CtrDoubleFeatureValue::UnseenDaysIndex()] = 0;
+      if (!_show_scale) {
+        push_show = 1;
+      }
+      VLOG(3) << "accessor show scale:" << _show_scale
+              << ", push_show:" << push_show;
+      push_shows[item] = push_show;
     }
-    VLOG(3) << "accessor show scale:" << _show_scale
-            << ", push_show:" << push_show;
-    _embed_sgd_rule->UpdateValue(
-        update_value + CtrDoubleFeatureValue::EmbedWIndex(),
-        update_value + CtrDoubleFeatureValue::EmbedG2SumIndex(),
-        push_value + CtrDoublePushValue::EmbedGIndex(),
-        push_show);
-    _embedx_sgd_rule->UpdateValue(
-        update_value + CtrDoubleFeatureValue::EmbedxWIndex(),
-        update_value + CtrDoubleFeatureValue::EmbedxG2SumIndex(),
-        push_value + CtrDoublePushValue::EmbedxGIndex(),
-        push_show);
+    _embed_sgd_rule->UpdateValueBatch(
+        update_values + begin,
+        CtrDoubleFeatureValue::EmbedWIndex(),
+        CtrDoubleFeatureValue::EmbedG2SumIndex(),
+        push_values + begin,
+        CtrDoublePushValue::EmbedGIndex(),
+        push_shows,
+        batch);
+    _embedx_sgd_rule->UpdateValueBatch(
+        update_values + begin,
+        CtrDoubleFeatureValue::EmbedxWIndex(),
+        CtrDoubleFeatureValue::EmbedxG2SumIndex(),
+        push_values + begin,
+        CtrDoublePushValue::EmbedxGIndex(),
+        push_shows,
+        batch);
   }
   return 0;
 }
@@ -14,11 +14,14 @@
 
 #pragma once
 
+#include <string.h>
+
 #include <mct/hash-map.hpp>
 #include <vector>
 
 #include "gflags/gflags.h"
 #include "paddle/fluid/distributed/common/chunk_allocator.h"
+#include "paddle/fluid/distributed/ps/table/depends/feature_value_arena.h"
 
 namespace paddle {
 namespace distributed {
@@ -27,19 +30,95 @@ static const int CTR_SPARSE_SHARD_BUCKET_NUM_BITS = 6;
 static const size_t CTR_SPARSE_SHARD_BUCKET_NUM =
     static_cast<size_t>(1) << CTR_SPARSE_SHARD_BUCKET_NUM_BITS;
 
+// The payload lives in the owning shard's FeatureValueArena once the value
+// is bound to it (SparseTableShard does this on insertion); unbound values,
+// e.g. temporaries, use malloc. The block always matches size() exactly, so
+// resize reallocates within the arena instead of keeping vector-like slack.
 class FixedFeatureValue {
  public:
   FixedFeatureValue() {}
-  ~FixedFeatureValue() {}
-  float* data() { return _data.data(); }
-  size_t size() { return _data.size(); }
-  void resize(size_t size) { _data.resize(size); }
-  void shrink_to_fit() { _data.shrink_to_fit(); }
+  FixedFeatureValue(const FixedFeatureValue& other) { *this = other; }
+  FixedFeatureValue& operator=(const FixedFeatureValue& other) {
+    if (this != &other) {
+      Reallocate(other._size, 0);
+      if (_size > 0) {
+        memcpy(_data, other._data, _size * sizeof(float));
+      }
+    }
+    return *this;
+  }
+  ~FixedFeatureValue() { Free(); }
+  float* data() { return _data; }
+  size_t size() { return _size; }
+  // Keeps the first min(size, new size) floats and zero-fills the rest.
+  void resize(size_t size) {
+    if (size != _size) {
+      Reallocate(size, _size < size ? _size : size);
+    }
+  }
+  void shrink_to_fit() {}
+  // Moves the payload into `arena`; nullptr switches back to malloc.
+  void set_arena(FeatureValueArena* arena) {
+    if (arena == _arena) {
+      return;
+    }
+    float* old_data = _data;
+    FeatureValueArena* old_arena = _arena;
+    _arena = arena;
+    _data = Alloc(_size);
+    if (_size > 0) {
+      memcpy(_data, old_data, _size * sizeof(float));
+    }
+    Free(old_arena, old_data, _size);
+  }
 
  private:
-  std::vector<float> _data;
+  float* Alloc(size_t size) {
+    if (size == 0) {
+      return nullptr;
+    }
+    return _arena != nullptr
+               ? _arena->Acquire(size)
+               : static_cast<float*>(malloc(size * sizeof(float)));
+  }
+  static void Free(FeatureValueArena* arena, float* data, size_t size) {
+    if (arena != nullptr) {
+      arena->Release(data, size);
+    } else {
+      free(data);
+    }
+  }
+  void Free() {
+    Free(_arena, _data, _size);
+    _data = nullptr;
+    _size = 0;
+  }
+  void Reallocate(size_t size, size_t keep) {
+    float* new_data = Alloc(size);
+    if (keep > 0) {
+      memcpy(new_data, _data, keep * sizeof(float));
+    }
+    if (size > keep) {
+      memset(new_data + keep, 0, (size - keep) * sizeof(float));
+    }
+    Free();
+    _data = new_data;
+    _size = static_cast<uint32_t>(size);
+  }
+
+  float* _data = nullptr;
+  uint32_t _size = 0;
+  FeatureValueArena* _arena = nullptr;
 };
 
+// Binds freshly inserted values to the shard arena; a no-op for value types
+// that do not use one.
+template <class VALUE>
+inline void BindValueArena(VALUE* value, FeatureValueArena* arena) {}
+inline void BindValueArena(FixedFeatureValue* value, FeatureValueArena* arena) {
+  value->set_arena(arena);
+}
+
 template <class KEY, class VALUE>
 struct alignas(64) SparseTableShard {
  public:
@@ -149,7 +228,9 @@ struct alignas(64) SparseTableShard {
     auto res = _buckets[bucket].insert_with_hash({key, NULL}, hash);
 
     if (res.second) {
-      res.first->second = _alloc.acquire(std::forward<ARGS>(args)...);
+      VALUE* value = _alloc.acquire(std::forward<ARGS>(args)...);
+      BindValueArena(value, &_value_arena);
+      res.first->second = value;
     }
 
     return {{res.first, bucket, _buckets}, res.second};
@@ -184,6 +265,9 @@ struct alignas(64) SparseTableShard {
     quick_erase(it);
     return 1;
   }
+  // Returns slabs emptied by erase to the system, see FeatureValueArena.
+  size_t reclaim() { return _value_arena.Reclaim(); }
+  FeatureValueArenaStat arena_stat() { return _value_arena.Stat(); }
   size_t compute_bucket(size_t hash) {
     if (CTR_SPARSE_SHARD_BUCKET_NUM == 1) {
       return 0;
@@ -194,6 +278,8 @@ struct alignas(64) SparseTableShard {
 
  private:
   map_type _buckets[CTR_SPARSE_SHARD_BUCKET_NUM];
+  // declared before _alloc so that it outlives the values using it
+  FeatureValueArena _value_arena;
   ChunkAllocator<VALUE> _alloc;
   std::hash<KEY> _hasher;
 };
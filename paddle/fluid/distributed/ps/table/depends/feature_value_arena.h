@@ -0,0 +1,248 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <vector>
+
+#include "glog/logging.h"
+
+namespace paddle {
+namespace distributed {
+
+struct FeatureValueArenaStat {
+  size_t slab_num = 0;
+  size_t slab_bytes = 0;  // bytes obtained from the system
+  size_t used_bytes = 0;  // bytes handed out to live values
+  size_t value_num = 0;   // live values served by the arena
+  size_t huge_bytes = 0;  // values too large for a size class
+  size_t huge_num = 0;
+
+  FeatureValueArenaStat& operator+=(const FeatureValueArenaStat& other) {
+    slab_num += other.slab_num;
+    slab_bytes += other.slab_bytes;
+    used_bytes += other.used_bytes;
+    value_num += other.value_num;
+    huge_bytes += other.huge_bytes;
+    huge_num += other.huge_num;
+    return *this;
+  }
+  // occupancy of the slabs, 1.0 means no internal free space
+  double occupancy() const {
+    return slab_bytes == 0 ? 0.0 : static_cast<double>(used_bytes) / slab_bytes;
+  }
+};
+
+// Slab arena for the float payloads of FixedFeatureValue, one per shard.
+//
+// Payloads are grouped into size classes keyed by their exact float count,
+// which keeps the few distinct value dims of CtrDymfAccessor (one per mf_dim)
+// free of padding. Each class carves fixed-size blocks out of slabs aligned
+// to kSlabBytes, so the owning slab (and its live count) is found by masking
+// the block address. Released blocks go to a per-class free list; Reclaim()
+// returns every slab without live blocks to the system in one pass, which is
+// what MemorySparseTable::Shrink calls after erasing features.
+//
+// A shard is normally touched only by its own task pool thread, but gpups
+// dumps resize values of one shard from several threads, so Acquire/Release
+// take a spin lock that is uncontended in the common case.
+class FeatureValueArena {
+ public:
+  static const size_t kSlabBytes = 256 * 1024;
+  // larger payloads fall back to malloc
+  static const size_t kMaxClassDim = 4096;
+
+  FeatureValueArena() {}
+  FeatureValueArena(const FeatureValueArena&) = delete;
+  FeatureValueArena& operator=(const FeatureValueArena&) = delete;
+  ~FeatureValueArena() {
+    for (auto& size_class : _classes) {
+      Slab* slab = size_class.slabs;
+      while (slab != nullptr) {
+        Slab* next = slab->next;
+        free(slab);
+        slab = next;
+      }
+    }
+  }
+
+  float* Acquire(size_t dim) {
+    if (dim == 0) {
+      return nullptr;
+    }
+    if (dim > kMaxClassDim) {
+      Lock();
+      _huge_bytes += dim * sizeof(float);
+      ++_huge_num;
+      Unlock();
+      return static_cast<float*>(malloc(dim * sizeof(float)));
+    }
+    Lock();
+    SizeClass& size_class = GetClass(dim);
+    if (size_class.free_list == nullptr) {
+      NewSlab(dim, &size_class);
+    }
+    FreeNode* node = size_class.free_list;
+    size_class.free_list = node->next;
+    ++SlabOf(node)->live;
+    ++size_class.live;
+    Unlock();
+    return reinterpret_cast<float*>(node);
+  }
+
+  void Release(float* data, size_t dim) {
+    if (data == nullptr) {
+      return;
+    }
+    if (dim > kMaxClassDim) {
+      Lock();
+      _huge_bytes -= dim * sizeof(float);
+      --_huge_num;
+      Unlock();
+      free(data);
+      return;
+    }
+    Lock();
+    SizeClass& size_class = _classes[dim];
+    FreeNode* node = reinterpret_cast<FreeNode*>(data);
+    node->next = size_class.free_list;
+    size_class.free_list = node;
+    --SlabOf(node)->live;
+    --size_class.live;
+    Unlock();
+  }
+
+  // Frees every slab that has no live block and returns the freed bytes.
+  size_t Reclaim() {
+    Lock();
+    size_t freed = 0;
+    for (auto& size_class : _classes) {
+      if (size_class.slabs == nullptr) {
+        continue;
+      }
+      // drop free blocks that live in empty slabs
+      FreeNode** link = &size_class.free_list;
+      while (*link != nullptr) {
+        if (SlabOf(*link)->live == 0) {
+          *link = (*link)->next;
+        } else {
+          link = &(*link)->next;
+        }
+      }
+      Slab** slab_link = &size_class.slabs;
+      while (*slab_link != nullptr) {
+        Slab* slab = *slab_link;
+        if (slab->live == 0) {
+          *slab_link = slab->next;
+          free(slab);
+          --size_class.slab_num;
+          freed += kSlabBytes;
+        } else {
+          slab_link = &slab->next;
+        }
+      }
+    }
+    Unlock();
+    return freed;
+  }
+
+  FeatureValueArenaStat Stat() {
+    FeatureValueArenaStat stat;
+    Lock();
+    for (size_t dim = 0; dim < _classes.size(); ++dim) {
+      const SizeClass& size_class = _classes[dim];
+      stat.slab_num += size_class.slab_num;
+      stat.used_bytes += size_class.live * BlockBytes(dim);
+      stat.value_num += size_class.live;
+    }
+    stat.slab_bytes = stat.slab_num * kSlabBytes;
+    stat.huge_bytes = _huge_bytes;
+    stat.huge_num = _huge_num;
+    Unlock();
+    return stat;
+  }
+
+ private:
+  struct FreeNode {
+    FreeNode* next;
+  };
+  struct Slab {
+    Slab* next;
+    size_t live;
+  };
+  struct SizeClass {
+    FreeNode* free_list = nullptr;
+    Slab* slabs = nullptr;
+    size_t slab_num = 0;
+    size_t live = 0;
+  };
+
+  // blocks hold at least a free-list pointer and stay 8-byte aligned
+  static size_t BlockBytes(size_t dim) {
+    size_t bytes = dim * sizeof(float);
+    bytes = bytes < sizeof(FreeNode) ? sizeof(FreeNode) : bytes;
+    return (bytes + 7) / 8 * 8;
+  }
+
+  static Slab* SlabOf(const void* ptr) {
+    return reinterpret_cast<Slab*>(reinterpret_cast<uintptr_t>(ptr) &
+                                   ~(static_cast<uintptr_t>(kSlabBytes) - 1));
+  }
+
+  void Lock() {
+    while (_lock.test_and_set(std::memory_order_acquire)) {
+    }
+  }
+  void Unlock() { _lock.clear(std::memory_order_release); }
+
+  SizeClass& GetClass(size_t dim) {
+    if (dim >= _classes.size()) {
+      _classes.resize(dim + 1);
+    }
+    return _classes[dim];
+  }
+
+  void NewSlab(size_t dim, SizeClass* size_class) {
+    void* ptr = nullptr;
+    CHECK_EQ(posix_memalign(&ptr, kSlabBytes, kSlabBytes), 0)
+        << "FeatureValueArena alloc slab failed";
+    Slab* slab = static_cast<Slab*>(ptr);
+    slab->next = size_class->slabs;
+    slab->live = 0;
+    size_class->slabs = slab;
+    ++size_class->slab_num;
+
+    size_t block_bytes = BlockBytes(dim);
+    char* begin = static_cast<char*>(ptr) + (sizeof(Slab) + 7) / 8 * 8;
+    char* end = static_cast<char*>(ptr) + kSlabBytes;
+    for (char* block = begin; block + block_bytes <= end;
+         block += block_bytes) {
+      FreeNode* node = reinterpret_cast<FreeNode*>(block);
+      node->next = size_class->free_list;
+      size_class->free_list = node;
+    }
+  }
+
+  std::atomic_flag _lock = ATOMIC_FLAG_INIT;
+  std::vector<SizeClass> _classes;
+  size_t _huge_bytes = 0;
+  size_t _huge_num = 0;
+};
+
+}  // namespace distributed
+}  // namespace paddle
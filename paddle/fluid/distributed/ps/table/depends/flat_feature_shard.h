@@ -0,0 +1,438 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "glog/logging.h"
+#include "paddle/fluid/distributed/ps/table/depends/feature_value.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace paddle {
+namespace distributed {
+
+// Reader-writer spin lock for one bucket of FlatSparseTableShard. Readers
+// only bump a counter, so concurrent pulls of one bucket never block each
+// other; a writer waits until the counter drains.
+class FlatBucketLock {
+ public:
+  FlatBucketLock() : _state(0) {}
+  FlatBucketLock(const FlatBucketLock&) = delete;
+  FlatBucketLock& operator=(const FlatBucketLock&) = delete;
+
+  void lock_shared() {
+    for (int loop = 0;; ++loop) {
+      int32_t state = _state.load(std::memory_order_relaxed);
+      if (state >= 0 && _state.compare_exchange_weak(
+                            state, state + 1, std::memory_order_acquire)) {
+        return;
+      }
+      Relax(loop);
+    }
+  }
+  void unlock_shared() { _state.fetch_sub(1, std::memory_order_release); }
+
+  void lock() {
+    for (int loop = 0;; ++loop) {
+      int32_t state = 0;
+      if (_state.compare_exchange_weak(
+              state, -1, std::memory_order_acquire)) {
+        return;
+      }
+      Relax(loop);
+    }
+  }
+  void unlock() { _state.store(0, std::memory_order_release); }
+
+ private:
+  static void Relax(int loop) {
+    if (loop < 64) {
+#if defined(__x86_64__) || defined(__i386__)
+      _mm_pause();
+#endif
+    } else {
+      std::this_thread::yield();
+    }
+  }
+
+  std::atomic<int32_t> _state;  // -1: writer, >0: readers
+};
+
+// Open-addressing sparse shard that keeps every value inline in a 64-byte
+// aligned slab instead of behind a per-feature heap allocation.
+//
+// The shard is split into CTR_SPARSE_SHARD_BUCKET_NUM buckets, each an
+// independent linear-probing table with its own FlatBucketLock. Lookups take
+// the bucket lock shared, inserts/updates/erases take it exclusively, so a
+// shard can be served by any number of threads at once. Every row reserves
+// `value_dim` floats (the accessor's full value size) and records how many of
+// them are in use, which keeps the mf-extension semantics of
+// FixedFeatureValue without reallocating.
+//
+// Rows move when a bucket grows or when an erase back-shifts a probe chain,
+// so value pointers are only valid while the bucket lock is held: all
+// accesses go through the callback-style methods below.
+template <class KEY>
+class FlatSparseTableShard {
+ public:
+  static const size_t kSlabAlign = 64;
+
+  FlatSparseTableShard() {}
+  FlatSparseTableShard(const FlatSparseTableShard&) = delete;
+  FlatSparseTableShard& operator=(const FlatSparseTableShard&) = delete;
+  ~FlatSparseTableShard() {
+    for (size_t bucket = 0; bucket < CTR_SPARSE_SHARD_BUCKET_NUM; ++bucket) {
+      _buckets[bucket].Release();
+    }
+  }
+
+  // Must be called once before the shard is used.
+  void Init(size_t value_dim, size_t init_bucket_capacity = 64) {
+    CHECK(value_dim > 0);
+    _value_dim = value_dim;
+    // pad rows to 16 bytes so that every row starts SIMD-aligned
+    _row_stride = (value_dim + 3) / 4 * 4;
+    size_t capacity = 16;
+    while (capacity < init_bucket_capacity) {
+      capacity <<= 1;
+    }
+    _init_capacity = capacity;
+    for (size_t bucket = 0; bucket < CTR_SPARSE_SHARD_BUCKET_NUM; ++bucket) {
+      _buckets[bucket].Allocate(_init_capacity, _row_stride);
+    }
+  }
+
+  void set_max_load_factor(float x) {
+    CHECK(x > 0.0f && x < 1.0f);
+    _max_load_factor = x;
+  }
+
+  size_t value_dim() const { return _value_dim; }
+  size_t bucket_count() const { return CTR_SPARSE_SHARD_BUCKET_NUM; }
+  size_t bucket_size(size_t bucket) const { return _buckets[bucket].size; }
+
+  // Unsynchronized sum of bucket sizes; exact when no writer is active.
+  size_t size() const {
+    size_t total = 0;
+    for (size_t bucket = 0; bucket < CTR_SPARSE_SHARD_BUCKET_NUM; ++bucket) {
+      total += _buckets[bucket].size;
+    }
+    return total;
+  }
+  bool empty() const { return size() == 0; }
+
+  // Bytes held by the slot and value arrays of all buckets.
+  size_t memory_bytes() const {
+    size_t total = 0;
+    for (size_t bucket = 0; bucket < CTR_SPARSE_SHARD_BUCKET_NUM; ++bucket) {
+      total += _buckets[bucket].capacity *
+               (sizeof(Slot) + _row_stride * sizeof(float));
+    }
+    return total;
+  }
+
+  // Calls fn(const float* value, size_t dim) under the shared bucket lock.
+  // Returns false if the key is absent.
+  template <class FN>
+  bool Read(const KEY& key, FN&& fn) {
+    size_t hash = Hash(key);
+    Bucket& bucket = _buckets[ComputeBucket(hash)];
+    bucket.lock.lock_shared();
+    size_t pos = bucket.Find(key, hash);
+    bool found = pos != Bucket::kNotFound;
+    if (found) {
+      fn(static_cast<const float*>(bucket.Row(pos, _row_stride)),
+         static_cast<size_t>(bucket.slots[pos].dim));
+    }
+    bucket.lock.unlock_shared();
+    return found;
+  }
+
+  // Calls fn(float* value, uint32_t* dim) under the exclusive bucket lock.
+  // When the key is absent, create(float* value) is called first on a zeroed
+  // row and must return the initial dim; returning 0 skips the insertion and
+  // fn is not called. Returns true if fn was called.
+  template <class CREATE, class FN>
+  bool Upsert(const KEY& key, CREATE&& create, FN&& fn) {
+    size_t hash = Hash(key);
+    Bucket& bucket = _buckets[ComputeBucket(hash)];
+    bucket.lock.lock();
+    size_t pos = bucket.Find(key, hash);
+    if (pos == Bucket::kNotFound) {
+      if (bucket.size + 1 > bucket.capacity * _max_load_factor) {
+        bucket.Grow(_row_stride);
+      }
+      pos = bucket.ProbeEmpty(hash);
+      float* row = bucket.Row(pos, _row_stride);
+      memset(row, 0, _row_stride * sizeof(float));
+      size_t dim = create(row);
+      if (dim == 0) {
+        bucket.lock.unlock();
+        return false;
+      }
+      CHECK(dim <= _value_dim);
+      bucket.slots[pos].key = key;
+      bucket.slots[pos].dim = static_cast<uint32_t>(dim);
+      ++bucket.size;
+    }
+    fn(bucket.Row(pos, _row_stride), &bucket.slots[pos].dim);
+    bucket.lock.unlock();
+    return true;
+  }
+
+  size_t Erase(const KEY& key) {
+    size_t hash = Hash(key);
+    Bucket& bucket = _buckets[ComputeBucket(hash)];
+    bucket.lock.lock();
+    size_t pos = bucket.Find(key, hash);
+    size_t erased = 0;
+    if (pos != Bucket::kNotFound) {
+      bucket.EraseAt(pos, _row_stride);
+      erased = 1;
+    }
+    bucket.lock.unlock();
+    return erased;
+  }
+
+  // Visits every row of one bucket under the exclusive bucket lock with
+  // fn(const KEY& key, float* value, uint32_t* dim).
+  template <class FN>
+  void ForEach(size_t bucket_idx, FN&& fn) {
+    Bucket& bucket = _buckets[bucket_idx];
+    bucket.lock.lock();
+    for (size_t pos = 0; pos < bucket.capacity; ++pos) {
+      if (bucket.slots[pos].dim != 0) {
+        fn(bucket.slots[pos].key,
+           bucket.Row(pos, _row_stride),
+           &bucket.slots[pos].dim);
+      }
+    }
+    bucket.lock.unlock();
+  }
+
+  // Copies the rows of one bucket under the shared bucket lock, so that they
+  // can be visited after without holding it, e.g. while writing a file. The
+  // i-th row has key (*keys)[i] and the (*dims)[i] floats at
+  // values->data() + i * value_dim().
+  void Snapshot(size_t bucket_idx,
+                std::vector<KEY>* keys,
+                std::vector<uint32_t>* dims,
+                std::vector<float>* values) {
+    Bucket& bucket = _buckets[bucket_idx];
+    bucket.lock.lock_shared();
+    keys->resize(bucket.size);
+    dims->resize(bucket.size);
+    values->resize(bucket.size * _value_dim);
+    size_t i = 0;
+    for (size_t pos = 0; pos < bucket.capacity; ++pos) {
+      if (bucket.slots[pos].dim != 0) {
+        (*keys)[i] = bucket.slots[pos].key;
+        (*dims)[i] = bucket.slots[pos].dim;
+        memcpy(values->data() + i * _value_dim,
+               bucket.Row(pos, _row_stride),
+               bucket.slots[pos].dim * sizeof(float));
+        ++i;
+      }
+    }
+    bucket.lock.unlock_shared();
+  }
+
+  template <class FN>
+  void ForEach(FN&& fn) {
+    for (size_t bucket = 0; bucket < CTR_SPARSE_SHARD_BUCKET_NUM; ++bucket) {
+      ForEach(bucket, fn);
+    }
+  }
+
+  // Removes every row of one bucket for which pred(value, dim) is true and
+  // returns how many rows were removed. pred is called exactly once per row,
+  // so it may update the value (e.g. decay show/click during shrink).
+  template <class PRED>
+  size_t EraseIf(size_t bucket_idx, PRED&& pred) {
+    Bucket& bucket = _buckets[bucket_idx];
+    bucket.lock.lock();
+    // back-shifting moves rows around, so pick victims first
+    std::vector<KEY> victims;
+    for (size_t pos = 0; pos < bucket.capacity; ++pos) {
+      if (bucket.slots[pos].dim != 0 &&
+          pred(bucket.Row(pos, _row_stride),
+               static_cast<size_t>(bucket.slots[pos].dim))) {
+        victims.push_back(bucket.slots[pos].key);
+      }
+    }
+    for (auto& key : victims) {
+      bucket.EraseAt(bucket.Find(key, Hash(key)), _row_stride);
+    }
+    bucket.lock.unlock();
+    return victims.size();
+  }
+
+  template <class PRED>
+  size_t EraseIf(PRED&& pred) {
+    size_t erased = 0;
+    for (size_t bucket = 0; bucket < CTR_SPARSE_SHARD_BUCKET_NUM; ++bucket) {
+      erased += EraseIf(bucket, pred);
+    }
+    return erased;
+  }
+
+  void clear() {
+    for (size_t bucket = 0; bucket < CTR_SPARSE_SHARD_BUCKET_NUM; ++bucket) {
+      Bucket& b = _buckets[bucket];
+      b.lock.lock();
+      b.Release();
+      b.Allocate(_init_capacity, _row_stride);
+      b.lock.unlock();
+    }
+  }
+
+ private:
+  struct Slot {
+    KEY key;
+    uint32_t dim;  // 0 marks an empty slot
+  };
+
+  struct alignas(64) Bucket {
+    static const size_t kNotFound = static_cast<size_t>(-1);
+
+    FlatBucketLock lock;
+    Slot* slots = nullptr;
+    float* values = nullptr;
+    size_t capacity = 0;  // power of two
+    size_t size = 0;
+
+    float* Row(size_t pos, size_t stride) { return values + pos * stride; }
+
+    void Allocate(size_t cap, size_t stride) {
+      slots = static_cast<Slot*>(calloc(cap, sizeof(Slot)));
+      void* ptr = nullptr;
+      CHECK_EQ(posix_memalign(&ptr, kSlabAlign, cap * stride * sizeof(float)),
+               0)
+          << "FlatSparseTableShard alloc failed, capacity: " << cap;
+      CHECK(slots != nullptr);
+      values = static_cast<float*>(ptr);
+      capacity = cap;
+      size = 0;
+    }
+
+    void Release() {
+      free(slots);
+      free(values);
+      slots = nullptr;
+      values = nullptr;
+      capacity = 0;
+      size = 0;
+    }
+
+    size_t Find(const KEY& key, size_t hash) const {
+      size_t mask = capacity - 1;
+      for (size_t pos = hash & mask;; pos = (pos + 1) & mask) {
+        if (slots[pos].dim == 0) {
+          return kNotFound;
+        }
+        if (slots[pos].key == key) {
+          return pos;
+        }
+      }
+    }
+
+    size_t ProbeEmpty(size_t hash) const {
+      size_t mask = capacity - 1;
+      size_t pos = hash & mask;
+      while (slots[pos].dim != 0) {
+        pos = (pos + 1) & mask;
+      }
+      return pos;
+    }
+
+    void Grow(size_t stride) {
+      Slot* old_slots = slots;
+      float* old_values = values;
+      size_t old_capacity = capacity;
+      size_t old_size = size;
+      Allocate(old_capacity * 2, stride);
+      for (size_t pos = 0; pos < old_capacity; ++pos) {
+        if (old_slots[pos].dim == 0) {
+          continue;
+        }
+        size_t new_pos = ProbeEmpty(Hash(old_slots[pos].key));
+        slots[new_pos] = old_slots[pos];
+        memcpy(Row(new_pos, stride),
+               old_values + pos * stride,
+               stride * sizeof(float));
+      }
+      size = old_size;
+      free(old_slots);
+      free(old_values);
+    }
+
+    // Backward-shift deletion keeps probe chains intact without tombstones.
+    void EraseAt(size_t pos, size_t stride) {
+      size_t mask = capacity - 1;
+      size_t hole = pos;
+      for (size_t next = (hole + 1) & mask; slots[next].dim != 0;
+           next = (next + 1) & mask) {
+        size_t home = Hash(slots[next].key) & mask;
+        // move `next` into the hole unless its home lies in (hole, next]
+        bool in_range = hole <= next ? (hole < home && home <= next)
+                                     : (hole < home || home <= next);
+        if (!in_range) {
+          slots[hole] = slots[next];
+          memcpy(Row(hole, stride), Row(next, stride), stride * sizeof(float));
+          hole = next;
+        }
+      }
+      slots[hole].dim = 0;
+      --size;
+    }
+  };
+
+  // feasigns are often small or sequential integers, so mix all bits before
+  // picking the bucket (high bits) and the slot (low bits).
+  static size_t Hash(const KEY& key) {
+    uint64_t h = static_cast<uint64_t>(key);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return static_cast<size_t>(h);
+  }
+
+  static size_t ComputeBucket(size_t hash) {
+    if (CTR_SPARSE_SHARD_BUCKET_NUM == 1) {
+      return 0;
+    }
+    return hash >> (sizeof(size_t) * 8 - CTR_SPARSE_SHARD_BUCKET_NUM_BITS);
+  }
+
+  Bucket _buckets[CTR_SPARSE_SHARD_BUCKET_NUM];
+  size_t _value_dim = 0;
+  size_t _row_stride = 0;
+  size_t _init_capacity = 16;
+  float _max_load_factor = 0.75f;
+};
+
+}  // namespace distributed
+}  // namespace paddle
@@ -0,0 +1,284 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <iterator>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace paddle {
+namespace distributed {
+
+// Count-min sketch of 4-bit counters, four per key, used as the frequency
+// filter of TinyLfuCache. Once the number of increments reaches ten times
+// the expected entry count all counters are halved, so that the estimate
+// follows recent popularity instead of all-time counts.
+class FrequencySketch {
+ public:
+  void Init(size_t expected_entries) {
+    size_t size = 64;
+    while (size < expected_entries) {
+      size <<= 1;
+    }
+    _table.assign(size, 0);
+    _mask = size - 1;
+    _sample_size = 10 * std::max<size_t>(expected_entries, 64);
+    _additions = 0;
+  }
+
+  void Increment(uint64_t key) {
+    bool added = false;
+    uint64_t hash = Mix(key);
+    for (int i = 0; i < 4; ++i) {
+      uint64_t* word;
+      int offset;
+      Locate(hash, i, &word, &offset);
+      uint64_t mask = 0xfUL << offset;
+      if ((*word & mask) != mask) {
+        *word += 1UL << offset;
+        added = true;
+      }
+    }
+    if (added && ++_additions >= _sample_size) {
+      Reset();
+    }
+  }
+
+  uint32_t Frequency(uint64_t key) const {
+    uint32_t freq = 15;
+    uint64_t hash = Mix(key);
+    for (int i = 0; i < 4; ++i) {
+      uint64_t* word;
+      int offset;
+      Locate(hash, i, &word, &offset);
+      freq = std::min<uint32_t>(freq, (*word >> offset) & 0xf);
+    }
+    return freq;
+  }
+
+  void Reset() {
+    for (auto& word : _table) {
+      word = (word >> 1) & 0x7777777777777777UL;
+    }
+    _additions /= 2;
+  }
+
+ private:
+  static uint64_t Mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdUL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53UL;
+    x ^= x >> 33;
+    return x;
+  }
+
+  void Locate(uint64_t hash, int i, uint64_t** word, int* offset) const {
+    static const uint64_t kSeeds[4] = {0x97cb3127UL,
+                                       0xab1f7d93UL,
+                                       0x1b873593UL,
+                                       0xcc9e2d51UL};
+    uint64_t h = Mix(hash + kSeeds[i]);
+    *word = const_cast<uint64_t*>(&_table[h & _mask]);
+    *offset = static_cast<int>((h >> 60) << 2);
+  }
+
+  std::vector<uint64_t> _table;
+  size_t _mask = 0;
+  size_t _sample_size = 0;
+  size_t _additions = 0;
+};
+
+struct TinyLfuCacheStat {
+  uint64_t hit = 0;
+  uint64_t miss = 0;
+  uint64_t admit = 0;   // candidates that made it into the main space
+  uint64_t reject = 0;  // candidates dropped by the frequency filter
+  uint64_t evict = 0;   // main space entries dropped for a candidate
+  uint64_t entries = 0;
+  uint64_t bytes = 0;
+
+  TinyLfuCacheStat& operator+=(const TinyLfuCacheStat& other) {
+    hit += other.hit;
+    miss += other.miss;
+    admit += other.admit;
+    reject += other.reject;
+    evict += other.evict;
+    entries += other.entries;
+    bytes += other.bytes;
+    return *this;
+  }
+  double hit_ratio() const {
+    return hit + miss == 0 ? 0.0 : static_cast<double>(hit) / (hit + miss);
+  }
+};
+
+// Byte-bounded W-TinyLFU cache of float values keyed by feasign.
+//
+// New entries go to a small LRU window. Entries pushed out of the window are
+// candidates for the main LRU space and are only admitted when the sketch
+// says they are requested more often than the main space victims they would
+// replace, which keeps one-off scans from flushing hot keys. A hit moves
+// the value out of the cache (Take), so the protected segment of the
+// original design would never be filled and is left out.
+//
+// Not thread safe; SSDSparseTable keeps one per shard and touches it from
+// the shard's task thread only.
+class TinyLfuCache {
+ public:
+  // bookkeeping bytes charged per entry on top of the values
+  static const size_t kEntryOverhead = 64;
+
+  void Init(size_t capacity_bytes, double window_ratio = 0.01) {
+    Clear();
+    _capacity = capacity_bytes;
+    _window_capacity = static_cast<size_t>(capacity_bytes * window_ratio);
+    _main_capacity = capacity_bytes - _window_capacity;
+    // assume values of about 64 floats to size the sketch
+    _sketch.Init(capacity_bytes / (kEntryOverhead + 64 * sizeof(float)));
+  }
+
+  bool enabled() const { return _capacity > 0; }
+
+  void RecordAccess(uint64_t key) { _sketch.Increment(key); }
+
+  // Moves the cached value of key into value and drops the entry.
+  bool Take(uint64_t key, std::vector<float>* value) {
+    auto it = _map.find(key);
+    if (it == _map.end()) {
+      ++_stat.miss;
+      return false;
+    }
+    ++_stat.hit;
+    value->swap(it->second->value);
+    Remove(it->second);
+    return true;
+  }
+
+  void Put(uint64_t key, const float* data, size_t dim) {
+    if (!enabled() || Weight(dim) > _main_capacity) {
+      return;
+    }
+    Erase(key);
+    _window.push_front(Entry());
+    auto entry = _window.begin();
+    entry->key = key;
+    entry->value.assign(data, data + dim);
+    entry->weight = Weight(dim);
+    entry->in_window = true;
+    _window_bytes += Weight(dim);
+    _map[key] = entry;
+    while (_window_bytes > _window_capacity && !_window.empty()) {
+      Promote(std::prev(_window.end()));
+    }
+  }
+
+  bool Erase(uint64_t key) {
+    auto it = _map.find(key);
+    if (it == _map.end()) {
+      return false;
+    }
+    Remove(it->second);
+    return true;
+  }
+
+  void Clear() {
+    _map.clear();
+    _window.clear();
+    _main.clear();
+    _window_bytes = 0;
+    _main_bytes = 0;
+  }
+
+  TinyLfuCacheStat Stat() const {
+    TinyLfuCacheStat stat = _stat;
+    stat.entries = _map.size();
+    stat.bytes = _window_bytes + _main_bytes;
+    return stat;
+  }
+
+ private:
+  struct Entry {
+    uint64_t key;
+    std::vector<float> value;
+    size_t weight;
+    bool in_window;
+  };
+  typedef std::list<Entry>::iterator Iter;
+
+  static size_t Weight(size_t dim) {
+    return dim * sizeof(float) + kEntryOverhead;
+  }
+
+  void Remove(Iter entry) {
+    _map.erase(entry->key);
+    if (entry->in_window) {
+      _window_bytes -= entry->weight;
+      _window.erase(entry);
+    } else {
+      _main_bytes -= entry->weight;
+      _main.erase(entry);
+    }
+  }
+
+  // Moves a window victim into the main space if it beats all the main
+  // victims it would replace, the victims are evicted only then.
+  void Promote(Iter candidate) {
+    uint32_t candidate_freq = _sketch.Frequency(candidate->key);
+    // the victims from the least recent end which make room for it, there
+    // are enough as its weight is at most _main_capacity
+    size_t freed = 0;
+    size_t victim_num = 0;
+    Iter victim = _main.end();
+    while (_main_bytes + candidate->weight - freed > _main_capacity) {
+      --victim;
+      if (candidate_freq <= _sketch.Frequency(victim->key)) {
+        Remove(candidate);
+        ++_stat.reject;
+        return;
+      }
+      freed += victim->weight;
+      ++victim_num;
+    }
+    for (; victim_num > 0; --victim_num) {
+      Remove(std::prev(_main.end()));
+      ++_stat.evict;
+    }
+    _main.splice(_main.begin(), _window, candidate);
+    candidate->in_window = false;
+    _window_bytes -= candidate->weight;
+    _main_bytes += candidate->weight;
+    ++_stat.admit;
+  }
+
+  size_t _capacity = 0;
+  size_t _window_capacity = 0;
+  size_t _main_capacity = 0;
+  size_t _window_bytes = 0;
+  size_t _main_bytes = 0;
+  std::list<Entry> _window;  // front is the most recent
+  std::list<Entry> _main;
+  std::unordered_map<uint64_t, Iter> _map;
+  FrequencySketch _sketch;
+  TinyLfuCacheStat _stat;
+};
+
+}  // namespace distributed
+}  // namespace paddle
@@ -0,0 +1,485 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/distributed/ps/table/memory_flat_sparse_table.h"
+
+#include <omp.h>
+
+#include <algorithm>
+
+#include "glog/logging.h"
+#include "paddle/fluid/distributed/common/cost_timer.h"
+#include "paddle/fluid/distributed/ps/table/memory_sparse_table.h"
+#include "paddle/fluid/framework/io/fs.h"
+#include "paddle/fluid/platform/enforce.h"
+
+DECLARE_bool(pserver_create_value_when_push);
+DECLARE_bool(pserver_enable_create_feasign_randomly);
+DECLARE_int32(pserver_table_save_max_retry);
+
+DEFINE_int32(pserver_flat_table_min_keys_per_task,
+             4096,
+             "MemoryFlatSparseTable splits pull/push requests into tasks of at "
+             "least this many keys, smaller requests run on the rpc thread");
+
+namespace paddle {
+namespace distributed {
+
+int32_t MemoryFlatSparseTable::Initialize() {
+  auto &profiler = CostProfiler::instance();
+  profiler.register_profiler("pserver_sparse_update_all");
+  profiler.register_profiler("pserver_sparse_select_all");
+  InitializeValue();
+  _task_pool.reset(new ::ThreadPool(_task_pool_size));
+  VLOG(0) << "initalize MemoryFlatSparseTable succ";
+  return 0;
+}
+
+int32_t MemoryFlatSparseTable::InitializeValue() {
+  _sparse_table_shard_num = static_cast<int>(_config.shard_num());
+  _avg_local_shard_num = MemorySparseTable::sparse_local_shard_num(
+      _sparse_table_shard_num, _shard_num);
+  _real_local_shard_num = _avg_local_shard_num;
+  if (static_cast<int>(_real_local_shard_num * (_shard_idx + 1)) >
+      _sparse_table_shard_num) {
+    _real_local_shard_num =
+        _sparse_table_shard_num - _real_local_shard_num * _shard_idx;
+    _real_local_shard_num =
+        _real_local_shard_num < 0 ? 0 : _real_local_shard_num;
+  }
+  _value_col = _value_accesor->GetAccessorInfo().size / sizeof(float);
+  _mf_value_col = _value_accesor->GetAccessorInfo().mf_size / sizeof(float);
+  VLOG(1) << "memory flat sparse table _avg_local_shard_num: "
+          << _avg_local_shard_num
+          << " _real_local_shard_num: " << _real_local_shard_num
+          << " _task_pool_size:" << _task_pool_size
+          << " value_col: " << _value_col;
+  if (_config.enable_revert()) {
+    LOG(WARNING) << "MemoryFlatSparseTable does not support patch model, "
+                    "enable_revert is ignored";
+  }
+
+  _local_shards.reset(new shard_type[_real_local_shard_num]);
+  for (int i = 0; i < _real_local_shard_num; ++i) {
+    _local_shards[i].Init(_value_col);
+  }
+  return 0;
+}
+
+int32_t MemoryFlatSparseTable::Load(const std::string &path,
+                                    const std::string &param) {
+  std::string table_path = TableDir(path);
+  auto file_list = _afs_client.list(table_path);
+
+  std::sort(file_list.begin(), file_list.end());
+  int load_param = atoi(param.c_str());
+  size_t expect_shard_num = _sparse_table_shard_num;
+  if (file_list.size() != expect_shard_num) {
+    LOG(WARNING) << "MemoryFlatSparseTable file_size:" << file_list.size()
+                 << " not equal to expect_shard_num:" << expect_shard_num;
+    return -1;
+  }
+  if (file_list.size() == 0) {
+    LOG(WARNING) << "MemoryFlatSparseTable load file is empty, path:" << path;
+    return -1;
+  }
+
+  size_t file_start_idx = _shard_idx * _avg_local_shard_num;
+  if (file_start_idx >= file_list.size()) {
+    return 0;
+  }
+
+  int thread_num = _real_local_shard_num < 15 ? _real_local_shard_num : 15;
+  omp_set_num_threads(thread_num);
+#pragma omp parallel for schedule(dynamic)
+  for (int i = 0; i < _real_local_shard_num; ++i) {
+    FsChannelConfig channel_config;
+    channel_config.path = file_list[file_start_idx + i];
+    channel_config.converter = _value_accesor->Converter(load_param).converter;
+    channel_config.deconverter =
+        _value_accesor->Converter(load_param).deconverter;
+
+    bool is_read_failed = false;
+    int retry_num = 0;
+    int err_no = 0;
+    std::vector<float> buffer(_value_col);
+    do {
+      is_read_failed = false;
+      err_no = 0;
+      std::string line_data;
+      auto read_channel = _afs_client.open_r(channel_config, 0, &err_no);
+      char *end = NULL;
+      auto &shard = _local_shards[i];
+      try {
+        while (read_channel->read_line(line_data) == 0 &&
+               line_data.size() > 1) {
+          uint64_t key = std::strtoul(line_data.data(), &end, 10);
+          size_t parse_size = static_cast<size_t>(
+              _value_accesor->ParseFromString(++end, buffer.data()));
+          shard.Upsert(
+              key,
+              [parse_size](float *row) { return parse_size; },
+              [&buffer, parse_size](float *row, uint32_t *dim) {
+                memcpy(row, buffer.data(), parse_size * sizeof(float));
+                *dim = static_cast<uint32_t>(parse_size);
+              });
+        }
+        read_channel->close();
+        if (err_no == -1) {
+          ++retry_num;
+          is_read_failed = true;
+          LOG(ERROR)
+              << "MemoryFlatSparseTable load failed after read, retry it! "
+              << "path:" << channel_config.path << " , retry_num=" << retry_num;
+        }
+      } catch (...) {
+        ++retry_num;
+        is_read_failed = true;
+        LOG(ERROR) << "MemoryFlatSparseTable load failed, retry it! path:"
+                   << channel_config.path << " , retry_num=" << retry_num;
+      }
+      if (retry_num > FLAGS_pserver_table_save_max_retry) {
+        LOG(ERROR) << "MemoryFlatSparseTable load failed reach max limit!";
+        exit(-1);
+      }
+    } while (is_read_failed);
+  }
+  LOG(INFO) << "MemoryFlatSparseTable load success, path from "
+            << file_list[file_start_idx] << " to "
+            << file_list[file_start_idx + _real_local_shard_num - 1];
+  return 0;
+}
+
+int32_t MemoryFlatSparseTable::Save(const std::string &dirname,
+                                    const std::string &param) {
+  if (_real_local_shard_num == 0) {
+    return 0;
+  }
+  VLOG(0) << "MemoryFlatSparseTable::save dirname: " << dirname;
+  int save_param =
+      atoi(param.c_str());  // checkpoint:0  xbox delta:1  xbox base:2
+
+  std::string table_path = TableDir(dirname);
+  _afs_client.remove(paddle::string::format_string(
+      "%s/part-%03d-*", table_path.c_str(), _shard_idx));
+  std::atomic<uint32_t> feasign_size_all{0};
+  size_t file_start_idx = _avg_local_shard_num * _shard_idx;
+
+  int thread_num = _real_local_shard_num < 20 ? _real_local_shard_num : 20;
+  omp_set_num_threads(thread_num);
+#pragma omp parallel for schedule(dynamic)
+  for (int i = 0; i < _real_local_shard_num; ++i) {
+    FsChannelConfig channel_config;
+    if (_config.compress_in_save() && (save_param == 0 || save_param == 3)) {
+      channel_config.path =
+          paddle::string::format_string("%s/part-%03d-%05d.gz",
+                                        table_path.c_str(),
+                                        _shard_idx,
+                                        file_start_idx + i);
+    } else {
+      channel_config.path = paddle::string::format_string("%s/part-%03d-%05d",
+                                                          table_path.c_str(),
+                                                          _shard_idx,
+                                                          file_start_idx + i);
+    }
+    channel_config.converter = _value_accesor->Converter(save_param).converter;
+    channel_config.deconverter =
+        _value_accesor->Converter(save_param).deconverter;
+    bool is_write_failed = false;
+    int feasign_size = 0;
+    int retry_num = 0;
+    int err_no = 0;
+    auto &shard = _local_shards[i];
+    // the rows are written from a snapshot of their bucket, so that pulls
+    // and pushes are not blocked by the file io
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> dims;
+    std::vector<float> values;
+    size_t value_dim = shard.value_dim();
+    do {
+      err_no = 0;
+      feasign_size = 0;
+      is_write_failed = false;
+      auto write_channel =
+          _afs_client.open_w(channel_config, 1024 * 1024 * 40, &err_no);
+      for (size_t bucket = 0; bucket < shard.bucket_count(); ++bucket) {
+        shard.Snapshot(bucket, &keys, &dims, &values);
+        for (size_t k = 0; k < keys.size(); ++k) {
+          float *value = values.data() + k * value_dim;
+          if (!_value_accesor->Save(value, save_param)) {
+            continue;
+          }
+          std::string format_value =
+              _value_accesor->ParseToString(value, dims[k]);
+          if (0 != write_channel->write_line(paddle::string::format_string(
+                       "%lu %s", keys[k], format_value.c_str()))) {
+            ++retry_num;
+            is_write_failed = true;
+            LOG(ERROR) << "MemoryFlatSparseTable save prefix failed, retry it! "
+                       << "path:" << channel_config.path
+                       << " , retry_num=" << retry_num;
+            break;
+          }
+          ++feasign_size;
+        }
+        if (is_write_failed) break;
+      }
+      write_channel->close();
+      if (err_no == -1) {
+        ++retry_num;
+        is_write_failed = true;
+        LOG(ERROR)
+            << "MemoryFlatSparseTable save prefix failed after write, retry "
+            << "it! path:" << channel_config.path
+            << " , retry_num=" << retry_num;
+      }
+      if (is_write_failed) {
+        _afs_client.remove(channel_config.path);
+      }
+      if (retry_num > FLAGS_pserver_table_save_max_retry) {
+        LOG(ERROR)
+            << "MemoryFlatSparseTable save prefix failed reach max limit!";
+        exit(-1);
+      }
+    } while (is_write_failed);
+    feasign_size_all += feasign_size;
+    shard.ForEach([this, save_param](
+                      const uint64_t &key, float *value, uint32_t *dim) {
+      _value_accesor->UpdateStatAfterSave(value, save_param);
+    });
+    LOG(INFO) << "MemoryFlatSparseTable save prefix success, path: "
+              << channel_config.path << " feasign_size: " << feasign_size;
+  }
+  return 0;
+}
+
+int64_t MemoryFlatSparseTable::LocalSize() {
+  int64_t local_size = 0;
+  for (int i = 0; i < _real_local_shard_num; ++i) {
+    local_size += _local_shards[i].size();
+  }
+  return local_size;
+}
+
+int64_t MemoryFlatSparseTable::LocalMFSize() {
+  std::vector<int64_t> size_arr(_real_local_shard_num, 0);
+  std::vector<std::future<void>> tasks(_real_local_shard_num);
+  for (int shard_id = 0; shard_id < _real_local_shard_num; ++shard_id) {
+    tasks[shard_id] = _task_pool->enqueue([this, shard_id, &size_arr]() {
+      _local_shards[shard_id].ForEach(
+          [this, shard_id, &size_arr](
+              const uint64_t &key, float *value, uint32_t *dim) {
+            if (_value_accesor->HasMF(*dim)) {
+              size_arr[shard_id] += 1;
+            }
+          });
+    });
+  }
+  int64_t ret_size = 0;
+  for (int i = 0; i < _real_local_shard_num; ++i) {
+    tasks[i].wait();
+    ret_size += size_arr[i];
+  }
+  return ret_size;
+}
+
+std::pair<int64_t, int64_t> MemoryFlatSparseTable::PrintTableStat() {
+  int64_t feasign_size = LocalSize();
+  int64_t mf_size = LocalMFSize();
+  size_t memory_bytes = 0;
+  for (int i = 0; i < _real_local_shard_num; ++i) {
+    memory_bytes += _local_shards[i].memory_bytes();
+  }
+  VLOG(0) << "MemoryFlatSparseTable table_id: " << _config.table_id()
+          << " feasign_size: " << feasign_size << " mf_size: " << mf_size
+          << " slab_bytes: " << memory_bytes;
+  return {feasign_size, mf_size};
+}
+
+int32_t MemoryFlatSparseTable::Pull(TableContext &context) {
+  CHECK(context.value_type == Sparse);
+  if (context.use_ptr) {
+    LOG(ERROR) << "MemoryFlatSparseTable does not support PullSparsePtr, "
+                  "use MemorySparseTable instead";
+    return -1;
+  }
+  return PullSparse(context.pull_context.values,
+                    context.pull_context.pull_value);
+}
+
+int32_t MemoryFlatSparseTable::Push(TableContext &context) {
+  CHECK(context.value_type == Sparse);
+  if (!context.use_ptr) {
+    return PushSparse(
+        context.push_context.keys, context.push_context.values, context.num);
+  } else {
+    return PushSparse(context.push_context.keys,
+                      context.push_context.ptr_values,
+                      context.num);
+  }
+}
+
+void MemoryFlatSparseTable::ParallelRun(
+    size_t num, const std::function<void(size_t, size_t)> &fn) {
+  size_t min_keys = static_cast<size_t>(
+      std::max(FLAGS_pserver_flat_table_min_keys_per_task, 1));
+  size_t task_num = std::min(static_cast<size_t>(_task_pool_size),
+                             (num + min_keys - 1) / min_keys);
+  if (task_num <= 1) {
+    fn(0, num);
+    return;
+  }
+  size_t step = (num + task_num - 1) / task_num;
+  std::vector<std::future<void>> tasks;
+  tasks.reserve(task_num);
+  for (size_t begin = step; begin < num; begin += step) {
+    size_t end = std::min(begin + step, num);
+    tasks.push_back(
+        _task_pool->enqueue([&fn, begin, end]() { fn(begin, end); }));
+  }
+  // the caller thread takes the first range itself
+  fn(0, std::min(step, num));
+  for (auto &task : tasks) {
+    task.wait();
+  }
+}
+
+int32_t MemoryFlatSparseTable::PullSparse(float *pull_values,
+                                          const PullSparseValue &pull_value) {
+  CostTimer timer("pserver_sparse_select_all");
+  const size_t value_col = _value_col;
+  const size_t mf_value_col = _mf_value_col;
+  const size_t select_value_size =
+      _value_accesor->GetAccessorInfo().select_size / sizeof(float);
+  const uint64_t *feasigns = pull_value.feasigns_;
+
+  ParallelRun(pull_value.numel_, [&](size_t begin, size_t end) {
+    std::vector<float> data_buffer(value_col);
+    float *data_buffer_ptr = data_buffer.data();
+    for (size_t i = begin; i < end; ++i) {
+      uint64_t key = feasigns[i];
+      auto &shard = ShardOf(key);
+      size_t data_size = value_col - mf_value_col;
+      auto copy_out = [data_buffer_ptr, &data_size](const float *value,
+                                                    size_t dim) {
+        data_size = dim;
+        memcpy(data_buffer_ptr, value, dim * sizeof(float));
+      };
+      if (!shard.Read(key, copy_out)) {
+        if (FLAGS_pserver_create_value_when_push) {
+          memset(data_buffer_ptr, 0, sizeof(float) * data_size);
+        } else {
+          shard.Upsert(
+              key,
+              [this, data_size](float *row) {
+                _value_accesor->Create(&row, 1);
+                return data_size;
+              },
+              [&copy_out](float *row, uint32_t *dim) {
+                copy_out(row, *dim);
+              });
+        }
+      }
+      for (size_t mf_idx = data_size; mf_idx < value_col; ++mf_idx) {
+        data_buffer_ptr[mf_idx] = 0.0;
+      }
+      float *select_data = pull_values + select_value_size * i;
+      _value_accesor->Select(
+          &select_data, (const float **)&data_buffer_ptr, 1);
+    }
+  });
+  return 0;
+}
+
+void MemoryFlatSparseTable::UpdateValue(float *value,
+                                        uint32_t *dim,
+                                        const float *update_data,
+                                        float *buffer) {
+  // rows always reserve the full value_col, so update in place even if mf
+  // has not been extended yet; the unused tail is re-created on extension.
+  _value_accesor->Update(&value, &update_data, 1);
+  if (*dim == _value_col || !_value_accesor->NeedExtendMF(value)) {
+    return;
+  }
+  memcpy(buffer, value, *dim * sizeof(float));
+  _value_accesor->Create(&value, 1);
+  memcpy(value, buffer, *dim * sizeof(float));
+  *dim = static_cast<uint32_t>(_value_col);
+}
+
+int32_t MemoryFlatSparseTable::PushSparse(const uint64_t *keys,
+                                          const float *values,
+                                          size_t num) {
+  CostTimer timer("pserver_sparse_update_all");
+  const size_t update_value_col =
+      _value_accesor->GetAccessorInfo().update_size / sizeof(float);
+  std::vector<const float *> value_ptrs(num);
+  for (size_t i = 0; i < num; ++i) {
+    value_ptrs[i] = values + i * update_value_col;
+  }
+  return PushSparse(keys, value_ptrs.data(), num);
+}
+
+int32_t MemoryFlatSparseTable::PushSparse(const uint64_t *keys,
+                                          const float **values,
+                                          size_t num) {
+  const size_t value_col = _value_col;
+  const size_t mf_value_col = _mf_value_col;
+  ParallelRun(num, [&](size_t begin, size_t end) {
+    std::vector<float> data_buffer(value_col);
+    float *data_buffer_ptr = data_buffer.data();
+    for (size_t i = begin; i < end; ++i) {
+      const float *update_data = values[i];
+      ShardOf(keys[i]).Upsert(
+          keys[i],
+          [this, update_data, value_col, mf_value_col](float *row) -> size_t {
+            if (FLAGS_pserver_enable_create_feasign_randomly &&
+                !_value_accesor->CreateValue(1, update_data)) {
+              return 0;
+            }
+            _value_accesor->Create(&row, 1);
+            return value_col - mf_value_col;
+          },
+          [this, update_data, data_buffer_ptr](float *row, uint32_t *dim) {
+            UpdateValue(row, dim, update_data, data_buffer_ptr);
+          });
+    }
+  });
+  return 0;
+}
+
+int32_t MemoryFlatSparseTable::Shrink(const std::string &param) {
+  VLOG(0) << "MemoryFlatSparseTable::Shrink";
+  std::vector<std::future<void>> tasks(_real_local_shard_num);
+  for (int shard_id = 0; shard_id < _real_local_shard_num; ++shard_id) {
+    tasks[shard_id] = _task_pool->enqueue([this, shard_id]() {
+      _local_shards[shard_id].EraseIf([this](float *value, size_t dim) {
+        return _value_accesor->Shrink(value);
+      });
+    });
+  }
+  for (auto &task : tasks) {
+    task.wait();
+  }
+  return 0;
+}
+
+void MemoryFlatSparseTable::Clear() {
+  for (int i = 0; i < _real_local_shard_num; ++i) {
+    _local_shards[i].clear();
+  }
+}
+
+}  // namespace distributed
+}  // namespace paddle
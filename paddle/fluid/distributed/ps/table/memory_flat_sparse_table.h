@@ -0,0 +1,98 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <ThreadPool.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "paddle/fluid/distributed/ps/table/accessor.h"
+#include "paddle/fluid/distributed/ps/table/common_table.h"
+#include "paddle/fluid/distributed/ps/table/depends/flat_feature_shard.h"
+
+namespace paddle {
+namespace distributed {
+
+// Sparse table backed by FlatSparseTableShard. Selected with
+// table_class: "MemoryFlatSparseTable"; the text checkpoint format is the
+// same as MemorySparseTable, so models can be moved between the two.
+//
+// Because every bucket carries its own lock, pulls and pushes are not
+// funnelled through per-shard single-thread pools: small requests run on the
+// calling (rpc) thread and large ones are split into contiguous ranges over
+// a shared pool. Value pointers are not stable, so PullSparsePtr (used by
+// PsLocalClient with use_ptr and gpups) and patch models are not supported.
+class MemoryFlatSparseTable : public Table {
+ public:
+  typedef FlatSparseTableShard<uint64_t> shard_type;
+  MemoryFlatSparseTable() {}
+  virtual ~MemoryFlatSparseTable() {}
+
+  int32_t Pull(TableContext& context) override;
+  int32_t Push(TableContext& context) override;
+
+  int32_t Initialize() override;
+  int32_t InitializeShard() override { return 0; }
+  int32_t InitializeValue();
+
+  int32_t Load(const std::string& path, const std::string& param) override;
+  int32_t Save(const std::string& path, const std::string& param) override;
+
+  int64_t LocalSize();
+  int64_t LocalMFSize();
+  std::pair<int64_t, int64_t> PrintTableStat() override;
+
+  int32_t PullSparse(float* values, const PullSparseValue& pull_value);
+  int32_t PushSparse(const uint64_t* keys, const float* values, size_t num);
+  int32_t PushSparse(const uint64_t* keys, const float** values, size_t num);
+
+  int32_t Flush() override { return 0; }
+  int32_t Shrink(const std::string& param) override;
+  void Clear() override;
+
+  void* GetShard(size_t shard_idx) override {
+    return &_local_shards[shard_idx];
+  }
+
+ protected:
+  // Runs fn(begin, end) over [0, num), inline when num is small and split
+  // into contiguous ranges over _task_pool otherwise.
+  void ParallelRun(size_t num, const std::function<void(size_t, size_t)>& fn);
+  inline shard_type& ShardOf(uint64_t key) {
+    return _local_shards[(key % _sparse_table_shard_num) %
+                         _avg_local_shard_num];
+  }
+  // Update one value in place, extending mf when the accessor asks for it.
+  void UpdateValue(float* value,
+                   uint32_t* dim,
+                   const float* update_data,
+                   float* buffer);
+
+  int _task_pool_size = 24;
+  int _avg_local_shard_num;
+  int _real_local_shard_num;
+  int _sparse_table_shard_num;
+  size_t _value_col = 0;
+  size_t _mf_value_col = 0;
+  std::shared_ptr<::ThreadPool> _task_pool;
+  std::unique_ptr<shard_type[]> _local_shards;
+};
+
+}  // namespace distributed
+}  // namespace paddle
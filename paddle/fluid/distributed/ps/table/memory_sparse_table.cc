@@ -36,10 +36,17 @@ DEFINE_bool(pserver_enable_create_feasign_randomly,
             false,
             "pserver_enable_create_feasign_randomly");
 DEFINE_int32(pserver_table_save_max_retry, 3, "pserver_table_save_max_retry");
+DEFINE_bool(pserver_sparse_binary_lazy_load,
+            false,
+            "serve local binary checkpoints from the mapping and import "
+            "features on first access instead of loading them all");
 
 namespace paddle {
 namespace distributed {
 
+// number of pushed keys handed to the accessor in one Update call
+static const size_t kPushBatchSize = 256;
+
 int32_t MemorySparseTable::Initialize() {
   auto &profiler = CostProfiler::instance();
   profiler.register_profiler("pserver_sparse_update_all");
@@ -74,6 +81,9 @@ int32_t MemorySparseTable::InitializeValue() {
           << " _task_pool_size:" << _task_pool_size;
 
   _local_shards.reset(new shard_type[_real_local_shard_num]);
+  _shard_locks.reset(new std::mutex[_real_local_shard_num]);
+  _lazy_files.resize(_real_local_shard_num);
+  _lazy_loaded_num.assign(_real_local_shard_num, 0);
 
   if (_config.enable_revert()) {
     // calculate merged shard number based on config param;
@@ -127,6 +137,7 @@ int32_t MemorySparseTable::Load(const std::string &path,
   if (load_param == 5) {
     return LoadPatch(file_list, load_param);
   }
+  DropLazyValues();
 
   size_t file_start_idx = _shard_idx * _avg_local_shard_num;
 
@@ -150,6 +161,10 @@ int32_t MemorySparseTable::Load(const std::string &path,
     channel_config.path = file_list[file_start_idx + i];
     VLOG(1) << "MemorySparseTable::load begin load " << channel_config.path
             << " into local shard " << i;
+    if (IsSparseBinaryFile(channel_config.path)) {
+      LoadBinaryShard(i, channel_config.path);
+      continue;
+    }
     channel_config.converter = _value_accesor->Converter(load_param).converter;
     channel_config.deconverter =
         _value_accesor->Converter(load_param).deconverter;
@@ -328,6 +343,10 @@ int32_t MemorySparseTable::Save(const std::string &dirname,
     return 0;
   }
 
+  MaterializeLazyValues();
+  bool use_binary =
+      _config.binary_checkpoint() && (save_param == 0 || save_param == 3);
+
   // cache model
   int64_t tk_size = LocalSize() * _config.sparse_table_cache_rate();
   TopkCalculator tk(_real_local_shard_num, tk_size);
@@ -348,7 +367,16 @@ int32_t MemorySparseTable::Save(const std::string &dirname,
 #pragma omp parallel for schedule(dynamic)
   for (int i = 0; i < _real_local_shard_num; ++i) {
     FsChannelConfig channel_config;
-    if (_config.compress_in_save() && (save_param == 0 || save_param == 3)) {
+    if (use_binary) {
+      // kept uncompressed so that it can be mmapped
+      channel_config.path =
+          paddle::string::format_string("%s/part-%03d-%05d%s",
+                                        table_path.c_str(),
+                                        _shard_idx,
+                                        file_start_idx + i,
+                                        kSparseBinaryFileSuffix);
+    } else if (_config.compress_in_save() &&
+               (save_param == 0 || save_param == 3)) {
       channel_config.path =
           paddle::string::format_string("%s/part-%03d-%05d.gz",
                                         table_path.c_str(),
@@ -368,51 +396,67 @@ int32_t MemorySparseTable::Save(const std::string &dirname,
     int retry_num = 0;
     int err_no = 0;
     auto &shard = _local_shards[i];
-    do {
-      err_no = 0;
-      feasign_size = 0;
-      is_write_failed = false;
-      auto write_channel =
-          _afs_client.open_w(channel_config, 1024 * 1024 * 40, &err_no);
-      for (auto it = shard.begin(); it != shard.end(); ++it) {
-        if (_config.enable_sparse_table_cache() &&
-            (save_param == 1 || save_param == 2) &&
-            _value_accesor->Save(it.value().data(), 4)) {
-          CostTimer timer10("sprase table top push");
-          tk.push(i, _value_accesor->GetField(it.value().data(), "show"));
+    if (use_binary) {
+      channel_config.converter.clear();
+      channel_config.deconverter.clear();
+      while (SaveBinaryShard(i, channel_config, save_param, &feasign_size) !=
+             0) {
+        ++retry_num;
+        LOG(ERROR) << "MemorySparseTable save binary failed, retry it! path:"
+                   << channel_config.path << " , retry_num=" << retry_num;
+        _afs_client.remove(channel_config.path);
+        if (retry_num > FLAGS_pserver_table_save_max_retry) {
+          LOG(ERROR) << "MemorySparseTable save binary failed reach max limit!";
+          exit(-1);
         }
+      }
+    } else {
+      do {
+        err_no = 0;
+        feasign_size = 0;
+        is_write_failed = false;
+        auto write_channel =
+            _afs_client.open_w(channel_config, 1024 * 1024 * 40, &err_no);
+        for (auto it = shard.begin(); it != shard.end(); ++it) {
+          if (_config.enable_sparse_table_cache() &&
+              (save_param == 1 || save_param == 2) &&
+              _value_accesor->Save(it.value().data(), 4)) {
+            CostTimer timer10("sprase table top push");
+            tk.push(i, _value_accesor->GetField(it.value().data(), "show"));
+          }
 
-        if (_value_accesor->Save(it.value().data(), save_param)) {
-          std::string format_value = _value_accesor->ParseToString(
-              it.value().data(), it.value().size());
-          if (0 != write_channel->write_line(paddle::string::format_string(
-                       "%lu %s", it.key(), format_value.c_str()))) {
-            ++retry_num;
-            is_write_failed = true;
-            LOG(ERROR)
-                << "MemorySparseTable save prefix failed, retry it! path:"
-                << channel_config.path << " , retry_num=" << retry_num;
-            break;
+          if (_value_accesor->Save(it.value().data(), save_param)) {
+            std::string format_value = _value_accesor->ParseToString(
+                it.value().data(), it.value().size());
+            if (0 != write_channel->write_line(paddle::string::format_string(
+                         "%lu %s", it.key(), format_value.c_str()))) {
+              ++retry_num;
+              is_write_failed = true;
+              LOG(ERROR)
+                  << "MemorySparseTable save prefix failed, retry it! path:"
+                  << channel_config.path << " , retry_num=" << retry_num;
+              break;
+            }
+            ++feasign_size;
           }
-          ++feasign_size;
         }
-      }
-      write_channel->close();
-      if (err_no == -1) {
-        ++retry_num;
-        is_write_failed = true;
-        LOG(ERROR)
-            << "MemorySparseTable save prefix failed after write, retry it! "
-            << "path:" << channel_config.path << " , retry_num=" << retry_num;
-      }
-      if (is_write_failed) {
-        _afs_client.remove(channel_config.path);
-      }
-      if (retry_num > FLAGS_pserver_table_save_max_retry) {
-        LOG(ERROR) << "MemorySparseTable save prefix failed reach max limit!";
-        exit(-1);
-      }
-    } while (is_write_failed);
+        write_channel->close();
+        if (err_no == -1) {
+          ++retry_num;
+          is_write_failed = true;
+          LOG(ERROR)
+              << "MemorySparseTable save prefix failed after write, retry it! "
+              << "path:" << channel_config.path << " , retry_num=" << retry_num;
+        }
+        if (is_write_failed) {
+          _afs_client.remove(channel_config.path);
+        }
+        if (retry_num > FLAGS_pserver_table_save_max_retry) {
+          LOG(ERROR) << "MemorySparseTable save prefix failed reach max limit!";
+          exit(-1);
+        }
+      } while (is_write_failed);
+    }
     feasign_size_all += feasign_size;
     for (auto it = shard.begin(); it != shard.end(); ++it) {
       _value_accesor->UpdateStatAfterSave(it.value().data(), save_param);
@@ -523,6 +567,15 @@ int64_t MemorySparseTable::CacheShuffle(
         &shuffled_channel,
     const std::vector<Table *> &table_ptrs) {
   LOG(INFO) << "cache shuffle with cache threshold: " << cache_threshold;
+  // the shards of the tables are iterated as the shards of this table
+  for (auto *table_ptr : table_ptrs) {
+    if (dynamic_cast<MemorySparseTable *>(table_ptr) == nullptr) {
+      LOG(ERROR) << "cache shuffle only supports MemorySparseTable and the "
+                    "tables derived from it";
+      return -1;
+    }
+  }
+  MaterializeLazyValues();
   int save_param = atoi(param.c_str());  // batch_model:0  xbox:1
   if (!_config.enable_sparse_table_cache() || cache_threshold < 0) {
     LOG(WARNING)
@@ -679,12 +732,20 @@ int32_t MemorySparseTable::SaveCache(
 int64_t MemorySparseTable::LocalSize() {
   int64_t local_size = 0;
   for (int i = 0; i < _real_local_shard_num; ++i) {
+    std::lock_guard<std::mutex> lock(_shard_locks[i]);
     local_size += _local_shards[i].size();
+    // features of a lazily served checkpoint that are not imported yet
+    auto &lazy_file = _lazy_files[i];
+    if (lazy_file != nullptr) {
+      local_size += lazy_file->key_num() - _lazy_loaded_num[i];
+    }
   }
   return local_size;
 }
 
 int64_t MemorySparseTable::LocalMFSize() {
+  // mf sizes are only known from the values
+  MaterializeLazyValues();
   std::vector<int64_t> size_arr(_real_local_shard_num, 0);
   std::vector<std::future<int>> tasks(_real_local_shard_num);
   int64_t ret_size = 0;
@@ -692,6 +753,7 @@ int64_t MemorySparseTable::LocalMFSize() {
     tasks[shard_id] =
         _shards_task_pool[shard_id % _shards_task_pool.size()]->enqueue(
             [this, shard_id, &size_arr]() -> int {
+              std::lock_guard<std::mutex> lock(_shard_locks[shard_id]);
               auto &local_shard = _local_shards[shard_id];
               for (auto it = local_shard.begin(); it != local_shard.end();
                    ++it) {
@@ -711,9 +773,27 @@ int64_t MemorySparseTable::LocalMFSize() {
   return ret_size;
 }
 
+FeatureValueArenaStat MemorySparseTable::LocalArenaStat() {
+  FeatureValueArenaStat stat;
+  for (int i = 0; i < _real_local_shard_num; ++i) {
+    std::lock_guard<std::mutex> lock(_shard_locks[i]);
+    stat += _local_shards[i].arena_stat();
+  }
+  return stat;
+}
+
 std::pair<int64_t, int64_t> MemorySparseTable::PrintTableStat() {
   int64_t feasign_size = LocalSize();
   int64_t mf_size = LocalMFSize();
+  auto arena_stat = LocalArenaStat();
+  size_t payload_bytes = arena_stat.slab_bytes + arena_stat.huge_bytes;
+  VLOG(0) << "MemorySparseTable table_id: " << _config.table_id()
+          << " feasign_size: " << feasign_size << " mf_size: " << mf_size
+          << " arena slab_bytes: " << arena_stat.slab_bytes
+          << " used_bytes: " << arena_stat.used_bytes
+          << " occupancy: " << arena_stat.occupancy()
+          << " payload_bytes_per_feature: "
+          << (feasign_size == 0 ? 0 : payload_bytes / feasign_size);
   return {feasign_size, mf_size};
 }
 
@@ -774,6 +854,7 @@ int32_t MemorySparseTable::PullSparse(float *pull_values,
              pull_values,
              mf_value_size,
              select_value_size]() -> int {
+              std::lock_guard<std::mutex> lock(_shard_locks[shard_id]);
               auto &local_shard = _local_shards[shard_id];
               float data_buffer[value_size];  // NOLINT
               float *data_buffer_ptr = data_buffer;
@@ -782,6 +863,10 @@ int32_t MemorySparseTable::PullSparse(float *pull_values,
               for (size_t i = 0; i < keys.size(); i++) {
                 uint64_t key = keys[i].first;
                 auto itr = local_shard.find(key);
+                if (itr == local_shard.end() && _has_lazy_files &&
+                    LoadLazyValue(shard_id, key)) {
+                  itr = local_shard.find(key);
+                }
                 size_t data_size = value_size - mf_value_size;
                 if (itr == local_shard.end()) {
                   // ++missed_keys;
@@ -826,51 +911,21 @@ int32_t MemorySparseTable::PullSparsePtr(int shard_id,  // fake num
                                          size_t num,
                                          uint16_t pass_id) {
   CostTimer timer("pscore_sparse_select_all");
-  size_t value_size = _value_accesor->GetAccessorInfo().size / sizeof(float);
-  size_t mf_value_size =
-      _value_accesor->GetAccessorInfo().mf_size / sizeof(float);
-
   std::vector<std::future<int>> tasks(_real_local_shard_num);
   std::vector<std::vector<std::pair<uint64_t, int>>> task_keys(
       _real_local_shard_num);
   for (size_t i = 0; i < num; ++i) {
-    int shard_id = (keys[i] % _sparse_table_shard_num) % _avg_local_shard_num;
+    int shard_id = LocalShardOf(keys[i]);
     task_keys[shard_id].push_back({keys[i], i});
   }
   // std::atomic<uint32_t> missed_keys{0};
   for (int shard_id = 0; shard_id < _real_local_shard_num; ++shard_id) {
     tasks[shard_id] =
         _shards_task_pool[shard_id % _shards_task_pool.size()]->enqueue(
-            [this,
-             shard_id,
-             &task_keys,
-             pull_values,
-             value_size,
-             mf_value_size]() -> int {
+            [this, shard_id, &task_keys, pull_values]() -> int {
               auto &keys = task_keys[shard_id];
-              auto &local_shard = _local_shards[shard_id];
-              float data_buffer[value_size];  // NOLINT
-              float *data_buffer_ptr = data_buffer;
-              for (size_t i = 0; i < keys.size(); ++i) {
-                uint64_t key = keys[i].first;
-                auto itr = local_shard.find(key);
-                size_t data_size = value_size - mf_value_size;
-                FixedFeatureValue *ret = NULL;
-                if (itr == local_shard.end()) {
-                  // ++missed_keys;
-                  auto &feature_value = local_shard[key];
-                  feature_value.resize(data_size);
-                  float *data_ptr = feature_value.data();
-                  _value_accesor->Create(&data_buffer_ptr, 1);
-                  memcpy(data_ptr, data_buffer_ptr, data_size * sizeof(float));
-                  ret = &feature_value;
-                } else {
-                  ret = itr.value_ptr();
-                }
-                int pull_data_idx = keys[i].second;
-                pull_values[pull_data_idx] = reinterpret_cast<char *>(ret);
-              }
-              return 0;
+              return PullSparsePtrShard(
+                  shard_id, keys.data(), keys.size(), pull_values);
             });
   }
   for (size_t shard_id = 0; shard_id < tasks.size(); ++shard_id) {
@@ -879,6 +934,44 @@ int32_t MemorySparseTable::PullSparsePtr(int shard_id,  // fake num
   return 0;
 }
 
+int32_t MemorySparseTable::PullSparsePtrShard(
+    int shard_id,
+    const std::pair<uint64_t, int> *keys,
+    size_t num,
+    char **pull_values) {
+  size_t value_size = _value_accesor->GetAccessorInfo().size / sizeof(float);
+  size_t mf_value_size =
+      _value_accesor->GetAccessorInfo().mf_size / sizeof(float);
+  std::lock_guard<std::mutex> lock(_shard_locks[shard_id]);
+  auto &local_shard = _local_shards[shard_id];
+  float data_buffer[value_size];  // NOLINT
+  float *data_buffer_ptr = data_buffer;
+  for (size_t i = 0; i < num; ++i) {
+    uint64_t key = keys[i].first;
+    auto itr = local_shard.find(key);
+    if (itr == local_shard.end() && _has_lazy_files &&
+        LoadLazyValue(shard_id, key)) {
+      itr = local_shard.find(key);
+    }
+    size_t data_size = value_size - mf_value_size;
+    FixedFeatureValue *ret = NULL;
+    if (itr == local_shard.end()) {
+      // ++missed_keys;
+      auto &feature_value = local_shard[key];
+      feature_value.resize(data_size);
+      float *data_ptr = feature_value.data();
+      _value_accesor->Create(&data_buffer_ptr, 1);
+      memcpy(data_ptr, data_buffer_ptr, data_size * sizeof(float));
+      ret = &feature_value;
+    } else {
+      ret = itr.value_ptr();
+    }
+    int pull_data_idx = keys[i].second;
+    pull_values[pull_data_idx] = reinterpret_cast<char *>(ret);
+  }
+  return 0;
+}
+
 int32_t MemorySparseTable::PushSparse(const uint64_t *keys,
                                       const float *values,
                                       size_t num) {
@@ -907,17 +1000,44 @@ int32_t MemorySparseTable::PushSparse(const uint64_t *keys,
          update_value_col,
          values,
          &task_keys]() -> int {
+          std::lock_guard<std::mutex> lock(_shard_locks[shard_id]);
           auto &keys = task_keys[shard_id];
           auto &local_shard = _local_shards[shard_id];
           auto &local_shard_new = _local_shards_new[shard_id];
           float data_buffer[value_col];  // NOLINT
           float *data_buffer_ptr = data_buffer;
+          // values already extended to full size are queued so that the
+          // sgd rules can vectorize across features. The queue is applied
+          // when kPushBatchSize values are pending, before a key missing
+          // from the shard is inserted and after the last key, so every
+          // update is done when the task returns. The revert copy below
+          // needs the updated value at once and turns the queue off.
+          bool batch_update = !_config.enable_revert();
+          std::vector<float *> batch_values;
+          std::vector<const float *> batch_update_data;
+          auto flush_batch = [&]() {
+            if (!batch_values.empty()) {
+              _value_accesor->Update(batch_values.data(),
+                                     batch_update_data.data(),
+                                     batch_values.size());
+              batch_values.clear();
+              batch_update_data.clear();
+            }
+          };
           for (size_t i = 0; i < keys.size(); ++i) {
             uint64_t key = keys[i].first;
             uint64_t push_data_idx = keys[i].second;
             const float *update_data =
                 values + push_data_idx * update_value_col;
             auto itr = local_shard.find(key);
+            if (itr == local_shard.end()) {
+              // inserting may rehash and move the queued values, apply them
+              flush_batch();
+            }
+            if (itr == local_shard.end() && _has_lazy_files &&
+                LoadLazyValue(shard_id, key)) {
+              itr = local_shard.find(key);
+            }
             if (itr == local_shard.end()) {
               if (FLAGS_pserver_enable_create_feasign_randomly &&
                   !_value_accesor->CreateValue(1, update_data)) {
@@ -937,7 +1057,14 @@ int32_t MemorySparseTable::PushSparse(const uint64_t *keys,
             float *value_data = feature_value.data();
             size_t value_size = feature_value.size();
 
-            if (value_size == value_col) {  // 已拓展到最大size, 则就地update
+            if (value_size == value_col && batch_update) {
+              batch_values.push_back(value_data);
+              batch_update_data.push_back(update_data);
+              if (batch_values.size() == kPushBatchSize) {
+                flush_batch();
+              }
+            } else if (value_size == value_col) {
+              // 已拓展到最大size, 则就地update
               _value_accesor->Update(&value_data, &update_data, 1);
             } else {
               // 拷入buffer区进行update，然后再回填，不需要的mf则回填时抛弃了
@@ -960,6 +1087,7 @@ int32_t MemorySparseTable::PushSparse(const uint64_t *keys,
                      new_size * sizeof(float));
             }
           }
+          flush_batch();
           return 0;
         });
   }
@@ -977,66 +1105,15 @@ int32_t MemorySparseTable::PushSparse(const uint64_t *keys,
   std::vector<std::vector<std::pair<uint64_t, int>>> task_keys(
       _real_local_shard_num);
   for (size_t i = 0; i < num; ++i) {
-    int shard_id = (keys[i] % _sparse_table_shard_num) % _avg_local_shard_num;
+    int shard_id = LocalShardOf(keys[i]);
     task_keys[shard_id].push_back({keys[i], i});
   }
 
-  size_t value_col = _value_accesor->GetAccessorInfo().size / sizeof(float);
-  size_t mf_value_col =
-      _value_accesor->GetAccessorInfo().mf_size / sizeof(float);
-  size_t update_value_col =
-      _value_accesor->GetAccessorInfo().update_size / sizeof(float);
-
   for (int shard_id = 0; shard_id < _real_local_shard_num; ++shard_id) {
     tasks[shard_id] = _shards_task_pool[shard_id % _task_pool_size]->enqueue(
-        [this,
-         shard_id,
-         value_col,
-         mf_value_col,
-         update_value_col,
-         values,
-         &task_keys]() -> int {
+        [this, shard_id, values, &task_keys]() -> int {
           auto &keys = task_keys[shard_id];
-          auto &local_shard = _local_shards[shard_id];
-          float data_buffer[value_col];  // NOLINT
-          float *data_buffer_ptr = data_buffer;
-          for (size_t i = 0; i < keys.size(); ++i) {
-            uint64_t key = keys[i].first;
-            uint64_t push_data_idx = keys[i].second;
-            const float *update_data = values[push_data_idx];
-            auto itr = local_shard.find(key);
-            if (itr == local_shard.end()) {
-              if (FLAGS_pserver_enable_create_feasign_randomly &&
-                  !_value_accesor->CreateValue(1, update_data)) {
-                continue;
-              }
-              auto value_size = value_col - mf_value_col;
-              auto &feature_value = local_shard[key];
-              feature_value.resize(value_size);
-              _value_accesor->Create(&data_buffer_ptr, 1);
-              memcpy(feature_value.data(),
-                     data_buffer_ptr,
-                     value_size * sizeof(float));
-              itr = local_shard.find(key);
-            }
-            auto &feature_value = itr.value();
-            float *value_data = feature_value.data();
-            size_t value_size = feature_value.size();
-            if (value_size == value_col) {  // 已拓展到最大size, 则就地update
-              _value_accesor->Update(&value_data, &update_data, 1);
-            } else {
-              // 拷入buffer区进行update，然后再回填，不需要的mf则回填时抛弃了
-              memcpy(data_buffer_ptr, value_data, value_size * sizeof(float));
-              _value_accesor->Update(&data_buffer_ptr, &update_data, 1);
-              if (_value_accesor->NeedExtendMF(data_buffer)) {
-                feature_value.resize(value_col);
-                value_data = feature_value.data();
-                _value_accesor->Create(&value_data, 1);
-              }
-              memcpy(value_data, data_buffer_ptr, value_size * sizeof(float));
-            }
-          }
-          return 0;
+          return PushSparseShard(shard_id, keys.data(), keys.size(), values);
         });
   }
 
@@ -1046,26 +1123,262 @@ int32_t MemorySparseTable::PushSparse(const uint64_t *keys,
   return 0;
 }
 
+int32_t MemorySparseTable::PushSparseShard(
+    int shard_id,
+    const std::pair<uint64_t, int> *keys,
+    size_t num,
+    const float **values) {
+  size_t value_col = _value_accesor->GetAccessorInfo().size / sizeof(float);
+  size_t mf_value_col =
+      _value_accesor->GetAccessorInfo().mf_size / sizeof(float);
+  std::lock_guard<std::mutex> lock(_shard_locks[shard_id]);
+  auto &local_shard = _local_shards[shard_id];
+  float data_buffer[value_col];  // NOLINT
+  float *data_buffer_ptr = data_buffer;
+  std::vector<float *> batch_values;
+  std::vector<const float *> batch_update_data;
+  auto flush_batch = [&]() {
+    if (!batch_values.empty()) {
+      _value_accesor->Update(batch_values.data(),
+                             batch_update_data.data(),
+                             batch_values.size());
+      batch_values.clear();
+      batch_update_data.clear();
+    }
+  };
+  for (size_t i = 0; i < num; ++i) {
+    uint64_t key = keys[i].first;
+    uint64_t push_data_idx = keys[i].second;
+    const float *update_data = values[push_data_idx];
+    auto itr = local_shard.find(key);
+    if (itr == local_shard.end()) {
+      // inserting may rehash and move the queued values, apply them
+      flush_batch();
+    }
+    if (itr == local_shard.end() && _has_lazy_files &&
+        LoadLazyValue(shard_id, key)) {
+      itr = local_shard.find(key);
+    }
+    if (itr == local_shard.end()) {
+      if (FLAGS_pserver_enable_create_feasign_randomly &&
+          !_value_accesor->CreateValue(1, update_data)) {
+        continue;
+      }
+      auto value_size = value_col - mf_value_col;
+      auto &feature_value = local_shard[key];
+      feature_value.resize(value_size);
+      _value_accesor->Create(&data_buffer_ptr, 1);
+      memcpy(feature_value.data(), data_buffer_ptr, value_size * sizeof(float));
+      itr = local_shard.find(key);
+    }
+    auto &feature_value = itr.value();
+    float *value_data = feature_value.data();
+    size_t value_size = feature_value.size();
+    if (value_size == value_col) {  // 已拓展到最大size, 则批量update
+      batch_values.push_back(value_data);
+      batch_update_data.push_back(update_data);
+      if (batch_values.size() == kPushBatchSize) {
+        flush_batch();
+      }
+    } else {
+      // 拷入buffer区进行update，然后再回填，不需要的mf则回填时抛弃了
+      memcpy(data_buffer_ptr, value_data, value_size * sizeof(float));
+      _value_accesor->Update(&data_buffer_ptr, &update_data, 1);
+      if (_value_accesor->NeedExtendMF(data_buffer)) {
+        feature_value.resize(value_col);
+        value_data = feature_value.data();
+        _value_accesor->Create(&value_data, 1);
+      }
+      memcpy(value_data, data_buffer_ptr, value_size * sizeof(float));
+    }
+  }
+  flush_batch();
+  return 0;
+}
+
 int32_t MemorySparseTable::Flush() { return 0; }
 
 int32_t MemorySparseTable::Shrink(const std::string &param) {
   VLOG(0) << "MemorySparseTable::Shrink";
-  // TODO(zhaocaibei123): implement with multi-thread
+  MaterializeLazyValues();
+  std::vector<std::future<int>> tasks(_real_local_shard_num);
+  std::atomic<size_t> erased{0}, reclaimed{0};
   for (int shard_id = 0; shard_id < _real_local_shard_num; ++shard_id) {
-    // Shrink
-    auto &shard = _local_shards[shard_id];
-    for (auto it = shard.begin(); it != shard.end();) {
-      if (_value_accesor->Shrink(it.value().data())) {
-        it = shard.erase(it);
-      } else {
-        ++it;
-      }
-    }
+    tasks[shard_id] =
+        _shards_task_pool[shard_id % _shards_task_pool.size()]->enqueue(
+            [this, shard_id, &erased, &reclaimed]() -> int {
+              std::lock_guard<std::mutex> lock(_shard_locks[shard_id]);
+              auto &shard = _local_shards[shard_id];
+              size_t shard_erased = 0;
+              for (size_t bucket = 0; bucket < shard.bucket_count();
+                   ++bucket) {
+                for (auto it = shard.begin(bucket); it != shard.end(bucket);) {
+                  if (_value_accesor->Shrink(it.value().data())) {
+                    it = shard.erase(bucket, it);
+                    ++shard_erased;
+                  } else {
+                    ++it;
+                  }
+                }
+              }
+              // give slabs emptied by the erase back in one pass
+              reclaimed += shard.reclaim();
+              erased += shard_erased;
+              return 0;
+            });
   }
+  for (auto &task : tasks) {
+    task.wait();
+  }
+  LOG(INFO) << "MemorySparseTable shrink erased " << erased
+            << " features, reclaimed " << reclaimed << " bytes";
   return 0;
 }
 
 void MemorySparseTable::Clear() { VLOG(0) << "clear coming soon"; }
 
+int32_t MemorySparseTable::SaveBinaryShard(
+    int shard_id,
+    const FsChannelConfig &channel_config,
+    int save_param,
+    int *feasign_size) {
+  // the format needs ascending keys
+  auto &shard = _local_shards[shard_id];
+  std::vector<std::pair<uint64_t, FixedFeatureValue *>> values;
+  values.reserve(shard.size());
+  for (auto it = shard.begin(); it != shard.end(); ++it) {
+    if (_value_accesor->Save(it.value().data(), save_param)) {
+      values.emplace_back(it.key(), &it.value());
+    }
+  }
+  std::sort(values.begin(), values.end());
+
+  int err_no = 0;
+  *feasign_size = 0;
+  auto write_channel =
+      _afs_client.open_w(channel_config, 1024 * 1024 * 40, &err_no);
+  SparseBinaryFileWriter writer(write_channel);
+  int32_t ret = 0;
+  for (auto &kv : values) {
+    if (writer.Append(kv.first, kv.second->data(), kv.second->size()) != 0) {
+      ret = -1;
+      break;
+    }
+    ++(*feasign_size);
+  }
+  if (ret == 0) {
+    ret = writer.Finish();
+  }
+  write_channel->close();
+  return err_no == -1 ? -1 : ret;
+}
+
+void MemorySparseTable::LoadBinaryShard(int shard_id,
+                                        const std::string &path) {
+  std::unique_ptr<SparseBinaryFile> file;
+  int retry_num = 0;
+  while (true) {
+    file.reset(new SparseBinaryFile());
+    if (file->Open(path, &_afs_client) == 0) {
+      break;
+    }
+    ++retry_num;
+    LOG(ERROR) << "MemorySparseTable load binary failed, retry it! path:"
+               << path << " , retry_num=" << retry_num;
+    if (retry_num > FLAGS_pserver_table_save_max_retry) {
+      LOG(ERROR) << "MemorySparseTable load failed reach max limit!";
+      exit(-1);
+    }
+  }
+  if (FLAGS_pserver_sparse_binary_lazy_load && file->is_mapped()) {
+    _lazy_files[shard_id] = std::move(file);
+    _lazy_loaded_num[shard_id] = 0;
+    _has_lazy_files = true;
+    VLOG(1) << "MemorySparseTable::load serve " << path << " lazily";
+    return;
+  }
+  auto &shard = _local_shards[shard_id];
+  int ret = file->ForEach(
+      [&shard](uint64_t key, const float *value, uint32_t dim) {
+        auto &feature_value = shard[key];
+        feature_value.resize(dim);
+        memcpy(feature_value.data(), value, dim * sizeof(float));
+      });
+  if (ret != 0) {
+    LOG(ERROR) << "MemorySparseTable load binary corrupted, path: " << path;
+    exit(-1);
+  }
+}
+
+bool MemorySparseTable::LoadLazyValue(int shard_id, uint64_t key) {
+  auto &file = _lazy_files[shard_id];
+  if (file == nullptr) {
+    return false;
+  }
+  uint32_t dim = 0;
+  const float *value = file->Find(key, &dim);
+  if (value == nullptr) {
+    return false;
+  }
+  auto &feature_value = _local_shards[shard_id][key];
+  feature_value.resize(dim);
+  memcpy(feature_value.data(), value, dim * sizeof(float));
+  ++_lazy_loaded_num[shard_id];
+  return true;
+}
+
+void MemorySparseTable::MaterializeLazyValues() {
+  if (!_has_lazy_files) {
+    return;
+  }
+  std::vector<std::future<int>> tasks(_real_local_shard_num);
+  for (int shard_id = 0; shard_id < _real_local_shard_num; ++shard_id) {
+    tasks[shard_id] =
+        _shards_task_pool[shard_id % _shards_task_pool.size()]->enqueue(
+            [this, shard_id]() -> int {
+              // PsLocalClient pulls and pushes on its own threads, the file
+              // must not be released under a LoadLazyValue of one of them
+              std::lock_guard<std::mutex> lock(_shard_locks[shard_id]);
+              auto &file = _lazy_files[shard_id];
+              if (file == nullptr) {
+                return 0;
+              }
+              auto &shard = _local_shards[shard_id];
+              int ret = file->ForEach(
+                  [&shard](uint64_t key, const float *value, uint32_t dim) {
+                    // imported features may have been updated since
+                    if (shard.find(key) != shard.end()) {
+                      return;
+                    }
+                    auto &feature_value = shard[key];
+                    feature_value.resize(dim);
+                    memcpy(feature_value.data(), value, dim * sizeof(float));
+                  });
+              CHECK_EQ(ret, 0) << "MemorySparseTable lazily served checkpoint "
+                                  "corrupted for shard "
+                               << shard_id;
+              file.reset();
+              _lazy_loaded_num[shard_id] = 0;
+              return 0;
+            });
+  }
+  for (auto &task : tasks) {
+    task.wait();
+  }
+  _has_lazy_files = false;
+}
+
+void MemorySparseTable::DropLazyValues() {
+  if (!_has_lazy_files) {
+    return;
+  }
+  for (int shard_id = 0; shard_id < _real_local_shard_num; ++shard_id) {
+    std::lock_guard<std::mutex> lock(_shard_locks[shard_id]);
+    _lazy_files[shard_id].reset();
+    _lazy_loaded_num[shard_id] = 0;
+  }
+  _has_lazy_files = false;
+}
+
 }  // namespace distributed
 }  // namespace paddle
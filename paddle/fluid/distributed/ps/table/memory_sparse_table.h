@@ -18,6 +18,7 @@
 #include <assert.h>
 #include <pthread.h>
 
+#include <atomic>
 #include <memory>
 #include <mutex>  // NOLINT
 #include <string>
@@ -29,6 +30,7 @@
 #include "paddle/fluid/distributed/ps/table/accessor.h"
 #include "paddle/fluid/distributed/ps/table/common_table.h"
 #include "paddle/fluid/distributed/ps/table/depends/feature_value.h"
+#include "paddle/fluid/distributed/ps/table/sparse_binary_file.h"
 #include "paddle/fluid/string/string_helper.h"
 
 #define PSERVER_SAVE_SUFFIX ".shard"
@@ -86,6 +88,8 @@ class MemorySparseTable : public Table {
       const std::vector<Table*>& table_ptrs) override;
   int64_t LocalSize();
   int64_t LocalMFSize();
+  // payload arena occupancy summed over local shards
+  FeatureValueArenaStat LocalArenaStat();
 
   std::pair<int64_t, int64_t> PrintTableStat() override;
   int32_t PullSparse(float* values, const PullSparseValue& pull_value);
@@ -100,6 +104,24 @@ class MemorySparseTable : public Table {
 
   int32_t PushSparse(const uint64_t* keys, const float** values, size_t num);
 
+  // Pulls and pushes of the keys of one local shard, as {key, index of its
+  // value} pairs, on the caller thread under the lock of the shard. They let
+  // a client in the process of the table, PsLocalClient, run a request shard
+  // by shard itself instead of through the shard threads.
+  virtual bool SupportShardAccess() { return true; }
+  int LocalShardNum() const { return _real_local_shard_num; }
+  int LocalShardOf(uint64_t key) const {
+    return (key % _sparse_table_shard_num) % _avg_local_shard_num;
+  }
+  int32_t PullSparsePtrShard(int shard_id,
+                             const std::pair<uint64_t, int>* keys,
+                             size_t num,
+                             char** pull_values);
+  int32_t PushSparseShard(int shard_id,
+                          const std::pair<uint64_t, int>* keys,
+                          size_t num,
+                          const float** values);
+
   int32_t Flush() override;
   int32_t Shrink(const std::string& param) override;
   void Clear() override;
@@ -116,12 +138,36 @@ class MemorySparseTable : public Table {
   virtual int32_t LoadPatch(const std::vector<std::string>& file_list,
                             int save_param);
 
+  // binary checkpoint, see sparse_binary_file.h
+  int32_t SaveBinaryShard(int shard_id,
+                          const FsChannelConfig& channel_config,
+                          int save_param,
+                          int* feasign_size);
+  void LoadBinaryShard(int shard_id, const std::string& path);
+  // Imports key from the lazily served checkpoint of the shard, returns
+  // false when the key is not in it. The caller holds the lock of the shard,
+  // which keeps MaterializeLazyValues from releasing the file meanwhile.
+  bool LoadLazyValue(int shard_id, uint64_t key);
+  // Imports everything still left in lazily served checkpoints, before
+  // operations that have to see the whole table.
+  void MaterializeLazyValues();
+  // Releases the lazily served checkpoints without importing what is left
+  // in them, before a load overwrites the table.
+  void DropLazyValues();
+
   int _task_pool_size = 24;
   int _avg_local_shard_num;
   int _real_local_shard_num;
   int _sparse_table_shard_num;
   std::vector<std::shared_ptr<::ThreadPool>> _shards_task_pool;
   std::unique_ptr<shard_type[]> _local_shards;
+  // held by every task of a shard and by the callers of the *Shard methods
+  std::unique_ptr<std::mutex[]> _shard_locks;
+
+  // mmapped checkpoints served lazily, one per local shard
+  std::vector<std::unique_ptr<SparseBinaryFile>> _lazy_files;
+  std::vector<size_t> _lazy_loaded_num;
+  std::atomic<bool> _has_lazy_files{false};
 
   // for patch model
   int _m_avg_local_shard_num;
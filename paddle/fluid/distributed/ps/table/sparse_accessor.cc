@@ -216,29 +216,40 @@ int32_t SparseAccessor::Merge(float** update_values,
 int32_t SparseAccessor::Update(float** update_values,
                                const float** push_values,
                                size_t num) {
-  for (size_t value_item = 0; value_item < num; ++value_item) {
-    float* update_value = update_values[value_item];
-    const float* push_value = push_values[value_item];
-    float push_show = push_value[SparsePushValue::ShowIndex()];
-    float push_click = push_value[SparsePushValue::ClickIndex()];
-    float slot = push_value[SparsePushValue::SlotIndex()];
-    update_value[sparse_feature_value.ShowIndex()] += push_show;
-    update_value[sparse_feature_value.ClickIndex()] += push_click;
-    update_value[sparse_feature_value.SlotIndex()] = slot;
-    update_value[sparse_feature_value.DeltaScoreIndex()] +=
-        (push_show - push_click) * _config.ctr_accessor_param().nonclk_coeff() +
-        push_click * _config.ctr_accessor_param().click_coeff();
-    update_value[sparse_feature_value.UnseenDaysIndex()] = 0;
-    _embed_sgd_rule->UpdateValue(
-        update_value + sparse_feature_value.EmbedWIndex(),
-        update_value + sparse_feature_value.EmbedG2SumIndex(),
-        push_value + SparsePushValue::EmbedGIndex(),
-        push_show);
-    _embedx_sgd_rule->UpdateValue(
-        update_value + sparse_feature_value.EmbedxWIndex(),
-        update_value + sparse_feature_value.EmbedxG2SumIndex(),
-        push_value + SparsePushValue::EmbedxGIndex(),
-        push_show);
+  const size_t batch_size = SparseValueSGDRule::kUpdateBatchSize;
+  float push_shows[batch_size];
+  for (size_t begin = 0; begin < num; begin += batch_size) {
+    size_t batch = num - begin < batch_size ? num - begin : batch_size;
+    for (size_t item = 0; item < batch; ++item) {
+      float* update_value = update_values[begin + item];
+      const float* push_value = push_values[begin + item];
+      float push_show = push_value[SparsePushValue::ShowIndex()];
+      float push_click = push_value[SparsePushValue::ClickIndex()];
+      float slot = push_value[SparsePushValue::SlotIndex()];
+      update_value[sparse_feature_value.ShowIndex()] += push_show;
+      update_value[sparse_feature_value.ClickIndex()] += push_click;
+      update_value[sparse_feature_value.SlotIndex()] = slot;
+      update_value[sparse_feature_value.DeltaScoreIndex()] +=
+          (push_show - push_click) *
+              _config.ctr_accessor_param().nonclk_coeff() +
+          push_click * _config.ctr_accessor_param().click_coeff();
+      update_value[sparse_feature_value.UnseenDaysIndex()] = 0;
+      push_shows[item] = push_show;
+    }
+    _embed_sgd_rule->UpdateValueBatch(update_values + begin,
+                                      sparse_feature_value.EmbedWIndex(),
+                                      sparse_feature_value.EmbedG2SumIndex(),
+                                      push_values + begin,
+                                      SparsePushValue::EmbedGIndex(),
+                                      push_shows,
+                                      batch);
+    _embedx_sgd_rule->UpdateValueBatch(update_values + begin,
+                                       sparse_feature_value.EmbedxWIndex(),
+                                       sparse_feature_value.EmbedxG2SumIndex(),
+                                       push_values + begin,
+                                       SparsePushValue::EmbedxGIndex(),
+                                       push_shows,
+                                       batch);
   }
   return 0;
 }
@@ -0,0 +1,410 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/distributed/ps/table/sparse_binary_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <xxhash.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include "glog/logging.h"
+#include "paddle/fluid/distributed/ps/table/accessor.h"
+#include "paddle/fluid/framework/io/fs.h"
+
+namespace paddle {
+namespace distributed {
+
+namespace {
+
+inline size_t Align8(size_t bytes) { return (bytes + 7) / 8 * 8; }
+
+inline size_t BlockHeadBytes(size_t key_num) {
+  return Align8(key_num * sizeof(uint64_t) +
+                (key_num + 1) * sizeof(uint32_t));
+}
+
+inline uint64_t FooterChecksum(const SparseBinaryFileFooter& footer) {
+  return XXH64(&footer, offsetof(SparseBinaryFileFooter, checksum), 0);
+}
+
+}  // namespace
+
+bool IsSparseBinaryFile(const std::string& path) {
+  size_t suffix_len = sizeof(kSparseBinaryFileSuffix) - 1;
+  return path.size() >= suffix_len &&
+         path.compare(path.size() - suffix_len,
+                      suffix_len,
+                      kSparseBinaryFileSuffix) == 0;
+}
+
+SparseBinaryFileWriter::SparseBinaryFileWriter(
+    std::shared_ptr<FsWriteChannel> channel, uint32_t block_key_num)
+    : _channel(channel), _block_key_num(block_key_num) {
+  CHECK_GT(_block_key_num, 0);
+  _offsets.push_back(0);
+}
+
+int32_t SparseBinaryFileWriter::Write(const void* data, size_t bytes) {
+  if (bytes == 0) {
+    return 0;
+  }
+  if (_channel->write(static_cast<const char*>(data), bytes) != 0) {
+    return -1;
+  }
+  _file_offset += bytes;
+  return 0;
+}
+
+int32_t SparseBinaryFileWriter::Append(uint64_t key,
+                                       const float* value,
+                                       uint32_t dim) {
+  CHECK(!_has_last_key || key > _last_key)
+      << "SparseBinaryFileWriter keys must be ascending, got " << key
+      << " after " << _last_key;
+  if (_file_offset == 0 && Write(&kSparseBinaryFileMagic,
+                                 sizeof(kSparseBinaryFileMagic)) != 0) {
+    return -1;
+  }
+  _has_last_key = true;
+  _last_key = key;
+  _keys.push_back(key);
+  _values.insert(_values.end(), value, value + dim);
+  _offsets.push_back(static_cast<uint32_t>(_values.size()));
+  if (_keys.size() >= _block_key_num) {
+    return FlushBlock();
+  }
+  return 0;
+}
+
+int32_t SparseBinaryFileWriter::FlushBlock() {
+  if (_keys.empty()) {
+    return 0;
+  }
+  size_t key_num = _keys.size();
+  size_t head_bytes = BlockHeadBytes(key_num);
+  size_t value_bytes = _values.size() * sizeof(float);
+  _block_buffer.assign(Align8(head_bytes + value_bytes), 0);
+  char* buf = _block_buffer.data();
+  memcpy(buf, _keys.data(), key_num * sizeof(uint64_t));
+  memcpy(buf + key_num * sizeof(uint64_t),
+         _offsets.data(),
+         _offsets.size() * sizeof(uint32_t));
+  memcpy(buf + head_bytes, _values.data(), value_bytes);
+
+  SparseBinaryBlockIndex index;
+  index.offset = _file_offset;
+  index.bytes = _block_buffer.size();
+  index.first_key = _keys.front();
+  index.last_key = _keys.back();
+  index.checksum = XXH64(buf, _block_buffer.size(), 0);
+  index.key_num = static_cast<uint32_t>(key_num);
+  index.reserved = 0;
+  if (Write(buf, _block_buffer.size()) != 0) {
+    return -1;
+  }
+  _index.push_back(index);
+  _key_num += key_num;
+  _value_num += _values.size();
+  _keys.clear();
+  _values.clear();
+  _offsets.resize(1);
+  return 0;
+}
+
+int32_t SparseBinaryFileWriter::Finish() {
+  if (_file_offset == 0 && Write(&kSparseBinaryFileMagic,
+                                 sizeof(kSparseBinaryFileMagic)) != 0) {
+    return -1;
+  }
+  if (FlushBlock() != 0) {
+    return -1;
+  }
+  SparseBinaryFileFooter footer;
+  memset(&footer, 0, sizeof(footer));
+  footer.magic = kSparseBinaryFileMagic;
+  footer.version = kSparseBinaryFileVersion;
+  footer.block_num = static_cast<uint32_t>(_index.size());
+  footer.key_num = _key_num;
+  footer.value_num = _value_num;
+  footer.index_offset = _file_offset;
+  size_t index_bytes = _index.size() * sizeof(SparseBinaryBlockIndex);
+  footer.index_checksum = XXH64(_index.data(), index_bytes, 0);
+  footer.checksum = FooterChecksum(footer);
+  if (Write(_index.data(), index_bytes) != 0) {
+    return -1;
+  }
+  return Write(&footer, sizeof(footer));
+}
+
+SparseBinaryFile::~SparseBinaryFile() {
+  if (_mapped) {
+    munmap(const_cast<char*>(_data), _size);
+  }
+}
+
+int32_t SparseBinaryFile::Open(const std::string& path,
+                               AfsClient* afs_client) {
+  _path = path;
+  if (paddle::framework::fs_select_internal(path) == 0) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      LOG(ERROR) << "SparseBinaryFile open failed, path: " << path;
+      return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      close(fd);
+      LOG(ERROR) << "SparseBinaryFile stat failed, path: " << path;
+      return -1;
+    }
+    _size = st.st_size;
+    void* addr = nullptr;
+    if (_size > 0) {
+      addr = mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (addr == nullptr || addr == MAP_FAILED) {
+      LOG(ERROR) << "SparseBinaryFile mmap failed, path: " << path;
+      return -1;
+    }
+    _data = static_cast<const char*>(addr);
+    _mapped = true;
+  } else {
+    FsChannelConfig channel_config;
+    channel_config.path = path;
+    int err_no = 0;
+    auto read_channel = afs_client->open_r(channel_config, 0, &err_no);
+    const size_t chunk = 1 << 22;
+    size_t read_size = 0;
+    while (true) {
+      _buffer.resize(read_size + chunk);
+      int ret = read_channel->read(_buffer.data() + read_size, chunk);
+      if (ret <= 0) {
+        break;
+      }
+      read_size += ret;
+    }
+    read_channel->close();
+    if (err_no == -1) {
+      LOG(ERROR) << "SparseBinaryFile read failed, path: " << path;
+      return -1;
+    }
+    _buffer.resize(read_size);
+    _data = _buffer.data();
+    _size = read_size;
+  }
+
+  if (_size < sizeof(kSparseBinaryFileMagic) + sizeof(SparseBinaryFileFooter) ||
+      memcmp(_data, &kSparseBinaryFileMagic, sizeof(kSparseBinaryFileMagic)) !=
+          0) {
+    LOG(ERROR) << "SparseBinaryFile bad magic, path: " << path;
+    return -1;
+  }
+  memcpy(&_footer, _data + _size - sizeof(_footer), sizeof(_footer));
+  if (_footer.magic != kSparseBinaryFileMagic ||
+      _footer.checksum != FooterChecksum(_footer)) {
+    LOG(ERROR) << "SparseBinaryFile footer corrupted, path: " << path;
+    return -1;
+  }
+  if (_footer.version != kSparseBinaryFileVersion) {
+    LOG(ERROR) << "SparseBinaryFile version " << _footer.version
+               << " not supported, path: " << path;
+    return -1;
+  }
+  size_t index_bytes = _footer.block_num * sizeof(SparseBinaryBlockIndex);
+  if (_footer.index_offset + index_bytes + sizeof(_footer) != _size ||
+      XXH64(_data + _footer.index_offset, index_bytes, 0) !=
+          _footer.index_checksum) {
+    LOG(ERROR) << "SparseBinaryFile index corrupted, path: " << path;
+    return -1;
+  }
+  _index =
+      reinterpret_cast<const SparseBinaryBlockIndex*>(_data +
+                                                      _footer.index_offset);
+  _block_state.reset(new std::atomic<uint8_t>[_footer.block_num]);
+  for (uint32_t i = 0; i < _footer.block_num; ++i) {
+    const auto& index = _index[i];
+    if (index.offset + index.bytes > _footer.index_offset ||
+        index.bytes < BlockHeadBytes(index.key_num)) {
+      LOG(ERROR) << "SparseBinaryFile block " << i
+                 << " out of range, path: " << path;
+      return -1;
+    }
+    _block_state[i].store(0, std::memory_order_relaxed);
+  }
+  if (_mapped) {
+    // a lazily served file is read at the keys pulled, readahead would only
+    // page in values nobody asked for, ForEach asks for it while it scans
+    madvise(const_cast<char*>(_data), _size, MADV_RANDOM);
+  }
+  return 0;
+}
+
+bool SparseBinaryFile::VerifyBlock(uint32_t block_idx) const {
+  uint8_t state = _block_state[block_idx].load(std::memory_order_acquire);
+  if (state == 0) {
+    const auto& index = _index[block_idx];
+    bool ok = XXH64(_data + index.offset, index.bytes, 0) == index.checksum;
+    state = ok ? 1 : 2;
+    _block_state[block_idx].store(state, std::memory_order_release);
+    if (!ok) {
+      LOG(ERROR) << "SparseBinaryFile block " << block_idx
+                 << " checksum mismatch, path: " << _path;
+    }
+  }
+  return state == 1;
+}
+
+const float* SparseBinaryFile::Find(uint64_t key, uint32_t* dim) const {
+  const SparseBinaryBlockIndex* end = _index + _footer.block_num;
+  // first block whose last_key >= key
+  const SparseBinaryBlockIndex* block = std::lower_bound(
+      _index,
+      end,
+      key,
+      [](const SparseBinaryBlockIndex& index, uint64_t k) {
+        return index.last_key < k;
+      });
+  if (block == end || block->first_key > key) {
+    return nullptr;
+  }
+  uint32_t block_idx = static_cast<uint32_t>(block - _index);
+  CHECK(VerifyBlock(block_idx))
+      << "SparseBinaryFile corrupted block " << block_idx << " in " << _path;
+  const char* base = _data + block->offset;
+  const uint64_t* keys = reinterpret_cast<const uint64_t*>(base);
+  const uint64_t* pos = std::lower_bound(keys, keys + block->key_num, key);
+  if (pos == keys + block->key_num || *pos != key) {
+    return nullptr;
+  }
+  size_t i = pos - keys;
+  const uint32_t* offsets = reinterpret_cast<const uint32_t*>(
+      base + block->key_num * sizeof(uint64_t));
+  const float* values = reinterpret_cast<const float*>(
+      base + BlockHeadBytes(block->key_num));
+  *dim = offsets[i + 1] - offsets[i];
+  return values + offsets[i];
+}
+
+int32_t SparseBinaryFile::ForEach(
+    const std::function<void(uint64_t, const float*, uint32_t)>& fn) const {
+  // only the blocks are scanned, the index stays random, and madvise wants
+  // a page aligned start
+  char* advise_begin = nullptr;
+  size_t advise_bytes = 0;
+  if (_mapped && _footer.block_num > 0) {
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    size_t begin = _index[0].offset / page_size * page_size;
+    const auto& last = _index[_footer.block_num - 1];
+    advise_begin = const_cast<char*>(_data) + begin;
+    advise_bytes = last.offset + last.bytes - begin;
+    madvise(advise_begin, advise_bytes, MADV_SEQUENTIAL);
+  }
+  int32_t ret = 0;
+  for (uint32_t block_idx = 0; block_idx < _footer.block_num; ++block_idx) {
+    if (!VerifyBlock(block_idx)) {
+      ret = -1;
+      break;
+    }
+    const auto& index = _index[block_idx];
+    const char* base = _data + index.offset;
+    const uint64_t* keys = reinterpret_cast<const uint64_t*>(base);
+    const uint32_t* offsets = reinterpret_cast<const uint32_t*>(
+        base + index.key_num * sizeof(uint64_t));
+    const float* values =
+        reinterpret_cast<const float*>(base + BlockHeadBytes(index.key_num));
+    for (uint32_t i = 0; i < index.key_num; ++i) {
+      fn(keys[i], values + offsets[i], offsets[i + 1] - offsets[i]);
+    }
+  }
+  if (advise_bytes > 0) {
+    madvise(advise_begin, advise_bytes, MADV_RANDOM);
+  }
+  return ret;
+}
+
+int64_t ConvertSparseTextToBinary(AfsClient* afs_client,
+                                  ValueAccessor* accessor,
+                                  const FsChannelConfig& text_config,
+                                  const std::string& binary_path) {
+  size_t value_size = accessor->GetAccessorInfo().size / sizeof(float);
+  std::vector<std::pair<uint64_t, size_t>> records;  // key, value offset
+  std::vector<uint32_t> dims;
+  std::vector<float> values;
+  std::vector<float> buffer(value_size);
+
+  int err_no = 0;
+  std::string line_data;
+  char* end = nullptr;
+  auto read_channel = afs_client->open_r(text_config, 0, &err_no);
+  while (read_channel->read_line(line_data) == 0 && line_data.size() > 1) {
+    uint64_t key = std::strtoul(line_data.data(), &end, 10);
+    int dim = accessor->ParseFromString(++end, buffer.data());
+    records.emplace_back(key, values.size());
+    dims.push_back(dim);
+    values.insert(values.end(), buffer.data(), buffer.data() + dim);
+  }
+  read_channel->close();
+  if (err_no == -1) {
+    LOG(ERROR) << "ConvertSparseTextToBinary read failed, path: "
+               << text_config.path;
+    return -1;
+  }
+
+  std::vector<uint32_t> order(records.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::stable_sort(
+      order.begin(), order.end(), [&records](uint32_t a, uint32_t b) {
+        return records[a].first < records[b].first;
+      });
+
+  FsChannelConfig binary_config;
+  binary_config.path = binary_path;
+  auto write_channel = afs_client->open_w(binary_config, 0, &err_no);
+  SparseBinaryFileWriter writer(write_channel);
+  for (size_t i = 0; i < order.size(); ++i) {
+    const auto& record = records[order[i]];
+    if (i + 1 < order.size() && record.first == records[order[i + 1]].first) {
+      continue;  // keep the last duplicate, as the text loader does
+    }
+    if (writer.Append(record.first,
+                      values.data() + record.second,
+                      dims[order[i]]) != 0) {
+      err_no = -1;
+      break;
+    }
+  }
+  if (err_no != -1 && writer.Finish() != 0) {
+    err_no = -1;
+  }
+  write_channel->close();
+  if (err_no == -1) {
+    LOG(ERROR) << "ConvertSparseTextToBinary write failed, path: "
+               << binary_path;
+    afs_client->remove(binary_path);
+    return -1;
+  }
+  return writer.key_num();
+}
+
+}  // namespace distributed
+}  // namespace paddle
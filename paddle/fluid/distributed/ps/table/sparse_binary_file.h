@@ -0,0 +1,169 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "paddle/fluid/distributed/common/afs_warpper.h"
+
+namespace paddle {
+namespace distributed {
+
+class ValueAccessor;
+
+// Binary checkpoint file of one sparse table shard.
+//
+// Layout (native byte order, every section 8-byte aligned):
+//
+//   [magic 8B]
+//   [block 0] ... [block n-1]
+//   [index: SparseBinaryBlockIndex x n]
+//   [SparseBinaryFileFooter]
+//
+// A block holds up to block_key_num records sorted by key:
+//
+//   [keys: uint64 x k][offsets: uint32 x (k + 1), padded to 8B]
+//   [values: float x offsets[k]]
+//
+// so the value of keys[i] is values[offsets[i], offsets[i + 1]) and records
+// are read in place without parsing. The index sits in a footer rather than
+// a leading header because checkpoints are written through pipes (hdfs/afs)
+// that can not seek back; readers locate it from the fixed-size footer.
+// Every block, the index and the footer carry an XXH64 checksum.
+struct SparseBinaryBlockIndex {
+  uint64_t offset;  // file offset of the block
+  uint64_t bytes;
+  uint64_t first_key;
+  uint64_t last_key;
+  uint64_t checksum;
+  uint32_t key_num;
+  uint32_t reserved;
+};
+
+struct SparseBinaryFileFooter {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t block_num;
+  uint64_t key_num;
+  uint64_t value_num;  // total floats of all records
+  uint64_t index_offset;
+  uint64_t index_checksum;
+  uint64_t reserved;
+  uint64_t checksum;  // of the preceding footer bytes
+};
+
+// "PSSPBIN1" in little endian
+static const uint64_t kSparseBinaryFileMagic = 0x314e494250535350UL;
+static const uint32_t kSparseBinaryFileVersion = 1;
+static const char kSparseBinaryFileSuffix[] = ".bin";
+
+// Returns true when path names a binary checkpoint file.
+bool IsSparseBinaryFile(const std::string& path);
+
+// Streams records into a binary file. Keys must be appended in strictly
+// ascending order, which lets readers binary search the index.
+class SparseBinaryFileWriter {
+ public:
+  static const uint32_t kDefaultBlockKeyNum = 4096;
+
+  explicit SparseBinaryFileWriter(
+      std::shared_ptr<FsWriteChannel> channel,
+      uint32_t block_key_num = kDefaultBlockKeyNum);
+  SparseBinaryFileWriter(const SparseBinaryFileWriter&) = delete;
+  SparseBinaryFileWriter& operator=(const SparseBinaryFileWriter&) = delete;
+
+  // Returns 0 on success, -1 when the channel write failed.
+  int32_t Append(uint64_t key, const float* value, uint32_t dim);
+  // Flushes the last block and writes index and footer.
+  int32_t Finish();
+
+  uint64_t key_num() const { return _key_num; }
+
+ private:
+  int32_t Write(const void* data, size_t bytes);
+  int32_t FlushBlock();
+
+  std::shared_ptr<FsWriteChannel> _channel;
+  uint32_t _block_key_num;
+  uint64_t _file_offset = 0;
+  uint64_t _key_num = 0;
+  uint64_t _value_num = 0;
+  bool _has_last_key = false;
+  uint64_t _last_key = 0;
+  std::vector<uint64_t> _keys;
+  std::vector<uint32_t> _offsets;
+  std::vector<float> _values;
+  std::vector<char> _block_buffer;
+  std::vector<SparseBinaryBlockIndex> _index;
+};
+
+// Read-only view of a binary file. Local files are mmapped, so opening is
+// O(index) and values are paged in on demand; remote files are read into
+// memory once. Block checksums are verified on first access of a block.
+class SparseBinaryFile {
+ public:
+  SparseBinaryFile() {}
+  ~SparseBinaryFile();
+  SparseBinaryFile(const SparseBinaryFile&) = delete;
+  SparseBinaryFile& operator=(const SparseBinaryFile&) = delete;
+
+  // Returns 0 on success, -1 when the file can not be read or its footer
+  // or index is corrupted.
+  int32_t Open(const std::string& path, AfsClient* afs_client);
+
+  bool is_mapped() const { return _mapped; }
+  uint64_t key_num() const { return _footer.key_num; }
+  uint32_t block_num() const { return _footer.block_num; }
+
+  // Returns the value of key and its dim, or nullptr when key is absent.
+  // Aborts on a corrupted block, like a failed text load does.
+  const float* Find(uint64_t key, uint32_t* dim) const;
+
+  // Calls fn(key, value, dim) for every record in key order. Returns -1
+  // without visiting it when a block fails its checksum.
+  int32_t ForEach(
+      const std::function<void(uint64_t, const float*, uint32_t)>& fn) const;
+
+ private:
+  bool VerifyBlock(uint32_t block_idx) const;
+
+  std::string _path;
+  bool _mapped = false;
+  const char* _data = nullptr;
+  size_t _size = 0;
+  std::vector<char> _buffer;  // used when the file is not mmapped
+  SparseBinaryFileFooter _footer;
+  const SparseBinaryBlockIndex* _index = nullptr;
+  // 0: unchecked, 1: checksum ok, 2: corrupted
+  mutable std::unique_ptr<std::atomic<uint8_t>[]> _block_state;
+};
+
+// Converts one text shard file ("key v0 v1 ...", as written by
+// MemorySparseTable::Save) into a binary file. The text file is read with
+// the deconverter of text_config, values are parsed with the accessor.
+// Returns the number of records written, or -1 on error.
+int64_t ConvertSparseTextToBinary(AfsClient* afs_client,
+                                  ValueAccessor* accessor,
+                                  const FsChannelConfig& text_config,
+                                  const std::string& binary_path);
+
+}  // namespace distributed
+}  // namespace paddle
@@ -15,14 +15,115 @@
 #include "paddle/fluid/distributed/ps/table/sparse_sgd_rule.h"
 
 #include <gflags/gflags.h>
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
 
 #include "glog/logging.h"
+#include "paddle/phi/backends/cpu/cpu_info.h"
+#include "paddle/phi/kernels/funcs/jit/kernels.h"
 
 DEFINE_bool(enable_show_scale_gradient, true, "enable show scale gradient");
+DEFINE_bool(enable_sparse_sgd_rule_simd,
+            true,
+            "update sparse values with the vectorized batch kernels, "
+            "false falls back to the per-feature scalar update");
 
 namespace paddle {
 namespace distributed {
 
+namespace {
+
+bool UseSimd() {
+  static const bool has_avx =
+      phi::backends::cpu::MayIUse(phi::backends::cpu::avx);
+  return FLAGS_enable_sparse_sgd_rule_simd && has_avx;
+}
+
+#ifdef __AVX__
+inline double HorizontalSum(__m256d v) {
+  __m128d sum =
+      _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+  sum = _mm_hadd_pd(sum, sum);
+  return _mm_cvtsd_f64(sum);
+}
+
+// the sums go to double as in the scalar rules, eight floats widen into two
+// accumulators
+inline void AddWidened(__m256 v, __m256d *lo, __m256d *hi) {
+  *lo = _mm256_add_pd(*lo, _mm256_cvtps_pd(_mm256_castps256_ps128(v)));
+  *hi = _mm256_add_pd(*hi, _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)));
+}
+
+inline void AddSquaresWidened(__m256 v, __m256d *lo, __m256d *hi) {
+  __m256d vlo = _mm256_cvtps_pd(_mm256_castps256_ps128(v));
+  __m256d vhi = _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1));
+  *lo = _mm256_add_pd(*lo, _mm256_mul_pd(vlo, vlo));
+  *hi = _mm256_add_pd(*hi, _mm256_mul_pd(vhi, vhi));
+}
+
+// max then min maps NaN to min_bound, as BoundValue does
+inline __m256 Bound(__m256 w, __m256 min_bound, __m256 max_bound) {
+  return _mm256_min_ps(_mm256_max_ps(w, min_bound), max_bound);
+}
+#endif
+
+template <class T>
+inline void BoundScalar(T &w, float min_bound, float max_bound) {  // NOLINT
+  if (!(w >= min_bound)) {
+    w = (T)min_bound;
+  } else if (!(w <= max_bound)) {
+    w = (T)max_bound;
+  }
+}
+
+void BoundValues(float *w, size_t n, float min_bound, float max_bound) {
+  size_t i = 0;
+#ifdef __AVX__
+  __m256 vmin = _mm256_set1_ps(min_bound);
+  __m256 vmax = _mm256_set1_ps(max_bound);
+  for (; i + 8 <= n; i += 8) {
+    _mm256_storeu_ps(w + i, Bound(_mm256_loadu_ps(w + i), vmin, vmax));
+  }
+#endif
+  for (; i < n; ++i) {
+    BoundScalar(w[i], min_bound, max_bound);
+  }
+}
+
+// w += a * x with w bounded, returns the sum of x * x in double
+double AxpyBound(float a,
+                 const float *x,
+                 float *w,
+                 size_t n,
+                 float min_bound,
+                 float max_bound) {
+  size_t i = 0;
+  double square_sum = 0;
+#ifdef __AVX__
+  __m256 va = _mm256_set1_ps(a);
+  __m256 vmin = _mm256_set1_ps(min_bound);
+  __m256 vmax = _mm256_set1_ps(max_bound);
+  __m256d vsum_lo = _mm256_setzero_pd();
+  __m256d vsum_hi = _mm256_setzero_pd();
+  for (; i + 8 <= n; i += 8) {
+    __m256 vx = _mm256_loadu_ps(x + i);
+    __m256 vw = _mm256_add_ps(_mm256_loadu_ps(w + i), _mm256_mul_ps(va, vx));
+    _mm256_storeu_ps(w + i, Bound(vw, vmin, vmax));
+    AddSquaresWidened(vx, &vsum_lo, &vsum_hi);
+  }
+  square_sum = HorizontalSum(_mm256_add_pd(vsum_lo, vsum_hi));
+#endif
+  for (; i < n; ++i) {
+    w[i] += a * x[i];
+    BoundScalar(w[i], min_bound, max_bound);
+    square_sum += static_cast<double>(x[i]) * x[i];
+  }
+  return square_sum;
+}
+
+}  // namespace
+
 void SparseNaiveSGDRule::LoadConfig(const SparseCommonSGDRuleParameter &param,
                                     size_t emb_dim) {
   _embedding_dim = emb_dim;
@@ -106,6 +207,34 @@ void SparseAdaGradSGDRule::UpdateValueWork(float *w,
   g2sum += add_g2sum / _embedding_dim;
 }
 
+void SparseAdaGradSGDRule::UpdateValueBatch(float **values,
+                                            size_t w_col,
+                                            size_t sgd_col,
+                                            const float **push_values,
+                                            size_t grad_col,
+                                            const float *scales,
+                                            size_t num) {
+  if (!UseSimd()) {
+    SparseValueSGDRule::UpdateValueBatch(
+        values, w_col, sgd_col, push_values, grad_col, scales, num);
+    return;
+  }
+  for (size_t k = 0; k < num; ++k) {
+    float &g2sum = values[k][sgd_col + G2SumIndex()];
+    float scale = scales[k];
+    float ratio =
+        learning_rate_ * sqrt(_initial_g2sum / (_initial_g2sum + g2sum));
+    // accumulated in double like UpdateValueWork
+    double add_g2sum = AxpyBound(-ratio / scale,
+                                 push_values[k] + grad_col,
+                                 values[k] + w_col,
+                                 _embedding_dim,
+                                 _min_bound,
+                                 _max_bound);
+    g2sum += add_g2sum / (static_cast<double>(scale) * scale) / _embedding_dim;
+  }
+}
+
 void SparseAdaGradSGDRule::InitValueWork(float *value,
                                          float *sgd,
                                          bool zero_init) {
@@ -159,6 +288,53 @@ void StdAdaGradSGDRule::UpdateValueWork(float *w,
   }
 }
 
+void StdAdaGradSGDRule::UpdateValueBatch(float **values,
+                                         size_t w_col,
+                                         size_t sgd_col,
+                                         const float **push_values,
+                                         size_t grad_col,
+                                         const float *scales,
+                                         size_t num) {
+  if (!UseSimd()) {
+    SparseValueSGDRule::UpdateValueBatch(
+        values, w_col, sgd_col, push_values, grad_col, scales, num);
+    return;
+  }
+  for (size_t k = 0; k < num; ++k) {
+    float *w = values[k] + w_col;
+    float *g2sum = values[k] + sgd_col + G2SumIndex();
+    const float *grad = push_values[k] + grad_col;
+    float scale = scales[k];
+    size_t i = 0;
+#ifdef __AVX__
+    __m256 vscale = _mm256_set1_ps(scale);
+    __m256 vlr = _mm256_set1_ps(learning_rate_);
+    __m256 vinit = _mm256_set1_ps(_initial_g2sum);
+    __m256 vmin = _mm256_set1_ps(_min_bound);
+    __m256 vmax = _mm256_set1_ps(_max_bound);
+    for (; i + 8 <= _embedding_dim; i += 8) {
+      __m256 vg = _mm256_div_ps(_mm256_loadu_ps(grad + i), vscale);
+      __m256 vg2sum = _mm256_loadu_ps(g2sum + i);
+      __m256 vratio = _mm256_sqrt_ps(
+          _mm256_div_ps(vinit, _mm256_add_ps(vinit, vg2sum)));
+      __m256 vw = _mm256_sub_ps(
+          _mm256_loadu_ps(w + i),
+          _mm256_mul_ps(_mm256_mul_ps(vlr, vg), vratio));
+      _mm256_storeu_ps(w + i, Bound(vw, vmin, vmax));
+      _mm256_storeu_ps(g2sum + i,
+                       _mm256_add_ps(vg2sum, _mm256_mul_ps(vg, vg)));
+    }
+#endif
+    for (; i < _embedding_dim; ++i) {
+      float scaled_grad = grad[i] / scale;
+      w[i] -= learning_rate_ * scaled_grad *
+              sqrt(_initial_g2sum / (_initial_g2sum + g2sum[i]));
+      BoundValue(w[i]);
+      g2sum[i] += scaled_grad * scaled_grad;
+    }
+  }
+}
+
 void StdAdaGradSGDRule::InitValueWork(float *value,
                                       float *sgd,
                                       bool zero_init) {
@@ -227,6 +403,52 @@ void SparseAdamSGDRule::UpdateValueWork(float *w,
   (*beta2_pow) *= _beta2_decay_rate;
 }
 
+// The moments and weights go through the jit adam kernel, which is code
+// generated for avx/avx2/avx512 and falls back to the refer implementation
+// elsewhere. It writes in place, bounds are applied afterwards.
+void SparseAdamSGDRule::UpdateValueBatch(float **values,
+                                         size_t w_col,
+                                         size_t sgd_col,
+                                         const float **push_values,
+                                         size_t grad_col,
+                                         const float *scales,
+                                         size_t num) {
+  if (!UseSimd()) {
+    SparseValueSGDRule::UpdateValueBatch(
+        values, w_col, sgd_col, push_values, grad_col, scales, num);
+    return;
+  }
+  phi::jit::adam_attr_t attr(_beta1_decay_rate, _beta2_decay_rate);
+  auto adam =
+      phi::jit::KernelFuncs<phi::jit::AdamTuple<float>, phi::CPUPlace>::Cache()
+          .At(attr);
+  int64_t dim = static_cast<int64_t>(_embedding_dim);
+  for (size_t k = 0; k < num; ++k) {
+    float *w = values[k] + w_col;
+    float *sgd = values[k] + sgd_col;
+    float *gsum = sgd + GSumIndex();
+    float *g2sum = sgd + G2SumIndex();
+    float *beta1_pow = sgd + Beta1PowIndex();
+    float *beta2_pow = sgd + Beta2PowIndex();
+    float lr = learning_rate_ * sqrt(1 - *beta2_pow) / (1 - *beta1_pow);
+    adam(_beta1_decay_rate,
+         _beta2_decay_rate,
+         -lr,
+         _ada_epsilon,
+         dim,
+         push_values[k] + grad_col,
+         gsum,
+         g2sum,
+         w,
+         gsum,
+         g2sum,
+         w);
+    BoundValues(w, _embedding_dim, _min_bound, _max_bound);
+    (*beta1_pow) *= _beta1_decay_rate;
+    (*beta2_pow) *= _beta2_decay_rate;
+  }
+}
+
 void SparseAdamSGDRule::InitValueWork(float *value,
                                       float *sgd,
                                       bool zero_init) {
@@ -310,6 +532,78 @@ void SparseSharedAdamSGDRule::UpdateValueWork(float *w,
   (*beta2_pow) *= _beta2_decay_rate;
 }
 
+void SparseSharedAdamSGDRule::UpdateValueBatch(float **values,
+                                               size_t w_col,
+                                               size_t sgd_col,
+                                               const float **push_values,
+                                               size_t grad_col,
+                                               const float *scales,
+                                               size_t num) {
+  if (!UseSimd()) {
+    SparseValueSGDRule::UpdateValueBatch(
+        values, w_col, sgd_col, push_values, grad_col, scales, num);
+    return;
+  }
+  for (size_t k = 0; k < num; ++k) {
+    float *w = values[k] + w_col;
+    float *sgd = values[k] + sgd_col;
+    const float *g = push_values[k] + grad_col;
+    float *gsum = sgd + GSumIndex();
+    float *g2sum = sgd + G2SumIndex();
+    float *beta1_pow = sgd + Beta1PowIndex();
+    float *beta2_pow = sgd + Beta2PowIndex();
+    float lr = learning_rate_ * sqrt(1 - *beta2_pow) / (1 - *beta1_pow);
+    // the shared moments are scalars, only the gradient term varies
+    float gsum_base = _beta1_decay_rate * (*gsum);
+    float g2sum_base = _beta2_decay_rate * (*g2sum);
+    float beta1_rest = 1 - _beta1_decay_rate;
+    float beta2_rest = 1 - _beta2_decay_rate;
+    double sum_gsum = 0;
+    double sum_g2sum = 0;
+    size_t i = 0;
+#ifdef __AVX__
+    __m256 vgsum_base = _mm256_set1_ps(gsum_base);
+    __m256 vg2sum_base = _mm256_set1_ps(g2sum_base);
+    __m256 vbeta1_rest = _mm256_set1_ps(beta1_rest);
+    __m256 vbeta2_rest = _mm256_set1_ps(beta2_rest);
+    __m256 vlr = _mm256_set1_ps(lr);
+    __m256 veps = _mm256_set1_ps(_ada_epsilon);
+    __m256 vmin = _mm256_set1_ps(_min_bound);
+    __m256 vmax = _mm256_set1_ps(_max_bound);
+    __m256d vsum_gsum[2] = {_mm256_setzero_pd(), _mm256_setzero_pd()};
+    __m256d vsum_g2sum[2] = {_mm256_setzero_pd(), _mm256_setzero_pd()};
+    for (; i + 8 <= _embedding_dim; i += 8) {
+      __m256 vg = _mm256_loadu_ps(g + i);
+      __m256 vgsum =
+          _mm256_add_ps(vgsum_base, _mm256_mul_ps(vbeta1_rest, vg));
+      __m256 vg2sum = _mm256_add_ps(
+          vg2sum_base, _mm256_mul_ps(vbeta2_rest, _mm256_mul_ps(vg, vg)));
+      __m256 vstep = _mm256_div_ps(
+          vgsum, _mm256_add_ps(_mm256_sqrt_ps(vg2sum), veps));
+      __m256 vw =
+          _mm256_sub_ps(_mm256_loadu_ps(w + i), _mm256_mul_ps(vlr, vstep));
+      _mm256_storeu_ps(w + i, Bound(vw, vmin, vmax));
+      AddWidened(vgsum, &vsum_gsum[0], &vsum_gsum[1]);
+      AddWidened(vg2sum, &vsum_g2sum[0], &vsum_g2sum[1]);
+    }
+    sum_gsum = HorizontalSum(_mm256_add_pd(vsum_gsum[0], vsum_gsum[1]));
+    sum_g2sum = HorizontalSum(_mm256_add_pd(vsum_g2sum[0], vsum_g2sum[1]));
+#endif
+    for (; i < _embedding_dim; ++i) {
+      float new_gsum = gsum_base + beta1_rest * g[i];
+      float new_g2sum = g2sum_base + beta2_rest * g[i] * g[i];
+      w[i] -= lr * (new_gsum / (sqrt(new_g2sum) + _ada_epsilon));
+      BoundValue(w[i]);
+      sum_gsum += new_gsum;
+      sum_g2sum += new_g2sum;
+    }
+    (*gsum) = sum_gsum / _embedding_dim;
+    (*g2sum) = sum_g2sum / _embedding_dim;
+    (*beta1_pow) *= _beta1_decay_rate;
+    (*beta2_pow) *= _beta2_decay_rate;
+  }
+}
+
 void SparseSharedAdamSGDRule::InitValueWork(float *value,
                                             float *sgd,
                                             bool zero_init) {
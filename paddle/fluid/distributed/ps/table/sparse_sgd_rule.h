@@ -51,6 +51,25 @@ class SparseValueSGDRule {
                    float scale = 1) {
     UpdateValueWork(w, sgd, push_value, scale);
   }
+  // Updates num features in one call. Feature i keeps its weights at
+  // values[i] + w_col and its rule state at values[i] + sgd_col, its
+  // gradient starts at push_values[i] + grad_col and is scaled by
+  // scales[i]. Rules override it with vectorized kernels; this fallback
+  // is the per-feature scalar update.
+  virtual void UpdateValueBatch(float** values,
+                                size_t w_col,
+                                size_t sgd_col,
+                                const float** push_values,
+                                size_t grad_col,
+                                const float* scales,
+                                size_t num) {
+    for (size_t i = 0; i < num; ++i) {
+      UpdateValueWork(values[i] + w_col,
+                      values[i] + sgd_col,
+                      push_values[i] + grad_col,
+                      scales[i]);
+    }
+  }
   template <class T>
   void BoundValue(T& w) {  // NOLINT
     if (!(w >= _min_bound)) {
@@ -62,6 +81,9 @@ class SparseValueSGDRule {
   float& MinBound() { return _min_bound; }
   float& MaxBound() { return _max_bound; }
 
+  // number of features accessors hand to UpdateValueBatch at a time
+  static const size_t kUpdateBatchSize = 64;
+
  protected:
   float _min_bound;
   float _max_bound;
@@ -97,6 +119,13 @@ class SparseAdaGradSGDRule : public SparseValueSGDRule {
                                float* sgd,
                                const float* push_value,
                                float scale);
+  virtual void UpdateValueBatch(float** values,
+                                size_t w_col,
+                                size_t sgd_col,
+                                const float** push_values,
+                                size_t grad_col,
+                                const float* scales,
+                                size_t num);
   virtual void InitValueWork(float* value, float* sgd, bool zero_init);
   virtual size_t Dim() { return 1; }
   size_t G2SumIndex() { return 0; }
@@ -114,6 +143,13 @@ class StdAdaGradSGDRule : public SparseValueSGDRule {
                                float* sgd,
                                const float* push_value,
                                float scale);
+  virtual void UpdateValueBatch(float** values,
+                                size_t w_col,
+                                size_t sgd_col,
+                                const float** push_values,
+                                size_t grad_col,
+                                const float* scales,
+                                size_t num);
   virtual void InitValueWork(float* value, float* sgd, bool zero_init);
   virtual size_t Dim() { return _embedding_dim; }
   size_t G2SumIndex() { return 0; }
@@ -131,6 +167,13 @@ class SparseAdamSGDRule : public SparseValueSGDRule {
                                float* sgd,
                                const float* push_value,
                                float scale);
+  virtual void UpdateValueBatch(float** values,
+                                size_t w_col,
+                                size_t sgd_col,
+                                const float** push_values,
+                                size_t grad_col,
+                                const float* scales,
+                                size_t num);
   virtual void InitValueWork(float* value, float* sgd, bool zero_init);
   virtual size_t Dim() { return _embedding_dim * 2 + 2; }
   size_t GSumIndex() { return 0; }
@@ -153,6 +196,13 @@ class SparseSharedAdamSGDRule : public SparseValueSGDRule {
                                float* sgd,
                                const float* push_value,
                                float scale);
+  virtual void UpdateValueBatch(float** values,
+                                size_t w_col,
+                                size_t sgd_col,
+                                const float** push_values,
+                                size_t grad_col,
+                                const float* scales,
+                                size_t num);
   virtual void InitValueWork(float* value, float* sgd, bool zero_init);
   virtual size_t Dim() { return 4; }
   size_t GSumIndex() { return 0; }
@@ -25,6 +25,10 @@ DECLARE_bool(pserver_create_value_when_push);
 DECLARE_bool(pserver_enable_create_feasign_randomly);
 DEFINE_bool(pserver_open_strict_check, false, "pserver_open_strict_check");
 DEFINE_int32(pserver_load_batch_size, 5000, "load batch size for ssd");
+DEFINE_int64(pserver_ssd_cache_mb,
+             0,
+             "memory budget in MB of the hot-key cache between the in-memory "
+             "shards and rocksdb of SSDSparseTable, 0 disables it");
 PADDLE_DEFINE_EXPORTED_string(rocksdb_path,
                               "database",
                               "path of sparse table rocksdb file");
@@ -36,6 +40,14 @@ int32_t SSDSparseTable::Initialize() {
   MemorySparseTable::Initialize();
   _db = paddle::distributed::RocksDBHandler::GetInstance();
   _db->initialize(FLAGS_rocksdb_path, _real_local_shard_num);
+  _ssd_cache.resize(_real_local_shard_num);
+  if (FLAGS_pserver_ssd_cache_mb > 0 && _real_local_shard_num > 0) {
+    size_t shard_bytes =
+        (FLAGS_pserver_ssd_cache_mb << 20) / _real_local_shard_num;
+    for (auto& cache : _ssd_cache) {
+      cache.Init(shard_bytes);
+    }
+  }
   VLOG(0) << "initalize SSDSparseTable succ";
   VLOG(0) << "SSD FLAGS_pserver_print_missed_key_num_every_push:"
           << FLAGS_pserver_print_missed_key_num_every_push;
@@ -72,6 +84,22 @@ int32_t SSDSparseTable::Push(TableContext& context) {
   }
 }
 
+bool SSDSparseTable::TakeCachedValue(int shard_id,
+                                     uint64_t key,
+                                     std::vector<float>* buffer) {
+  auto& cache = _ssd_cache[shard_id];
+  if (!cache.enabled() || !cache.Take(key, buffer)) {
+    return false;
+  }
+  auto& feature_value = _local_shards[shard_id][key];
+  feature_value.resize(buffer->size());
+  memcpy(const_cast<float*>(feature_value.data()),
+         buffer->data(),
+         buffer->size() * sizeof(float));
+  _db->del_data(shard_id, reinterpret_cast<char*>(&key), sizeof(uint64_t));
+  return true;
+}
+
 int32_t SSDSparseTable::PullSparse(float* pull_values,
                                    const uint64_t* keys,
                                    size_t num) {
@@ -106,63 +134,123 @@ int32_t SSDSparseTable::PullSparse(float* pull_values,
                &missed_keys]() -> int {
                 auto& keys = task_keys[shard_id];
                 auto& local_shard = _local_shards[shard_id];
+                auto& cache = _ssd_cache[shard_id];
                 float data_buffer[value_size];  // NOLINT
                 float* data_buffer_ptr = data_buffer;
+                // value == nullptr selects a zero value
+                auto select = [&](const float* value,
+                                  size_t data_size,
+                                  int pull_data_idx) {
+                  if (value == nullptr) {
+                    memset(data_buffer_ptr, 0, sizeof(float) * data_size);
+                  } else {
+                    memcpy(data_buffer_ptr, value, data_size * sizeof(float));
+                  }
+                  for (size_t mf_idx = data_size; mf_idx < value_size;
+                       ++mf_idx) {
+                    data_buffer_ptr[mf_idx] = 0.0;
+                  }
+                  float* select_data =
+                      pull_values + pull_data_idx * select_value_size;
+                  _value_accesor->Select(
+                      &select_data, (const float**)&data_buffer_ptr, 1);
+                };
+                // from rocksdb to mem
+                auto move_to_mem = [&](uint64_t key,
+                                       const float* value,
+                                       size_t data_size) {
+                  auto& feature_value = local_shard[key];
+                  feature_value.resize(data_size);
+                  memcpy(const_cast<float*>(feature_value.data()),
+                         value,
+                         data_size * sizeof(float));
+                  _db->del_data(shard_id,
+                                reinterpret_cast<char*>(&key),
+                                sizeof(uint64_t));
+                };
+
+                // keys missing in mem, read from rocksdb in one MultiGet
+                std::vector<std::pair<uint64_t, int>> ssd_keys;
+                std::vector<float> cached_value;
+                uint64_t mem_hit = 0;
                 for (size_t i = 0; i < keys.size(); ++i) {
                   uint64_t key = keys[i].first;
                   auto itr = local_shard.find(key);
-                  size_t data_size = value_size - mf_value_size;
+                  if (cache.enabled()) {
+                    cache.RecordAccess(key);
+                  }
+                  if (itr == local_shard.end() &&
+                      TakeCachedValue(shard_id, key, &cached_value)) {
+                    itr = local_shard.find(key);
+                  }
                   if (itr == local_shard.end()) {
-                    // pull rocksdb
-                    std::string tmp_string("");
-                    if (_db->get(shard_id,
-                                 reinterpret_cast<char*>(&key),
-                                 sizeof(uint64_t),
-                                 tmp_string) > 0) {
-                      ++missed_keys;
-                      if (FLAGS_pserver_create_value_when_push) {
-                        memset(data_buffer, 0, sizeof(float) * data_size);
-                      } else {
-                        auto& feature_value = local_shard[key];
-                        feature_value.resize(data_size);
-                        float* data_ptr =
-                            const_cast<float*>(feature_value.data());
-                        _value_accesor->Create(&data_buffer_ptr, 1);
-                        memcpy(data_ptr,
-                               data_buffer_ptr,
-                               data_size * sizeof(float));
-                      }
+                    ssd_keys.push_back(keys[i]);
+                    continue;
+                  }
+                  ++mem_hit;
+                  select(
+                      itr.value().data(), itr.value().size(), keys[i].second);
+                }
+                _pull_mem_hit += mem_hit;
+                if (ssd_keys.empty()) {
+                  return 0;
+                }
+
+                std::sort(ssd_keys.begin(), ssd_keys.end());
+                size_t ssd_num = ssd_keys.size();
+                std::vector<rocksdb::Slice> batch_keys;
+                batch_keys.reserve(ssd_num);
+                for (auto& ssd_key : ssd_keys) {
+                  batch_keys.emplace_back(
+                      reinterpret_cast<const char*>(&ssd_key.first),
+                      sizeof(uint64_t));
+                }
+                std::vector<rocksdb::PinnableSlice> batch_values(ssd_num);
+                std::vector<rocksdb::Status> status(ssd_num);
+                _db->multi_get(shard_id,
+                               ssd_num,
+                               batch_keys.data(),
+                               batch_values.data(),
+                               status.data());
+                uint64_t ssd_hit = 0;
+                for (size_t i = 0; i < ssd_num; ++i) {
+                  uint64_t key = ssd_keys[i].first;
+                  int pull_data_idx = ssd_keys[i].second;
+                  // a duplicated key has been moved to mem already
+                  auto itr = local_shard.find(key);
+                  if (itr != local_shard.end()) {
+                    select(itr.value().data(),
+                           itr.value().size(),
+                           pull_data_idx);
+                    continue;
+                  }
+                  size_t data_size = value_size - mf_value_size;
+                  if (status[i].IsNotFound()) {
+                    ++missed_keys;
+                    if (FLAGS_pserver_create_value_when_push) {
+                      select(nullptr, data_size, pull_data_idx);
                     } else {
-                      data_size = tmp_string.size() / sizeof(float);
-                      memcpy(data_buffer_ptr,
-                             paddle::string::str_to_float(tmp_string),
-                             data_size * sizeof(float));
-                      // from rocksdb to mem
                       auto& feature_value = local_shard[key];
                       feature_value.resize(data_size);
+                      _value_accesor->Create(&data_buffer_ptr, 1);
                       memcpy(const_cast<float*>(feature_value.data()),
                              data_buffer_ptr,
                              data_size * sizeof(float));
-                      _db->del_data(shard_id,
-                                    reinterpret_cast<char*>(&key),
-                                    sizeof(uint64_t));
+                      select(feature_value.data(), data_size, pull_data_idx);
                     }
                   } else {
-                    data_size = itr.value().size();
-                    memcpy(data_buffer_ptr,
-                           itr.value().data(),
-                           data_size * sizeof(float));
-                  }
-                  for (size_t mf_idx = data_size; mf_idx < value_size;
-                       ++mf_idx) {
-                    data_buffer[mf_idx] = 0.0;
+                    ++ssd_hit;
+                    data_size = batch_values[i].size() / sizeof(float);
+                    move_to_mem(
+                        key,
+                        paddle::string::str_to_float(batch_values[i].data()),
+                        data_size);
+                    itr = local_shard.find(key);
+                    select(itr.value().data(), data_size, pull_data_idx);
                   }
-                  int pull_data_idx = keys[i].second;
-                  float* select_data =
-                      pull_values + pull_data_idx * select_value_size;
-                  _value_accesor->Select(
-                      &select_data, (const float**)&data_buffer_ptr, 1);
                 }
+                _pull_ssd_hit += ssd_hit;
+                _pull_ssd_miss += ssd_num - ssd_hit;
                 return 0;
               });
     }
@@ -194,12 +282,21 @@ int32_t SSDSparseTable::PullSparsePtr(int shard_id,
     cur_ctx->reset();
     FixedFeatureValue* ret = NULL;
     auto& local_shard = _local_shards[shard_id];
+    auto& cache = _ssd_cache[shard_id];
     float data_buffer[value_size];  // NOLINT
     float* data_buffer_ptr = data_buffer;
+    std::vector<float> cached_value;
 
     for (size_t i = 0; i < num; ++i) {
       uint64_t key = pull_keys[i];
       auto itr = local_shard.find(key);
+      if (cache.enabled()) {
+        cache.RecordAccess(key);
+      }
+      if (itr == local_shard.end() &&
+          TakeCachedValue(shard_id, key, &cached_value)) {
+        itr = local_shard.find(key);
+      }
       if (itr == local_shard.end()) {
         cur_ctx->batch_index.push_back(i);
         cur_ctx->batch_keys.push_back(rocksdb::Slice(
@@ -348,6 +445,7 @@ int32_t SSDSparseTable::PushSparse(const uint64_t* keys,
                &task_keys]() -> int {
                 auto& keys = task_keys[shard_id];
                 auto& local_shard = _local_shards[shard_id];
+                std::vector<float> cached_value;
                 float data_buffer[value_col];  // NOLINT
                 float* data_buffer_ptr = data_buffer;
                 for (size_t i = 0; i < keys.size(); ++i) {
@@ -356,6 +454,11 @@ int32_t SSDSparseTable::PushSparse(const uint64_t* keys,
                   const float* update_data =
                       values + push_data_idx * update_value_col;
                   auto itr = local_shard.find(key);
+                  // update the cached value, a fresh one would shadow it
+                  if (itr == local_shard.end() &&
+                      TakeCachedValue(shard_id, key, &cached_value)) {
+                    itr = local_shard.find(key);
+                  }
                   if (itr == local_shard.end()) {
                     if (FLAGS_pserver_enable_create_feasign_randomly &&
                         !_value_accesor->CreateValue(1, update_data)) {
@@ -454,6 +557,7 @@ int32_t SSDSparseTable::PushSparse(const uint64_t* keys,
                &task_keys]() -> int {
                 auto& keys = task_keys[shard_id];
                 auto& local_shard = _local_shards[shard_id];
+                std::vector<float> cached_value;
                 float data_buffer[value_col];  // NOLINT
                 float* data_buffer_ptr = data_buffer;
                 for (size_t i = 0; i < keys.size(); ++i) {
@@ -461,6 +565,11 @@ int32_t SSDSparseTable::PushSparse(const uint64_t* keys,
                   uint64_t push_data_idx = keys[i].second;
                   const float* update_data = values[push_data_idx];
                   auto itr = local_shard.find(key);
+                  // update the cached value, a fresh one would shadow it
+                  if (itr == local_shard.end() &&
+                      TakeCachedValue(shard_id, key, &cached_value)) {
+                    itr = local_shard.find(key);
+                  }
                   if (itr == local_shard.end()) {
                     if (FLAGS_pserver_enable_create_feasign_randomly &&
                         !_value_accesor->CreateValue(1, update_data)) {
@@ -518,12 +627,16 @@ int32_t SSDSparseTable::Shrink(const std::string& param) {
 
     LOG(INFO) << "SSDSparseTable begin shrink shard:" << i;
     auto& shard = _local_shards[i];
-    for (auto it = shard.begin(); it != shard.end();) {
-      if (_value_accesor->Shrink(it.value().data())) {
-        it = shard.erase(it);
-        mem_count++;
-      } else {
-        ++it;
+    // shrink rewrites the values in rocksdb
+    _ssd_cache[i].Clear();
+    for (size_t bucket = 0; bucket < shard.bucket_count(); ++bucket) {
+      for (auto it = shard.begin(bucket); it != shard.end(bucket);) {
+        if (_value_accesor->Shrink(it.value().data())) {
+          it = shard.erase(bucket, it);
+          mem_count++;
+        } else {
+          ++it;
+        }
       }
     }
     auto* it = _db->get_iterator(i);
@@ -541,8 +654,10 @@ int32_t SSDSparseTable::Shrink(const std::string& param) {
       }
     }
     delete it;
+    size_t reclaimed = shard.reclaim();
     LOG(INFO) << "SSDSparseTable shrink success. shard:" << i << " delete MEM["
-              << mem_count << "] SSD[" << ssd_count << "]";
+              << mem_count << "] SSD[" << ssd_count << "] reclaimed "
+              << reclaimed << " bytes";
     // _db->flush(i);
   }
   return 0;
@@ -561,12 +676,15 @@ int32_t SSDSparseTable::UpdateTable() {
                  sizeof(uint64_t),
                  reinterpret_cast<const char*>(it.value().data()),
                  it.value().size() * sizeof(float));
+        // keep it at hand in case it is pulled again soon
+        _ssd_cache[i].Put(it.key(), it.value().data(), it.value().size());
         count++;
         it = shard.erase(it);
       } else {
         ++it;
       }
     }
+    shard.reclaim();
     _db->flush(i);
   }
   LOG(INFO) << "Table>> update count: " << count;
@@ -1528,6 +1646,9 @@ int32_t SSDSparseTable::SaveCache(
 int32_t SSDSparseTable::Load(const std::string& path,
                              const std::string& param) {
   VLOG(0) << "LOAD FLAGS_rocksdb_path:" << FLAGS_rocksdb_path;
+  for (auto& cache : _ssd_cache) {
+    cache.Clear();
+  }
   std::string table_path = TableDir(path);
   auto file_list = _afs_client.list(table_path);
 
@@ -1945,8 +2066,30 @@ int32_t SSDSparseTable::LoadWithBinary(const std::string& path, int param) {
   return 0;
 }
 
+TinyLfuCacheStat SSDSparseTable::SSDCacheStat() {
+  TinyLfuCacheStat stat;
+  for (auto& cache : _ssd_cache) {
+    stat += cache.Stat();
+  }
+  return stat;
+}
+
 std::pair<int64_t, int64_t> SSDSparseTable::PrintTableStat() {
   int64_t feasign_size = LocalSize();
+  auto cache_stat = SSDCacheStat();
+  uint64_t mem_hit = _pull_mem_hit;
+  uint64_t ssd_hit = _pull_ssd_hit;
+  uint64_t ssd_miss = _pull_ssd_miss;
+  uint64_t total = mem_hit + cache_stat.hit + ssd_hit + ssd_miss;
+  VLOG(0) << "SSDSparseTable table_id: " << _config.table_id()
+          << " mem feasign_size: " << feasign_size << " pull keys: " << total
+          << " mem_hit: " << mem_hit << " cache_hit: " << cache_stat.hit
+          << " ssd_hit: " << ssd_hit << " ssd_miss: " << ssd_miss
+          << " cache_hit_ratio: " << cache_stat.hit_ratio()
+          << " cache entries: " << cache_stat.entries
+          << " bytes: " << cache_stat.bytes << " admit: " << cache_stat.admit
+          << " reject: " << cache_stat.reject
+          << " evict: " << cache_stat.evict;
   return {feasign_size, -1};
 }
 
@@ -2081,14 +2224,18 @@ int32_t SSDSparseTable::CacheTable(uint16_t pass_id) {
               }
             }
 
+            auto& cache = _ssd_cache[shard_id];
             for (auto it = shard.begin(); it != shard.end();) {
               if (!_value_accesor->SaveMemCache(
                       it.value().data(), 0, show_threshold, pass_id)) {
+                // keep it at hand in case it is pulled again soon
+                cache.Put(it.key(), it.value().data(), it.value().size());
                 it = shard.erase(it);
               } else {
                 ++it;
               }
             }
+            shard.reclaim();
           }
           return 0;
         });
@@ -14,8 +14,11 @@
 
 #pragma once
 
+#include <atomic>
+
 #include "gflags/gflags.h"
 #include "paddle/fluid/distributed/ps/table/depends/rocksdb_warpper.h"
+#include "paddle/fluid/distributed/ps/table/depends/tiny_lfu_cache.h"
 #include "paddle/fluid/distributed/ps/table/memory_sparse_table.h"
 
 namespace paddle {
@@ -72,6 +75,9 @@ class SSDSparseTable : public MemorySparseTable {
 
   int32_t Push(TableContext& context) override;
 
+  // the values of a shard may be in rocksdb
+  bool SupportShardAccess() override { return false; }
+
   int32_t PullSparse(float* pull_values, const uint64_t* keys, size_t num);
   int32_t PullSparsePtr(int shard_id,
                         char** pull_values,
@@ -86,6 +92,7 @@ class SSDSparseTable : public MemorySparseTable {
   void Clear() override {
     for (int i = 0; i < _real_local_shard_num; ++i) {
       _local_shards[i].clear();
+      _ssd_cache[i].Clear();
     }
   }
 
@@ -122,8 +129,24 @@ class SSDSparseTable : public MemorySparseTable {
 
   int32_t CacheTable(uint16_t pass_id) override;
 
+  // counters of the pull path, summed over local shards
+  TinyLfuCacheStat SSDCacheStat();
+
  private:
+  // Moves key from the ssd cache of the shard to mem and deletes it from
+  // rocksdb, which the cache mirrors. buffer is scratch space. Returns false
+  // when key is not cached. The caller runs on the task thread of the shard.
+  bool TakeCachedValue(int shard_id, uint64_t key, std::vector<float>* buffer);
+
   RocksDBHandler* _db;
+  // Hot-key cache of values that live in rocksdb, one per local shard. It
+  // only mirrors rocksdb: CacheTable puts the values it moves to rocksdb,
+  // they leave it when a pull or a push moves them back to the shard, and it
+  // is dropped whenever rocksdb values are rewritten.
+  std::vector<TinyLfuCache> _ssd_cache;
+  std::atomic<uint64_t> _pull_mem_hit{0};
+  std::atomic<uint64_t> _pull_ssd_hit{0};
+  std::atomic<uint64_t> _pull_ssd_miss{0};
   int64_t _cache_tk_size;
   double _local_show_threshold{0.0};
   std::vector<paddle::framework::Channel<std::string>> _fs_channel;
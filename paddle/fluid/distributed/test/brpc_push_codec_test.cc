@@ -0,0 +1,284 @@
+/* Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "brpc/server.h"
+#include "gtest/gtest.h"
+#include "paddle/fluid/distributed/ps/service/brpc_ps_client.h"
+#include "paddle/fluid/distributed/ps/service/env.h"
+#include "paddle/fluid/distributed/ps/service/sparse_value_codec.h"
+#include "paddle/fluid/distributed/the_one_ps.pb.h"
+
+namespace paddle {
+namespace distributed {
+
+static const int kEmbedxDim = 8;
+// show, click, embed_w and embedx_w
+static const int kPullDim = 3 + kEmbedxDim;
+// slot, show, click, embed_g and embedx_g
+static const int kPushDim = 4 + kEmbedxDim;
+
+static float PulledValue(uint64_t key, int i) { return key * 0.5f + i; }
+
+// A server of a version before the sparse value codecs: it answers pulls in
+// float without echoing a compress type and reads pushes as floats. With
+// accept_fp16 it echoes the fp16 pushes and decodes them, as the current
+// server does.
+class OldPsService : public PsService {
+ public:
+  explicit OldPsService(bool accept = false) : accept_fp16(accept) {}
+
+  void service(::google::protobuf::RpcController* controller,
+               const PsRequestMessage* request,
+               PsResponseMessage* response,
+               ::google::protobuf::Closure* done) override {
+    brpc::ClosureGuard done_guard(done);
+    auto* cntl = static_cast<brpc::Controller*>(controller);
+    response->set_err_code(0);
+    response->set_err_msg("");
+    if (request->cmd_id() == PS_PULL_SPARSE_TABLE) {
+      uint32_t num = 0;
+      memcpy(&num, request->params(0).data(), sizeof(uint32_t));
+      std::string req = cntl->request_attachment().to_string();
+      // is_training, the keys and their counts
+      const char* keys = req.data() + sizeof(bool);
+      for (uint32_t i = 0; i < num; ++i) {
+        uint64_t key = 0;
+        memcpy(&key, keys + i * sizeof(uint64_t), sizeof(uint64_t));
+        std::vector<float> value(kPullDim);
+        for (int j = 0; j < kPullDim; ++j) {
+          value[j] = PulledValue(key, j);
+        }
+        cntl->response_attachment().append(value.data(),
+                                           kPullDim * sizeof(float));
+      }
+    } else if (request->cmd_id() == PS_PUSH_SPARSE_TABLE) {
+      std::lock_guard<std::mutex> lock(mutex);
+      uint32_t num = 0;
+      memcpy(&num, request->params(0).data(), sizeof(uint32_t));
+      push_params.push_back(request->params_size());
+      const std::string& data = request->data();
+      push_sizes.push_back(data.size());
+      SparseValueCodec codec(VALUE_FP32, kPushDim, kEmbedxDim);
+      if (accept_fp16 && request->params_size() == 2) {
+        uint32_t type = VALUE_FP16;
+        response->set_data(reinterpret_cast<char*>(&type), sizeof(uint32_t));
+        codec = SparseValueCodec(VALUE_FP16, kPushDim, kEmbedxDim);
+      }
+      if (data.size() != num * (sizeof(uint64_t) + codec.encoded_size())) {
+        return;
+      }
+      const char* values = data.data() + num * sizeof(uint64_t);
+      for (uint32_t i = 0; i < num; ++i) {
+        uint64_t key = 0;
+        memcpy(&key, data.data() + i * sizeof(uint64_t), sizeof(uint64_t));
+        auto& value = pushed[key];
+        value.resize(kPushDim);
+        codec.Decode(values + i * codec.encoded_size(), value.data());
+      }
+    }
+  }
+
+  bool accept_fp16;
+  std::mutex mutex;
+  std::vector<int> push_params;
+  std::vector<size_t> push_sizes;
+  std::map<uint64_t, std::vector<float>> pushed;
+};
+
+static void GetSparseTableProto(TableParameter* table_proto,
+                                ValueCompressType pull_compress_type) {
+  table_proto->set_table_id(0);
+  table_proto->set_table_class("MemorySparseTable");
+  table_proto->set_shard_num(10);
+  table_proto->set_type(PS_SPARSE_TABLE);
+  auto* accessor_config = table_proto->mutable_accessor();
+  accessor_config->set_accessor_class("CtrCommonAccessor");
+  accessor_config->set_fea_dim(11);
+  accessor_config->set_embedx_dim(kEmbedxDim);
+  accessor_config->set_embedx_threshold(0);
+  accessor_config->set_pull_compress_type(pull_compress_type);
+  accessor_config->set_push_compress_type(VALUE_FP16);
+  for (auto* sgd_param : {accessor_config->mutable_embed_sgd_param(),
+                          accessor_config->mutable_embedx_sgd_param()}) {
+    sgd_param->set_name("SparseNaiveSGDRule");
+    auto* naive_param = sgd_param->mutable_naive();
+    naive_param->set_learning_rate(0.1);
+    naive_param->set_initial_range(0.3);
+    naive_param->add_weight_bounds(-10.0);
+    naive_param->add_weight_bounds(10.0);
+  }
+}
+
+static PSParameter GetWorkerProto(ValueCompressType pull_compress_type) {
+  PSParameter worker_proto;
+  GetSparseTableProto(worker_proto.mutable_worker_param()
+                          ->mutable_downpour_worker_param()
+                          ->add_downpour_table_param(),
+                      pull_compress_type);
+  auto* server_proto =
+      worker_proto.mutable_server_param()->mutable_downpour_server_param();
+  auto* service_proto = server_proto->mutable_service_param();
+  service_proto->set_service_class("BrpcPsService");
+  service_proto->set_server_class("BrpcPsServer");
+  service_proto->set_client_class("BrpcPsClient");
+  service_proto->set_start_server_port(0);
+  service_proto->set_server_thread_num(4);
+  GetSparseTableProto(server_proto->add_downpour_table_param(),
+                      pull_compress_type);
+  return worker_proto;
+}
+
+static int Push(PSClient* client,
+                const std::vector<uint64_t>& keys,
+                const std::vector<float>& values) {
+  std::vector<const float*> value_ptrs;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    value_ptrs.push_back(values.data() + i * kPushDim);
+  }
+  auto* closure = new DownpourBrpcClosure(1, [](void* done) {
+    auto* closure = reinterpret_cast<DownpourBrpcClosure*>(done);
+    closure->set_promise_value(
+        closure->check_response(0, PS_PUSH_SPARSE_TABLE));
+  });
+  auto status = client->PushSparseRawGradient(
+      0, keys.data(), value_ptrs.data(), keys.size(), closure);
+  status.wait();
+  return status.get();
+}
+
+// Starts service on a local port and a client of a sparse table pushed in
+// fp16 connected to it.
+class PushCodecTest {
+ public:
+  PushCodecTest(PsService* service, ValueCompressType pull_compress_type) {
+    setenv("http_proxy", "", 1);
+    setenv("https_proxy", "", 1);
+    EXPECT_EQ(server.AddService(service, brpc::SERVER_DOESNT_OWN_SERVICE), 0);
+    brpc::ServerOptions options;
+    EXPECT_EQ(server.Start("127.0.0.1", brpc::PortRange(4300, 4400), &options),
+              0);
+    std::vector<std::string> host_sign_list = {
+        PSHost("127.0.0.1", server.listen_address().port, 0)
+            .SerializeToString()};
+    PSParameter worker_proto = GetWorkerProto(pull_compress_type);
+    env.SetPsServers(&host_sign_list, 1);
+    std::map<uint64_t, std::vector<Region>> dense_regions;
+    client.reset(PSClientFactory::Create(worker_proto));
+    EXPECT_EQ(client->Configure(worker_proto, dense_regions, env, 0), 0);
+  }
+  ~PushCodecTest() {
+    client->FinalizeWorker();
+    server.Stop(0);
+    server.Join();
+  }
+
+  brpc::Server server;
+  PaddlePSEnvironment env;
+  std::unique_ptr<PSClient> client;
+};
+
+static std::vector<float> PushValues(size_t key_num) {
+  std::vector<float> push_values(key_num * kPushDim);
+  for (size_t i = 0; i < push_values.size(); ++i) {
+    // values fp16 can not hold exactly
+    push_values[i] = 1.0f + i / 3.0f;
+  }
+  return push_values;
+}
+
+TEST(BrpcPsClient, PushInFloatToOldServer) {
+  OldPsService service;
+  PushCodecTest test(&service, VALUE_FP16);
+  PSClient* client = test.client.get();
+
+  std::vector<uint64_t> keys = {1, 7, 42, 1000};
+  std::vector<float> push_values = PushValues(keys.size());
+  auto check_pushed = [&]() {
+    std::lock_guard<std::mutex> lock(service.mutex);
+    ASSERT_FALSE(service.push_params.empty());
+    // no compress type param and the rows in float
+    EXPECT_EQ(service.push_params.back(), 1);
+    EXPECT_EQ(service.push_sizes.back(),
+              keys.size() * (sizeof(uint64_t) + kPushDim * sizeof(float)));
+    for (size_t i = 0; i < keys.size(); ++i) {
+      std::vector<float> expected(push_values.begin() + i * kPushDim,
+                                  push_values.begin() + (i + 1) * kPushDim);
+      EXPECT_EQ(service.pushed[keys[i]], expected);
+    }
+  };
+  // before any pull
+  ASSERT_EQ(Push(client, keys, push_values), 0);
+  check_pushed();
+  {
+    // the empty push asking for fp16 went first
+    std::lock_guard<std::mutex> lock(service.mutex);
+    ASSERT_EQ(service.push_params.size(), 2u);
+    EXPECT_EQ(service.push_params[0], 2);
+    EXPECT_EQ(service.push_sizes[0], 0u);
+  }
+
+  // the pull answered in float leaves the pushes in float
+  std::vector<float> pull_values(keys.size() * kPullDim);
+  std::vector<float*> pull_ptrs;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    pull_ptrs.push_back(pull_values.data() + i * kPullDim);
+  }
+  auto pull_status =
+      client->PullSparse(pull_ptrs.data(), 0, keys.data(), keys.size(), true);
+  pull_status.wait();
+  ASSERT_EQ(pull_status.get(), 0);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    for (int j = 0; j < kPullDim; ++j) {
+      EXPECT_EQ(pull_values[i * kPullDim + j], PulledValue(keys[i], j));
+    }
+  }
+  for (auto& value : push_values) {
+    value += 0.25f;
+  }
+  ASSERT_EQ(Push(client, keys, push_values), 0);
+  check_pushed();
+}
+
+TEST(BrpcPsClient, PushCompressedWithFloatPull) {
+  // the pulls in float do not hold the pushes back
+  OldPsService service(true);
+  PushCodecTest test(&service, VALUE_FP32);
+
+  std::vector<uint64_t> keys = {1, 7, 42, 1000};
+  std::vector<float> push_values = PushValues(keys.size());
+  ASSERT_EQ(Push(test.client.get(), keys, push_values), 0);
+  SparseValueCodec codec(VALUE_FP16, kPushDim, kEmbedxDim);
+  std::lock_guard<std::mutex> lock(service.mutex);
+  ASSERT_EQ(service.push_params.size(), 2u);
+  EXPECT_EQ(service.push_params.back(), 2);
+  EXPECT_EQ(service.push_sizes.back(),
+            keys.size() * (sizeof(uint64_t) + codec.encoded_size()));
+  for (size_t i = 0; i < keys.size(); ++i) {
+    std::vector<char> encoded(codec.encoded_size());
+    std::vector<float> expected(kPushDim);
+    codec.Encode(push_values.data() + i * kPushDim, encoded.data());
+    codec.Decode(encoded.data(), expected.data());
+    EXPECT_EQ(service.pushed[keys[i]], expected);
+  }
+}
+
+}  // namespace distributed
+}  // namespace paddle
@@ -46,5 +46,49 @@ TEST(BENCHMARK, LargeScaleKV) {
   ASSERT_FLOAT_EQ(value_data[3], 0.3);
 }
 
+TEST(FeatureValueArena, ReclaimAfterShrink) {
+  typedef SparseTableShard<uint64_t, FixedFeatureValue> shard_type;
+  shard_type shard;
+  // mixed payload dims, like CtrDymfAccessor with several mf_dim
+  std::vector<size_t> dims = {9, 17, 73};
+  for (uint64_t key = 0; key < 30000; ++key) {
+    auto& value = shard[key];
+    value.resize(dims[key % dims.size()]);
+    for (size_t i = 0; i < value.size(); ++i) {
+      value.data()[i] = key + i;
+    }
+  }
+  auto stat = shard.arena_stat();
+  ASSERT_EQ(stat.value_num, 30000UL);
+  ASSERT_GT(stat.occupancy(), 0.9);
+
+  // growing keeps the prefix and zero-fills the tail
+  auto& grown = shard[3];
+  grown.resize(73);
+  ASSERT_FLOAT_EQ(grown.data()[8], 11.0);
+  ASSERT_FLOAT_EQ(grown.data()[72], 0.0);
+
+  // erase every value of dim 73, their slabs must be returned in bulk
+  for (size_t bucket = 0; bucket < shard.bucket_count(); ++bucket) {
+    for (auto it = shard.begin(bucket); it != shard.end(bucket);) {
+      if (it.value().size() == 73) {
+        it = shard.erase(bucket, it);
+      } else {
+        ++it;
+      }
+    }
+  }
+  ASSERT_GT(shard.reclaim(), 0UL);
+  stat = shard.arena_stat();
+  ASSERT_EQ(stat.value_num, shard.size());
+  for (auto it = shard.begin(); it != shard.end(); ++it) {
+    ASSERT_FLOAT_EQ(it.value().data()[1], it.key() + 1);
+  }
+
+  shard.clear();
+  shard.reclaim();
+  ASSERT_EQ(shard.arena_stat().slab_num, 0UL);
+}
+
 }  // namespace distributed
 }  // namespace paddle
@@ -0,0 +1,252 @@
+/* Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "paddle/fluid/distributed/ps/table/memory_flat_sparse_table.h"
+
+#include <ThreadPool.h>
+
+#include <chrono>  // NOLINT
+#include <future>
+#include <random>
+#include <string>
+#include <thread>  // NOLINT
+
+#include "gtest/gtest.h"
+#include "paddle/fluid/distributed/ps/table/memory_sparse_table.h"
+#include "paddle/fluid/framework/channel.h"
+#include "paddle/fluid/distributed/ps/table/table.h"
+#include "paddle/fluid/distributed/the_one_ps.pb.h"
+
+// Use --flat_sparse_table_bench_key_num=100000000 to reproduce the
+// 10^8 keys per server numbers.
+DEFINE_int64(flat_sparse_table_bench_key_num,
+             200000,
+             "number of distinct keys inserted by the benchmark");
+DEFINE_int32(flat_sparse_table_bench_threads,
+             8,
+             "number of client threads issuing pull/push in the benchmark");
+
+namespace paddle {
+namespace distributed {
+
+static void InitTableConfig(const std::string &table_class,
+                            TableParameter *table_config) {
+  table_config->set_table_class(table_class);
+  table_config->set_shard_num(10);
+  TableAccessorParameter *accessor_config = table_config->mutable_accessor();
+  accessor_config->set_accessor_class("CtrCommonAccessor");
+  accessor_config->set_fea_dim(11);
+  accessor_config->set_embedx_dim(8);
+  accessor_config->set_embedx_threshold(5);
+  accessor_config->mutable_ctr_accessor_param()->set_nonclk_coeff(0.2);
+  accessor_config->mutable_ctr_accessor_param()->set_click_coeff(1);
+  accessor_config->mutable_ctr_accessor_param()->set_base_threshold(0.5);
+  accessor_config->mutable_ctr_accessor_param()->set_delta_threshold(0.2);
+  accessor_config->mutable_ctr_accessor_param()->set_delta_keep_days(16);
+  accessor_config->mutable_ctr_accessor_param()->set_show_click_decay_rate(
+      0.99);
+
+  accessor_config->mutable_embed_sgd_param()->set_name("SparseNaiveSGDRule");
+  auto *naive_param =
+      accessor_config->mutable_embed_sgd_param()->mutable_naive();
+  naive_param->set_learning_rate(0.1);
+  naive_param->set_initial_range(0.0);
+  naive_param->add_weight_bounds(-10.0);
+  naive_param->add_weight_bounds(10.0);
+
+  accessor_config->mutable_embedx_sgd_param()->set_name("SparseNaiveSGDRule");
+  naive_param = accessor_config->mutable_embedx_sgd_param()->mutable_naive();
+  naive_param->set_learning_rate(0.1);
+  naive_param->set_initial_range(0.0);
+  naive_param->add_weight_bounds(-10.0);
+  naive_param->add_weight_bounds(10.0);
+}
+
+static Table *CreateTable(const std::string &table_class) {
+  TableParameter table_config;
+  InitTableConfig(table_class, &table_config);
+  FsClientParameter fs_config;
+  Table *table = CREATE_PSCORE_CLASS(Table, table_class);
+  table->SetShard(0, 1);
+  EXPECT_EQ(table->Initialize(table_config, fs_config), 0);
+  return table;
+}
+
+static void PullValues(Table *table,
+                       std::vector<uint64_t> *keys,
+                       std::vector<uint32_t> *fres,
+                       int emb_dim,
+                       std::vector<float> *values) {
+  values->resize(keys->size() * (emb_dim + 3));
+  auto value = PullSparseValue(*keys, *fres, emb_dim);
+  TableContext table_context;
+  table_context.value_type = Sparse;
+  table_context.pull_context.pull_value = value;
+  table_context.pull_context.values = values->data();
+  ASSERT_EQ(table->Pull(table_context), 0);
+}
+
+static void PushValues(Table *table,
+                       const std::vector<uint64_t> &keys,
+                       const std::vector<float> &grads) {
+  TableContext table_context;
+  table_context.value_type = Sparse;
+  table_context.push_context.keys = keys.data();
+  table_context.push_context.values = grads.data();
+  table_context.num = keys.size();
+  ASSERT_EQ(table->Push(table_context), 0);
+}
+
+TEST(MemoryFlatSparseTable, SameResultAsMemorySparseTable) {
+  int emb_dim = 8;
+  int push_dim = emb_dim + 4;
+  std::unique_ptr<Table> flat(CreateTable("MemoryFlatSparseTable"));
+  std::unique_ptr<Table> base(CreateTable("MemorySparseTable"));
+
+  std::vector<uint64_t> keys;
+  std::vector<uint32_t> fres;
+  for (uint64_t i = 0; i < 1000; ++i) {
+    keys.push_back(i * 7919);
+    fres.push_back(1);
+  }
+  // enough show/click for part of the keys to extend mf
+  std::vector<float> grads(keys.size() * push_dim);
+  for (int step = 0; step < 4; ++step) {
+    for (size_t i = 0; i < keys.size(); ++i) {
+      float *g = grads.data() + i * push_dim;
+      g[0] = 0;                          // slot
+      g[1] = static_cast<float>(i % 3);  // show
+      g[2] = static_cast<float>(i % 2);  // click
+      for (int k = 3; k < push_dim; ++k) {
+        g[k] = 0.01 * k + 0.001 * step;
+      }
+    }
+    PushValues(flat.get(), keys, grads);
+    PushValues(base.get(), keys, grads);
+  }
+
+  std::vector<float> flat_values, base_values;
+  PullValues(flat.get(), &keys, &fres, emb_dim, &flat_values);
+  PullValues(base.get(), &keys, &fres, emb_dim, &base_values);
+  ASSERT_EQ(flat_values.size(), base_values.size());
+  for (size_t i = 0; i < flat_values.size(); ++i) {
+    ASSERT_FLOAT_EQ(flat_values[i], base_values[i]) << "index " << i;
+  }
+  ASSERT_EQ(flat->PrintTableStat(), base->PrintTableStat());
+
+  flat->Shrink("");
+  base->Shrink("");
+  ASSERT_EQ(flat->PrintTableStat(), base->PrintTableStat());
+}
+
+TEST(MemoryFlatSparseTable, SnapshotBucket) {
+  FlatSparseTableShard<uint64_t> shard;
+  shard.Init(5);
+  for (uint64_t key = 1; key <= 200; ++key) {
+    shard.Upsert(
+        key,
+        [key](float *value) { return key % 2 == 0 ? 5 : 3; },
+        [key](float *value, uint32_t *dim) {
+          for (uint32_t k = 0; k < *dim; ++k) {
+            value[k] = key + k;
+          }
+        });
+  }
+  std::vector<uint64_t> keys;
+  std::vector<uint32_t> dims;
+  std::vector<float> values;
+  size_t total = 0;
+  for (size_t bucket = 0; bucket < shard.bucket_count(); ++bucket) {
+    shard.Snapshot(bucket, &keys, &dims, &values);
+    ASSERT_EQ(keys.size(), shard.bucket_size(bucket));
+    for (size_t i = 0; i < keys.size(); ++i) {
+      ASSERT_EQ(dims[i], keys[i] % 2 == 0 ? 5u : 3u);
+      for (uint32_t k = 0; k < dims[i]; ++k) {
+        EXPECT_EQ(values[i * shard.value_dim() + k], keys[i] + k);
+      }
+    }
+    total += keys.size();
+  }
+  EXPECT_EQ(total, 200u);
+}
+
+TEST(MemoryFlatSparseTable, CacheShuffleRejectsFlatTable) {
+  std::unique_ptr<Table> flat(CreateTable("MemoryFlatSparseTable"));
+  std::unique_ptr<Table> base(CreateTable("MemorySparseTable"));
+  auto channel =
+      paddle::framework::MakeChannel<std::pair<uint64_t, std::string>>();
+  auto send_msg = [](int msg_type, int to_pserver_id, std::string &msg) {
+    std::promise<int32_t> promise;
+    promise.set_value(0);
+    return promise.get_future();
+  };
+  EXPECT_EQ(base->CacheShuffle("", "0", 0, send_msg, channel, {flat.get()}),
+            -1);
+}
+
+// Side-by-side PullSparse/PushSparse throughput of the two backends.
+static void RunBenchmark(const std::string &table_class) {
+  int emb_dim = 8;
+  int push_dim = emb_dim + 4;
+  int64_t key_num = FLAGS_flat_sparse_table_bench_key_num;
+  int thread_num = FLAGS_flat_sparse_table_bench_threads;
+  const size_t batch = 4096;
+  std::unique_ptr<Table> table(CreateTable(table_class));
+
+  auto run = [&](bool is_push) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_num; ++t) {
+      threads.emplace_back([&, t]() {
+        std::mt19937_64 rng(t);
+        std::vector<uint64_t> keys(batch);
+        std::vector<uint32_t> fres(batch, 1);
+        std::vector<float> grads(batch * push_dim, 0.1);
+        std::vector<float> values;
+        for (int64_t begin = t * batch; begin < key_num;
+             begin += thread_num * batch) {
+          for (size_t i = 0; i < batch; ++i) {
+            keys[i] = is_push ? (begin + i) % key_num : rng() % key_num;
+          }
+          if (is_push) {
+            PushValues(table.get(), keys, grads);
+          } else {
+            PullValues(table.get(), &keys, &fres, emb_dim, &values);
+          }
+        }
+      });
+    }
+    for (auto &th : threads) {
+      th.join();
+    }
+    double sec = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+    VLOG(3) << table_class << (is_push ? " PushSparse " : " PullSparse ")
+            << key_num << " keys, " << thread_num << " threads: " << sec
+            << " s, " << key_num / sec / 1e6 << " M keys/s";
+  };
+  run(true);   // insert every key once
+  run(true);   // update existing keys
+  run(false);  // random pulls
+  VLOG(3) << table_class << " local size: " << table->PrintTableStat().first;
+}
+
+TEST(MemoryFlatSparseTable, PullPushBenchmark) {
+  RunBenchmark("MemorySparseTable");
+  RunBenchmark("MemoryFlatSparseTable");
+}
+
+}  // namespace distributed
+}  // namespace paddle
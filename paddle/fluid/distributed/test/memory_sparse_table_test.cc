@@ -152,5 +152,91 @@ TEST(MemorySparseTable, SGD) {
   }
 }
 
+TEST(MemorySparseTable, ShardAccess) {
+  int emb_dim = 8;
+  TableParameter table_config;
+  table_config.set_table_class("MemorySparseTable");
+  table_config.set_shard_num(10);
+  FsClientParameter fs_config;
+  MemorySparseTable *table = new MemorySparseTable();
+  table->SetShard(0, 1);
+
+  TableAccessorParameter *accessor_config = table_config.mutable_accessor();
+  accessor_config->set_accessor_class("CtrCommonAccessor");
+  accessor_config->set_fea_dim(11);
+  accessor_config->set_embedx_dim(emb_dim);
+  accessor_config->set_embedx_threshold(5);
+  accessor_config->mutable_embed_sgd_param()->set_name("SparseNaiveSGDRule");
+  auto *naive_param =
+      accessor_config->mutable_embed_sgd_param()->mutable_naive();
+  naive_param->set_learning_rate(0.1);
+  naive_param->set_initial_range(0.3);
+  naive_param->add_weight_bounds(-10.0);
+  naive_param->add_weight_bounds(10.0);
+  accessor_config->mutable_embedx_sgd_param()->set_name("SparseNaiveSGDRule");
+  naive_param = accessor_config->mutable_embedx_sgd_param()->mutable_naive();
+  naive_param->set_learning_rate(0.1);
+  naive_param->set_initial_range(0.3);
+  naive_param->add_weight_bounds(-10.0);
+  naive_param->add_weight_bounds(10.0);
+  ASSERT_EQ(table->Initialize(table_config, fs_config), 0);
+  ASSERT_TRUE(table->SupportShardAccess());
+
+  // the keys grouped by shard as a client does
+  std::vector<uint64_t> keys;
+  for (uint64_t key = 0; key < 1000; ++key) {
+    keys.push_back(key * 7919);
+  }
+  std::vector<std::vector<std::pair<uint64_t, int>>> shard_keys(
+      table->LocalShardNum());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    shard_keys[table->LocalShardOf(keys[i])].push_back({keys[i], i});
+  }
+
+  // threads push a show of each key shard by shard, concurrently with the
+  // pushes of the shard threads
+  const int trainers = 4;
+  std::vector<float> gradient(keys.size() * (emb_dim + 4), 0);
+  std::vector<const float *> gradient_ptrs(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    gradient[i * (emb_dim + 4) + 1] = 1;
+    gradient_ptrs[i] = gradient.data() + i * (emb_dim + 4);
+  }
+  std::vector<std::thread> threads;
+  for (int t = 0; t < trainers; ++t) {
+    threads.emplace_back([&, t] {
+      for (size_t i = 0; i < shard_keys.size(); ++i) {
+        auto &keys_of_shard = shard_keys[(i + t) % shard_keys.size()];
+        table->PushSparseShard((i + t) % shard_keys.size(),
+                               keys_of_shard.data(),
+                               keys_of_shard.size(),
+                               gradient_ptrs.data());
+      }
+    });
+  }
+  threads.emplace_back([&] {
+    table->PushSparse(keys.data(), gradient_ptrs.data(), keys.size());
+  });
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // both pulls give the same values
+  std::vector<char *> ptrs(keys.size());
+  std::vector<char *> shard_ptrs(keys.size());
+  table->PullSparsePtr(0, ptrs.data(), keys.data(), keys.size(), 0);
+  for (size_t i = 0; i < shard_keys.size(); ++i) {
+    table->PullSparsePtrShard(
+        i, shard_keys[i].data(), shard_keys[i].size(), shard_ptrs.data());
+  }
+  for (size_t i = 0; i < keys.size(); ++i) {
+    ASSERT_EQ(ptrs[i], shard_ptrs[i]);
+    auto *value = reinterpret_cast<FixedFeatureValue *>(ptrs[i]);
+    // slot, unseen_days, delta_score, show
+    EXPECT_FLOAT_EQ(value->data()[3], trainers + 1);
+  }
+  delete table;
+}
+
 }  // namespace distributed
 }  // namespace paddle
@@ -0,0 +1,142 @@
+/* Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "paddle/fluid/distributed/ps/service/ps_local_client.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/fluid/distributed/ps/service/env.h"
+#include "paddle/fluid/distributed/ps/table/memory_sparse_table.h"
+#include "paddle/fluid/distributed/the_one_ps.pb.h"
+
+DECLARE_bool(pserver_local_shard_parallel);
+
+namespace paddle {
+namespace distributed {
+
+static const int kEmbedxDim = 8;
+// slot, show, click, embed_g and embedx_g
+static const int kPushDim = 4 + kEmbedxDim;
+
+static PSParameter MakeLocalPsParameter() {
+  PSParameter ps_param;
+  auto* table_param = ps_param.mutable_server_param()
+                          ->mutable_downpour_server_param()
+                          ->add_downpour_table_param();
+  table_param->set_table_id(0);
+  table_param->set_table_class("MemorySparseTable");
+  table_param->set_shard_num(10);
+  auto* accessor_config = table_param->mutable_accessor();
+  accessor_config->set_accessor_class("CtrCommonAccessor");
+  accessor_config->set_fea_dim(11);
+  accessor_config->set_embedx_dim(kEmbedxDim);
+  accessor_config->set_embedx_threshold(5);
+  auto* ctr_param = accessor_config->mutable_ctr_accessor_param();
+  ctr_param->set_nonclk_coeff(0.2);
+  ctr_param->set_click_coeff(1);
+  ctr_param->set_delete_threshold(0.8);
+  ctr_param->set_show_click_decay_rate(0.99);
+  for (auto* sgd_param : {accessor_config->mutable_embed_sgd_param(),
+                          accessor_config->mutable_embedx_sgd_param()}) {
+    sgd_param->set_name("SparseNaiveSGDRule");
+    auto* naive_param = sgd_param->mutable_naive();
+    naive_param->set_learning_rate(0.1);
+    naive_param->set_initial_range(0.3);
+    naive_param->add_weight_bounds(-10.0);
+    naive_param->add_weight_bounds(10.0);
+  }
+  return ps_param;
+}
+
+// exposes the table the client serves
+class TestPsLocalClient : public PsLocalClient {
+ public:
+  MemorySparseTable* SparseTable() {
+    return dynamic_cast<MemorySparseTable*>(GetTable(0));
+  }
+};
+
+TEST(PsLocalClient, PullPushWhileShrink) {
+  FLAGS_pserver_local_shard_parallel = true;
+  PSParameter ps_param = MakeLocalPsParameter();
+  PaddlePSEnvironment env;
+  TestPsLocalClient client;
+  ASSERT_EQ(client.Configure(ps_param, {}, env, 0), 0);
+  auto* table = client.SparseTable();
+  ASSERT_NE(table, nullptr);
+
+  // the hot keys are pushed shows and clicks enough to outlive the shrinks,
+  // the cold ones are only pulled and go at the first shrink
+  const uint64_t hot_num = 2000;
+  const uint64_t cold_num = 2000;
+  std::vector<uint64_t> hot_keys(hot_num);
+  std::vector<uint64_t> cold_keys(cold_num);
+  for (uint64_t i = 0; i < hot_num; ++i) {
+    hot_keys[i] = i * 7 + 1;
+  }
+  for (uint64_t i = 0; i < cold_num; ++i) {
+    cold_keys[i] = (hot_num + i) * 7 + 1;
+  }
+  std::vector<float> push_value(kPushDim, 0.01f);
+  push_value[0] = 1;   // slot
+  push_value[1] = 10;  // show
+  push_value[2] = 10;  // click
+  std::vector<const float*> push_values(hot_num, push_value.data());
+
+  std::atomic<bool> done{false};
+  std::atomic<int> null_pulls{0};
+  std::vector<std::thread> workers;
+  for (int t = 0; t < 4; ++t) {
+    const auto& keys = t % 2 == 0 ? hot_keys : cold_keys;
+    workers.emplace_back([&, t, keys]() {
+      std::vector<char*> pull_values(keys.size());
+      for (int round = 0; round < 50; ++round) {
+        std::fill(pull_values.begin(), pull_values.end(), nullptr);
+        client.PullSparsePtr(
+            0, pull_values.data(), 0, keys.data(), keys.size(), 0);
+        for (auto* value : pull_values) {
+          null_pulls += value == nullptr;
+        }
+        if (t % 2 == 0) {
+          client.PushSparse(0, keys.data(), push_values.data(), keys.size());
+        }
+      }
+    });
+  }
+  std::thread shrinker([&]() {
+    // few enough shrinks for the decayed shows of the hot keys to stay
+    for (int i = 0; i < 100 && !done; ++i) {
+      table->Shrink("");
+      table->LocalSize();
+      table->LocalMFSize();
+    }
+  });
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  done = true;
+  shrinker.join();
+  EXPECT_EQ(null_pulls, 0);
+
+  // the hot keys outlive a last shrink, the cold ones do not
+  table->Shrink("");
+  EXPECT_EQ(table->LocalSize(), static_cast<int64_t>(hot_num));
+}
+
+}  // namespace distributed
+}  // namespace paddle
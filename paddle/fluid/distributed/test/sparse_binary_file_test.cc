@@ -0,0 +1,244 @@
+/* Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "paddle/fluid/distributed/ps/table/sparse_binary_file.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/fluid/distributed/ps/table/memory_sparse_table.h"
+#include "paddle/fluid/distributed/ps/table/table.h"
+#include "paddle/fluid/distributed/the_one_ps.pb.h"
+#include "paddle/fluid/framework/io/fs.h"
+
+DECLARE_bool(pserver_sparse_binary_lazy_load);
+
+namespace paddle {
+namespace distributed {
+
+TEST(SparseBinaryFile, WriteAndRead) {
+  std::string path = "./sparse_binary_file_test/part-000-00000.bin";
+  AfsClient afs_client;
+  FsChannelConfig channel_config;
+  channel_config.path = path;
+  int err_no = 0;
+  auto write_channel = afs_client.open_w(channel_config, 0, &err_no);
+  SparseBinaryFileWriter writer(write_channel, 64);
+  std::vector<float> value(32);
+  for (uint64_t key = 0; key < 1000; ++key) {
+    uint32_t dim = key % 2 == 0 ? 11 : 32;
+    for (uint32_t i = 0; i < dim; ++i) {
+      value[i] = key + i * 0.5;
+    }
+    ASSERT_EQ(writer.Append(key * 3, value.data(), dim), 0);
+  }
+  ASSERT_EQ(writer.Finish(), 0);
+  write_channel->close();
+  ASSERT_EQ(err_no, 0);
+
+  {
+    SparseBinaryFile file;
+    ASSERT_EQ(file.Open(path, &afs_client), 0);
+    ASSERT_TRUE(file.is_mapped());
+    ASSERT_EQ(file.key_num(), 1000UL);
+    ASSERT_EQ(file.block_num(), 16U);
+    for (uint64_t key = 0; key < 1000; ++key) {
+      uint32_t dim = 0;
+      const float* found = file.Find(key * 3, &dim);
+      ASSERT_NE(found, nullptr);
+      ASSERT_EQ(dim, key % 2 == 0 ? 11U : 32U);
+      ASSERT_FLOAT_EQ(found[dim - 1], key + (dim - 1) * 0.5);
+      ASSERT_EQ(file.Find(key * 3 + 1, &dim), nullptr);
+    }
+    uint64_t count = 0;
+    ASSERT_EQ(file.ForEach([&count](uint64_t key, const float* v, uint32_t) {
+      ASSERT_EQ(key, count * 3);
+      ASSERT_FLOAT_EQ(v[0], count);
+      ++count;
+    }),
+              0);
+    ASSERT_EQ(count, 1000UL);
+  }
+
+  // flip one value byte, the block checksum has to catch it
+  FILE* fp = fopen(path.c_str(), "r+b");
+  ASSERT_NE(fp, nullptr);
+  fseek(fp, 4096, SEEK_SET);
+  int c = fgetc(fp);
+  fseek(fp, 4096, SEEK_SET);
+  fputc(c ^ 0xff, fp);
+  fclose(fp);
+  SparseBinaryFile file;
+  ASSERT_EQ(file.Open(path, &afs_client), 0);
+  ASSERT_EQ(file.ForEach([](uint64_t, const float*, uint32_t) {}), -1);
+  paddle::framework::fs_remove("./sparse_binary_file_test");
+}
+
+static Table* CreateTable(bool binary_checkpoint) {
+  TableParameter table_config;
+  table_config.set_table_class("MemorySparseTable");
+  table_config.set_shard_num(10);
+  table_config.set_binary_checkpoint(binary_checkpoint);
+  TableAccessorParameter* accessor_config = table_config.mutable_accessor();
+  accessor_config->set_accessor_class("CtrCommonAccessor");
+  accessor_config->set_fea_dim(11);
+  accessor_config->set_embedx_dim(8);
+  accessor_config->set_embedx_threshold(5);
+  accessor_config->mutable_ctr_accessor_param()->set_nonclk_coeff(0.2);
+  accessor_config->mutable_ctr_accessor_param()->set_click_coeff(1);
+  accessor_config->mutable_ctr_accessor_param()->set_base_threshold(0.5);
+  accessor_config->mutable_ctr_accessor_param()->set_delta_threshold(0.2);
+  accessor_config->mutable_ctr_accessor_param()->set_delta_keep_days(16);
+  accessor_config->mutable_ctr_accessor_param()->set_show_click_decay_rate(
+      0.99);
+  for (auto* sgd_param : {accessor_config->mutable_embed_sgd_param(),
+                          accessor_config->mutable_embedx_sgd_param()}) {
+    sgd_param->set_name("SparseNaiveSGDRule");
+    auto* naive_param = sgd_param->mutable_naive();
+    naive_param->set_learning_rate(0.1);
+    naive_param->set_initial_range(0.0);
+    naive_param->add_weight_bounds(-10.0);
+    naive_param->add_weight_bounds(10.0);
+  }
+  FsClientParameter fs_config;
+  Table* table = new MemorySparseTable();
+  table->SetShard(0, 1);
+  EXPECT_EQ(table->Initialize(table_config, fs_config), 0);
+  return table;
+}
+
+static void PullValues(Table* table,
+                       const std::vector<uint64_t>& keys,
+                       std::vector<float>* values) {
+  int emb_dim = 8;
+  std::vector<uint32_t> fres(keys.size(), 1);
+  values->resize(keys.size() * (emb_dim + 3));
+  auto value = PullSparseValue(keys, fres, emb_dim);
+  TableContext table_context;
+  table_context.value_type = Sparse;
+  table_context.pull_context.pull_value = value;
+  table_context.pull_context.values = values->data();
+  ASSERT_EQ(table->Pull(table_context), 0);
+}
+
+static void ExpectSameValues(Table* expect,
+                             Table* actual,
+                             const std::vector<uint64_t>& keys) {
+  std::vector<float> expect_values, actual_values;
+  PullValues(expect, keys, &expect_values);
+  PullValues(actual, keys, &actual_values);
+  ASSERT_EQ(expect_values.size(), actual_values.size());
+  for (size_t i = 0; i < expect_values.size(); ++i) {
+    ASSERT_FLOAT_EQ(expect_values[i], actual_values[i]) << "index " << i;
+  }
+}
+
+TEST(SparseBinaryFile, MemorySparseTableSaveLoad) {
+  std::string text_dir = "./sparse_binary_table_test/text";
+  std::string binary_dir = "./sparse_binary_table_test/binary";
+  std::unique_ptr<Table> base(CreateTable(false));
+  std::unique_ptr<Table> binary(CreateTable(true));
+
+  int push_dim = 8 + 4;
+  std::vector<uint64_t> keys;
+  for (uint64_t i = 0; i < 5000; ++i) {
+    keys.push_back(i * 7919);
+  }
+  std::vector<float> grads(keys.size() * push_dim);
+  for (int step = 0; step < 3; ++step) {
+    for (size_t i = 0; i < keys.size(); ++i) {
+      float* g = grads.data() + i * push_dim;
+      g[0] = 0;
+      g[1] = static_cast<float>(i % 3);
+      g[2] = static_cast<float>(i % 2);
+      for (int k = 3; k < push_dim; ++k) {
+        g[k] = 0.01 * k + 0.001 * step;
+      }
+    }
+    TableContext table_context;
+    table_context.value_type = Sparse;
+    table_context.push_context.keys = keys.data();
+    table_context.push_context.values = grads.data();
+    table_context.num = keys.size();
+    ASSERT_EQ(base->Push(table_context), 0);
+  }
+  ASSERT_EQ(base->Save(text_dir, "0"), 0);
+
+  // text -> table -> binary
+  ASSERT_EQ(binary->Load(text_dir, "0"), 0);
+  ASSERT_EQ(binary->Save(binary_dir, "0"), 0);
+  AfsClient afs_client;
+  auto binary_files = afs_client.list(binary_dir + "/000/");
+  ASSERT_EQ(binary_files.size(), 10UL);
+  for (auto& file : binary_files) {
+    ASSERT_TRUE(IsSparseBinaryFile(file)) << file;
+  }
+
+  std::unique_ptr<Table> bulk(CreateTable(false));
+  ASSERT_EQ(bulk->Load(binary_dir, "0"), 0);
+  ASSERT_EQ(bulk->PrintTableStat(), base->PrintTableStat());
+  ExpectSameValues(base.get(), bulk.get(), keys);
+
+  FLAGS_pserver_sparse_binary_lazy_load = true;
+  std::unique_ptr<Table> lazy(CreateTable(false));
+  ASSERT_EQ(lazy->Load(binary_dir, "0"), 0);
+  FLAGS_pserver_sparse_binary_lazy_load = false;
+  ASSERT_EQ(dynamic_cast<MemorySparseTable*>(lazy.get())->LocalSize(),
+            base->PrintTableStat().first);
+  std::vector<uint64_t> half_keys(keys.begin(), keys.begin() + keys.size() / 2);
+  ExpectSameValues(base.get(), lazy.get(), half_keys);
+  // materializes the rest
+  ASSERT_EQ(lazy->PrintTableStat(), base->PrintTableStat());
+  ExpectSameValues(base.get(), lazy.get(), keys);
+
+  // a load over lazily served files replaces them instead of importing them
+  FLAGS_pserver_sparse_binary_lazy_load = true;
+  std::unique_ptr<Table> reloaded(CreateTable(false));
+  ASSERT_EQ(reloaded->Load(binary_dir, "0"), 0);
+  FLAGS_pserver_sparse_binary_lazy_load = false;
+  ASSERT_EQ(reloaded->Load(binary_dir, "0"), 0);
+  ASSERT_EQ(dynamic_cast<MemorySparseTable*>(reloaded.get())->LocalSize(),
+            base->PrintTableStat().first);
+  ASSERT_EQ(reloaded->PrintTableStat(), base->PrintTableStat());
+  ExpectSameValues(base.get(), reloaded.get(), keys);
+
+  // offline conversion of the text files
+  std::string converted_dir = "./sparse_binary_table_test/converted";
+  auto text_files = afs_client.list(text_dir + "/000/");
+  ASSERT_EQ(text_files.size(), 10UL);
+  std::sort(text_files.begin(), text_files.end());
+  for (size_t i = 0; i < text_files.size(); ++i) {
+    FsChannelConfig text_config;
+    text_config.path = text_files[i];
+    auto binary_path = paddle::string::format_string(
+        "%s/000/part-000-%05d.bin", converted_dir.c_str(), i);
+    ASSERT_GE(ConvertSparseTextToBinary(&afs_client,
+                                        base->ValueAccesor().get(),
+                                        text_config,
+                                        binary_path),
+              0);
+  }
+  std::unique_ptr<Table> converted(CreateTable(false));
+  ASSERT_EQ(converted->Load(converted_dir, "0"), 0);
+  ASSERT_EQ(converted->PrintTableStat(), base->PrintTableStat());
+  ExpectSameValues(base.get(), converted.get(), keys);
+  paddle::framework::fs_remove("./sparse_binary_table_test");
+}
+
+}  // namespace distributed
+}  // namespace paddle
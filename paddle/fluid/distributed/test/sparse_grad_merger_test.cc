@@ -0,0 +1,170 @@
+/* Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "paddle/fluid/distributed/ps/service/communicator/sparse_grad_merger.h"
+
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <map>
+#include <memory>
+#include <random>
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+#include "paddle/phi/backends/cpu/cpu_context.h"
+#include "paddle/phi/kernels/funcs/selected_rows_functor.h"
+
+namespace paddle {
+namespace distributed {
+
+// gradients of batch_num batches, each of row_num feasigns drawn from a
+// power law over key_num keys as the hot feasigns of ctr models
+static std::vector<std::unique_ptr<phi::SelectedRows>> MakeGrads(
+    int batch_num, int row_num, int key_num, int width, uint64_t seed) {
+  std::mt19937_64 engine(seed);
+  std::uniform_real_distribution<double> uniform(0, 1);
+  std::vector<std::unique_ptr<phi::SelectedRows>> grads;
+  for (int b = 0; b < batch_num; ++b) {
+    std::unique_ptr<phi::SelectedRows> grad(new phi::SelectedRows());
+    std::vector<int64_t> rows(row_num);
+    for (auto &row : rows) {
+      row = static_cast<int64_t>(key_num * pow(uniform(engine), 3)) *
+            1000003;
+    }
+    grad->set_rows(rows);
+    grad->set_height(key_num);
+    auto *value = grad->mutable_value();
+    value->Resize(phi::make_ddim({row_num, width}));
+    float *data = value->mutable_data<float>(phi::CPUPlace());
+    for (int i = 0; i < row_num * width; ++i) {
+      data[i] = uniform(engine) - 0.5;
+    }
+    grads.push_back(std::move(grad));
+  }
+  return grads;
+}
+
+static std::vector<const phi::SelectedRows *> Inputs(
+    const std::vector<std::unique_ptr<phi::SelectedRows>> &grads) {
+  std::vector<const phi::SelectedRows *> inputs;
+  for (auto &grad : grads) {
+    inputs.push_back(grad.get());
+  }
+  return inputs;
+}
+
+static void CheckMerge(int batch_num,
+                       int row_num,
+                       int thread_num,
+                       bool average) {
+  const int width = 9;
+  auto grads = MakeGrads(batch_num, row_num, row_num * 4, width, row_num);
+  auto inputs = Inputs(grads);
+
+  phi::SelectedRows expected;
+  phi::CPUContext context;
+  if (average) {
+    phi::funcs::scatter::MergeAverage<phi::CPUContext, float> merge;
+    merge(context, inputs, &expected);
+  } else {
+    phi::funcs::scatter::MergeAdd<phi::CPUContext, float> merge;
+    merge(context, inputs, &expected);
+  }
+  std::map<uint64_t, const float *> expected_rows;
+  for (size_t i = 0; i < expected.rows().size(); ++i) {
+    expected_rows[expected.rows()[i]] =
+        expected.value().data<float>() + i * width;
+  }
+
+  ::ThreadPool pool(thread_num);
+  SparseGradMerger merger(&pool, thread_num);
+  std::vector<uint64_t> keys;
+  std::vector<float> values;
+  merger.Merge(inputs, average, &keys, &values);
+  ASSERT_EQ(keys.size(), expected_rows.size());
+  ASSERT_EQ(values.size(), keys.size() * width);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    ASSERT_EQ(expected_rows.count(keys[i]), 1UL);
+    const float *row = expected_rows[keys[i]];
+    for (int j = 0; j < width; ++j) {
+      ASSERT_NEAR(values[i * width + j], row[j], 1e-5);
+    }
+    expected_rows.erase(keys[i]);
+  }
+}
+
+TEST(SparseGradMerger, merge_add) {
+  CheckMerge(1, 10, 1, false);
+  CheckMerge(8, 1000, 1, false);
+  CheckMerge(20, 10000, 4, false);
+}
+
+TEST(SparseGradMerger, merge_average) {
+  CheckMerge(3, 1000, 1, true);
+  CheckMerge(16, 10000, 4, true);
+}
+
+TEST(SparseGradMerger, empty) {
+  std::vector<const phi::SelectedRows *> inputs;
+  phi::SelectedRows empty;
+  inputs.push_back(&empty);
+  SparseGradMerger merger;
+  std::vector<uint64_t> keys(1);
+  std::vector<float> values(1);
+  merger.Merge(inputs, false, &keys, &values);
+  EXPECT_TRUE(keys.empty());
+  EXPECT_TRUE(values.empty());
+}
+
+// the bytes a push of the keys and rows puts on the wire
+static size_t PushBytes(size_t row_num, int width) {
+  return row_num * (sizeof(uint64_t) + width * sizeof(float));
+}
+
+TEST(SparseGradMerger, benchmark) {
+  const int width = 11;
+  const int batch_num = 20;
+  auto grads = MakeGrads(batch_num, 50000, 1000000, width, 0);
+  auto inputs = Inputs(grads);
+
+  auto start = std::chrono::steady_clock::now();
+  phi::CPUContext context;
+  phi::SelectedRows merged;
+  phi::funcs::scatter::MergeAdd<phi::CPUContext, float> merge_add;
+  merge_add(context, inputs, &merged);
+  double merge_add_sec = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+
+  ::ThreadPool pool(4);
+  for (int thread_num : {1, 4}) {
+    SparseGradMerger merger(&pool, thread_num);
+    std::vector<uint64_t> keys;
+    std::vector<float> values;
+    start = std::chrono::steady_clock::now();
+    merger.Merge(inputs, false, &keys, &values);
+    double sec = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+    EXPECT_EQ(keys.size(), merged.rows().size());
+    VLOG(3) << "SparseGradMerger of " << thread_num << " threads: "
+            << batch_num * 50000 / sec / 1e6 << "M rows/s, MergeAdd: "
+            << batch_num * 50000 / merge_add_sec / 1e6 << "M rows/s";
+  }
+  VLOG(3) << "bytes to push " << PushBytes(batch_num * 50000, width)
+          << " -> " << PushBytes(merged.rows().size(), width);
+}
+
+}  // namespace distributed
+}  // namespace paddle
@@ -0,0 +1,151 @@
+/* Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "paddle/fluid/distributed/ps/service/sparse_pull_cache.h"
+
+#include <cmath>
+#include <random>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace paddle {
+namespace distributed {
+
+static const size_t kDim = 11;
+
+static std::vector<float> ValueOf(uint64_t key) {
+  std::vector<float> value(kDim);
+  for (size_t i = 0; i < kDim; ++i) {
+    value[i] = key * 100 + i;
+  }
+  return value;
+}
+
+TEST(SparsePullCache, get_put) {
+  SparsePullCache cache(1 << 20, kDim * sizeof(float), 0, true);
+  std::vector<float> value(kDim);
+  EXPECT_FALSE(cache.Get(7, value.data()));
+  cache.Put(7, ValueOf(7).data(), cache.step());
+  EXPECT_TRUE(cache.Get(7, value.data()));
+  EXPECT_EQ(value, ValueOf(7));
+
+  auto stat = cache.Stat();
+  EXPECT_EQ(stat.hit, 1u);
+  EXPECT_EQ(stat.miss, 1u);
+  EXPECT_EQ(stat.entries, 1u);
+  EXPECT_DOUBLE_EQ(stat.hit_ratio(), 0.5);
+}
+
+TEST(SparsePullCache, staleness) {
+  SparsePullCache cache(1 << 20, kDim * sizeof(float), 2, true);
+  std::vector<float> value(kDim);
+  for (uint64_t key = 0; key < 4; ++key) {
+    cache.Put(key, ValueOf(key).data(), cache.step());
+  }
+  // a push of key 0 in the bound keeps it
+  uint64_t pushed = 0;
+  cache.OnPush(&pushed, 1);
+  cache.OnPush(nullptr, 0);
+  EXPECT_TRUE(cache.Get(0, value.data()));
+  EXPECT_TRUE(cache.Get(1, value.data()));
+  // the third push drops the pushed key, the others expire on a read
+  cache.OnPush(&pushed, 1);
+  EXPECT_EQ(cache.Stat().entries, 3u);
+  EXPECT_EQ(cache.Stat().expire, 1u);
+  EXPECT_FALSE(cache.Get(0, value.data()));
+  EXPECT_FALSE(cache.Get(1, value.data()));
+  EXPECT_EQ(cache.Stat().expire, 2u);
+
+  // a value pulled before the pushes is not cached
+  cache.Put(5, ValueOf(5).data(), 0);
+  EXPECT_FALSE(cache.Get(5, value.data()));
+  cache.Put(5, ValueOf(5).data(), cache.step());
+  EXPECT_TRUE(cache.Get(5, value.data()));
+  EXPECT_EQ(value, ValueOf(5));
+}
+
+TEST(SparsePullCache, eviction) {
+  // a single entry per shard
+  size_t value_size = kDim * sizeof(float);
+  std::vector<float> value(kDim);
+
+  // without lfu admission a new key always evicts the LRU one
+  SparsePullCache lru(0, value_size, 0, false);
+  for (uint64_t key = 0; key < 1000; ++key) {
+    lru.Put(key, ValueOf(key).data(), 0);
+  }
+  EXPECT_LE(lru.Stat().entries, 64u);
+  EXPECT_EQ(lru.Stat().entries + lru.Stat().evict, 1000u);
+  EXPECT_EQ(lru.Stat().reject, 0u);
+  EXPECT_TRUE(lru.Get(999, value.data()));
+
+  // with lfu admission a key read once does not evict a hot one of its shard
+  SparsePullCache lfu(0, value_size, 0, true);
+  uint64_t hot = 3;
+  lfu.Put(hot, ValueOf(hot).data(), 0);
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_TRUE(lfu.Get(hot, value.data()));
+  }
+  for (uint64_t key = 100; key < 10000; ++key) {
+    lfu.Get(key, value.data());
+    lfu.Put(key, ValueOf(key).data(), 0);
+  }
+  EXPECT_TRUE(lfu.Get(hot, value.data()));
+  EXPECT_EQ(value, ValueOf(hot));
+  EXPECT_GT(lfu.Stat().reject, 0u);
+}
+
+// Pulls keys of a zipf like distribution through the cache from threads,
+// and reports its hit ratio.
+TEST(SparsePullCache, concurrent_hit_ratio) {
+  const size_t key_num = 1000000;
+  SparsePullCache cache(8 << 20, kDim * sizeof(float), 4, true);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&cache, t] {
+      std::mt19937_64 engine(t);
+      std::uniform_real_distribution<double> uniform(0, 1);
+      std::vector<float> value(kDim);
+      for (int step = 0; step < 50; ++step) {
+        std::vector<uint64_t> keys;
+        for (int i = 0; i < 2000; ++i) {
+          uint64_t key = static_cast<uint64_t>(
+              std::pow(key_num, uniform(engine)));
+          uint64_t pull_step = cache.step();
+          if (cache.Get(key, value.data())) {
+            EXPECT_EQ(value, ValueOf(key));
+          } else {
+            cache.Put(key, ValueOf(key).data(), pull_step);
+          }
+          keys.push_back(key);
+        }
+        cache.OnPush(keys.data(), keys.size());
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  auto stat = cache.Stat();
+  VLOG(3) << "hit " << stat.hit << " miss " << stat.miss << " hit_ratio "
+          << stat.hit_ratio() << " expire " << stat.expire << " evict "
+          << stat.evict << " reject " << stat.reject;
+  EXPECT_GT(stat.hit_ratio(), 0.3);
+}
+
+}  // namespace distributed
+}  // namespace paddle
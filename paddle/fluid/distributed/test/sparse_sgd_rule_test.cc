@@ -14,12 +14,26 @@ limitations under the License. */
 
 #include "paddle/fluid/distributed/ps/table/sparse_sgd_rule.h"
 
+#include <chrono>  // NOLINT
 #include <cmath>
 #include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
 
+#include "gflags/gflags.h"
 #include "gtest/gtest.h"
 #include "paddle/fluid/distributed/the_one_ps.pb.h"
 
+DECLARE_bool(enable_sparse_sgd_rule_simd);
+DEFINE_int32(sparse_sgd_rule_bench_key_num,
+             100000,
+             "number of features updated per round by the benchmark");
+DEFINE_int32(sparse_sgd_rule_bench_dim,
+             64,
+             "embedding dim used by the benchmark");
+
 namespace paddle {
 namespace distributed {
 
@@ -205,5 +219,165 @@ TEST(downpour_sparse_adam_test, test_init_and_update) {
     ASSERT_FLOAT_EQ(value[i], label[i]) << "i is " << i;
   }
 }
+
+static SparseCommonSGDRuleParameter BatchTestParam(const std::string& name) {
+  SparseCommonSGDRuleParameter param;
+  param.set_name(name);
+  if (name == "SparseAdamSGDRule" || name == "SparseSharedAdamSGDRule") {
+    auto* adam_param = param.mutable_adam();
+    adam_param->set_learning_rate(0.1);
+    adam_param->set_initial_range(0.3);
+    adam_param->set_beta1_decay_rate(0.9);
+    adam_param->set_beta2_decay_rate(0.999);
+    adam_param->set_ada_epsilon(1e-08);
+    adam_param->add_weight_bounds(-1.0);
+    adam_param->add_weight_bounds(1.0);
+  } else {
+    auto* adagrad_param = param.mutable_adagrad();
+    adagrad_param->set_learning_rate(0.1);
+    adagrad_param->set_initial_g2sum(3.0);
+    adagrad_param->set_initial_range(0.3);
+    adagrad_param->add_weight_bounds(-1.0);
+    adagrad_param->add_weight_bounds(1.0);
+  }
+  return param;
+}
+
+static std::unique_ptr<SparseValueSGDRule> CreateBatchTestRule(
+    const std::string& name, size_t dim) {
+  std::unique_ptr<SparseValueSGDRule> rule;
+  if (name == "SparseAdaGradSGDRule") {
+    rule.reset(new SparseAdaGradSGDRule());
+  } else if (name == "StdAdaGradSGDRule") {
+    rule.reset(new StdAdaGradSGDRule());
+  } else if (name == "SparseAdamSGDRule") {
+    rule.reset(new SparseAdamSGDRule());
+  } else {
+    rule.reset(new SparseSharedAdamSGDRule());
+  }
+  rule->LoadConfig(BatchTestParam(name), dim);
+  return rule;
+}
+
+// Runs the same pushes through UpdateValue one feature at a time and
+// through UpdateValueBatch, duplicates included, and compares the values.
+static void CheckBatchUpdate(const std::string& name, size_t dim) {
+  auto rule = CreateBatchTestRule(name, dim);
+  const size_t key_num = 37;
+  const size_t value_dim = dim + rule->Dim();
+  const size_t push_dim = dim + 1;  // one leading non-gradient column
+  std::vector<float> expect(key_num * value_dim);
+  for (size_t k = 0; k < key_num; ++k) {
+    rule->InitValue(expect.data() + k * value_dim,
+                    expect.data() + k * value_dim + dim,
+                    false);
+  }
+  std::vector<float> actual = expect;
+
+  std::mt19937 rng(dim);
+  std::uniform_real_distribution<float> dist(-2.0, 2.0);
+  const size_t batch_num = 50;
+  std::vector<float> push(batch_num * push_dim);
+  std::vector<float> scales(batch_num);
+  std::vector<float*> values(batch_num);
+  std::vector<const float*> push_values(batch_num);
+  for (int step = 0; step < 20; ++step) {
+    for (size_t i = 0; i < batch_num; ++i) {
+      for (size_t j = 0; j < push_dim; ++j) {
+        push[i * push_dim + j] = dist(rng);
+      }
+      scales[i] = 1 + i % 3;
+      size_t key = rng() % key_num;
+      values[i] = actual.data() + key * value_dim;
+      push_values[i] = push.data() + i * push_dim;
+      rule->UpdateValue(expect.data() + key * value_dim,
+                        expect.data() + key * value_dim + dim,
+                        push_values[i] + 1,
+                        scales[i]);
+    }
+    rule->UpdateValueBatch(values.data(),
+                           0,
+                           dim,
+                           push_values.data(),
+                           1,
+                           scales.data(),
+                           batch_num);
+  }
+  for (size_t i = 0; i < expect.size(); ++i) {
+    ASSERT_NEAR(expect[i], actual[i], 1e-4 * (1 + std::fabs(expect[i])))
+        << name << " dim " << dim << " index " << i;
+    if (i % value_dim < dim) {
+      ASSERT_GE(actual[i], -1.0);
+      ASSERT_LE(actual[i], 1.0);
+    }
+  }
+}
+
+TEST(sparse_sgd_rule_batch_test, match_per_feature_update) {
+  for (auto name : {"SparseAdaGradSGDRule",
+                    "StdAdaGradSGDRule",
+                    "SparseAdamSGDRule",
+                    "SparseSharedAdamSGDRule"}) {
+    for (size_t dim : {1, 8, 13, 64}) {
+      CheckBatchUpdate(name, dim);
+    }
+  }
+  FLAGS_enable_sparse_sgd_rule_simd = false;
+  CheckBatchUpdate("SparseAdamSGDRule", 13);
+  FLAGS_enable_sparse_sgd_rule_simd = true;
+}
+
+// Microbenchmark of the push update: per-feature UpdateValue against
+// UpdateValueBatch. Use --sparse_sgd_rule_bench_key_num to scale it.
+TEST(sparse_sgd_rule_batch_test, benchmark) {
+  const size_t key_num = FLAGS_sparse_sgd_rule_bench_key_num;
+  const size_t dim = FLAGS_sparse_sgd_rule_bench_dim;
+  const size_t batch_size = SparseValueSGDRule::kUpdateBatchSize;
+  for (auto name : {"SparseAdaGradSGDRule",
+                    "StdAdaGradSGDRule",
+                    "SparseAdamSGDRule",
+                    "SparseSharedAdamSGDRule"}) {
+    auto rule = CreateBatchTestRule(name, dim);
+    const size_t value_dim = dim + rule->Dim();
+    std::vector<float> value(key_num * value_dim);
+    for (size_t k = 0; k < key_num; ++k) {
+      rule->InitValue(
+          value.data() + k * value_dim, value.data() + k * value_dim + dim);
+    }
+    std::vector<float> grad(key_num * dim, 0.01);
+    std::vector<float> scales(key_num, 1.0);
+    std::vector<float*> values(key_num);
+    std::vector<const float*> push_values(key_num);
+    for (size_t k = 0; k < key_num; ++k) {
+      values[k] = value.data() + k * value_dim;
+      push_values[k] = grad.data() + k * dim;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t k = 0; k < key_num; ++k) {
+      rule->UpdateValue(values[k], values[k] + dim, push_values[k]);
+    }
+    auto middle = std::chrono::steady_clock::now();
+    for (size_t k = 0; k < key_num; k += batch_size) {
+      size_t batch = key_num - k < batch_size ? key_num - k : batch_size;
+      rule->UpdateValueBatch(values.data() + k,
+                             0,
+                             dim,
+                             push_values.data() + k,
+                             0,
+                             scales.data() + k,
+                             batch);
+    }
+    auto end = std::chrono::steady_clock::now();
+    double scalar_ms =
+        std::chrono::duration<double, std::milli>(middle - start).count();
+    double batch_ms =
+        std::chrono::duration<double, std::milli>(end - middle).count();
+    VLOG(3) << name << " dim " << dim << " keys " << key_num
+            << ": per-feature " << scalar_ms << " ms, batch " << batch_ms
+            << " ms, speedup " << scalar_ms / batch_ms;
+  }
+}
+
 }  // namespace distributed
 }  // namespace paddle
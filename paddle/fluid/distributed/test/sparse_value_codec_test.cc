@@ -0,0 +1,153 @@
+/* Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "paddle/fluid/distributed/ps/service/sparse_value_codec.h"
+
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace paddle {
+namespace distributed {
+
+// rows of a ctr pull value, show and click counts and an embedding
+static std::vector<float> MakeRows(size_t row_num, size_t dim) {
+  std::mt19937 engine(0);
+  std::normal_distribution<float> normal(0, 0.01);
+  std::vector<float> rows(row_num * dim);
+  for (size_t i = 0; i < row_num; ++i) {
+    float *row = rows.data() + i * dim;
+    row[0] = engine() % 100000;
+    row[1] = engine() % 1000;
+    for (size_t j = 2; j < dim; ++j) {
+      row[j] = normal(engine);
+    }
+  }
+  return rows;
+}
+
+// the max error of the embedx values relative to the max of their row
+static double RoundTrip(const SparseValueCodec &codec,
+                        size_t tail_dim,
+                        const std::vector<float> &rows,
+                        std::vector<float> *decoded) {
+  size_t dim = codec.value_size() / sizeof(float);
+  size_t row_num = rows.size() / dim;
+  std::vector<char> encoded(row_num * codec.encoded_size());
+  for (size_t i = 0; i < row_num; ++i) {
+    codec.Encode(rows.data() + i * dim,
+                 encoded.data() + i * codec.encoded_size());
+  }
+  decoded->resize(rows.size());
+  for (size_t i = 0; i < row_num; ++i) {
+    codec.Decode(encoded.data() + i * codec.encoded_size(),
+                 decoded->data() + i * dim);
+  }
+  double max_error = 0;
+  for (size_t i = 0; i < row_num; ++i) {
+    const float *row = rows.data() + i * dim;
+    const float *out = decoded->data() + i * dim;
+    // the head is sent in float
+    for (size_t j = 0; j < dim - tail_dim; ++j) {
+      EXPECT_EQ(row[j], out[j]);
+    }
+    float max_abs = 0;
+    for (size_t j = dim - tail_dim; j < dim; ++j) {
+      max_abs = std::max(max_abs, std::fabs(row[j]));
+    }
+    for (size_t j = dim - tail_dim; j < dim; ++j) {
+      double error = std::fabs(row[j] - out[j]) / max_abs;
+      max_error = std::max(max_error, error);
+    }
+  }
+  return max_error;
+}
+
+TEST(SparseValueCodec, round_trip) {
+  const size_t dim = 3 + 64;
+  const size_t tail_dim = 64;
+  auto rows = MakeRows(1000, dim);
+  std::vector<float> decoded;
+
+  SparseValueCodec fp32(VALUE_FP32, dim, tail_dim);
+  EXPECT_EQ(fp32.encoded_size(), dim * sizeof(float));
+  EXPECT_EQ(RoundTrip(fp32, tail_dim, rows, &decoded), 0);
+
+  SparseValueCodec fp16(VALUE_FP16, dim, tail_dim);
+  EXPECT_EQ(fp16.encoded_size(), 3 * sizeof(float) + tail_dim * 2);
+  EXPECT_LT(RoundTrip(fp16, tail_dim, rows, &decoded), 2e-3);
+
+  SparseValueCodec bf16(VALUE_BF16, dim, tail_dim);
+  EXPECT_EQ(bf16.encoded_size(), 3 * sizeof(float) + tail_dim * 2);
+  EXPECT_LT(RoundTrip(bf16, tail_dim, rows, &decoded), 8e-3);
+
+  SparseValueCodec int8(VALUE_INT8, dim, tail_dim);
+  EXPECT_EQ(int8.encoded_size(), 4 * sizeof(float) + tail_dim);
+  EXPECT_LT(RoundTrip(int8, tail_dim, rows, &decoded), 0.5 / 127 + 1e-6);
+}
+
+TEST(SparseValueCodec, zero_and_short_rows) {
+  // a row of zeros has a zero scale
+  std::vector<float> rows(10, 0);
+  std::vector<float> decoded;
+  SparseValueCodec int8(VALUE_INT8, 10, 8);
+  std::vector<char> encoded(int8.encoded_size());
+  int8.Encode(rows.data(), encoded.data());
+  decoded.resize(10, 1);
+  int8.Decode(encoded.data(), decoded.data());
+  for (auto value : decoded) {
+    EXPECT_EQ(value, 0);
+  }
+  // the tail is at most the row
+  SparseValueCodec fp16(VALUE_FP16, 4, 8);
+  EXPECT_EQ(fp16.encoded_size(), 4 * sizeof(uint16_t));
+}
+
+// Encodes and decodes the rows of a pull, as the server and the client of a
+// loopback pull, and reports the throughput, bytes and error of the types.
+TEST(SparseValueCodec, benchmark) {
+  const size_t dim = 3 + 128;
+  const size_t tail_dim = 128;
+  const size_t row_num = 100000;
+  auto rows = MakeRows(row_num, dim);
+  std::vector<float> decoded(rows.size());
+  for (auto type : {VALUE_FP32, VALUE_FP16, VALUE_BF16, VALUE_INT8}) {
+    SparseValueCodec codec(type, dim, tail_dim);
+    std::vector<char> encoded(row_num * codec.encoded_size());
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < row_num; ++i) {
+      codec.Encode(rows.data() + i * dim,
+                   encoded.data() + i * codec.encoded_size());
+    }
+    for (size_t i = 0; i < row_num; ++i) {
+      codec.Decode(encoded.data() + i * codec.encoded_size(),
+                   decoded.data() + i * dim);
+    }
+    double sec = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+    double error = RoundTrip(codec, tail_dim, rows, &decoded);
+    VLOG(3) << ValueCompressType_Name(type) << ": " << codec.encoded_size()
+            << " of " << codec.value_size() << " bytes per row, "
+            << row_num / sec / 1e6
+            << "M rows/s encode and decode, max relative error " << error;
+  }
+}
+
+}  // namespace distributed
+}  // namespace paddle
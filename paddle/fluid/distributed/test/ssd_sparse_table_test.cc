@@ -0,0 +1,137 @@
+/* Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "paddle/fluid/distributed/ps/table/ssd_sparse_table.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/fluid/distributed/ps/table/ctr_dymf_accessor.h"
+#include "paddle/fluid/distributed/the_one_ps.pb.h"
+
+DECLARE_int64(pserver_ssd_cache_mb);
+DECLARE_string(rocksdb_path);
+
+namespace paddle {
+namespace distributed {
+
+static const int kEmbedxDim = 8;
+
+class SSDSparseTableTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    FLAGS_pserver_ssd_cache_mb = 16;
+    // the db of each test is a new one
+    FLAGS_rocksdb_path =
+        std::string("./ssd_sparse_table_test_") +
+        ::testing::UnitTest::GetInstance()->current_test_info()->name();
+    TableParameter table_config;
+    table_config.set_table_class("SSDSparseTable");
+    table_config.set_shard_num(10);
+    auto* accessor_config = table_config.mutable_accessor();
+    accessor_config->set_accessor_class("CtrDymfAccessor");
+    accessor_config->set_fea_dim(11);
+    accessor_config->set_embedx_dim(kEmbedxDim);
+    accessor_config->set_embedx_threshold(5);
+    auto* ctr_param = accessor_config->mutable_ctr_accessor_param();
+    ctr_param->set_nonclk_coeff(0.2);
+    ctr_param->set_click_coeff(1);
+    ctr_param->set_show_click_decay_rate(0.99);
+    for (auto* sgd_param : {accessor_config->mutable_embed_sgd_param(),
+                            accessor_config->mutable_embedx_sgd_param()}) {
+      sgd_param->set_name("SparseNaiveSGDRule");
+      auto* naive_param = sgd_param->mutable_naive();
+      naive_param->set_learning_rate(0.1);
+      naive_param->set_initial_range(0.3);
+      naive_param->add_weight_bounds(-10.0);
+      naive_param->add_weight_bounds(10.0);
+    }
+    table_.reset(new SSDSparseTable());
+    table_->SetShard(0, 1);
+    ASSERT_EQ(table_->Initialize(table_config, FsClientParameter()), 0);
+    for (uint64_t key = 0; key < 1000; ++key) {
+      keys_.push_back(key * 3 + 1);
+    }
+  }
+
+  // pushes a show and a click of each key
+  void Push() {
+    std::vector<float> values(
+        keys_.size() * CtrDymfAccessor::CtrDymfPushValue::Dim(kEmbedxDim),
+        0.01f);
+    for (size_t i = 0; i < keys_.size(); ++i) {
+      float* value =
+          &values[i * CtrDymfAccessor::CtrDymfPushValue::Dim(kEmbedxDim)];
+      value[CtrDymfAccessor::CtrDymfPushValue::SlotIndex()] = 1;
+      value[CtrDymfAccessor::CtrDymfPushValue::ShowIndex()] = 1;
+      value[CtrDymfAccessor::CtrDymfPushValue::ClickIndex()] = 1;
+      value[CtrDymfAccessor::CtrDymfPushValue::MfDimIndex()] = kEmbedxDim;
+    }
+    TableContext context;
+    context.value_type = Sparse;
+    context.push_context.keys = keys_.data();
+    context.push_context.values = values.data();
+    context.num = keys_.size();
+    ASSERT_EQ(table_->Push(context), 0);
+  }
+
+  // pulls the keys and returns their shows
+  std::vector<float> PullShows() {
+    size_t pull_dim = CtrDymfAccessor::CtrDymfPullValue::Dim(kEmbedxDim);
+    std::vector<float> values(keys_.size() * pull_dim);
+    std::vector<uint32_t> frequencies(keys_.size(), 1);
+    PullSparseValue pull_value(keys_, frequencies, kEmbedxDim);
+    TableContext context;
+    context.value_type = Sparse;
+    context.pull_context.pull_value = pull_value;
+    context.pull_context.values = values.data();
+    table_->Pull(context);
+    int show_idx = CtrDymfAccessor::CtrDymfPullValue::ShowIndex();
+    std::vector<float> shows(keys_.size());
+    for (size_t i = 0; i < keys_.size(); ++i) {
+      shows[i] = values[i * pull_dim + show_idx];
+    }
+    return shows;
+  }
+
+  std::unique_ptr<SSDSparseTable> table_;
+  std::vector<uint64_t> keys_;
+};
+
+TEST_F(SSDSparseTableTest, CacheHitsAfterCacheTable) {
+  Push();
+  // the values of pass 0 are moved to rocksdb and to the cache
+  ASSERT_EQ(table_->CacheTable(1), 0);
+  ASSERT_EQ(table_->LocalSize(), 0);
+  EXPECT_EQ(PullShows(), std::vector<float>(keys_.size(), 1));
+  auto stat = table_->SSDCacheStat();
+  EXPECT_EQ(stat.hit, keys_.size());
+  EXPECT_EQ(stat.miss, 0UL);
+  EXPECT_EQ(table_->LocalSize(), static_cast<int64_t>(keys_.size()));
+}
+
+TEST_F(SSDSparseTableTest, PushUpdatesCachedValue) {
+  Push();
+  ASSERT_EQ(table_->CacheTable(1), 0);
+  // the push updates the cached values rather than fresh ones
+  Push();
+  ASSERT_EQ(table_->CacheTable(1), 0);
+  EXPECT_EQ(PullShows(), std::vector<float>(keys_.size(), 2));
+  EXPECT_EQ(table_->SSDCacheStat().hit, 2 * keys_.size());
+}
+
+}  // namespace distributed
+}  // namespace paddle
@@ -0,0 +1,132 @@
+/* Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "paddle/fluid/distributed/ps/table/depends/tiny_lfu_cache.h"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace paddle {
+namespace distributed {
+
+TEST(FrequencySketch, CountAndAge) {
+  FrequencySketch sketch;
+  sketch.Init(1024);
+  for (int i = 0; i < 5; ++i) {
+    sketch.Increment(42);
+  }
+  ASSERT_EQ(sketch.Frequency(42), 5U);
+  ASSERT_LE(sketch.Frequency(43), 1U);
+  for (int i = 0; i < 100; ++i) {
+    sketch.Increment(7);
+  }
+  // 4-bit counters saturate
+  ASSERT_EQ(sketch.Frequency(7), 15U);
+  sketch.Reset();
+  ASSERT_EQ(sketch.Frequency(7), 7U);
+  ASSERT_EQ(sketch.Frequency(42), 2U);
+}
+
+TEST(TinyLfuCache, TakeMovesValueOut) {
+  TinyLfuCache cache;
+  cache.Init(1 << 20);
+  std::vector<float> value = {1, 2, 3};
+  cache.Put(1, value.data(), value.size());
+  std::vector<float> out;
+  ASSERT_TRUE(cache.Take(1, &out));
+  ASSERT_EQ(out, value);
+  ASSERT_FALSE(cache.Take(1, &out));
+  auto stat = cache.Stat();
+  ASSERT_EQ(stat.hit, 1UL);
+  ASSERT_EQ(stat.miss, 1UL);
+  ASSERT_EQ(stat.entries, 0UL);
+  ASSERT_EQ(stat.bytes, 0UL);
+}
+
+TEST(TinyLfuCache, HotKeysSurviveScan) {
+  const size_t dim = 16;
+  const size_t entry_bytes = dim * sizeof(float) + TinyLfuCache::kEntryOverhead;
+  TinyLfuCache cache;
+  cache.Init(1000 * entry_bytes);
+  std::vector<float> value(dim, 1.0);
+  // 500 hot keys requested many times
+  for (int round = 0; round < 4; ++round) {
+    for (uint64_t key = 0; key < 500; ++key) {
+      cache.RecordAccess(key);
+    }
+  }
+  for (uint64_t key = 0; key < 500; ++key) {
+    cache.Put(key, value.data(), dim);
+  }
+  // a scan of one-off keys, each requested once, while the hot keys keep
+  // being requested
+  for (uint64_t key = 100000; key < 110000; ++key) {
+    cache.RecordAccess(key % 500);
+    cache.RecordAccess(key);
+    cache.Put(key, value.data(), dim);
+  }
+  auto stat = cache.Stat();
+  ASSERT_LE(stat.bytes, 1000 * entry_bytes);
+  ASSERT_GT(stat.reject, 0UL);
+  std::vector<float> out;
+  size_t hot_hit = 0;
+  for (uint64_t key = 0; key < 500; ++key) {
+    hot_hit += cache.Take(key, &out);
+  }
+  // a plain LRU of this size would have lost all of them
+  ASSERT_GT(hot_hit, 450UL);
+}
+
+TEST(TinyLfuCache, RejectKeepsVictims) {
+  const size_t entry_bytes = sizeof(float) + TinyLfuCache::kEntryOverhead;
+  // no window, a put is a candidate for the main space at once
+  TinyLfuCache cache;
+  cache.Init(3 * entry_bytes, 0.0);
+  std::vector<float> value(18, 1.0);
+  // keys 1, 2 and 3 fill the main space, 1 is the least recent
+  for (uint64_t key = 1; key <= 3; ++key) {
+    for (int i = 0; i < (key == 1 ? 1 : 5); ++i) {
+      cache.RecordAccess(key);
+    }
+    cache.Put(key, value.data(), 1);
+  }
+  ASSERT_EQ(cache.Stat().admit, 3UL);
+  // a candidate of two entries in size beats 1 but not 2
+  for (int i = 0; i < 3; ++i) {
+    cache.RecordAccess(9);
+  }
+  cache.Put(9, value.data(), value.size());
+  auto stat = cache.Stat();
+  ASSERT_EQ(stat.reject, 1UL);
+  ASSERT_EQ(stat.evict, 0UL);
+  ASSERT_EQ(stat.entries, 3UL);
+  // a more frequent one replaces both
+  for (int i = 0; i < 3; ++i) {
+    cache.RecordAccess(9);
+  }
+  cache.Put(9, value.data(), value.size());
+  stat = cache.Stat();
+  ASSERT_EQ(stat.evict, 2UL);
+  ASSERT_EQ(stat.entries, 2UL);
+  std::vector<float> out;
+  ASSERT_FALSE(cache.Take(1, &out));
+  ASSERT_FALSE(cache.Take(2, &out));
+  ASSERT_TRUE(cache.Take(3, &out));
+  ASSERT_TRUE(cache.Take(9, &out));
+  ASSERT_EQ(out, value);
+}
+
+}  // namespace distributed
+}  // namespace paddle
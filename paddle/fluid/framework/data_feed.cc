@@ -26,6 +26,8 @@ limitations under the License. */
 #include <sys/stat.h>
 #endif
 #include "io/fs.h"
+#include "paddle/fluid/framework/sample_binary_file.h"
+#include "paddle/fluid/framework/slot_text_parser.h"
 #include "paddle/fluid/platform/monitor.h"
 #include "paddle/fluid/platform/timer.h"
 
@@ -199,7 +201,18 @@ bool DataFeed::SetFileList(const std::vector<std::string>& files) {
   CheckInit();
   // Do not set finish_set_filelist_ flag,
   // since a user may set file many times after init reader
-  filelist_.assign(files.begin(), files.end());
+  // the large local files are read by byte ranges if it is enabled, but
+  // the sample files whole, as their samples do not align to the ranges
+  filelist_.clear();
+  for (auto& file : files) {
+    if (IsSampleFile(file)) {
+      filelist_.push_back(file);
+      continue;
+    }
+    for (auto& range : fs_split_read_ranges({file}, pipe_command_)) {
+      filelist_.push_back(range);
+    }
+  }
 
   finish_set_filelist_ = true;
   return true;
@@ -531,6 +544,10 @@ void InMemoryDataFeed<T>::LoadIntoMemory() {
   while (this->PickOneFile(&filename)) {
     VLOG(3) << "PickOneFile, filename=" << filename
             << ", thread_id=" << thread_id_;
+    if (IsSampleFile(filename)) {
+      LoadSampleFile(filename);
+      continue;
+    }
 #ifdef PADDLE_WITH_BOX_PS
     if (BoxWrapper::GetInstance()->UseAfsApi()) {
       this->fp_ = BoxWrapper::GetInstance()->afs_manager->GetFile(
@@ -568,6 +585,67 @@ void InMemoryDataFeed<T>::LoadIntoMemory() {
 #endif
 }
 
+// Keeps each sample of a sample file with probability sample_rate, as
+// BufferedLineFileReader does with the lines of a text file.
+class SampleFileSampler {
+ public:
+  explicit SampleFileSampler(float sample_rate)
+      : sample_rate_(sample_rate),
+        sample_(std::abs(sample_rate - 1.0f) >= 1e-5f),
+        random_engine_(std::random_device()()),
+        uniform_distribution_(0.0f, 1.0f) {}
+
+  bool Keep() {
+    return !sample_ || uniform_distribution_(random_engine_) < sample_rate_;
+  }
+
+ private:
+  float sample_rate_;
+  bool sample_;
+  std::default_random_engine random_engine_;
+  std::uniform_real_distribution<float> uniform_distribution_;
+};
+
+template <typename T>
+void InMemoryDataFeed<T>::LoadSampleFile(const std::string& filename) {
+  platform::Timer timeline;
+  timeline.Start();
+  SampleFileReader reader(filename);
+  PADDLE_ENFORCE_EQ(
+      reader.header().record_type,
+      GetSampleRecordType(static_cast<T*>(nullptr)),
+      platform::errors::InvalidArgument(
+          "The sample file is not dumped by this dataset, file[%s].",
+          filename));
+  SampleFileSampler sampler(sample_rate_);
+  paddle::framework::ChannelWriter<T> writer(input_channel_);
+  T instance;
+  const char* data = nullptr;
+  size_t size = 0;
+  size_t num = 0;
+  while (reader.Next(&data, &size)) {
+    if (!sampler.Keep()) {
+      continue;
+    }
+    if (ParseOneInstanceFromSample(data, size, &instance)) {
+      writer << std::move(instance);
+      ++num;
+    }
+    instance = T();
+  }
+  STAT_ADD(STAT_total_feasign_num_in_mem, fea_num_);
+  {
+    std::lock_guard<std::mutex> flock(*mutex_for_fea_num_);
+    *total_fea_num_ += fea_num_;
+    fea_num_ = 0;
+  }
+  writer.Flush();
+  timeline.Pause();
+  VLOG(3) << "LoadSampleFile() read all samples, file=" << filename
+          << ", samples=" << num << ", cost time=" << timeline.ElapsedSec()
+          << " seconds, thread_id=" << thread_id_;
+}
+
 template <typename T>
 void InMemoryDataFeed<T>::LoadIntoMemoryFromSo() {
 #if (defined _LINUX) && (defined PADDLE_WITH_HETERPS) && \
@@ -584,6 +662,11 @@ void InMemoryDataFeed<T>::LoadIntoMemoryFromSo() {
   while (this->PickOneFile(&filename)) {
     VLOG(3) << "PickOneFile, filename=" << filename
             << ", thread_id=" << thread_id_;
+    // the parser library reads the text files only
+    if (IsSampleFile(filename)) {
+      LoadSampleFile(filename);
+      continue;
+    }
     platform::Timer timeline;
     timeline.Start();
     if (ps_gpu_ptr->UseAfsApi()) {
@@ -848,11 +931,10 @@ bool MultiSlotDataFeed::ParseOneInstanceFromPipe(
     const char* str = reader.get();
     std::string line = std::string(str);
 
-    char* endptr = const_cast<char*>(str);
-    int pos = 0;
+    SlotTextParser parser(str, reader.length());
     for (size_t i = 0; i < use_slots_index_.size(); ++i) {
       int idx = use_slots_index_[i];
-      int num = strtol(&str[pos], &endptr, 10);
+      int num = parser.ParseInt();
 
       if (num <= 0) {
         std::stringstream ss;
@@ -879,23 +961,17 @@ bool MultiSlotDataFeed::ParseOneInstanceFromPipe(
         (*instance)[idx].Init(all_slots_type_[i]);
         if ((*instance)[idx].GetType()[0] == 'f') {  // float
           for (int j = 0; j < num; ++j) {
-            float feasign = strtof(endptr, &endptr);
+            float feasign = parser.ParseFloat();
             (*instance)[idx].AddValue(feasign);
           }
         } else if ((*instance)[idx].GetType()[0] == 'u') {  // uint64
           for (int j = 0; j < num; ++j) {
-            uint64_t feasign = (uint64_t)strtoull(endptr, &endptr, 10);
+            uint64_t feasign = parser.ParseUint64();
             (*instance)[idx].AddValue(feasign);
           }
         }
-        pos = endptr - str;
       } else {
-        for (int j = 0; j <= num; ++j) {
-          // pos = line.find_first_of(' ', pos + 1);
-          while (line[pos + 1] != ' ') {
-            pos++;
-          }
-        }
+        parser.SkipTokens(num);
       }
     }
     return true;
@@ -913,11 +989,10 @@ bool MultiSlotDataFeed::ParseOneInstance(std::vector<MultiSlotType>* instance) {
     instance->resize(use_slots_num);
     // parse line
     const char* str = line.c_str();
-    char* endptr = const_cast<char*>(str);
-    int pos = 0;
+    SlotTextParser parser(str, line.size());
     for (size_t i = 0; i < use_slots_index_.size(); ++i) {
       int idx = use_slots_index_[i];
-      int num = strtol(&str[pos], &endptr, 10);
+      int num = parser.ParseInt();
       PADDLE_ENFORCE_NE(
           num,
           0,
@@ -939,20 +1014,17 @@ bool MultiSlotDataFeed::ParseOneInstance(std::vector<MultiSlotType>* instance) {
         (*instance)[idx].Init(all_slots_type_[i]);
         if ((*instance)[idx].GetType()[0] == 'f') {  // float
           for (int j = 0; j < num; ++j) {
-            float feasign = strtof(endptr, &endptr);
+            float feasign = parser.ParseFloat();
             (*instance)[idx].AddValue(feasign);
           }
         } else if ((*instance)[idx].GetType()[0] == 'u') {  // uint64
           for (int j = 0; j < num; ++j) {
-            uint64_t feasign = (uint64_t)strtoull(endptr, &endptr, 10);
+            uint64_t feasign = parser.ParseUint64();
             (*instance)[idx].AddValue(feasign);
           }
         }
-        pos = endptr - str;
       } else {
-        for (int j = 0; j <= num; ++j) {
-          pos = line.find_first_of(' ', pos + 1);
-        }
+        parser.SkipTokens(num);
       }
     }
   } else {
@@ -1132,8 +1204,6 @@ bool MultiSlotInMemoryDataFeed::ParseOneInstanceFromPipe(Record* instance) {
     return false;
   } else {
     const char* str = reader.get();
-    std::string line = std::string(str);
-    // VLOG(3) << line;
     char* endptr = const_cast<char*>(str);
     int pos = 0;
     if (parse_ins_id_) {
@@ -1181,9 +1251,10 @@ bool MultiSlotInMemoryDataFeed::ParseOneInstanceFromPipe(Record* instance) {
       instance->rank = rank;
       pos += len + 1;
     }
+    SlotTextParser parser(str, reader.length(), pos);
     for (size_t i = 0; i < use_slots_index_.size(); ++i) {
       int idx = use_slots_index_[i];
-      int num = strtol(&str[pos], &endptr, 10);
+      int num = parser.ParseInt();
       PADDLE_ENFORCE_NE(
           num,
           0,
@@ -1208,15 +1279,14 @@ bool MultiSlotInMemoryDataFeed::ParseOneInstanceFromPipe(Record* instance) {
                            "please check this error line: %s",
                            str));
 
-        char* uidptr = endptr;
-        uint64_t feasign = (uint64_t)strtoull(uidptr, &uidptr, 10);
-        instance->uid_ = feasign;
+        SlotTextParser uid_parser = parser;
+        instance->uid_ = uid_parser.ParseUint64();
       }
 #endif
       if (idx != -1) {
         if (all_slots_type_[i][0] == 'f') {  // float
           for (int j = 0; j < num; ++j) {
-            float feasign = strtof(endptr, &endptr);
+            float feasign = parser.ParseFloat();
             // if float feasign is equal to zero, ignore it
             // except when slot is dense
             if (fabs(feasign) < 1e-6 && !use_slots_is_dense_[i]) {
@@ -1228,7 +1298,7 @@ bool MultiSlotInMemoryDataFeed::ParseOneInstanceFromPipe(Record* instance) {
           }
         } else if (all_slots_type_[i][0] == 'u') {  // uint64
           for (int j = 0; j < num; ++j) {
-            uint64_t feasign = (uint64_t)strtoull(endptr, &endptr, 10);
+            uint64_t feasign = parser.ParseUint64();
             // if uint64 feasign is equal to zero, ignore it
             // except when slot is dense
             if (feasign == 0 && !use_slots_is_dense_[i]) {
@@ -1239,14 +1309,8 @@ bool MultiSlotInMemoryDataFeed::ParseOneInstanceFromPipe(Record* instance) {
             instance->uint64_feasigns_.push_back(FeatureItem(f, idx));
           }
         }
-        pos = endptr - str;
       } else {
-        for (int j = 0; j <= num; ++j) {
-          // pos = line.find_first_of(' ', pos + 1);
-          while (line[pos + 1] != ' ') {
-            pos++;
-          }
-        }
+        parser.SkipTokens(num);
       }
     }
     instance->float_feasigns_.shrink_to_fit();
@@ -1259,6 +1323,13 @@ bool MultiSlotInMemoryDataFeed::ParseOneInstanceFromPipe(Record* instance) {
 #endif
 }
 
+bool MultiSlotInMemoryDataFeed::ParseOneInstanceFromSample(
+    const char* data, size_t size, Record* instance) {
+  DeserializeSample(data, size, instance);
+  fea_num_ += instance->uint64_feasigns_.size();
+  return true;
+}
+
 bool MultiSlotInMemoryDataFeed::ParseOneInstance(Record* instance) {
 #ifdef _LINUX
   std::string line;
@@ -1266,11 +1337,10 @@ bool MultiSlotInMemoryDataFeed::ParseOneInstance(Record* instance) {
     VLOG(3) << line;
     // parse line
     const char* str = line.c_str();
-    char* endptr = const_cast<char*>(str);
-    int pos = 0;
+    SlotTextParser parser(str, line.size());
     for (size_t i = 0; i < use_slots_index_.size(); ++i) {
       int idx = use_slots_index_[i];
-      int num = strtol(&str[pos], &endptr, 10);
+      int num = parser.ParseInt();
       PADDLE_ENFORCE_NE(
           num,
           0,
@@ -1291,7 +1361,7 @@ bool MultiSlotInMemoryDataFeed::ParseOneInstance(Record* instance) {
       if (idx != -1) {
         if (all_slots_type_[i][0] == 'f') {  // float
           for (int j = 0; j < num; ++j) {
-            float feasign = strtof(endptr, &endptr);
+            float feasign = parser.ParseFloat();
             if (fabs(feasign) < 1e-6) {
               continue;
             }
@@ -1301,7 +1371,7 @@ bool MultiSlotInMemoryDataFeed::ParseOneInstance(Record* instance) {
           }
         } else if (all_slots_type_[i][0] == 'u') {  // uint64
           for (int j = 0; j < num; ++j) {
-            uint64_t feasign = (uint64_t)strtoull(endptr, &endptr, 10);
+            uint64_t feasign = parser.ParseUint64();
             if (feasign == 0) {
               continue;
             }
@@ -1310,11 +1380,8 @@ bool MultiSlotInMemoryDataFeed::ParseOneInstance(Record* instance) {
             instance->uint64_feasigns_.push_back(FeatureItem(f, idx));
           }
         }
-        pos = endptr - str;
       } else {
-        for (int j = 0; j <= num; ++j) {
-          pos = line.find_first_of(' ', pos + 1);
-        }
+        parser.SkipTokens(num);
       }
     }
     instance->float_feasigns_.shrink_to_fit();
@@ -2195,6 +2262,11 @@ void SlotRecordInMemoryDataFeed::LoadIntoMemoryByFile(void) {
   while (this->PickOneFile(&filename)) {
     VLOG(3) << "PickOneFile, filename=" << filename
             << ", thread_id=" << thread_id_;
+    // the parser library reads the text files only
+    if (IsSampleFile(filename)) {
+      LoadSampleFile(filename);
+      continue;
+    }
     platform::Timer timeline;
     timeline.Start();
 
@@ -2342,6 +2414,10 @@ void SlotRecordInMemoryDataFeed::LoadIntoMemoryByCommand(void) {
   while (this->PickOneFile(&filename)) {
     VLOG(3) << "PickOneFile, filename=" << filename
             << ", thread_id=" << thread_id_;
+    if (IsSampleFile(filename)) {
+      LoadSampleFile(filename);
+      continue;
+    }
     int lines = 0;
     std::vector<SlotRecord> record_vec;
     platform::Timer timeline;
@@ -2398,6 +2474,66 @@ void SlotRecordInMemoryDataFeed::LoadIntoMemoryByCommand(void) {
 #endif
 }
 
+void SlotRecordInMemoryDataFeed::LoadSampleFile(const std::string& filename) {
+  platform::Timer timeline;
+  timeline.Start();
+  SampleFileReader reader(filename);
+  PADDLE_ENFORCE_EQ(
+      reader.header().record_type,
+      kSlotRecordSample,
+      platform::errors::InvalidArgument(
+          "The sample file is not dumped by a SlotRecordDataset, file[%s].",
+          filename));
+  SampleFileSampler sampler(sample_rate_);
+
+  std::vector<SlotRecord> record_vec;
+  SlotRecordPool().get(&record_vec, OBJPOOL_BLOCK_SIZE);
+  int offset = 0;
+  size_t num = 0;
+  const char* data = nullptr;
+  size_t size = 0;
+  while (reader.Next(&data, &size)) {
+    if (!sampler.Keep()) {
+      continue;
+    }
+    SlotRecord& rec = record_vec[offset];
+    DeserializeSample(data, size, &rec);
+    PADDLE_ENFORCE_EQ(
+        rec->slot_uint64_feasigns_.slot_offsets.size() ==
+                static_cast<size_t>(uint64_use_slot_size_ + 1) &&
+            rec->slot_float_feasigns_.slot_offsets.size() ==
+                static_cast<size_t>(float_use_slot_size_ + 1),
+        true,
+        platform::errors::InvalidArgument(
+            "The sample of file[%s] has %d uint64 slots and %d float slots, "
+            "but %d and %d slots are used.",
+            filename,
+            rec->slot_uint64_feasigns_.slot_offsets.size() - 1,
+            rec->slot_float_feasigns_.slot_offsets.size() - 1,
+            uint64_use_slot_size_,
+            float_use_slot_size_));
+    ++num;
+    if (++offset >= OBJPOOL_BLOCK_SIZE) {
+      input_channel_->Write(std::move(record_vec));
+      record_vec.clear();
+      SlotRecordPool().get(&record_vec, OBJPOOL_BLOCK_SIZE);
+      offset = 0;
+    }
+  }
+  if (offset > 0) {
+    input_channel_->WriteMove(offset, &record_vec[0]);
+    if (offset < OBJPOOL_BLOCK_SIZE) {
+      SlotRecordPool().put(&record_vec[offset], (OBJPOOL_BLOCK_SIZE - offset));
+    }
+  } else {
+    SlotRecordPool().put(&record_vec);
+  }
+  timeline.Pause();
+  VLOG(3) << "LoadSampleFile() read all samples, file=" << filename
+          << ", samples=" << num << ", cost time=" << timeline.ElapsedSec()
+          << " seconds, thread_id=" << thread_id_;
+}
+
 static void parser_log_key(const std::string& log_key,
                            uint64_t* search_id,
                            uint32_t* cmatch,
@@ -2459,9 +2595,10 @@ bool SlotRecordInMemoryDataFeed::ParseOneInstance(const std::string& line,
   int float_total_slot_num = 0;
   int uint64_total_slot_num = 0;
 
+  SlotTextParser parser(str, line.size(), pos);
   for (size_t i = 0; i < all_slots_info_.size(); ++i) {
     auto& info = all_slots_info_[i];
-    int num = strtol(&str[pos], &endptr, 10);
+    int num = parser.ParseInt();
     PADDLE_ENFORCE(num,
                    "The number of ids can not be zero, you need padding "
                    "it in data generator; or if there is something wrong with "
@@ -2473,7 +2610,7 @@ bool SlotRecordInMemoryDataFeed::ParseOneInstance(const std::string& line,
         auto& slot_fea = slot_float_feasigns[info.slot_value_idx];
         slot_fea.clear();
         for (int j = 0; j < num; ++j) {
-          float feasign = strtof(endptr, &endptr);
+          float feasign = parser.ParseFloat();
           if (fabs(feasign) < 1e-6 && !used_slots_info_[info.used_idx].dense) {
             continue;
           }
@@ -2484,20 +2621,13 @@ bool SlotRecordInMemoryDataFeed::ParseOneInstance(const std::string& line,
         auto& slot_fea = slot_uint64_feasigns[info.slot_value_idx];
         slot_fea.clear();
         for (int j = 0; j < num; ++j) {
-          uint64_t feasign =
-              static_cast<uint64_t>(strtoull(endptr, &endptr, 10));
+          uint64_t feasign = parser.ParseUint64();
           slot_fea.push_back(feasign);
           ++uint64_total_slot_num;
         }
       }
-      pos = endptr - str;
     } else {
-      for (int j = 0; j <= num; ++j) {
-        // pos = line.find_first_of(' ', pos + 1);
-        while (line[pos + 1] != ' ') {
-          pos++;
-        }
-      }
+      parser.SkipTokens(num);
     }
   }
   rec->slot_float_feasigns_.add_slot_feasigns(slot_float_feasigns,
@@ -2529,6 +2659,10 @@ void SlotRecordInMemoryDataFeed::PutToFeedVec(const SlotRecord* ins_vec,
 #if defined(PADDLE_WITH_CUDA) && defined(PADDLE_WITH_HETERPS)
   // do nothing
 #else
+  if (columns_ != nullptr) {
+    PutColumnsToFeedVec(ins_vec, num);
+    return;
+  }
   for (int j = 0; j < use_slot_size_; ++j) {
     auto& feed = feed_vec_[j];
     if (feed == nullptr) {
@@ -2609,6 +2743,276 @@ void SlotRecordInMemoryDataFeed::PutToFeedVec(const SlotRecord* ins_vec,
 #endif
 }
 
+constexpr size_t SlotRecordColumns::kChunkRecordNum;
+
+void SlotRecordColumns::Build(SlotRecord* records,
+                              size_t num,
+                              int uint64_slot_num,
+                              int float_slot_num,
+                              int thread_num) {
+  Clear();
+  record_num_ = num;
+  uint64_slot_num_ = uint64_slot_num;
+  float_slot_num_ = float_slot_num;
+  size_t chunk_num = (num + kChunkRecordNum - 1) / kChunkRecordNum;
+  chunks_.resize(chunk_num);
+  thread_num = std::max(1, std::min(thread_num, static_cast<int>(chunk_num)));
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < thread_num; ++tid) {
+    threads.emplace_back([this, records, num, chunk_num, tid, thread_num]() {
+      for (size_t i = tid; i < chunk_num; i += thread_num) {
+        size_t begin = i * kChunkRecordNum;
+        BuildChunk(records + begin,
+                   std::min(kChunkRecordNum, num - begin),
+                   begin,
+                   &chunks_[i]);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+}
+
+void SlotRecordColumns::BuildChunk(SlotRecord* records,
+                                   size_t num,
+                                   size_t first_row,
+                                   Chunk* chunk) {
+  auto build = [records, num](auto member, int slot_num, auto* columns) {
+    columns->resize(slot_num);
+    // count the values first so that each column is allocated once
+    std::vector<size_t> totals(slot_num, 0);
+    for (size_t i = 0; i < num; ++i) {
+      auto& offsets = (records[i]->*member).slot_offsets;
+      int n = std::min(slot_num, static_cast<int>(offsets.size()) - 1);
+      for (int j = 0; j < n; ++j) {
+        totals[j] += offsets[j + 1] - offsets[j];
+      }
+    }
+    for (int j = 0; j < slot_num; ++j) {
+      auto& column = (*columns)[j];
+      column.values.reserve(totals[j]);
+      column.offsets.reserve(num + 1);
+      column.offsets.push_back(0);
+    }
+    for (size_t i = 0; i < num; ++i) {
+      auto& slot_values = records[i]->*member;
+      auto& offsets = slot_values.slot_offsets;
+      int n = std::min(slot_num, static_cast<int>(offsets.size()) - 1);
+      for (int j = 0; j < slot_num; ++j) {
+        auto& column = (*columns)[j];
+        if (j < n) {
+          auto values = slot_values.slot_values.begin();
+          column.values.insert(column.values.end(),
+                               values + offsets[j],
+                               values + offsets[j + 1]);
+        }
+        column.offsets.push_back(static_cast<uint32_t>(column.values.size()));
+      }
+    }
+  };
+  build(&SlotRecordObject::slot_uint64_feasigns_,
+        uint64_slot_num_,
+        &chunk->uint64_slots);
+  build(&SlotRecordObject::slot_float_feasigns_,
+        float_slot_num_,
+        &chunk->float_slots);
+  for (size_t i = 0; i < num; ++i) {
+    records[i]->clear(true);
+    records[i]->column_row_ = static_cast<int64_t>(first_row + i);
+  }
+}
+
+void SlotRecordColumns::Clear() {
+  record_num_ = 0;
+  std::vector<Chunk>().swap(chunks_);
+}
+
+size_t SlotRecordColumns::MemorySize() const {
+  size_t total = 0;
+  for (auto& chunk : chunks_) {
+    for (auto& column : chunk.uint64_slots) {
+      total += column.values.capacity() * sizeof(uint64_t) +
+               column.offsets.capacity() * sizeof(uint32_t);
+    }
+    for (auto& column : chunk.float_slots) {
+      total += column.values.capacity() * sizeof(float) +
+               column.offsets.capacity() * sizeof(uint32_t);
+    }
+  }
+  return total;
+}
+
+template <>
+const SlotRecordColumns::Column<uint64_t>&
+SlotRecordColumns::GetColumn<uint64_t>(size_t chunk_idx,
+                                       int slot_value_idx) const {
+  return chunks_[chunk_idx].uint64_slots[slot_value_idx];
+}
+
+template <>
+const SlotRecordColumns::Column<float>& SlotRecordColumns::GetColumn<float>(
+    size_t chunk_idx, int slot_value_idx) const {
+  return chunks_[chunk_idx].float_slots[slot_value_idx];
+}
+
+template <typename T>
+size_t SlotRecordColumns::GetLoD(int slot_value_idx,
+                                 const SlotRecord* records,
+                                 size_t num,
+                                 std::vector<size_t>* lod) const {
+  constexpr bool kFillEmpty = std::is_same<T, uint64_t>::value;
+  lod->clear();
+  lod->reserve(num + 1);
+  lod->push_back(0);
+  size_t total = 0;
+  for (size_t i = 0; i < num; ++i) {
+    size_t row = static_cast<size_t>(records[i]->column_row_);
+    auto& offsets =
+        GetColumn<T>(row / kChunkRecordNum, slot_value_idx).offsets;
+    size_t k = row % kChunkRecordNum;
+    size_t fea_num = offsets[k + 1] - offsets[k];
+    total += (kFillEmpty && fea_num == 0) ? 1 : fea_num;
+    lod->push_back(total);
+  }
+  return total;
+}
+
+template <typename T>
+void SlotRecordColumns::CopyValues(int slot_value_idx,
+                                   const SlotRecord* records,
+                                   size_t num,
+                                   T* dst) const {
+  constexpr bool kFillEmpty = std::is_same<T, uint64_t>::value;
+  size_t i = 0;
+  while (i < num) {
+    // the run of records of consecutive rows of one chunk, which is the
+    // whole batch unless the records are shuffled after the build
+    size_t row = static_cast<size_t>(records[i]->column_row_);
+    size_t first = row % kChunkRecordNum;
+    size_t last = first + 1;
+    while (i + last - first < num && last < kChunkRecordNum &&
+           static_cast<size_t>(records[i + last - first]->column_row_) ==
+               row + last - first) {
+      ++last;
+    }
+    i += last - first;
+    auto& column = GetColumn<T>(row / kChunkRecordNum, slot_value_idx);
+    auto& offsets = column.offsets;
+    auto copy = [&dst, &column](size_t from, size_t to) {
+      if (to > from) {
+        memcpy(dst, &column.values[from], sizeof(T) * (to - from));
+        dst += to - from;
+      }
+    };
+    size_t run_begin = offsets[first];
+    if (kFillEmpty) {
+      // copy the runs of records having values, and 0 for each empty one
+      for (size_t k = first; k < last; ++k) {
+        if (offsets[k + 1] == offsets[k]) {
+          copy(run_begin, offsets[k]);
+          *dst++ = 0;
+          run_begin = offsets[k];
+        }
+      }
+    }
+    copy(run_begin, offsets[last]);
+  }
+}
+
+void SlotRecordColumns::GetValues(int64_t row, SlotRecord rec) const {
+  size_t chunk_idx = static_cast<size_t>(row) / kChunkRecordNum;
+  size_t k = static_cast<size_t>(row) % kChunkRecordNum;
+  auto get = [this, chunk_idx, k](int slot_num, auto* slot_values) {
+    using T = typename decltype(slot_values->slot_values)::value_type;
+    slot_values->clear(false);
+    for (int j = 0; j < slot_num; ++j) {
+      auto& column = this->template GetColumn<T>(chunk_idx, j);
+      uint32_t begin = column.offsets[k];
+      slot_values->add_values(column.values.data() + begin,
+                              column.offsets[k + 1] - begin);
+    }
+  };
+  get(uint64_slot_num_, &rec->slot_uint64_feasigns_);
+  get(float_slot_num_, &rec->slot_float_feasigns_);
+}
+
+template size_t SlotRecordColumns::GetLoD<uint64_t>(
+    int, const SlotRecord*, size_t, std::vector<size_t>*) const;
+template size_t SlotRecordColumns::GetLoD<float>(
+    int, const SlotRecord*, size_t, std::vector<size_t>*) const;
+template void SlotRecordColumns::CopyValues<uint64_t>(int,
+                                                      const SlotRecord*,
+                                                      size_t,
+                                                      uint64_t*) const;
+template void SlotRecordColumns::CopyValues<float>(int,
+                                                   const SlotRecord*,
+                                                   size_t,
+                                                   float*) const;
+
+void SlotRecordInMemoryDataFeed::PutColumnsToFeedVec(const SlotRecord* ins_vec,
+                                                     int num) {
+  bool is_cpu = platform::is_cpu_place(this->place_);
+  for (int j = 0; j < use_slot_size_; ++j) {
+    auto& feed = feed_vec_[j];
+    if (feed == nullptr) {
+      continue;
+    }
+
+    auto& slot_offset = offset_[j];
+    int total_instance = 0;
+    auto& info = used_slots_info_[j];
+    // values are copied into the tensor directly on cpu
+    if (info.type[0] == 'f') {  // float
+      total_instance = static_cast<int>(columns_->GetLoD<float>(
+          info.slot_value_idx, ins_vec, num, &slot_offset));
+      float* tensor_ptr =
+          feed->mutable_data<float>({total_instance, 1}, this->place_);
+      if (is_cpu) {
+        columns_->CopyValues<float>(
+            info.slot_value_idx, ins_vec, num, tensor_ptr);
+      } else {
+        auto& batch_fea = batch_float_feasigns_[j];
+        batch_fea.resize(total_instance);
+        columns_->CopyValues<float>(
+            info.slot_value_idx, ins_vec, num, batch_fea.data());
+        CopyToFeedTensor(
+            tensor_ptr, batch_fea.data(), total_instance * sizeof(float));
+      }
+    } else if (info.type[0] == 'u') {  // uint64
+      total_instance = static_cast<int>(columns_->GetLoD<uint64_t>(
+          info.slot_value_idx, ins_vec, num, &slot_offset));
+      // no uint64_t type in paddlepaddle
+      int64_t* tensor_ptr =
+          feed->mutable_data<int64_t>({total_instance, 1}, this->place_);
+      if (is_cpu) {
+        columns_->CopyValues<uint64_t>(info.slot_value_idx,
+                                       ins_vec,
+                                       num,
+                                       reinterpret_cast<uint64_t*>(tensor_ptr));
+      } else {
+        auto& batch_fea = batch_uint64_feasigns_[j];
+        batch_fea.resize(total_instance);
+        columns_->CopyValues<uint64_t>(
+            info.slot_value_idx, ins_vec, num, batch_fea.data());
+        CopyToFeedTensor(
+            tensor_ptr, batch_fea.data(), total_instance * sizeof(int64_t));
+      }
+    }
+
+    if (info.dense) {
+      if (info.inductive_shape_index != -1) {
+        info.local_shape[info.inductive_shape_index] =
+            total_instance / info.total_dims_without_inductive;
+      }
+      feed->Resize(phi::make_ddim(info.local_shape));
+    } else {
+      LoD data_lod{slot_offset};
+      feed_vec_[j]->set_lod(data_lod);
+    }
+  }
+}
+
 void SlotRecordInMemoryDataFeed::ExpandSlotRecord(SlotRecord* rec) {
   SlotRecord& ins = (*rec);
   if (ins->slot_float_feasigns_.slot_offsets.empty()) {
@@ -2714,7 +3118,7 @@ bool SlotRecordInMemoryDataFeed::Start() {
         auto batch_size = batch.second;
 
         paddle::platform::SetDeviceId(place_.GetDeviceId());
-        pack->pack_instance(&records_[offset], batch_size);
+        pack->pack_instance(&records_[offset], batch_size, columns_);
         this->BuildSlotBatchGPU(batch_size, pack);
         using_pack_queue_.Push(pack);
       }
@@ -3171,10 +3575,25 @@ void MiniBatchGpuPack::pack_float_data(const SlotRecord* ins_vec, int num) {
       << "float value length error";
 }
 
-void MiniBatchGpuPack::pack_instance(const SlotRecord* ins_vec, int num) {
+void MiniBatchGpuPack::pack_instance(const SlotRecord* ins_vec,
+                                     int num,
+                                     const SlotRecordColumns* columns) {
   ins_num_ = num;
   batch_ins_ = ins_vec;
   CHECK(used_uint64_num_ > 0 || used_float_num_ > 0);
+  if (columns != nullptr) {
+    // the values of the pack are laid out by record, so the batch is filled
+    // with its values first; the objects are kept to reuse their memory
+    if (column_records_.size() < static_cast<size_t>(num)) {
+      column_records_.resize(num);
+    }
+    column_ins_.resize(num);
+    for (int i = 0; i < num; ++i) {
+      column_ins_[i] = &column_records_[i];
+      columns->GetValues(ins_vec[i]->column_row_, column_ins_[i]);
+    }
+    ins_vec = column_ins_.data();
+  }
   // uint64 and float
   if (used_uint64_num_ > 0 && used_float_num_ > 0) {
     pack_all_data(ins_vec, num);
@@ -53,6 +53,7 @@ DECLARE_int32(record_pool_max_size);
 DECLARE_int32(slotpool_thread_num);
 DECLARE_bool(enable_slotpool_wait_release);
 DECLARE_bool(enable_slotrecord_reset_shrink);
+DECLARE_bool(enable_slotrecord_columnar);
 
 namespace paddle {
 namespace framework {
@@ -184,12 +185,16 @@ struct SlotRecordObject {
   std::string ins_id_;
   SlotValues<uint64_t> slot_uint64_feasigns_;
   SlotValues<float> slot_float_feasigns_;
+  // the row of the record in SlotRecordColumns holding its slot values, or
+  // -1 if the record holds them itself
+  int64_t column_row_ = -1;
 
   ~SlotRecordObject() { clear(true); }
   void reset(void) { clear(FLAGS_enable_slotrecord_reset_shrink); }
   void clear(bool shrink) {
     slot_uint64_feasigns_.clear(shrink);
     slot_float_feasigns_.clear(shrink);
+    column_row_ = -1;
   }
 };
 using SlotRecord = SlotRecordObject*;
@@ -378,6 +383,69 @@ inline SlotObjPool& SlotRecordPool() {
   static SlotObjPool pool;
   return pool;
 }
+
+// Columnar layout of the slot values of in memory SlotRecords, used when
+// FLAGS_enable_slotrecord_columnar is set. The values of one slot of
+// kChunkRecordNum records are stored contiguously with their offsets, so the
+// slot of a batch of records built next to each other is assembled by a few
+// memcpy instead of a copy per record. Build moves the values out of the
+// records, which only keep their row in the columns, so that the values are
+// held once; the records may be shuffled after, and a record is filled with
+// its values again by GetValues, e.g. to dump it.
+class SlotRecordColumns {
+ public:
+  static constexpr size_t kChunkRecordNum = 65536;
+
+  // Moves the slot values of records[0, num) into columns with thread_num
+  // threads, the values of the records are released.
+  void Build(SlotRecord* records,
+             size_t num,
+             int uint64_slot_num,
+             int float_slot_num,
+             int thread_num);
+  void Clear();
+  size_t RecordNum() const { return record_num_; }
+  size_t MemorySize() const;
+
+  // Sets the lod offsets of the slot_value_idx-th slot of type T of
+  // records[0, num) and returns the value num. For uint64 slots a record
+  // without value counts one, which is filled by 0.
+  template <typename T>
+  size_t GetLoD(int slot_value_idx,
+                const SlotRecord* records,
+                size_t num,
+                std::vector<size_t>* lod) const;
+  template <typename T>
+  void CopyValues(int slot_value_idx,
+                  const SlotRecord* records,
+                  size_t num,
+                  T* dst) const;
+  // Fills the slot values of the record at row into rec.
+  void GetValues(int64_t row, SlotRecord rec) const;
+
+ private:
+  template <typename T>
+  struct Column {
+    std::vector<T> values;
+    std::vector<uint32_t> offsets;
+  };
+  struct Chunk {
+    std::vector<Column<uint64_t>> uint64_slots;
+    std::vector<Column<float>> float_slots;
+  };
+
+  void BuildChunk(SlotRecord* records,
+                  size_t num,
+                  size_t first_row,
+                  Chunk* chunk);
+  template <typename T>
+  const Column<T>& GetColumn(size_t chunk_idx, int slot_value_idx) const;
+
+  size_t record_num_ = 0;
+  int uint64_slot_num_ = 0;
+  int float_slot_num_ = 0;
+  std::vector<Chunk> chunks_;
+};
 struct PvInstanceObject {
   std::vector<Record*> ads;
   void merge_instance(Record* ins) { ads.push_back(ins); }
@@ -542,7 +610,10 @@ class MiniBatchGpuPack {
   bool is_use() { return is_using_; }
   void set_use_flag(bool is_use) { is_using_ = is_use; }
   void reset(const paddle::platform::Place& place);
-  void pack_instance(const SlotRecord* ins_vec, int num);
+  // reads the slot values from columns if the records have moved them there
+  void pack_instance(const SlotRecord* ins_vec,
+                     int num,
+                     const SlotRecordColumns* columns = nullptr);
   int ins_num() { return ins_num_; }
   int pv_num() { return pv_num_; }
   BatchGPUValue& value() { return value_; }
@@ -642,6 +713,9 @@ class MiniBatchGpuPack {
   std::vector<UsedSlotGpuType> gpu_used_slots_;
   std::vector<SlotRecord> ins_vec_;
   const SlotRecord* batch_ins_ = nullptr;
+  // the batch filled with its values from SlotRecordColumns
+  std::vector<SlotRecordObject> column_records_;
+  std::vector<SlotRecord> column_ins_;
 
   // uint64 tensor
   phi::DenseTensor uint64_tensor_;
@@ -1394,6 +1468,9 @@ class InMemoryDataFeed : public DataFeed {
   virtual void SetCurrentPhase(int current_phase);
   virtual void LoadIntoMemory();
   virtual void LoadIntoMemoryFromSo();
+  // loads a file of kSampleFileSuffix, which is dumped by
+  // Dataset::DumpSamples()
+  virtual void LoadSampleFile(const std::string& filename);
   virtual void SetRecord(T* records) { records_ = records; }
   int GetDefaultBatchSize() { return default_batch_size_; }
   void AddBatchOffset(const std::pair<int, int>& offset) {
@@ -1412,6 +1489,12 @@ class InMemoryDataFeed : public DataFeed {
                                   CustomParser* parser) {
     return 0;
   }
+  virtual bool ParseOneInstanceFromSample(const char* data,
+                                          size_t size,
+                                          T* instance) {
+    PADDLE_THROW(platform::errors::Unimplemented(
+        "This function(ParseOneInstanceFromSample) is not implemented."));
+  }
   virtual void PutToFeedVec(const std::vector<T>& ins_vec) = 0;
   virtual void PutToFeedVec(const T* ins_vec, int num) = 0;
 
@@ -1428,6 +1511,8 @@ class InMemoryDataFeed : public DataFeed {
   bool parse_logkey_;
   bool enable_pv_merge_;
   int current_phase_{-1};  // only for untest
+  // share of the instances kept on load, of text lines and sample files
+  float sample_rate_ = 1.0f;
   std::ifstream file_;
   std::shared_ptr<FILE> fp_;
   paddle::framework::ChannelObject<T>* input_channel_;
@@ -1797,6 +1882,9 @@ class MultiSlotInMemoryDataFeed : public InMemoryDataFeed<Record> {
                                   const char* str,
                                   std::vector<Record>* instances,
                                   CustomParser* parser);
+  virtual bool ParseOneInstanceFromSample(const char* data,
+                                          size_t size,
+                                          Record* instance);
   virtual void PutToFeedVec(const std::vector<Record>& ins_vec);
   virtual void GetMsgFromLogKey(const std::string& log_key,
                                 uint64_t* search_id,
@@ -1812,6 +1900,9 @@ class SlotRecordInMemoryDataFeed : public InMemoryDataFeed<SlotRecord> {
   virtual void Init(const DataFeedDesc& data_feed_desc);
   virtual void LoadIntoMemory();
   void ExpandSlotRecord(SlotRecord* ins);
+  int GetUint64SlotNum() { return uint64_use_slot_size_; }
+  int GetFloatSlotNum() { return float_use_slot_size_; }
+  void SetColumns(const SlotRecordColumns* columns) { columns_ = columns; }
 
  protected:
   virtual bool Start();
@@ -1826,11 +1917,14 @@ class SlotRecordInMemoryDataFeed : public InMemoryDataFeed<SlotRecord> {
   virtual void LoadIntoMemoryByLib(void);
   virtual void LoadIntoMemoryByLine(void);
   virtual void LoadIntoMemoryByFile(void);
+  virtual void LoadSampleFile(const std::string& filename);
   virtual void SetInputChannel(void* channel) {
     input_channel_ = static_cast<ChannelObject<SlotRecord>*>(channel);
   }
   bool ParseOneInstance(const std::string& line, SlotRecord* rec);
   virtual void PutToFeedVec(const SlotRecord* ins_vec, int num);
+  // the same as PutToFeedVec, reads the slot values from columns_
+  void PutColumnsToFeedVec(const SlotRecord* ins_vec, int num);
   virtual void AssignFeedVar(const Scope& scope);
 #if defined(PADDLE_WITH_CUDA) && defined(PADDLE_WITH_HETERPS)
   void BuildSlotBatchGPU(const int ins_num, MiniBatchGpuPack* pack);
@@ -1870,7 +1964,6 @@ class SlotRecordInMemoryDataFeed : public InMemoryDataFeed<SlotRecord> {
 #endif
   virtual void DumpWalkPath(std::string dump_path, size_t dump_rate);
 
-  float sample_rate_ = 1.0f;
   int use_slot_size_ = 0;
   int float_use_slot_size_ = 0;
   int uint64_use_slot_size_ = 0;
@@ -1878,6 +1971,7 @@ class SlotRecordInMemoryDataFeed : public InMemoryDataFeed<SlotRecord> {
   std::vector<UsedSlotInfo> used_slots_info_;
   size_t float_total_dims_size_ = 0;
   std::vector<int> float_total_dims_without_inductives_;
+  const SlotRecordColumns* columns_ = nullptr;
 
 #if defined(PADDLE_WITH_CUDA) && defined(PADDLE_WITH_HETERPS)
   int pack_thread_num_{5};
@@ -22,6 +22,8 @@
 #include "paddle/fluid/framework/data_feed_factory.h"
 #include "paddle/fluid/framework/fleet/fleet_wrapper.h"
 #include "paddle/fluid/framework/io/fs.h"
+#include "paddle/fluid/framework/parallel_shuffle.h"
+#include "paddle/fluid/framework/sample_binary_file.h"
 #include "paddle/fluid/platform/monitor.h"
 #include "paddle/fluid/platform/timer.h"
 
@@ -645,7 +647,7 @@ void DatasetImpl<T>::LocalShuffle() {
   input_channel_->Close();
   std::vector<T> data;
   input_channel_->ReadAll(data);
-  std::shuffle(data.begin(), data.end(), fleet_ptr->LocalRandomEngine());
+  ParallelShuffle(&data, thread_num_, fleet_ptr->LocalRandomEngine()());
   input_channel_->Open();
   input_channel_->Write(std::move(data));
   data.clear();
@@ -677,6 +679,64 @@ void DatasetImpl<T>::DumpWalkPath(std::string dump_path, size_t dump_rate) {
 #endif
 }
 
+template <typename T>
+void DatasetImpl<T>::DumpSamples(const std::string& dump_path) {
+  VLOG(3) << "DatasetImpl<T>::DumpSamples() begin";
+  platform::Timer timeline;
+  timeline.Start();
+  // the samples are in input_channel_, or in input_records_ once
+  // PrepareTrain has read them out of it
+  bool has_channel_data = input_channel_ && input_channel_->Size() > 0;
+  if (!has_channel_data && input_records_.empty()) {
+    VLOG(3) << "DatasetImpl<T>::DumpSamples() end, no data to dump";
+    return;
+  }
+  std::vector<T> data;
+  if (has_channel_data) {
+    input_channel_->Close();
+    input_channel_->ReadAll(data);
+  }
+  size_t total_num = input_records_.size() + data.size();
+  fs_mkdir(dump_path);
+  std::vector<std::thread> dump_threads;
+  for (int i = 0; i < thread_num_; ++i) {
+    dump_threads.emplace_back([this, i, total_num, &data, &dump_path] {
+      size_t begin = total_num * i / thread_num_;
+      size_t end = total_num * (i + 1) / thread_num_;
+      std::string path = string::format_string(
+          "%s/part-%05d%s", dump_path.c_str(), i, kSampleFileSuffix);
+      SampleFileWriter writer(path,
+                              GetSampleRecordType(static_cast<T*>(nullptr)));
+      for (size_t j = begin; j < end; ++j) {
+        WriteSample(&writer,
+                    j < input_records_.size()
+                        ? input_records_[j]
+                        : data[j - input_records_.size()]);
+      }
+    });
+  }
+  for (auto& t : dump_threads) {
+    t.join();
+  }
+  if (has_channel_data) {
+    input_channel_->Open();
+    input_channel_->Write(std::move(data));
+    data.clear();
+    data.shrink_to_fit();
+    input_channel_->Close();
+  }
+
+  timeline.Pause();
+  VLOG(3) << "DatasetImpl<T>::DumpSamples() end, cost time="
+          << timeline.ElapsedSec() << " seconds";
+}
+
+template <typename T>
+void DatasetImpl<T>::WriteSample(SampleFileWriter* writer,
+                                 const T& rec) const {
+  writer->Write(rec);
+}
+
 // do tdm sample
 void MultiSlotDataset::TDMSample(const std::string tree_name,
                                  const std::string tree_path,
@@ -770,22 +830,20 @@ void MultiSlotDataset::GlobalShuffle(int thread_num) {
     return;
   }
 
+  if (thread_num == -1) {
+    thread_num = thread_num_;
+  }
+
   // local shuffle
   input_channel_->Close();
   std::vector<Record> data;
   input_channel_->ReadAll(data);
-  std::shuffle(data.begin(), data.end(), fleet_ptr->LocalRandomEngine());
-  input_channel_->Open();
-  input_channel_->Write(std::move(data));
-  data.clear();
-  data.shrink_to_fit();
-
-  input_channel_->Close();
-  input_channel_->SetBlockSize(fleet_send_batch_size_);
+  ParallelShuffle(&data, thread_num, fleet_ptr->LocalRandomEngine()());
   VLOG(3) << "MultiSlotDataset::GlobalShuffle() input_channel_ size "
-          << input_channel_->Size();
+          << data.size();
 
-  auto get_client_id = [this, fleet_ptr](const Record& data) -> size_t {
+  auto get_client_id = [this](const Record& data,
+                              ShuffleEngine* engine) -> size_t {
     if (this->merge_by_insid_) {
       return XXH64(data.ins_id_.data(), data.ins_id_.length(), 0) %
              this->trainer_num_;
@@ -793,47 +851,55 @@ void MultiSlotDataset::GlobalShuffle(int thread_num) {
       return XXH64(data.uid_.data(), data.uid_.length(), 0) %
              this->trainer_num_;
     } else {
-      return fleet_ptr->LocalRandomEngine()() % this->trainer_num_;
+      return (*engine)() % this->trainer_num_;
     }
   };
 
-  auto global_shuffle_func = [this, get_client_id]() {
+  // partition by client in parallel, the records of each client stay in
+  // the shuffled order
+  std::vector<size_t> offsets;
+  ParallelPartition(&data,
+                    trainer_num_,
+                    thread_num,
+                    fleet_ptr->LocalRandomEngine()(),
+                    get_client_id,
+                    &offsets);
+
+  // send batches of fleet_send_batch_size_ records, in random order so
+  // that the clients receive at the same time
+  std::vector<std::pair<int, size_t>> batches;
+  for (int i = 0; i < trainer_num_; ++i) {
+    for (size_t begin = offsets[i]; begin < offsets[i + 1];
+         begin += fleet_send_batch_size_) {
+      batches.emplace_back(i, begin);
+    }
+  }
+  std::shuffle(batches.begin(), batches.end(), fleet_ptr->LocalRandomEngine());
+
+  std::atomic<size_t> next_batch{0};
+  auto global_shuffle_func = [this, &data, &offsets, &batches, &next_batch]() {
 #ifdef PADDLE_WITH_PSCORE
     auto fleet_ptr = distributed::FleetWrapper::GetInstance();
 #else
     auto fleet_ptr = framework::FleetWrapper::GetInstance();
 #endif
-    // auto fleet_ptr = framework::FleetWrapper::GetInstance();
-    std::vector<Record> data;
-    while (this->input_channel_->Read(data)) {
-      std::vector<paddle::framework::BinaryArchive> ars(this->trainer_num_);
-      for (auto& t : data) {
-        auto client_id = get_client_id(t);
-        ars[client_id] << t;
+    // a batch is serialized while the former one of the thread is sent
+    std::future<int32_t> last_status;
+    size_t index = 0;
+    while ((index = next_batch.fetch_add(1)) < batches.size()) {
+      int client_id = batches[index].first;
+      size_t begin = batches[index].second;
+      size_t end = std::min<size_t>(begin + this->fleet_send_batch_size_,
+                                    offsets[client_id + 1]);
+      paddle::framework::BinaryArchive ar;
+      for (size_t i = begin; i < end; ++i) {
+        ar << data[i];
       }
-      std::vector<std::future<int32_t>> total_status;
-      std::vector<int> send_index(this->trainer_num_);
-      for (int i = 0; i < this->trainer_num_; ++i) {
-        send_index[i] = i;
+      std::string msg(ar.Buffer(), ar.Length());
+      if (last_status.valid()) {
+        last_status.wait();
       }
-      std::shuffle(
-          send_index.begin(), send_index.end(), fleet_ptr->LocalRandomEngine());
-      for (int index = 0; index < this->trainer_num_; ++index) {
-        int i = send_index[index];
-        if (ars[i].Length() == 0) {
-          continue;
-        }
-        std::string msg(ars[i].Buffer(), ars[i].Length());
-        auto ret = fleet_ptr->SendClientToClientMsg(0, i, msg);
-        total_status.push_back(std::move(ret));
-      }
-      for (auto& t : total_status) {
-        t.wait();
-      }
-      ars.clear();
-      ars.shrink_to_fit();
-      data.clear();
-      data.shrink_to_fit();
+      last_status = fleet_ptr->SendClientToClientMsg(0, client_id, msg);
       // currently we find bottleneck is server not able to handle large data
       // in time, so we can remove this sleep and set fleet_send_batch_size to
       // 1024, and set server thread to 24.
@@ -841,12 +907,12 @@ void MultiSlotDataset::GlobalShuffle(int thread_num) {
         sleep(this->fleet_send_sleep_seconds_);
       }
     }
+    if (last_status.valid()) {
+      last_status.wait();
+    }
   };
 
   std::vector<std::thread> global_shuffle_threads;
-  if (thread_num == -1) {
-    thread_num = thread_num_;
-  }
   VLOG(3) << "start global shuffle threads, num = " << thread_num;
   for (int i = 0; i < thread_num; ++i) {
     global_shuffle_threads.push_back(std::thread(global_shuffle_func));
@@ -856,6 +922,8 @@ void MultiSlotDataset::GlobalShuffle(int thread_num) {
   }
   global_shuffle_threads.clear();
   global_shuffle_threads.shrink_to_fit();
+  data.clear();
+  data.shrink_to_fit();
   input_channel_->Clear();
   timeline.Pause();
   VLOG(3) << "DatasetImpl<T>::GlobalShuffle() end, cost time="
@@ -1825,6 +1893,8 @@ void SlotRecordDataset::ReleaseMemory() {
   if (enable_heterps_) {
     VLOG(3) << "put pool records size: " << input_records_.size();
     SlotRecordPool().put(&input_records_);
+    columns_.Clear();
+    columns_stale_ = true;
     input_records_.clear();
     input_records_.shrink_to_fit();
     VLOG(3) << "release heterps input records records size: "
@@ -1868,11 +1938,11 @@ void SlotRecordDataset::DynamicAdjustChannelNum(int channel_num,
 }
 
 void SlotRecordDataset::PrepareTrain() {
-#ifdef PADDLE_WITH_GLOO
   if (enable_heterps_) {
     if (input_records_.size() == 0 && input_channel_ != nullptr &&
         input_channel_->Size() != 0) {
       input_channel_->ReadAll(input_records_);
+      columns_stale_ = true;
       VLOG(3) << "read from channel to records with records size: "
               << input_records_.size();
     }
@@ -1885,6 +1955,8 @@ void SlotRecordDataset::PrepareTrain() {
     VLOG(3) << "thread_num: " << thread_num_
             << " memory size: " << total_ins_num
             << " default batch_size: " << default_batch_size;
+    // the batch num of the threads is aligned among the trainers by gloo,
+    // without it each trainer splits its own records
     compute_thread_batch_nccl(
         thread_num_, total_ins_num, default_batch_size, &offset);
     VLOG(3) << "offset size: " << offset.size();
@@ -1897,14 +1969,52 @@ void SlotRecordDataset::PrepareTrain() {
           readers_[i % thread_num_].get())
           ->AddBatchOffset(offset[i]);
     }
+    if (FLAGS_enable_slotrecord_columnar) {
+      BuildColumns();
+    }
   }
-#else
-  PADDLE_THROW(platform::errors::Unavailable(
-      "dataset set heterps need compile with GLOO"));
-#endif
   return;
 }
 
+void SlotRecordDataset::BuildColumns() {
+  auto* reader =
+      reinterpret_cast<SlotRecordInMemoryDataFeed*>(readers_[0].get());
+  if (columns_stale_) {
+    platform::Timer timeline;
+    timeline.Start();
+    columns_.Build(input_records_.data(),
+                   input_records_.size(),
+                   reader->GetUint64SlotNum(),
+                   reader->GetFloatSlotNum(),
+                   thread_num_);
+    timeline.Pause();
+    VLOG(1) << "build slot record columns of " << columns_.RecordNum()
+            << " records, memory size: " << columns_.MemorySize()
+            << ", span: " << timeline.ElapsedSec();
+    columns_stale_ = false;
+  }
+  for (int i = 0; i < thread_num_; i++) {
+    reinterpret_cast<SlotRecordInMemoryDataFeed*>(readers_[i].get())
+        ->SetColumns(&columns_);
+  }
+}
+
+void SlotRecordDataset::WriteSample(SampleFileWriter* writer,
+                                    const SlotRecord& rec) const {
+  if (rec->column_row_ < 0) {
+    writer->Write(rec);
+    return;
+  }
+  // the slot values are held by columns_
+  SlotRecordObject object;
+  object.search_id = rec->search_id;
+  object.rank = rec->rank;
+  object.cmatch = rec->cmatch;
+  object.ins_id_ = rec->ins_id_;
+  columns_.GetValues(rec->column_row_, &object);
+  writer->Write(SlotRecord(&object));
+}
+
 void SlotRecordDataset::DynamicAdjustReadersNum(int thread_num) {
   if (thread_num_ == thread_num) {
     VLOG(3) << "DatasetImpl<T>::DynamicAdjustReadersNum thread_num_="
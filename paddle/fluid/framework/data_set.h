@@ -36,6 +36,8 @@
 namespace paddle {
 namespace framework {
 
+class SampleFileWriter;
+
 // Dataset is a abstract class, which defines user interfaces
 // Example Usage:
 //    Dataset* dataset = DatasetFactory::CreateDataset("InMemoryDataset")
@@ -173,6 +175,9 @@ class Dataset {
   virtual uint32_t GetPassID() = 0;
 
   virtual void DumpWalkPath(std::string dump_path, size_t dump_rate) = 0;
+  // dump the samples loaded in memory to dump_path as sample files, which
+  // can be loaded again without parsing text
+  virtual void DumpSamples(const std::string& dump_path) = 0;
 
  protected:
   virtual int ReceiveFromClient(int msg_type,
@@ -268,6 +273,7 @@ class DatasetImpl : public Dataset {
   virtual std::vector<std::string> GetSlots();
   virtual bool GetEpochFinish();
   virtual void DumpWalkPath(std::string dump_path, size_t dump_rate);
+  virtual void DumpSamples(const std::string& dump_path);
 
   std::vector<paddle::framework::Channel<T>>& GetMultiOutputChannel() {
     return multi_output_channel_;
@@ -294,6 +300,8 @@ class DatasetImpl : public Dataset {
     // TODO(yaoxuefeng) for SlotRecordDataset
     return -1;
   }
+  // writes rec into the sample file of DumpSamples
+  virtual void WriteSample(SampleFileWriter* writer, const T& rec) const;
   std::vector<std::shared_ptr<paddle::framework::DataFeed>> readers_;
   std::vector<std::shared_ptr<paddle::framework::DataFeed>> preload_readers_;
   paddle::framework::Channel<T> input_channel_;
@@ -412,7 +420,18 @@ class SlotRecordDataset : public DatasetImpl<SlotRecord> {
   virtual void DynamicAdjustReadersNum(int thread_num);
 
  protected:
+  // moves the slot values of input_records_ into columns_ if they are stale
+  // and sets the columns to the readers
+  void BuildColumns();
+  virtual void WriteSample(SampleFileWriter* writer,
+                           const SlotRecord& rec) const;
+
   bool enable_heterps_ = true;
+  // slot values of input_records_ if FLAGS_enable_slotrecord_columnar
+  SlotRecordColumns columns_;
+  // set whenever input_records_ is read or released, the columns are built
+  // again by the next PrepareTrain
+  bool columns_stale_ = true;
 };
 
 }  // end namespace framework
@@ -16,14 +16,34 @@ limitations under the License. */
 
 #include <sys/stat.h>
 
+#include <algorithm>
+#include <cstring>
 #include <memory>
 
 #include "glog/logging.h"
+#include "paddle/fluid/framework/io/local_file_reader.h"
 #include "paddle/fluid/platform/enforce.h"
+#include "paddle/phi/core/flags.h"
+
+PADDLE_DEFINE_EXPORTED_bool(
+    enable_native_file_reader,
+    false,
+    "Whether to read local files in process when the converter is empty or "
+    "cat, by pread of large blocks and zlib for .gz files, instead of a "
+    "shell pipe.");
+
+PADDLE_DEFINE_EXPORTED_int64(
+    dataset_file_split_size_mb,
+    0,
+    "If > 0 and enable_native_file_reader is set, the local uncompressed "
+    "files of a dataset larger than this are split into byte ranges of this "
+    "size, which are read by the reader threads in parallel.");
 
 namespace paddle {
 namespace framework {
 
+static const char kRangeSeparator[] = "@range=";
+
 static void fs_add_read_converter_internal(std::string& path,  // NOLINT
                                            bool& is_pipe,      // NOLINT
                                            const std::string& converter) {
@@ -104,8 +124,76 @@ size_t localfs_buffer_size() { return localfs_buffer_size_internal(); }
 
 void localfs_set_buffer_size(size_t x) { localfs_buffer_size_internal() = x; }
 
+static bool fs_is_cat_converter_internal(const std::string& converter) {
+  std::string cmd = string::trim_spaces(converter);
+  return cmd == "" || cmd == "cat";
+}
+
+std::string fs_range_path(const std::string& path,
+                          int64_t begin,
+                          int64_t end) {
+  return string::format_string(
+      "%s%s%ld-%ld", path.c_str(), kRangeSeparator, begin, end);
+}
+
+bool fs_parse_range_path(const std::string& path,
+                         std::string* file,
+                         int64_t* begin,
+                         int64_t* end) {
+  size_t pos = path.rfind(kRangeSeparator);
+  if (pos == std::string::npos) {
+    return false;
+  }
+  long begin_value = 0;  // NOLINT
+  long end_value = 0;    // NOLINT
+  if (sscanf(path.c_str() + pos + strlen(kRangeSeparator),
+             "%ld-%ld",
+             &begin_value,
+             &end_value) != 2) {
+    return false;
+  }
+  *file = path.substr(0, pos);
+  *begin = begin_value;
+  *end = end_value;
+  return true;
+}
+
+std::vector<std::string> fs_split_read_ranges(
+    const std::vector<std::string>& paths, const std::string& converter) {
+  int64_t split_size = FLAGS_dataset_file_split_size_mb << 20;
+  if (!FLAGS_enable_native_file_reader || split_size <= 0 ||
+      !fs_is_cat_converter_internal(converter)) {
+    return paths;
+  }
+  std::vector<std::string> ranges;
+  for (auto& path : paths) {
+    struct stat buf;
+    if (fs_select_internal(path) != 0 || fs_end_with_internal(path, ".gz") ||
+        stat(path.c_str(), &buf) != 0 || buf.st_size <= split_size) {
+      ranges.push_back(path);
+      continue;
+    }
+    for (int64_t begin = 0; begin < buf.st_size; begin += split_size) {
+      ranges.push_back(fs_range_path(
+          path, begin, std::min<int64_t>(begin + split_size, buf.st_size)));
+    }
+  }
+  return ranges;
+}
+
 std::shared_ptr<FILE> localfs_open_read(std::string path,
                                         const std::string& converter) {
+  if (FLAGS_enable_native_file_reader &&
+      fs_is_cat_converter_internal(converter)) {
+    std::string file;
+    int64_t begin = 0;
+    int64_t end = -1;
+    if (fs_parse_range_path(path, &file, &begin, &end)) {
+      return localfs_open_read_native(file, begin, end);
+    }
+    return localfs_open_read_native(path);
+  }
+
   bool is_pipe = false;
 
   if (fs_end_with_internal(path, ".gz")) {
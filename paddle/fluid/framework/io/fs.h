@@ -30,6 +30,22 @@ namespace framework {
 
 int fs_select_internal(const std::string& path);
 
+// Path of the byte range [begin, end) of a local file, which is read by
+// fs_open_read when enable_native_file_reader is set.
+extern std::string fs_range_path(const std::string& path,
+                                 int64_t begin,
+                                 int64_t end);
+
+extern bool fs_parse_range_path(const std::string& path,
+                                std::string* file,
+                                int64_t* begin,
+                                int64_t* end);
+
+// Splits the large local files of paths into byte ranges of
+// FLAGS_dataset_file_split_size_mb, returns paths if it is not enabled.
+extern std::vector<std::string> fs_split_read_ranges(
+    const std::vector<std::string>& paths, const std::string& converter);
+
 // localfs
 extern size_t localfs_buffer_size();
 
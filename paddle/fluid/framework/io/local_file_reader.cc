@@ -0,0 +1,272 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/io/local_file_reader.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "glog/logging.h"
+#include "paddle/fluid/platform/enforce.h"
+
+namespace paddle {
+namespace framework {
+
+namespace {
+
+constexpr int64_t kBlockSize = 4 << 20;
+constexpr int64_t kMinBlockSize = 64 << 10;
+
+bool EndWith(const std::string& path, const std::string& str) {
+  return path.size() >= str.size() &&
+         path.compare(path.size() - str.size(), str.size(), str) == 0;
+}
+
+}  // namespace
+
+struct LocalFileReader::GzipStream {
+  z_stream stream;
+  bool stream_end{false};
+};
+
+LocalFileReader::LocalFileReader(const std::string& path,
+                                 int64_t begin,
+                                 int64_t end)
+    : path_(path), end_(end) {
+  bool is_gzip = EndWith(path, ".gz");
+  PADDLE_ENFORCE_EQ(
+      !is_gzip || (begin == 0 && end < 0),
+      true,
+      platform::errors::InvalidArgument(
+          "A gzip file can not be read by byte range, path[%s].", path));
+  fd_ = open(path.c_str(), O_RDONLY);
+  PADDLE_ENFORCE_GE(
+      fd_,
+      0,
+      platform::errors::Unavailable("Failed to open file, path[%s].", path));
+  struct stat buf;
+  if (fstat(fd_, &buf) != 0) {
+    close(fd_);
+    PADDLE_THROW(platform::errors::External(
+        "Failed to get file status, path[%s].", path));
+  }
+  file_size_ = buf.st_size;
+  posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+  if (is_gzip) {
+    gzip_.reset(new GzipStream());
+    memset(&gzip_->stream, 0, sizeof(z_stream));
+    // 16 for the gzip header
+    if (inflateInit2(&gzip_->stream, 16 + MAX_WBITS) != Z_OK) {
+      close(fd_);
+      PADDLE_THROW(platform::errors::External(
+          "Failed to init zlib to read file, path[%s].", path));
+    }
+  }
+
+  if (end_ < 0 || end_ > file_size_) {
+    end_ = file_size_;
+  }
+  if (begin > 0) {
+    // the range begins in the line of the byte before it
+    read_pos_ = begin - 1;
+    skip_first_line_ = true;
+  }
+  block_pos_ = read_pos_;
+  finished_ = begin >= end_;
+  // a small range reads a small block, and the rest of its last line in
+  // the next blocks
+  block_.resize(static_cast<size_t>(std::min<int64_t>(
+      kBlockSize, std::max<int64_t>(end_ - read_pos_, kMinBlockSize))));
+}
+
+LocalFileReader::~LocalFileReader() {
+  if (gzip_ != nullptr) {
+    inflateEnd(&gzip_->stream);
+  }
+  close(fd_);
+}
+
+bool LocalFileReader::FillBlock() {
+  if (read_pos_ >= file_size_) {
+    return false;
+  }
+  size_t size = static_cast<size_t>(
+      std::min<int64_t>(block_.size(), file_size_ - read_pos_));
+  size_t done = 0;
+  while (done < size) {
+    ssize_t n = pread(fd_, block_.data() + done, size - done, read_pos_ + done);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    PADDLE_ENFORCE_GE(
+        n,
+        0,
+        platform::errors::External("Failed to read file, path[%s], errno %d.",
+                                   path_,
+                                   errno));
+    if (n == 0) {
+      break;
+    }
+    done += n;
+  }
+  if (done == 0) {
+    return false;
+  }
+  block_pos_ = read_pos_;
+  block_begin_ = 0;
+  block_end_ = done;
+  read_pos_ += done;
+  if (read_pos_ < file_size_) {
+    posix_fadvise(fd_, read_pos_, block_.size(), POSIX_FADV_WILLNEED);
+  }
+  return true;
+}
+
+size_t LocalFileReader::Read(char* buf, size_t size) {
+  if (finished_ || size == 0) {
+    return 0;
+  }
+  return gzip_ != nullptr ? ReadGzip(buf, size) : ReadRange(buf, size);
+}
+
+size_t LocalFileReader::ReadRange(char* buf, size_t size) {
+  size_t finished = 0;
+  while (finished < size && !finished_) {
+    if (block_begin_ == block_end_ && !FillBlock()) {
+      finished_ = true;
+      break;
+    }
+    const char* data = block_.data() + block_begin_;
+    size_t avail = block_end_ - block_begin_;
+    if (skip_first_line_) {
+      auto* newline = static_cast<const char*>(memchr(data, '\n', avail));
+      size_t n = newline != nullptr ? newline - data + 1 : avail;
+      skip_first_line_ = newline == nullptr;
+      block_begin_ += n;
+      block_pos_ += n;
+      continue;
+    }
+
+    size_t n = 0;
+    if (block_pos_ < end_) {
+      n = static_cast<size_t>(std::min<int64_t>(avail, end_ - block_pos_));
+    } else if (last_is_newline_) {
+      // the next line begins in the next range
+      finished_ = true;
+      break;
+    } else {
+      // the rest of the line crossing end
+      auto* newline = static_cast<const char*>(memchr(data, '\n', avail));
+      n = newline != nullptr ? newline - data + 1 : avail;
+    }
+    n = std::min(n, size - finished);
+    memcpy(buf + finished, data, n);
+    last_is_newline_ = data[n - 1] == '\n';
+    finished += n;
+    block_begin_ += n;
+    block_pos_ += n;
+  }
+  return finished;
+}
+
+size_t LocalFileReader::ReadGzip(char* buf, size_t size) {
+  z_stream& stream = gzip_->stream;
+  size = std::min<size_t>(size, std::numeric_limits<uInt>::max());
+  stream.next_out = reinterpret_cast<Bytef*>(buf);
+  stream.avail_out = static_cast<uInt>(size);
+  while (stream.avail_out > 0) {
+    if (block_begin_ == block_end_ && !FillBlock()) {
+      PADDLE_ENFORCE_EQ(
+          gzip_->stream_end || stream.total_in == 0,
+          true,
+          platform::errors::External("Unexpected end of gzip file, path[%s].",
+                                     path_));
+      finished_ = true;
+      break;
+    }
+    if (gzip_->stream_end) {
+      // concatenated gzip members, as zcat reads them
+      inflateReset(&stream);
+      gzip_->stream_end = false;
+    }
+    size_t avail = block_end_ - block_begin_;
+    stream.next_in = reinterpret_cast<Bytef*>(block_.data() + block_begin_);
+    stream.avail_in = static_cast<uInt>(avail);
+    int ret = inflate(&stream, Z_NO_FLUSH);
+    block_begin_ += avail - stream.avail_in;
+    if (ret == Z_STREAM_END) {
+      gzip_->stream_end = true;
+    } else {
+      PADDLE_ENFORCE_EQ(
+          ret == Z_OK || ret == Z_BUF_ERROR,
+          true,
+          platform::errors::External(
+              "Failed to inflate gzip file, path[%s], zlib error %d.",
+              path_,
+              ret));
+    }
+  }
+  return size - stream.avail_out;
+}
+
+#if defined(__linux__)
+static ssize_t LocalFileCookieRead(void* cookie, char* buf, size_t size) {
+  try {
+    return static_cast<LocalFileReader*>(cookie)->Read(buf, size);
+  } catch (std::exception& e) {
+    LOG(ERROR) << e.what();
+    errno = EIO;
+    return -1;
+  }
+}
+
+static int LocalFileCookieClose(void* cookie) {
+  delete static_cast<LocalFileReader*>(cookie);
+  return 0;
+}
+#endif
+
+std::shared_ptr<FILE> localfs_open_read_native(const std::string& path,
+                                               int64_t begin,
+                                               int64_t end) {
+#if defined(__linux__)
+  auto* reader = new LocalFileReader(path, begin, end);
+  cookie_io_functions_t funcs;
+  memset(&funcs, 0, sizeof(funcs));
+  funcs.read = LocalFileCookieRead;
+  funcs.close = LocalFileCookieClose;
+  FILE* fp = fopencookie(reader, "r", funcs);
+  if (fp == nullptr) {
+    delete reader;
+    PADDLE_THROW(
+        platform::errors::Unavailable("Failed to open file, path[%s].", path));
+  }
+  return {fp, [](FILE* fp) { fclose(fp); }};
+#else
+  PADDLE_THROW(platform::errors::Unimplemented(
+      "The native file reader is only supported on Linux."));
+  return nullptr;
+#endif
+}
+
+}  // namespace framework
+}  // namespace paddle
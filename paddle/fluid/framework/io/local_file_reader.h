@@ -0,0 +1,78 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace paddle {
+namespace framework {
+
+// Reads a local file in process, by pread of large blocks with the next
+// block advised to the kernel for readahead, and inflates .gz files with
+// zlib, so no shell and pipe is needed as with the zcat or cat converters.
+//
+// A reader can read the byte range [begin, end) of an uncompressed file
+// only. The range skips the line it begins in and reads the line crossing
+// end to its end, so the ranges splitting a file read each line once.
+class LocalFileReader {
+ public:
+  // end < 0 reads to the end of the file
+  LocalFileReader(const std::string& path, int64_t begin, int64_t end);
+  ~LocalFileReader();
+
+  LocalFileReader(const LocalFileReader&) = delete;
+  LocalFileReader& operator=(const LocalFileReader&) = delete;
+
+  // reads up to size bytes to buf, returns 0 at the end
+  size_t Read(char* buf, size_t size);
+
+ private:
+  struct GzipStream;
+
+  // reads the next block of the file, returns false at the end
+  bool FillBlock();
+  size_t ReadRange(char* buf, size_t size);
+  size_t ReadGzip(char* buf, size_t size);
+
+  std::string path_;
+  int fd_{-1};
+  int64_t file_size_{0};
+  int64_t end_{-1};
+  // file offset of the next block
+  int64_t read_pos_{0};
+  // file offset of block_[block_begin_]
+  int64_t block_pos_{0};
+  std::vector<char> block_;
+  size_t block_begin_{0};
+  size_t block_end_{0};
+  bool skip_first_line_{false};
+  bool last_is_newline_{true};
+  bool finished_{false};
+  std::unique_ptr<GzipStream> gzip_;
+};
+
+// Opens a LocalFileReader of path as a FILE, which works with fread and
+// getline as the files of localfs_open_read.
+std::shared_ptr<FILE> localfs_open_read_native(const std::string& path,
+                                               int64_t begin = 0,
+                                               int64_t end = -1);
+
+}  // namespace framework
+}  // namespace paddle
@@ -14,9 +14,14 @@
 
 #include <gtest/gtest.h>
 
+#include <zlib.h>
+
 #include <fstream>
+#include <string>
+#include <vector>
 
 #include "paddle/fluid/framework/io/fs.h"
+#include "paddle/fluid/framework/io/local_file_reader.h"
 
 #if defined _WIN32 || defined __APPLE__
 #else
@@ -60,3 +65,68 @@ TEST(FS, mv) {
 
 #endif
 }
+
+#ifdef _LINUX
+static std::string ReadNative(const std::string& path,
+                              int64_t begin,
+                              int64_t end) {
+  auto fp = paddle::framework::localfs_open_read_native(path, begin, end);
+  std::string content;
+  char buf[1000];
+  size_t n = 0;
+  while ((n = fread(buf, 1, sizeof(buf), fp.get())) > 0) {
+    content.append(buf, n);
+  }
+  return content;
+}
+#endif
+
+TEST(FS, native_read) {
+#ifdef _LINUX
+  std::string content;
+  for (int i = 0; i < 300000; ++i) {
+    content += std::to_string(i) + " " + std::string(i % 37, 'x') + "\n";
+  }
+  // the last line has no newline
+  content += "end";
+  {
+    std::ofstream out("native_read.txt");
+    out << content;
+  }
+  EXPECT_EQ(ReadNative("native_read.txt", 0, -1), content);
+
+  // the ranges read every line once, whatever the range size
+  for (int64_t split : {65536, 100000, 1 << 20, 5 << 20, 8 << 20}) {
+    std::string joined;
+    for (int64_t begin = 0; begin < static_cast<int64_t>(content.size());
+         begin += split) {
+      joined += ReadNative("native_read.txt", begin, begin + split);
+    }
+    EXPECT_EQ(joined, content) << "split " << split;
+  }
+
+  gzFile gz = gzopen("native_read.txt.gz", "wb");
+  gzwrite(gz, content.data(), content.size());
+  gzclose(gz);
+  // a second gzip member appended, as zcat reads it
+  gz = gzopen("native_read.txt.gz", "ab");
+  gzwrite(gz, "\nmore", 5);
+  gzclose(gz);
+  EXPECT_EQ(ReadNative("native_read.txt.gz", 0, -1), content + "\nmore");
+
+  std::string range = paddle::framework::fs_range_path("a.txt", 10, 20);
+  std::string file;
+  int64_t begin = 0;
+  int64_t end = 0;
+  EXPECT_TRUE(
+      paddle::framework::fs_parse_range_path(range, &file, &begin, &end));
+  EXPECT_EQ(file, "a.txt");
+  EXPECT_EQ(begin, 10);
+  EXPECT_EQ(end, 20);
+  EXPECT_FALSE(
+      paddle::framework::fs_parse_range_path("a.txt", &file, &begin, &end));
+
+  paddle::framework::localfs_remove("native_read.txt");
+  paddle::framework::localfs_remove("native_read.txt.gz");
+#endif
+}
@@ -0,0 +1,168 @@
+/* Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "paddle/fluid/framework/ir/embedding_seq_pool_fuse_pass.h"
+
+#include <string>
+#include <unordered_set>
+
+#include "paddle/fluid/framework/ir/graph_pattern_detector.h"
+
+namespace paddle {
+namespace framework {
+namespace ir {
+namespace patterns {
+
+struct EmbeddingSeqPoolPattern : public PatternBase {
+  EmbeddingSeqPoolPattern(PDPattern* pattern, const std::string& name_scope)
+      : PatternBase(pattern, name_scope, "embedding_seq_pool") {}
+  void operator()();
+  PATTERN_DECL_NODE(w);
+  PATTERN_DECL_NODE(ids);
+  PATTERN_DECL_NODE(lookup_table);
+  PATTERN_DECL_NODE(lookup_table_out);
+  PATTERN_DECL_NODE(sequence_pool);
+  PATTERN_DECL_NODE(sequence_pool_out);
+};
+
+void EmbeddingSeqPoolPattern::operator()() {
+  auto* w = pattern->NewNode(w_repr())
+                ->AsInput()
+                ->assert_is_persistable_var()
+                ->assert_is_op_input("lookup_table", "W");
+  auto* ids = pattern->NewNode(ids_repr())
+                  ->AsInput()
+                  ->assert_is_op_input("lookup_table", "Ids");
+  auto* lookup_table =
+      pattern->NewNode(lookup_table_repr())->assert_is_op("lookup_table");
+  auto* lookup_table_out = pattern->NewNode(lookup_table_out_repr())
+                               ->assert_is_op_output("lookup_table", "Out")
+                               ->assert_is_only_input_of_op("sequence_pool")
+                               ->AsIntermediate();
+  lookup_table->LinksFrom({w, ids}).LinksTo({lookup_table_out});
+  auto* sequence_pool =
+      pattern->NewNode(sequence_pool_repr())->assert_is_op("sequence_pool");
+  auto* sequence_pool_out = pattern->NewNode(sequence_pool_out_repr())
+                                ->assert_is_op_output("sequence_pool", "Out")
+                                ->AsOutput();
+  sequence_pool->LinksFrom({lookup_table_out}).LinksTo({sequence_pool_out});
+}
+
+}  // namespace patterns
+
+// The combiner of fused_embedding_seq_pool of the pooltype of sequence_pool,
+// or empty if it is not fused.
+static std::string EmbeddingSeqPoolCombiner(const std::string& pooltype) {
+  if (pooltype == "SUM") {
+    return "sum";
+  } else if (pooltype == "AVERAGE") {
+    return "mean";
+  } else if (pooltype == "SQRT") {
+    return "sqrt";
+  }
+  return "";
+}
+
+void EmbeddingSeqPoolFusePass::ApplyImpl(ir::Graph* graph) const {
+  PADDLE_ENFORCE_NOT_NULL(
+      graph, platform::errors::PreconditionNotMet("graph should not be null."));
+  FusePassBase::Init(name_scope_, graph);
+  GraphPatternDetector gpd;
+  patterns::EmbeddingSeqPoolPattern fused_pattern(gpd.mutable_pattern(),
+                                                  name_scope_);
+  fused_pattern();
+
+  int fusion_count{0};
+  auto handler = [&](const GraphPatternDetector::subgraph_t& subgraph,
+                     Graph* g) {
+    VLOG(4) << "handle Embedding SeqPool fuse";
+    GET_IR_NODE_FROM_SUBGRAPH(w, w, fused_pattern);
+    GET_IR_NODE_FROM_SUBGRAPH(ids, ids, fused_pattern);
+    GET_IR_NODE_FROM_SUBGRAPH(lookup_table, lookup_table, fused_pattern);
+    GET_IR_NODE_FROM_SUBGRAPH(
+        lookup_table_out, lookup_table_out, fused_pattern);
+    GET_IR_NODE_FROM_SUBGRAPH(sequence_pool, sequence_pool, fused_pattern);
+    GET_IR_NODE_FROM_SUBGRAPH(
+        sequence_pool_out, sequence_pool_out, fused_pattern);
+
+    auto* lookup_op = lookup_table->Op();
+    auto* pool_op = sequence_pool->Op();
+    std::string combiner = EmbeddingSeqPoolCombiner(
+        PADDLE_GET_CONST(std::string, pool_op->GetAttr("pooltype")));
+    if (combiner.empty()) {
+      return;
+    }
+    // the fused op pools empty sequences to 0, and does not count the
+    // padding ids
+    if (pool_op->HasAttr("pad_value") &&
+        PADDLE_GET_CONST(float, pool_op->GetAttr("pad_value")) != 0.f) {
+      return;
+    }
+    int64_t padding_idx =
+        PADDLE_GET_CONST(int64_t, lookup_op->GetAttr("padding_idx"));
+    if (padding_idx != -1 && combiner != "sum") {
+      return;
+    }
+    if (lookup_op->HasAttr("is_distributed") &&
+        PADDLE_GET_CONST(bool, lookup_op->GetAttr("is_distributed"))) {
+      return;
+    }
+    // the ids of the fused op are sequences of [-1, 1]
+    if (!ids->Var() || ids->Var()->GetLoDLevel() != 1) {
+      return;
+    }
+    auto ids_shape = ids->Var()->GetShape();
+    if (ids_shape.size() != 2 || ids_shape.back() != 1) {
+      return;
+    }
+    // the MaxIndex of sequence_pool, if any, should be unused
+    std::unordered_set<const Node*> marked_nodes(
+        {lookup_table, lookup_table_out, sequence_pool});
+    for (auto* out : sequence_pool->outputs) {
+      if (out == sequence_pool_out) {
+        continue;
+      }
+      if (!out->outputs.empty()) {
+        return;
+      }
+      marked_nodes.insert(out);
+    }
+
+    OpDesc op_desc;
+    op_desc.SetType("fused_embedding_seq_pool");
+    op_desc.SetInput("W", {w->Name()});
+    op_desc.SetInput("Ids", {ids->Name()});
+    op_desc.SetOutput("Out", {sequence_pool_out->Name()});
+    op_desc.SetAttr("combiner", combiner);
+    op_desc.SetAttr("padding_idx", padding_idx);
+    op_desc.SetAttr("is_sparse", false);
+    auto* op = g->CreateOpNode(&op_desc);
+    IR_NODE_LINK_TO(w, op);
+    IR_NODE_LINK_TO(ids, op);
+    IR_NODE_LINK_TO(op, sequence_pool_out);
+
+    GraphSafeRemoveNodes(g, marked_nodes);
+    ++fusion_count;
+  };
+
+  gpd(graph, handler);
+  AddStatis(fusion_count);
+}
+
+}  // namespace ir
+}  // namespace framework
+}  // namespace paddle
+
+REGISTER_PASS(embedding_seq_pool_fuse_pass,
+              paddle::framework::ir::EmbeddingSeqPoolFusePass);
@@ -0,0 +1,55 @@
+/* Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#include <string>
+
+#include "paddle/fluid/framework/ir/fuse_pass_base.h"
+
+namespace paddle {
+namespace framework {
+namespace ir {
+
+/**
+ * Fuse LookupTable and SequencePool (with sum, average or sqrt pooltype);
+ *
+ * Before fuse:
+ *     W     Ids
+ *      \    /
+ *    lookup_table
+ *         |
+ *   sequence_pool
+ *         |
+ * After fuse:
+ *     W     Ids
+ *      \    /
+ * FusedEmbeddingSeqPool
+ *         |
+ */
+class Graph;
+
+class EmbeddingSeqPoolFusePass : public FusePassBase {
+ public:
+  virtual ~EmbeddingSeqPoolFusePass() {}
+
+ protected:
+  void ApplyImpl(ir::Graph* graph) const override;
+
+  const std::string name_scope_{"embedding_seq_pool_fuse"};
+};
+
+}  // namespace ir
+}  // namespace framework
+}  // namespace paddle
@@ -0,0 +1,133 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include "paddle/fluid/framework/ir/embedding_seq_pool_fuse_pass.h"
+#include "paddle/fluid/framework/op_proto_maker.h"
+
+namespace paddle {
+namespace framework {
+namespace ir {
+
+void SetOp(ProgramDesc* prog,
+           const std::string& type,
+           const std::vector<std::string>& inputs,
+           const std::vector<std::string>& outputs,
+           const std::string& pooltype = "SUM") {
+  auto* op = prog->MutableBlock(0)->AppendOp();
+  op->SetType(type);
+  if (type == "lookup_table") {
+    op->SetInput("W", {inputs[0]});
+    op->SetInput("Ids", {inputs[1]});
+    op->SetAttr("padding_idx", static_cast<int64_t>(-1));
+    op->SetAttr("is_distributed", false);
+    op->SetOutput("Out", {outputs[0]});
+  } else if (type == "sequence_pool") {
+    op->SetInput("X", {inputs[0]});
+    op->SetAttr("pooltype", pooltype);
+    op->SetAttr("pad_value", 0.f);
+    op->SetOutput("MaxIndex", {outputs[0]});
+    op->SetOutput("Out", {outputs[1]});
+  } else {
+    op->SetInput("X", inputs);
+    op->SetOutput("Out", outputs);
+  }
+  op->SetAttr(OpProtoAndCheckerMaker::OpRoleAttrName(),
+              static_cast<int>(OpRole::kForward));
+}
+
+int CountOpType(const ir::Graph* graph,
+                const std::string& op_type = "fused_embedding_seq_pool") {
+  int count = 0;
+  for (auto* node : graph->Nodes()) {
+    if (node->IsOp() && node->Op()->Type() == op_type) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+ProgramDesc BuildProgramDesc(const std::string& pooltype) {
+  ProgramDesc prog;
+  for (auto& v : std::vector<std::string>({"w", "ids", "a", "b", "c"})) {
+    auto* var = prog.MutableBlock(0)->Var(v);
+    var->SetType(proto::VarType::LOD_TENSOR);
+  }
+  prog.MutableBlock(0)->Var("w")->SetPersistable(true);
+  prog.MutableBlock(0)->Var("w")->SetShape({100, 16});
+  prog.MutableBlock(0)->Var("ids")->SetShape({-1, 1});
+  prog.MutableBlock(0)->Var("ids")->SetLoDLevel(1);
+
+  SetOp(&prog,
+        "lookup_table",
+        std::vector<std::string>({"w", "ids"}),
+        std::vector<std::string>({"a"}));
+  SetOp(&prog,
+        "sequence_pool",
+        std::vector<std::string>({"a"}),
+        std::vector<std::string>({"b", "c"}),
+        pooltype);
+  return prog;
+}
+
+/*
+ * Before fuse:
+ *    w     ids
+ *     \    /
+ *   lookup_table
+ *        |
+ *        a
+ *        |
+ *  sequence_pool
+ *     /     \
+ *    b       c
+ *
+ * After fuse:
+ *    w     ids
+ *     \    /
+ * fused_embedding_seq_pool
+ *        |
+ *        c
+ */
+TEST(EmbeddingSeqPoolFusePass, basic) {
+  for (auto& pooltype : std::vector<std::string>({"SUM", "AVERAGE", "SQRT"})) {
+    std::unique_ptr<ir::Graph> graph(
+        new ir::Graph(BuildProgramDesc(pooltype)));
+    auto pass = PassRegistry::Instance().Get("embedding_seq_pool_fuse_pass");
+    int before = graph->Nodes().size();
+    graph.reset(pass->Apply(graph.release()));
+    int after = graph->Nodes().size();
+    // Remove 4 Nodes: lookup_table, a, sequence_pool, b
+    // Add 1 Node: fused_embedding_seq_pool
+    EXPECT_EQ(after, before - 3);
+    EXPECT_EQ(CountOpType(graph.get()), 1);
+    EXPECT_EQ(CountOpType(graph.get(), "lookup_table"), 0);
+  }
+}
+
+TEST(EmbeddingSeqPoolFusePass, unsupported_pooltype) {
+  std::unique_ptr<ir::Graph> graph(new ir::Graph(BuildProgramDesc("MAX")));
+  auto pass = PassRegistry::Instance().Get("embedding_seq_pool_fuse_pass");
+  int before = graph->Nodes().size();
+  graph.reset(pass->Apply(graph.release()));
+  EXPECT_EQ(static_cast<int>(graph->Nodes().size()), before);
+  EXPECT_EQ(CountOpType(graph.get()), 0);
+}
+
+}  // namespace ir
+}  // namespace framework
+}  // namespace paddle
+
+USE_PASS(embedding_seq_pool_fuse_pass);
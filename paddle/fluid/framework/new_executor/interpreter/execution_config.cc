@@ -134,7 +134,15 @@ void ExecutionConfig::Log(int log_level) {
           << "used_for_control_flow_op = " << used_for_control_flow_op << "\n"
           << "used_for_jit = " << used_for_jit << "\n"
           << "deivce_num_threads = " << device_num_threads << "\n"
-          << "host_num_threads = " << host_num_threads << "\n";
+          << "host_num_threads = " << host_num_threads << "\n"
+          << "use_work_stealing = " << use_work_stealing << "\n"
+          << "inline_op_max_cost_ns = " << inline_op_max_cost_ns << "\n"
+          << "use_static_memory_plan = " << use_static_memory_plan << "\n"
+          << "max_memory_plan_num = " << max_memory_plan_num << "\n"
+          << "profile_instructions = " << profile_instructions << "\n"
+          << "use_profiled_priority = " << use_profiled_priority << "\n"
+          << "profiled_priority_interval = " << profiled_priority_interval
+          << "\n";
 
   log_str << "force_root_scope_vars = [";
   for (const std::string& var : force_root_scope_vars) {
@@ -14,6 +14,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <set>
 #include <string>
 
@@ -33,6 +34,30 @@ struct ExecutionConfig {
   size_t device_num_threads{0};
   size_t host_num_threads{0};
 
+  // Run host instructions on a work-stealing pool instead of the host
+  // AsyncWorkQueue, see InterpreterCore::RunNextInstructionsStealing.
+  bool use_work_stealing{false};
+  // Ready host successors whose measured run time is below this are run on
+  // the current thread instead of being scheduled.
+  uint64_t inline_op_max_cost_ns{5000};
+
+  // On CPU, run the instructions serially in trace order and back the
+  // intermediate tensors with a preallocated arena, see StaticMemoryPlan.
+  bool use_static_memory_plan{false};
+  // At most this many plans, by feed shapes, are kept with their arenas, the
+  // least recently used one is freed to make room for a new one.
+  size_t max_memory_plan_num{4};
+
+  // Record the time, queue wait, thread and memory of every instruction,
+  // see InstructionProfiler.
+  bool profile_instructions{false};
+  // Order ready instructions of equal scheduling priority by the critical
+  // path measured in the previous runs, needs profile_instructions.
+  bool use_profiled_priority{false};
+  // The critical path and the trace order are computed again after every
+  // this many profiled runs, starting from the first one.
+  size_t profiled_priority_interval{16};
+
   std::set<std::string> force_root_scope_vars;
   std::set<std::string> jit_input_vars;
   std::set<std::string> skip_gc_vars;
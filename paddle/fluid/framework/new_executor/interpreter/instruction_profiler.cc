@@ -0,0 +1,223 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/new_executor/interpreter/instruction_profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <unordered_map>
+
+#include "paddle/fluid/framework/selected_rows_utils.h"
+#include "paddle/fluid/platform/os_info.h"
+
+namespace paddle {
+namespace framework {
+namespace interpreter {
+
+namespace {
+
+const phi::Allocation* HolderOf(const Variable* var) {
+  const phi::DenseTensor* tensor = nullptr;
+  if (var == nullptr) {
+    return nullptr;
+  } else if (var->IsType<phi::DenseTensor>()) {
+    tensor = &var->Get<phi::DenseTensor>();
+  } else if (var->IsType<phi::SelectedRows>()) {
+    tensor = &var->Get<phi::SelectedRows>().value();
+  }
+  return tensor != nullptr ? tensor->Holder().get() : nullptr;
+}
+
+template <typename Callback>
+void ForEachOutput(const Instruction& instr,
+                   const VariableScope& var_scope,
+                   Callback callback) {
+  for (auto& item : instr.Outputs()) {
+    for (int var_id : item.second) {
+      if (var_id >= 0) {
+        callback(var_scope.VarRef(var_id));
+      }
+    }
+  }
+}
+
+double ToUs(uint64_t ns) { return static_cast<double>(ns) / 1000.0; }
+
+}  // namespace
+
+void InstructionProfiler::Reset(size_t instr_num) {
+  records_.assign(instr_num, InstructionRecord());
+  costs_.assign(instr_num, InstructionCost());
+  critical_path_ns_.assign(instr_num, 0);
+  run_num_ = 0;
+}
+
+void InstructionProfiler::BeginRun() {
+  run_start_ns_ = platform::PosixInNsec();
+  for (auto& record : records_) {
+    record.ready_ns = 0;
+    record.start_ns = 0;
+    record.end_ns = 0;
+    record.alloc_bytes = 0;
+    record.free_bytes = 0;
+  }
+}
+
+void InstructionProfiler::EndRun() {
+  ++run_num_;
+  for (size_t i = 0; i < records_.size(); ++i) {
+    const InstructionRecord& record = records_[i];
+    if (record.start_ns < run_start_ns_ || record.end_ns < record.start_ns) {
+      continue;  // not run, e.g. an artificial instruction
+    }
+    // roots and instructions run in trace order are ready at the start
+    uint64_t ready_ns = std::max(record.ready_ns, run_start_ns_);
+    uint64_t time_ns = record.end_ns - record.start_ns;
+    InstructionCost& cost = costs_[i];
+    ++cost.runs;
+    cost.total_ns += time_ns;
+    cost.max_ns = std::max(cost.max_ns, time_ns);
+    cost.total_wait_ns +=
+        record.start_ns > ready_ns ? record.start_ns - ready_ns : 0;
+    cost.total_alloc_bytes += record.alloc_bytes;
+    cost.total_free_bytes += record.free_bytes;
+  }
+}
+
+void InstructionProfiler::MarkReady(size_t instr_id) {
+  records_[instr_id].ready_ns = platform::PosixInNsec();
+}
+
+void InstructionProfiler::Start(const Instruction& instr,
+                                const VariableScope& var_scope) {
+  InstructionRecord& record = records_[instr.Id()];
+  record.output_holders.clear();
+  ForEachOutput(instr, var_scope, [&record](const Variable* var) {
+    record.output_holders.push_back(HolderOf(var));
+  });
+  record.thread_id = platform::GetCurrentThreadStdId();
+  record.start_ns = platform::PosixInNsec();
+}
+
+void InstructionProfiler::End(const Instruction& instr,
+                              const VariableScope& var_scope) {
+  InstructionRecord& record = records_[instr.Id()];
+  record.end_ns = platform::PosixInNsec();
+  size_t idx = 0;
+  ForEachOutput(instr, var_scope, [&record, &idx](const Variable* var) {
+    const phi::Allocation* holder = HolderOf(var);
+    if (holder != nullptr && holder != record.output_holders[idx]) {
+      record.alloc_bytes += holder->size();
+    }
+    ++idx;
+  });
+}
+
+void InstructionProfiler::AddFreed(size_t instr_id, const Variable* var) {
+  const phi::Allocation* holder = HolderOf(var);
+  if (holder != nullptr) {
+    records_[instr_id].free_bytes += holder->size();
+  }
+}
+
+void InstructionProfiler::UpdateCriticalPath(
+    const std::map<size_t, std::set<size_t>>& downstream_map,
+    const std::vector<size_t>& topo_order) {
+  for (auto it = topo_order.rbegin(); it != topo_order.rend(); ++it) {
+    uint64_t longest_downstream = 0;
+    auto downstream = downstream_map.find(*it);
+    if (downstream != downstream_map.end()) {
+      for (size_t next_id : downstream->second) {
+        longest_downstream =
+            std::max(longest_downstream, critical_path_ns_[next_id]);
+      }
+    }
+    critical_path_ns_[*it] = costs_[*it].AverageNs() + longest_downstream;
+  }
+}
+
+void InstructionProfiler::ExportChromeTrace(
+    const std::string& path, const std::vector<Instruction>& instrs) const {
+  std::ofstream ofs(path, std::ofstream::out | std::ofstream::trunc);
+  if (!ofs) {
+    LOG(WARNING) << "Unable to open file " << path << " for writing data.";
+    return;
+  }
+  uint32_t pid = platform::GetProcessId();
+  ofs << std::fixed << std::setprecision(3);
+  ofs << "{\"displayTimeUnit\": \"us\", \"traceEvents\": [";
+  auto thread_names = platform::GetAllThreadNames();
+  bool first = true;
+  for (auto& item : thread_names) {
+    ofs << (first ? "\n" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\""
+        << ", \"pid\": " << pid << ", \"tid\": " << item.first
+        << ", \"args\": {\"name\": \"" << item.second << "\"}}";
+    first = false;
+  }
+  for (size_t i = 0; i < records_.size() && i < instrs.size(); ++i) {
+    const InstructionRecord& record = records_[i];
+    if (record.start_ns < run_start_ns_ || record.end_ns < record.start_ns) {
+      continue;
+    }
+    uint64_t ready_ns = std::max(record.ready_ns, run_start_ns_);
+    ofs << (first ? "\n" : ",\n") << "{\"name\": \""
+        << instrs[i].OpBase()->Type() << "\", \"cat\": \"Operator\""
+        << ", \"ph\": \"X\", \"pid\": " << pid
+        << ", \"tid\": " << record.thread_id
+        << ", \"ts\": " << ToUs(record.start_ns)
+        << ", \"dur\": " << ToUs(record.end_ns - record.start_ns)
+        << ", \"args\": {\"instr_id\": " << i << ", \"queue_wait_us\": "
+        << ToUs(record.start_ns > ready_ns ? record.start_ns - ready_ns : 0)
+        << ", \"alloc_bytes\": " << record.alloc_bytes
+        << ", \"free_bytes\": " << record.free_bytes << "}}";
+    first = false;
+  }
+  ofs << "\n]}\n";
+  if (ofs) {
+    LOG(INFO) << "writing the instruction trace to " << path;
+  }
+}
+
+void InstructionProfiler::ExportCsv(
+    const std::string& path, const std::vector<Instruction>& instrs) const {
+  std::ofstream ofs(path, std::ofstream::out | std::ofstream::trunc);
+  if (!ofs) {
+    LOG(WARNING) << "Unable to open file " << path << " for writing data.";
+    return;
+  }
+  auto thread_names = platform::GetAllThreadNames();
+  ofs << std::fixed << std::setprecision(3);
+  ofs << "instr_id,op_type,runs,avg_time_us,max_time_us,avg_queue_wait_us,"
+         "avg_alloc_bytes,avg_free_bytes,critical_path_us,last_thread\n";
+  for (size_t i = 0; i < costs_.size() && i < instrs.size(); ++i) {
+    const InstructionCost& cost = costs_[i];
+    uint64_t runs = std::max<uint64_t>(cost.runs, 1);
+    auto name = thread_names.find(records_[i].thread_id);
+    ofs << i << "," << instrs[i].OpBase()->Type() << "," << cost.runs << ","
+        << ToUs(cost.AverageNs()) << "," << ToUs(cost.max_ns) << ","
+        << ToUs(cost.total_wait_ns / runs) << ","
+        << cost.total_alloc_bytes / runs << ","
+        << cost.total_free_bytes / runs << ","
+        << ToUs(critical_path_ns_[i]) << ","
+        << (name != thread_names.end() ? name->second : "") << "\n";
+  }
+  if (ofs) {
+    LOG(INFO) << "writing the instruction cost table to " << path;
+  }
+}
+
+}  // namespace interpreter
+}  // namespace framework
+}  // namespace paddle
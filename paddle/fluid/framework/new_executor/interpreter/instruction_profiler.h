@@ -0,0 +1,107 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "paddle/fluid/framework/new_executor/new_executor_defs.h"
+
+namespace paddle {
+namespace framework {
+namespace interpreter {
+
+// What happened to one instruction in the last run, times are
+// PosixInNsec() values.
+struct InstructionRecord {
+  uint64_t ready_ns{0};  // all dependences done, waiting for a thread
+  uint64_t start_ns{0};
+  uint64_t end_ns{0};
+  uint64_t thread_id{0};  // std tid of the thread that ran it
+  size_t alloc_bytes{0};  // new output holders
+  size_t free_bytes{0};   // holders handed to the gc after it
+  // output holders before the run, to tell which ones it allocated
+  std::vector<const phi::Allocation*> output_holders;
+};
+
+// Sums over all profiled runs.
+struct InstructionCost {
+  uint64_t runs{0};
+  uint64_t total_ns{0};
+  uint64_t max_ns{0};
+  uint64_t total_wait_ns{0};
+  uint64_t total_alloc_bytes{0};
+  uint64_t total_free_bytes{0};
+
+  uint64_t AverageNs() const { return runs == 0 ? 0 : total_ns / runs; }
+};
+
+// Per-instruction profiler of InterpreterCore.
+//
+// Every instruction owns one record, written only by the thread that makes
+// it ready and then by the thread that runs it, so recording takes no lock
+// and costs a few clock reads per instruction. EndRun folds the records of
+// a run into the accumulated costs, which are exported as a chrome trace of
+// the last run and a CSV cost table, and turned into critical path lengths
+// that InterpreterCore uses to order ready instructions of equal priority.
+class InstructionProfiler {
+ public:
+  void Reset(size_t instr_num);
+  size_t Size() const { return records_.size(); }
+
+  void BeginRun();
+  void EndRun();
+  // the runs since the last Reset
+  uint64_t RunNum() const { return run_num_; }
+
+  void MarkReady(size_t instr_id);
+  void Start(const Instruction& instr, const VariableScope& var_scope);
+  void End(const Instruction& instr, const VariableScope& var_scope);
+  void AddFreed(size_t instr_id, const Variable* var);
+
+  const InstructionCost& Cost(size_t instr_id) const {
+    return costs_[instr_id];
+  }
+  const InstructionRecord& LastRecord(size_t instr_id) const {
+    return records_[instr_id];
+  }
+
+  // Longest path of average costs from each instruction to the end of the
+  // program. topo_order must list every instruction after its upstreams.
+  void UpdateCriticalPath(
+      const std::map<size_t, std::set<size_t>>& downstream_map,
+      const std::vector<size_t>& topo_order);
+  const std::vector<uint64_t>& CriticalPathNs() const {
+    return critical_path_ns_;
+  }
+
+  void ExportChromeTrace(const std::string& path,
+                         const std::vector<Instruction>& instrs) const;
+  void ExportCsv(const std::string& path,
+                 const std::vector<Instruction>& instrs) const;
+
+ private:
+  std::vector<InstructionRecord> records_;
+  std::vector<InstructionCost> costs_;
+  std::vector<uint64_t> critical_path_ns_;
+  uint64_t run_start_ns_{0};
+  uint64_t run_num_{0};
+};
+
+}  // namespace interpreter
+}  // namespace framework
+}  // namespace paddle
@@ -0,0 +1,266 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/new_executor/interpreter/static_memory_plan.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "paddle/fluid/memory/malloc.h"
+
+namespace paddle {
+namespace framework {
+namespace interpreter {
+
+namespace {
+
+constexpr size_t kBlockAlignment = 64;
+constexpr size_t kNoGap = std::numeric_limits<size_t>::max();
+
+size_t AlignSize(size_t size) {
+  return (size + kBlockAlignment - 1) / kBlockAlignment * kBlockAlignment;
+}
+
+// A slice of the arena, it keeps the arena alive as long as a tensor refers
+// to it.
+class ArenaAllocation : public phi::Allocation {
+ public:
+  ArenaAllocation(const std::shared_ptr<phi::Allocation>& arena,
+                  size_t offset,
+                  size_t size)
+      : phi::Allocation(static_cast<uint8_t*>(arena->ptr()) + offset,
+                        size,
+                        arena->place()),
+        arena_(arena) {}
+
+ private:
+  std::shared_ptr<phi::Allocation> arena_;
+};
+
+}  // namespace
+
+StaticMemoryPlan::StaticMemoryPlan(const platform::Place& place,
+                                   std::vector<MemoryBlock>&& blocks,
+                                   size_t var_num)
+    : blocks_(std::move(blocks)), planned_(var_num, false) {
+  // Best fit offset assignment: larger blocks are placed first, each in the
+  // smallest gap left between the blocks already placed whose lifetimes
+  // overlap with it, or after all of them when no gap is large enough.
+  std::vector<size_t> order(blocks_.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [this](size_t lhs, size_t rhs) {
+    if (blocks_[lhs].size != blocks_[rhs].size) {
+      return blocks_[lhs].size > blocks_[rhs].size;
+    }
+    return blocks_[lhs].first_step < blocks_[rhs].first_step;
+  });
+
+  std::vector<const MemoryBlock*> placed;
+  std::vector<const MemoryBlock*> live;
+  for (size_t idx : order) {
+    MemoryBlock& block = blocks_[idx];
+    live.clear();
+    for (const MemoryBlock* other : placed) {
+      if (other->first_step <= block.last_step &&
+          block.first_step <= other->last_step) {
+        live.push_back(other);
+      }
+    }
+    std::sort(live.begin(),
+              live.end(),
+              [](const MemoryBlock* lhs, const MemoryBlock* rhs) {
+                return lhs->offset < rhs->offset;
+              });
+    size_t best_offset = 0;
+    size_t best_gap = kNoGap;
+    size_t gap_begin = 0;
+    for (const MemoryBlock* other : live) {
+      if (other->offset > gap_begin) {
+        size_t gap = other->offset - gap_begin;
+        if (gap >= block.size && gap < best_gap) {
+          best_gap = gap;
+          best_offset = gap_begin;
+        }
+      }
+      gap_begin = std::max(gap_begin, other->offset + other->size);
+    }
+    block.offset = best_gap == kNoGap ? gap_begin : best_offset;
+    placed.push_back(&block);
+    arena_size_ = std::max(arena_size_, block.offset + block.size);
+    total_block_size_ += block.size;
+    for (size_t var_id : block.var_ids) {
+      planned_[var_id] = true;
+    }
+  }
+
+  if (arena_size_ > 0) {
+    arena_ = memory::AllocShared(place, arena_size_);
+  }
+  VLOG(4) << "StaticMemoryPlan: " << blocks_.size() << " blocks, "
+          << total_block_size_ << " bytes planned into an arena of "
+          << arena_size_ << " bytes";
+}
+
+void StaticMemoryPlan::Apply(const VariableScope& var_scope) const {
+  for (const MemoryBlock& block : blocks_) {
+    auto holder =
+        std::make_shared<ArenaAllocation>(arena_, block.offset, block.size);
+    for (size_t var_id : block.var_ids) {
+      auto* tensor = var_scope.VarRef(var_id)->GetMutable<phi::DenseTensor>();
+      // the meta may still describe the shapes of another plan
+      tensor->clear();
+      tensor->ResetHolder(holder);
+    }
+  }
+}
+
+void StaticMemoryPlan::Release(const VariableScope& var_scope) const {
+  for (const MemoryBlock& block : blocks_) {
+    for (size_t var_id : block.var_ids) {
+      auto* var = var_scope.VarRef(var_id);
+      if (var->IsType<phi::DenseTensor>()) {
+        var->GetMutable<phi::DenseTensor>()->clear();
+      }
+    }
+  }
+}
+
+StaticMemoryPlanner::StaticMemoryPlanner(std::vector<bool>&& candidates)
+    : candidates_(std::move(candidates)),
+      vars_(candidates_.size()),
+      parents_(candidates_.size()) {
+  for (size_t i = 0; i < parents_.size(); ++i) {
+    parents_[i] = i;
+  }
+}
+
+size_t StaticMemoryPlanner::Find(size_t var_id) {
+  while (parents_[var_id] != var_id) {
+    parents_[var_id] = parents_[parents_[var_id]];
+    var_id = parents_[var_id];
+  }
+  return var_id;
+}
+
+void StaticMemoryPlanner::Union(size_t lhs, size_t rhs) {
+  parents_[Find(lhs)] = Find(rhs);
+}
+
+void StaticMemoryPlanner::Use(int var_id,
+                              bool is_output,
+                              const VariableScope& var_scope) {
+  if (var_id < 0 || static_cast<size_t>(var_id) >= vars_.size()) {
+    return;
+  }
+  VarInfo& info = vars_[var_id];
+  if (!info.seen) {
+    info.seen = true;
+    info.first_step = step_;
+    if (!is_output) {
+      // the value comes from outside of the run
+      candidates_[var_id] = false;
+    }
+  }
+  info.last_step = step_;
+
+  Variable* var = var_scope.VarRef(var_id);
+  if (var == nullptr || !var->IsInitialized()) {
+    return;
+  }
+  if (!var->IsType<phi::DenseTensor>()) {
+    candidates_[var_id] = false;
+    return;
+  }
+  const auto& tensor = var->Get<phi::DenseTensor>();
+  if (!tensor.IsInitialized()) {
+    return;
+  }
+  const auto& holder = tensor.Holder();
+  if (!platform::is_cpu_place(holder->place())) {
+    candidates_[var_id] = false;
+  }
+  info.size = std::max(info.size, holder->size());
+  auto it = holder2var_.emplace(holder.get(), var_id);
+  if (!it.second) {
+    Union(it.first->second, var_id);
+  }
+}
+
+void StaticMemoryPlanner::Record(const Instruction& instr,
+                                 const VariableScope& var_scope) {
+  holder2var_.clear();
+  for (auto& item : instr.Inputs()) {
+    for (int var_id : item.second) {
+      Use(var_id, /*is_output=*/false, var_scope);
+    }
+  }
+  for (auto& item : instr.Outputs()) {
+    for (int var_id : item.second) {
+      Use(var_id, /*is_output=*/true, var_scope);
+    }
+  }
+  // vars shared back after a data transfer are not visible in the inputs
+  // and outputs
+  for (auto& item : instr.InplaceBackMap()) {
+    for (int var_id : {item.first, item.second}) {
+      if (var_id >= 0 && static_cast<size_t>(var_id) < candidates_.size()) {
+        candidates_[var_id] = false;
+      }
+    }
+  }
+  ++step_;
+}
+
+std::unique_ptr<StaticMemoryPlan> StaticMemoryPlanner::Build(
+    const platform::Place& place) {
+  std::unordered_map<size_t, MemoryBlock> root2block;
+  std::unordered_map<size_t, bool> root2valid;
+  for (size_t var_id = 0; var_id < vars_.size(); ++var_id) {
+    const VarInfo& info = vars_[var_id];
+    if (!info.seen) {
+      continue;
+    }
+    size_t root = Find(var_id);
+    auto valid = root2valid.emplace(root, true).first;
+    valid->second = valid->second && candidates_[var_id];
+    auto it = root2block.find(root);
+    if (it == root2block.end()) {
+      MemoryBlock block;
+      block.first_step = info.first_step;
+      block.last_step = info.last_step;
+      it = root2block.emplace(root, block).first;
+    }
+    MemoryBlock& block = it->second;
+    block.var_ids.push_back(var_id);
+    block.size = std::max(block.size, info.size);
+    block.first_step = std::min(block.first_step, info.first_step);
+    block.last_step = std::max(block.last_step, info.last_step);
+  }
+
+  std::vector<MemoryBlock> blocks;
+  for (auto& item : root2block) {
+    if (root2valid[item.first] && item.second.size > 0) {
+      item.second.size = AlignSize(item.second.size);
+      blocks.emplace_back(std::move(item.second));
+    }
+  }
+  return std::unique_ptr<StaticMemoryPlan>(
+      new StaticMemoryPlan(place, std::move(blocks), vars_.size()));
+}
+
+}  // namespace interpreter
+}  // namespace framework
+}  // namespace paddle
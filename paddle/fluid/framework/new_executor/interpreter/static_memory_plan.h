@@ -0,0 +1,109 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "paddle/fluid/framework/new_executor/new_executor_defs.h"
+#include "paddle/fluid/platform/place.h"
+#include "paddle/phi/core/allocator.h"
+
+namespace paddle {
+namespace framework {
+namespace interpreter {
+
+// A buffer of the plan: the vars sharing one allocation, the range of trace
+// steps in which it is alive and its place in the arena.
+struct MemoryBlock {
+  std::vector<size_t> var_ids;
+  size_t size{0};
+  size_t first_step{0};
+  size_t last_step{0};
+  size_t offset{0};
+};
+
+// Offset assignment of the intermediate tensors of a program for one set of
+// feed shapes. All planned tensors are slices of one arena, which is
+// allocated once, so steady state runs do not call the allocator for them.
+class StaticMemoryPlan {
+ public:
+  StaticMemoryPlan(const platform::Place& place,
+                   std::vector<MemoryBlock>&& blocks,
+                   size_t var_num);
+
+  // Installs the arena slices as the holders of the planned vars.
+  void Apply(const VariableScope& var_scope) const;
+  // Drops the arena slices from the planned vars.
+  void Release(const VariableScope& var_scope) const;
+
+  bool IsPlanned(size_t var_id) const { return planned_[var_id]; }
+
+  // bytes of the arena
+  size_t ArenaSize() const { return arena_size_; }
+  // bytes the planned tensors would take without any reuse
+  size_t TotalBlockSize() const { return total_block_size_; }
+  size_t BlockNum() const { return blocks_.size(); }
+
+ private:
+  std::vector<MemoryBlock> blocks_;
+  std::vector<bool> planned_;
+  std::shared_ptr<phi::Allocation> arena_;
+  size_t arena_size_{0};
+  size_t total_block_size_{0};
+};
+
+// Builds a StaticMemoryPlan from one serial run of the instructions.
+//
+// Record is called after each instruction runs, before its vars are garbage
+// collected, in the order of the run. Tensors first written by an
+// instruction of the run are candidates, their lifetime ends at the last
+// instruction touching them. Vars found sharing a holder inside one
+// instruction (inplace and share buffer ops) are merged into one block, and
+// a block is dropped when any of its vars is not a candidate, e.g. a feed, a
+// parameter or a var read before written.
+class StaticMemoryPlanner {
+ public:
+  // candidates[i] tells whether var i may be planned at all
+  explicit StaticMemoryPlanner(std::vector<bool>&& candidates);
+
+  void Record(const Instruction& instr, const VariableScope& var_scope);
+
+  std::unique_ptr<StaticMemoryPlan> Build(const platform::Place& place);
+
+ private:
+  struct VarInfo {
+    bool seen{false};
+    size_t size{0};
+    size_t first_step{0};
+    size_t last_step{0};
+  };
+
+  size_t Find(size_t var_id);
+  void Union(size_t lhs, size_t rhs);
+  void Use(int var_id, bool is_output, const VariableScope& var_scope);
+
+  size_t step_{0};
+  std::vector<bool> candidates_;
+  std::vector<VarInfo> vars_;
+  std::vector<size_t> parents_;
+  // holder of each var touched by the current instruction
+  std::unordered_map<const phi::Allocation*, size_t> holder2var_;
+};
+
+}  // namespace interpreter
+}  // namespace framework
+}  // namespace paddle
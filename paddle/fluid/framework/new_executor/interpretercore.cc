@@ -14,14 +14,19 @@
 
 #include "paddle/fluid/framework/new_executor/interpretercore.h"
 
+#include <algorithm>
+#include <chrono>  // NOLINT
 #include <unordered_set>
 
 #include "gflags/gflags.h"
 
 #include "paddle/fluid/framework/details/nan_inf_utils.h"
 #include "paddle/fluid/framework/details/share_tensor_buffer_functor.h"
+#include "paddle/fluid/framework/feed_fetch_type.h"
 #include "paddle/fluid/framework/new_executor/interpreter/interpreter_util.h"
 #include "paddle/fluid/framework/operator.h"
+#include "paddle/fluid/framework/tensor_util.h"
+#include "paddle/fluid/memory/allocation/allocation_tracer.h"
 #include "paddle/fluid/platform/device/gpu/gpu_info.h"
 #include "paddle/fluid/platform/os_info.h"
 #include "paddle/fluid/platform/profiler/event_tracing.h"
@@ -49,6 +54,31 @@ PADDLE_DEFINE_EXPORTED_bool(new_executor_use_local_scope,
                             true,
                             "Use local_scope in new executor(especially used "
                             "in UT), can turn off for better performance");
+PADDLE_DEFINE_EXPORTED_bool(
+    new_executor_use_work_stealing,
+    false,
+    "Run host ops of the new executor on a work-stealing thread pool, which "
+    "keeps ready successors on the current thread and inlines cheap ones.");
+PADDLE_DEFINE_EXPORTED_bool(
+    new_executor_static_memory_plan,
+    false,
+    "Back the intermediate tensors of the new executor on CPU with one "
+    "preallocated arena, planned per feed shapes.");
+PADDLE_DEFINE_EXPORTED_bool(
+    new_executor_profile_instructions,
+    false,
+    "Record the time, queue wait, thread and memory of every instruction "
+    "of the new executor, see InterpreterCore::ExportInstructionProfile.");
+PADDLE_DEFINE_EXPORTED_bool(
+    new_executor_profiled_priority,
+    false,
+    "Run the ready instructions with the longest measured critical path "
+    "first, implies new_executor_profile_instructions.");
+PADDLE_DEFINE_EXPORTED_int32(
+    new_executor_profiled_priority_interval,
+    16,
+    "The profiled runs between two analyses of the critical path for "
+    "new_executor_profiled_priority.");
 PADDLE_DEFINE_EXPORTED_bool(control_flow_use_new_executor,
                             true,
                             "Use new executor in control flow op");
@@ -130,6 +160,21 @@ InterpreterCore::InterpreterCore(const platform::Place& place,
   if (!FLAGS_new_executor_use_local_scope) {
     execution_config_.create_local_scope = false;
   }
+  if (FLAGS_new_executor_use_work_stealing) {
+    execution_config_.use_work_stealing = true;
+  }
+  if (FLAGS_new_executor_static_memory_plan) {
+    execution_config_.use_static_memory_plan = true;
+  }
+  if (FLAGS_new_executor_profile_instructions) {
+    execution_config_.profile_instructions = true;
+  }
+  if (FLAGS_new_executor_profiled_priority) {
+    execution_config_.profile_instructions = true;
+    execution_config_.use_profiled_priority = true;
+    execution_config_.profiled_priority_interval =
+        std::max(FLAGS_new_executor_profiled_priority_interval, 1);
+  }
   execution_config_.AnalyzeThreadPoolConfig(place, block.OpSize());
   execution_config_.Log(/*log_level=*/8);
 
@@ -139,12 +184,27 @@ InterpreterCore::InterpreterCore(const platform::Place& place,
   }
   var_scope_.SetLocalScope(local_scope_);
 
+  if (execution_config_.profile_instructions) {
+    instruction_profiler_ =
+        std::make_unique<interpreter::InstructionProfiler>();
+  }
+
   instruction_scheduling_priority_less = [this](size_t lhs, size_t rhs) {
     SchedulingPriority lhs_scheduling_priority =
         vec_instruction_[lhs].GetSchedulingPriority();
     SchedulingPriority rhs_scheduling_priority =
         vec_instruction_[rhs].GetSchedulingPriority();
     if (lhs_scheduling_priority == rhs_scheduling_priority) {
+      // the longer measured path to the end goes first
+      if (execution_config_.use_profiled_priority &&
+          instruction_profiler_ != nullptr &&
+          instruction_profiler_->Size() == vec_instruction_.size()) {
+        uint64_t lhs_path = instruction_profiler_->CriticalPathNs()[lhs];
+        uint64_t rhs_path = instruction_profiler_->CriticalPathNs()[rhs];
+        if (lhs_path != rhs_path) {
+          return lhs_path < rhs_path;
+        }
+      }
       return lhs < rhs;
     }
     return lhs_scheduling_priority > rhs_scheduling_priority;
@@ -157,6 +217,7 @@ InterpreterCore::~InterpreterCore() {
   // cancle gc's thread
   gc_.reset(nullptr);
   async_work_queue_.reset();
+  work_stealing_pool_.reset();
   VLOG(4) << "~InterpreterCore(): " << this << " on " << place_;
 
 #ifdef PADDLE_WITH_MKLDNN
@@ -181,6 +242,9 @@ interpreter::CostInfo InterpreterCore::DryRun(
     // create work_queue, so the async_work_queue_ is created
     // until the second step run.
     async_work_queue_ = GetWorkQueue();
+    if (UseWorkStealing()) {
+      work_stealing_pool_ = GetWorkStealingPool();
+    }
 
     // lazy initialization of gc, do not create gc is the program only run once
     if (!gc_) {
@@ -206,8 +270,19 @@ void InterpreterCore::RunImpl() {
 
   interpreter::ResetAtomicGuard guard(&deps_, &refs_);
 
-  if ((execution_config_.used_for_jit || execution_config_.used_for_cinn) &&
-      (sync_op_num_ == 0)) {
+  if (instruction_profiler_ != nullptr) {
+    if (instruction_profiler_->Size() != vec_instruction_.size()) {
+      instruction_profiler_->Reset(vec_instruction_.size());
+    }
+    instruction_profiler_->BeginRun();
+  }
+
+  if (UseStaticMemoryPlan()) {
+    VLOG(4) << "Tracing Instruction List with static memory plan";
+    RunWithMemoryPlan();
+  } else if ((execution_config_.used_for_jit ||
+              execution_config_.used_for_cinn) &&
+             (sync_op_num_ == 0)) {
     VLOG(4) << "Tracing Instruction List";
     TraceInstructionList(vec_instruction_);
   } else {
@@ -216,8 +291,28 @@ void InterpreterCore::RunImpl() {
     // create work_queue, so the async_work_queue_ is created
     // until the second step run.
     async_work_queue_ = GetWorkQueue();
+    if (UseWorkStealing()) {
+      work_stealing_pool_ = GetWorkStealingPool();
+    }
     ExecuteInstructionList(vec_instruction_);
   }
+
+  if (instruction_profiler_ != nullptr) {
+    instruction_profiler_->EndRun();
+    // the averages settle within a few runs, so the order is not analysed
+    // again after every run
+    size_t interval =
+        std::max<size_t>(execution_config_.profiled_priority_interval, 1);
+    if (execution_config_.use_profiled_priority &&
+        (instruction_profiler_->RunNum() - 1) % interval == 0) {
+      instruction_profiler_->UpdateCriticalPath(
+          dependency_builder_.OpDownstreamMap(), trace_execute_order_);
+      // the memory plans are made for the current trace order
+      if (!UseStaticMemoryPlan()) {
+        AnalyseExecuteOrderForTrace();
+      }
+    }
+  }
 #ifdef PADDLE_WITH_ASCEND_CL
   if (platform::is_npu_place(place_)) {
     platform::DeviceContextPool::Instance().Get(place_)->Wait();
@@ -244,6 +339,9 @@ paddle::framework::FetchList InterpreterCore::Run(
   Prepare(feed_names, feed_tensors, is_build);
 
   if (is_build) {
+    if (UseStaticMemoryPlan()) {
+      memory_plan_key_ = MemoryPlanKey(feed_names);
+    }
     RunImpl();
   }
 
@@ -303,6 +401,9 @@ paddle::framework::FetchList InterpreterCore::Run(
       RunImpl();
     }
   } else {
+    if (UseStaticMemoryPlan()) {
+      memory_plan_key_ = MemoryPlanKey(feed_names);
+    }
     RunImpl();
   }
 
@@ -385,8 +486,34 @@ void InterpreterCore::reset_scope(Scope* new_scope) {
   }
 }
 
+void InterpreterCore::ExportInstructionProfile(
+    const std::string& trace_path, const std::string& csv_path) const {
+  PADDLE_ENFORCE_NOT_NULL(
+      instruction_profiler_,
+      platform::errors::PreconditionNotMet(
+          "Instruction profiling is off, set "
+          "FLAGS_new_executor_profile_instructions to turn it on."));
+  if (!trace_path.empty()) {
+    instruction_profiler_->ExportChromeTrace(trace_path, vec_instruction_);
+  }
+  if (!csv_path.empty()) {
+    instruction_profiler_->ExportCsv(csv_path, vec_instruction_);
+  }
+}
+
 void InterpreterCore::ShareWorkQueueFrom(std::shared_ptr<InterpreterCore> src) {
+  // the queue of a work-stealing core has no host threads, so cores of
+  // different modes keep their own queues
+  if (UseWorkStealing() != src->UseWorkStealing()) {
+    VLOG(8) << "Not share AsyncWorkQueue from InterpreterCore(" << src.get()
+            << ") to InterpreterCore(" << this
+            << ") as only one of them uses work stealing";
+    return;
+  }
   async_work_queue_ = src->GetWorkQueue();
+  if (UseWorkStealing()) {
+    work_stealing_pool_ = src->GetWorkStealingPool();
+  }
   VLOG(8) << "Share AsyncWorkQueue from InterpreterCore(" << src.get()
           << ") to InterpreterCore(" << this << ")";
 }
@@ -410,14 +537,28 @@ bool InterpreterCore::BuildInplaceCheckVarIsOnlyInput(
 
 std::shared_ptr<interpreter::AsyncWorkQueue> InterpreterCore::GetWorkQueue() {
   if (async_work_queue_ == nullptr) {
+    // in work-stealing mode the host ops run on work_stealing_pool_
     async_work_queue_ = std::make_shared<interpreter::AsyncWorkQueue>(
-        execution_config_.host_num_threads,
+        UseWorkStealing() ? 0 : execution_config_.host_num_threads,
         execution_config_.device_num_threads,
         nullptr);
   }
   return async_work_queue_;
 }
 
+std::shared_ptr<WorkStealingPool> InterpreterCore::GetWorkStealingPool() {
+  if (work_stealing_pool_ == nullptr) {
+    work_stealing_pool_ = std::make_shared<WorkStealingPool>(
+        "HostTasks", std::max<size_t>(execution_config_.host_num_threads, 1));
+  }
+  return work_stealing_pool_;
+}
+
+bool InterpreterCore::UseWorkStealing() const {
+  return execution_config_.use_work_stealing &&
+         !FLAGS_new_executor_serial_run;
+}
+
 void InterpreterCore::BuildAndCacheInstructionCtx(Instruction* instr_node) {
   Scope* inner_scope =
       HasLocalScope() ? local_scope_ : var_scope_.GetMutableScope();
@@ -613,6 +754,10 @@ void InterpreterCore::BuildOperatorDependences() {
   // and set the dependecy_count_
   size_t instr_num = vec_instruction_.size();
   dependecy_count_.resize(instr_num);
+  instr_cost_ns_ = std::vector<std::atomic<uint64_t>>(instr_num);
+  for (auto& cost : instr_cost_ns_) {
+    cost.store(0, std::memory_order_relaxed);
+  }
   auto downstream_map = dependency_builder_.Build(vec_instruction_);
 
   for (size_t instr_id = 0; instr_id < instr_num; ++instr_id) {
@@ -1021,6 +1166,7 @@ void InterpreterCore::RunInstruction(const Instruction& instr_node) {
   auto* op = instr_node.OpBase();
   platform::RecordEvent instruction_event(
       op->Type(), platform::TracerEventType::Operator, 1);
+  memory::allocation::AllocationTraceScope allocation_trace_scope(op->Type());
 
   SetDeviceId(instr_node.DeviceContext().GetPlace());
 
@@ -1028,7 +1174,16 @@ void InterpreterCore::RunInstruction(const Instruction& instr_node) {
     instr_node.WaitEvent(place_);
 
     if (!instr_node.IsArtificial()) {
-      RunOperator(instr_node);
+      if (UNLIKELY(instruction_profiler_ != nullptr)) {
+        instruction_profiler_->Start(instr_node, var_scope_);
+        RunOperator(instr_node);
+        instruction_profiler_->End(instr_node, var_scope_);
+      } else {
+        RunOperator(instr_node);
+      }
+      if (UNLIKELY(memory_planner_ != nullptr)) {
+        memory_planner_->Record(instr_node, var_scope_);
+      }
       CheckGC(instr_node);
       interpreter::LogDeviceMemoryStats(place_);
     }
@@ -1065,6 +1220,9 @@ void InterpreterCore::ExecuteInstructionList(
       RecordMemcpyD2H(vec_instr.at(i));
       if (FLAGS_new_executor_serial_run) {
         RunInstructionAsync(i);
+      } else if (UseWorkStealing() &&
+                 vec_instr.at(i).KernelType() != OpFuncType::kGpuAsync) {
+        work_stealing_pool_->Schedule(&RunInstructionTask, this, i);
       } else {
         async_work_queue_->AddTask(vec_instr.at(i).KernelType(),
                                    [this, i] { RunInstructionAsync(i); });
@@ -1082,6 +1240,9 @@ void InterpreterCore::ExecuteInstructionList(
     // EOF is not a fatal error.
     if (exception_holder_.Type() != "EOF") {
       async_work_queue_->Cancel();
+      if (work_stealing_pool_ != nullptr) {
+        work_stealing_pool_->Cancel();
+      }
     }
     VLOG(4) << "Cancel ok";
     PADDLE_ENFORCE_EQ(
@@ -1102,7 +1263,11 @@ void InterpreterCore::RunNextInstructions(const Instruction& instr,
   auto IsReady = [this](size_t next_id) {
     VLOG(4) << "op_id: " << next_id
             << ", remain deps: " << deps_[next_id]->DynamicDep();
-    return deps_[next_id]->CheckAndDecrease();
+    bool is_ready = deps_[next_id]->CheckAndDecrease();
+    if (is_ready && instruction_profiler_ != nullptr) {
+      instruction_profiler_->MarkReady(next_id);
+    }
+    return is_ready;
   };
 
   for (size_t next_instr_id : instr.NextInstrsInDifferenceThread()) {
@@ -1120,6 +1285,74 @@ void InterpreterCore::RunNextInstructions(const Instruction& instr,
   }
 }
 
+void InterpreterCore::RunNextInstructionsStealing(
+    const Instruction& instr, SchedulingQueue* reserved_next_ops) {
+  platform::RecordEvent record(
+      "RunNextInstructions", platform::TracerEventType::UserDefined, 10);
+
+  auto IsReady = [this](size_t next_id) {
+    VLOG(4) << "op_id: " << next_id
+            << ", remain deps: " << deps_[next_id]->DynamicDep();
+    bool is_ready = deps_[next_id]->CheckAndDecrease();
+    if (is_ready && instruction_profiler_ != nullptr) {
+      instruction_profiler_->MarkReady(next_id);
+    }
+    return is_ready;
+  };
+  auto IsCheap = [this](size_t next_id) {
+    uint64_t cost = instr_cost_ns_[next_id].load(std::memory_order_relaxed);
+    return cost != 0 && cost < execution_config_.inline_op_max_cost_ns;
+  };
+
+  // A device launch op keeps its stream order: its device successors stay on
+  // this thread, as in RunNextInstructions.
+  if (instr.KernelType() == OpFuncType::kGpuAsync) {
+    for (size_t next_instr_id : instr.NextInstrsInDifferenceThread()) {
+      if (IsReady(next_instr_id)) {
+        work_stealing_pool_->Schedule(&RunInstructionTask, this, next_instr_id);
+      }
+    }
+    for (size_t next_instr_id : instr.NextInstrsInSameThread()) {
+      if (IsReady(next_instr_id)) {
+        reserved_next_ops->push(next_instr_id);
+      }
+    }
+    return;
+  }
+
+  // For a host op the thread of a successor is decided from what is ready:
+  // the first ready host successor and the cheap ones continue on this
+  // thread, the others are pushed to this worker's deque where idle workers
+  // can steal them.
+  bool chained = false;
+  auto Dispatch = [&](size_t next_id) {
+    if (vec_instruction_[next_id].KernelType() == OpFuncType::kGpuAsync) {
+      async_work_queue_->AddTask(OpFuncType::kGpuAsync, [this, next_id]() {
+        RunInstructionAsync(next_id);
+      });
+    } else if (!chained || IsCheap(next_id)) {
+      chained = true;
+      reserved_next_ops->push(next_id);
+    } else {
+      work_stealing_pool_->Schedule(&RunInstructionTask, this, next_id);
+    }
+  };
+  for (size_t next_instr_id : instr.NextInstrsInSameThread()) {
+    if (IsReady(next_instr_id)) {
+      Dispatch(next_instr_id);
+    }
+  }
+  for (size_t next_instr_id : instr.NextInstrsInDifferenceThread()) {
+    if (IsReady(next_instr_id)) {
+      Dispatch(next_instr_id);
+    }
+  }
+}
+
+void InterpreterCore::RunInstructionTask(void* core, size_t instr_id) {
+  static_cast<InterpreterCore*>(core)->RunInstructionAsync(instr_id);
+}
+
 void InterpreterCore::RunInstructionAsync(size_t instr_id) {
   // NOTE(Ruibiao): Due to the uncertain order in multi-threading asynchronous
   // scheduling, the priority order involved cross-thread scheduling is not
@@ -1132,7 +1365,22 @@ void InterpreterCore::RunInstructionAsync(size_t instr_id) {
     ready_ops.pop();
     auto& instr_node = vec_instruction_.at(instr_id);
 
-    RunInstruction(instr_node);
+    bool use_work_stealing = UseWorkStealing();
+    if (use_work_stealing) {
+      auto start = std::chrono::steady_clock::now();
+      RunInstruction(instr_node);
+      uint64_t cost = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+      // only the thread running the instruction writes its cost, others
+      // read it to place the successors
+      auto& avg_cost = instr_cost_ns_[instr_id];
+      uint64_t last = avg_cost.load(std::memory_order_relaxed);
+      avg_cost.store(last == 0 ? cost : (last * 3 + cost) / 4,
+                     std::memory_order_relaxed);
+    } else {
+      RunInstruction(instr_node);
+    }
 
     if (UNLIKELY(exception_holder_.IsCaught())) {
       VLOG(4) << "Exception caught";
@@ -1150,7 +1398,11 @@ void InterpreterCore::RunInstructionAsync(size_t instr_id) {
       }
     }
 
-    RunNextInstructions(instr_node, &ready_ops);
+    if (use_work_stealing) {
+      RunNextInstructionsStealing(instr_node, &ready_ops);
+    } else {
+      RunNextInstructions(instr_node, &ready_ops);
+    }
   }
 }
 
@@ -1268,9 +1520,16 @@ void InterpreterCore::CheckGC(const Instruction& instr) {
     if (var_scope.VarDesc(var_id) && var_scope.VarDesc(var_id)->Persistable()) {
       continue;
     }
+    // planned vars keep their arena slice
+    if (memory_plan_ != nullptr && memory_plan_->IsPlanned(var_id)) {
+      continue;
+    }
     if (is_ready) {
       VLOG(6) << "Async delete variable with name : "
               << var_scope.GetNameById(var_id);
+      if (UNLIKELY(instruction_profiler_ != nullptr)) {
+        instruction_profiler_->AddFreed(instr.Id(), refs_[var_id]->Var());
+      }
       gc_->Add(refs_[var_id]->Var(), instr);
     }
   }
@@ -1342,6 +1601,114 @@ void InterpreterCore::SetFeedVarsInplaceSkip(
 
 bool InterpreterCore::HasLocalScope() const { return local_scope_ != nullptr; }
 
+bool InterpreterCore::UseStaticMemoryPlan() const {
+  return execution_config_.use_static_memory_plan &&
+         platform::is_cpu_place(place_);
+}
+
+std::string InterpreterCore::MemoryPlanKey(
+    const std::vector<std::string>& feed_names) const {
+  std::stringstream key;
+  Scope* inner_scope =
+      HasLocalScope() ? local_scope_ : var_scope_.GetMutableScope();
+  for (auto& feed_name : feed_names) {
+    auto* var = inner_scope->FindVar(feed_name);
+    if (var != nullptr && var->IsType<phi::DenseTensor>()) {
+      auto& tensor = var->Get<phi::DenseTensor>();
+      key << feed_name << ":" << tensor.dims() << ":" << tensor.lod() << ";";
+    }
+  }
+  // feed ops read the feed list, their outputs still have the last shapes
+  auto* feed_var = inner_scope->FindVar(interpreter::kFeedVarName);
+  if (feed_var != nullptr && feed_var->IsType<FeedList>()) {
+    auto& feed_list = feed_var->Get<FeedList>();
+    for (size_t i = 0; i < feed_list.size(); ++i) {
+      if (feed_list[i].type() == typeid(phi::DenseTensor)) {
+        auto& tensor = PADDLE_GET_CONST(phi::DenseTensor, feed_list[i]);
+        key << i << ":" << tensor.dims() << ":" << tensor.lod() << ";";
+      }
+    }
+  }
+  return key.str();
+}
+
+std::vector<bool> InterpreterCore::MemoryPlanCandidates() const {
+  std::vector<bool> candidates(var_scope_.VarSize(), false);
+  for (size_t var_id = 0; var_id < candidates.size(); ++var_id) {
+    auto* var_desc = var_scope_.VarDesc(var_id);
+    candidates[var_id] =
+        var_desc != nullptr && !var_desc->Persistable() &&
+        var_desc->GetType() == proto::VarType::LOD_TENSOR &&
+        !execution_config_.skip_gc_vars.count(var_desc->Name()) &&
+        !execution_config_.force_root_scope_vars.count(var_desc->Name());
+  }
+  // fetched without copy, the fetch list would alias the arena
+  for (auto& instr : vec_instruction_) {
+    auto* op = instr.OpBase();
+    if (op->Type() == "fetch_v2" && op->HasAttr("deepcopy") &&
+        !op->Attr<bool>("deepcopy")) {
+      for (auto& item : instr.Inputs()) {
+        for (int var_id : item.second) {
+          candidates[var_id] = false;
+        }
+      }
+    }
+  }
+  return candidates;
+}
+
+// Note(static memory plan):
+// The first run with new feed shapes records the lifetime and size of every
+// intermediate tensor while running serially in trace order, then builds a
+// StaticMemoryPlan from it. Later runs with the same feed shapes install the
+// arena slices as the holders of the planned vars and skip their GC, so the
+// kernels find their outputs already allocated. Running in the same trace
+// order keeps the lifetimes the plan was made for.
+void InterpreterCore::RunWithMemoryPlan() {
+  auto it = memory_plans_.find(memory_plan_key_);
+  if (it == memory_plans_.end()) {
+    VLOG(4) << "Build static memory plan for feed shapes " << memory_plan_key_;
+    if (memory_plan_ != nullptr) {
+      memory_plan_->Release(var_scope_);
+      memory_plan_ = nullptr;
+    }
+    interpreter::StaticMemoryPlanner planner(MemoryPlanCandidates());
+    memory_planner_ = &planner;
+    try {
+      TraceInstructionList(vec_instruction_);
+    } catch (...) {
+      memory_planner_ = nullptr;
+      throw;
+    }
+    memory_planner_ = nullptr;
+    memory_plans_[memory_plan_key_] = planner.Build(place_);
+    memory_plan_lru_.push_back(memory_plan_key_);
+    // the evicted plans free their arenas, none of them is applied now
+    size_t max_plan_num =
+        std::max<size_t>(execution_config_.max_memory_plan_num, 1);
+    while (memory_plans_.size() > max_plan_num) {
+      VLOG(4) << "Free static memory plan for feed shapes "
+              << memory_plan_lru_.front();
+      memory_plans_.erase(memory_plan_lru_.front());
+      memory_plan_lru_.pop_front();
+    }
+    return;
+  }
+  memory_plan_lru_.splice(
+      memory_plan_lru_.end(),
+      memory_plan_lru_,
+      std::find(
+          memory_plan_lru_.begin(), memory_plan_lru_.end(), memory_plan_key_));
+  if (memory_plan_ != it->second.get()) {
+    if (memory_plan_ != nullptr) {
+      memory_plan_->Release(var_scope_);
+    }
+    it->second->Apply(var_scope_);
+    memory_plan_ = it->second.get();
+  }
+  TraceInstructionList(vec_instruction_);
+}
+
 // Note(zhangbo):
 // (1) What is "Trace"?
 // The OP execute scheduling rule adopted by Interpretercore by default is a
@@ -1437,7 +1804,7 @@ void InterpreterCore::AnalyseExecuteOrderForTrace() {
   VLOG(4) << "Analyze the execution order of Trace scheduling mode.";
   interpreter::ResetAtomicGuard guard(&deps_, &refs_);
 
-  auto op_downstream_map = dependency_builder_.OpDownstreamMap();
+  const auto& op_downstream_map = dependency_builder_.OpDownstreamMap();
 
   auto IsReady = [this](size_t next_id) {
     VLOG(4) << "op_id: " << next_id
@@ -1459,9 +1826,11 @@ void InterpreterCore::AnalyseExecuteOrderForTrace() {
     ready_ops.pop();
     trace_order.push_back(now_id);
 
-    auto next_op_set = op_downstream_map[now_id];
-
-    for (size_t next_op_id : next_op_set) {
+    auto next_op_set = op_downstream_map.find(now_id);
+    if (next_op_set == op_downstream_map.end()) {
+      continue;
+    }
+    for (size_t next_op_id : next_op_set->second) {
       if (IsReady(next_op_id)) {
         ready_ops.push(next_op_id);
       }
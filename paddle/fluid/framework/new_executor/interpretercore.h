@@ -13,6 +13,8 @@
 // limitations under the License.
 #pragma once
 
+#include <atomic>
+#include <list>
 #include <map>
 #include <queue>
 #include <string>
@@ -23,10 +25,13 @@
 #include "paddle/fluid/framework/new_executor/garbage_collector/garbage_collector.h"
 #include "paddle/fluid/framework/new_executor/interpreter/dependency_builder.h"
 #include "paddle/fluid/framework/new_executor/interpreter/execution_config.h"
+#include "paddle/fluid/framework/new_executor/interpreter/instruction_profiler.h"
 #include "paddle/fluid/framework/new_executor/interpreter/interpreter_util.h"
+#include "paddle/fluid/framework/new_executor/interpreter/static_memory_plan.h"
 #include "paddle/fluid/framework/new_executor/interpreter/stream_analyzer.h"
 #include "paddle/fluid/framework/new_executor/new_executor_defs.h"
 #include "paddle/fluid/framework/new_executor/profiler.h"
+#include "paddle/fluid/framework/new_executor/workqueue/work_stealing_pool.h"
 #include "paddle/fluid/framework/program_desc.h"
 #include "paddle/fluid/framework/tensor.h"
 #include "paddle/fluid/framework/variable.h"
@@ -34,6 +39,10 @@
 #include "paddle/fluid/platform/device_event.h"
 
 DECLARE_bool(new_executor_use_local_scope);
+DECLARE_bool(new_executor_use_work_stealing);
+DECLARE_bool(new_executor_static_memory_plan);
+DECLARE_bool(new_executor_profile_instructions);
+DECLARE_bool(new_executor_profiled_priority);
 DECLARE_bool(control_flow_use_new_executor);
 
 namespace paddle {
@@ -82,6 +91,19 @@ class InterpreterCore {
 
   const platform::Place& GetPlace() const { return place_; }
 
+  // the number of static memory plans kept
+  size_t MemoryPlanNum() const { return memory_plans_.size(); }
+
+  // nullptr unless ExecutionConfig::profile_instructions is set
+  const interpreter::InstructionProfiler* GetInstructionProfiler() const {
+    return instruction_profiler_.get();
+  }
+
+  // Writes a chrome trace of the last run and the CSV cost table of all the
+  // profiled runs, an empty path skips that file.
+  void ExportInstructionProfile(const std::string& trace_path,
+                                const std::string& csv_path) const;
+
  private:
   DISABLE_COPY_AND_ASSIGN(InterpreterCore);
   // build graph
@@ -109,6 +131,9 @@ class InterpreterCore {
   void RunInstruction(const Instruction& instr_node);
   void RunNextInstructions(const Instruction& instr_id,
                            SchedulingQueue* reserved_next_ops);
+  void RunNextInstructionsStealing(const Instruction& instr,
+                                   SchedulingQueue* reserved_next_ops);
+  static void RunInstructionTask(void* core, size_t instr_id);
   void RunOperator(const Instruction& instr_node);
   // Trace
   void TraceInstructionList(const std::vector<Instruction>& vec_instr);
@@ -120,6 +145,12 @@ class InterpreterCore {
 
   void RecordMemcpyD2H(const Instruction& instr_node);
 
+  // static memory plan
+  bool UseStaticMemoryPlan() const;
+  std::string MemoryPlanKey(const std::vector<std::string>& feed_names) const;
+  std::vector<bool> MemoryPlanCandidates() const;
+  void RunWithMemoryPlan();
+
   // gc
   void RecordStreamForGC(const Instruction& instr);
   void CheckGC(const Instruction& instr);
@@ -127,6 +158,8 @@ class InterpreterCore {
 
   // workqueue
   std::shared_ptr<interpreter::AsyncWorkQueue> GetWorkQueue();
+  std::shared_ptr<WorkStealingPool> GetWorkStealingPool();
+  bool UseWorkStealing() const;
 
   // scope
   bool HasLocalScope() const;
@@ -163,6 +196,11 @@ class InterpreterCore {
 
   EventsWaiter main_thread_blocker_;
   std::shared_ptr<interpreter::AsyncWorkQueue> async_work_queue_;
+  // runs the host instructions when execution_config_.use_work_stealing
+  std::shared_ptr<WorkStealingPool> work_stealing_pool_;
+  // moving average of the measured run time of each instruction in ns, 0 if
+  // not measured yet, only maintained in work-stealing mode
+  std::vector<std::atomic<uint64_t>> instr_cost_ns_;
 
   details::ExceptionHolder exception_holder_;
   std::shared_ptr<EventsWaiter::EventNotifier> exception_notifier_{nullptr};
@@ -181,6 +219,20 @@ class InterpreterCore {
   std::vector<std::shared_ptr<interpreter::OpDepInfo>> deps_;
   std::vector<std::shared_ptr<interpreter::VarRefInfo>> refs_;
 
+  // static memory plans by feed shapes, memory_plan_ is the one whose arena
+  // currently backs the planned vars, memory_planner_ is only set in the run
+  // that builds a plan
+  std::unordered_map<std::string,
+                     std::unique_ptr<interpreter::StaticMemoryPlan>>
+      memory_plans_;
+  // the keys of memory_plans_ from the least to the most recently used
+  std::list<std::string> memory_plan_lru_;
+  const interpreter::StaticMemoryPlan* memory_plan_{nullptr};
+  interpreter::StaticMemoryPlanner* memory_planner_{nullptr};
+  std::string memory_plan_key_;
+
+  std::unique_ptr<interpreter::InstructionProfiler> instruction_profiler_;
+
   // used for Trace
   int64_t sync_op_num_{-1};
   std::vector<size_t> trace_execute_order_;
@@ -15,11 +15,19 @@
 #include "paddle/fluid/framework/new_executor/standalone_executor.h"
 
 #include <gtest/gtest.h>
+#include <unistd.h>
 
+#include <algorithm>
 #include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <iterator>
 #include <string>
+#include <vector>
 
+#include "paddle/fluid/memory/stats.h"
 #include "paddle/phi/core/kernel_registry.h"
 
 USE_OP_ITSELF(fill_constant);
@@ -279,5 +287,249 @@ TEST(InterpreterCore, workqueue_multiplexing) {
       program, {"a", "b"}, {tensor_a, tensor_b}, {"c"}, {0.0, 1.1, 2.2, 3.3});
 }
 
+// width independent chains of depth elementwise_add ops, out = a + depth * b
+ProgramDesc GetWideAddProgram(int width,
+                              int depth,
+                              std::vector<std::string>* fetch_names) {
+  ProgramDesc program;
+  BlockDesc* main_block = program.MutableBlock(0);
+  main_block->Var("a")->SetType(proto::VarType::LOD_TENSOR);
+  main_block->Var("b")->SetType(proto::VarType::LOD_TENSOR);
+  for (int w = 0; w < width; ++w) {
+    std::string prev = "a";
+    for (int d = 0; d < depth; ++d) {
+      std::string out =
+          "chain_" + std::to_string(w) + "_" + std::to_string(d);
+      main_block->Var(out)->SetType(proto::VarType::LOD_TENSOR);
+      OpDesc* add = main_block->AppendOp();
+      add->SetType("elementwise_add");
+      add->SetInput("X", {prev});
+      add->SetInput("Y", {"b"});
+      add->SetOutput("Out", {out});
+      prev = out;
+    }
+    fetch_names->push_back(prev);
+  }
+  return program;
+}
+
+TEST(InterpreterCore, work_stealing) {
+  const int width = 16, depth = 64, numel = 256;
+  std::vector<std::string> fetch_names;
+  ProgramDesc program = GetWideAddProgram(width, depth, &fetch_names);
+
+  const platform::CPUPlace place = platform::CPUPlace();
+  phi::DDim dims = phi::make_ddim({numel});
+  phi::DenseTensor tensor_a, tensor_b;
+  float* data_a = tensor_a.mutable_data<float>(dims, place);
+  float* data_b = tensor_b.mutable_data<float>(dims, place);
+  for (int i = 0; i < numel; ++i) {
+    data_a[i] = i;
+    data_b[i] = 0.5;
+  }
+
+  for (bool use_work_stealing : {false, true}) {
+    Scope scope;
+    interpreter::ExecutionConfig execution_config;
+    execution_config.use_work_stealing = use_work_stealing;
+    std::shared_ptr<InterpreterCore> core = CreateInterpreterCore(
+        place, program, &scope, fetch_names, execution_config);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int step = 0; step < 20; ++step) {
+      FetchList fetch_list = core->Run({"a", "b"}, {tensor_a, tensor_b});
+      ASSERT_EQ(fetch_list.size(), static_cast<size_t>(width));
+      for (auto& fetch : fetch_list) {
+        const float* out =
+            PADDLE_GET_CONST(phi::DenseTensor, fetch).data<float>();
+        for (int i = 0; i < numel; ++i) {
+          ASSERT_FLOAT_EQ(out[i], i + depth * 0.5);
+        }
+      }
+    }
+    std::chrono::duration<double> diff =
+        std::chrono::steady_clock::now() - start;
+    VLOG(3) << "use_work_stealing " << use_work_stealing << ", time cost "
+            << diff.count();
+  }
+}
+
+TEST(InterpreterCore, share_work_queue_across_modes) {
+  const int width = 4, depth = 16, numel = 16;
+  std::vector<std::string> fetch_names;
+  ProgramDesc program = GetWideAddProgram(width, depth, &fetch_names);
+
+  const platform::CPUPlace place = platform::CPUPlace();
+  phi::DDim dims = phi::make_ddim({numel});
+  phi::DenseTensor tensor_a, tensor_b;
+  float* data_a = tensor_a.mutable_data<float>(dims, place);
+  float* data_b = tensor_b.mutable_data<float>(dims, place);
+  for (int i = 0; i < numel; ++i) {
+    data_a[i] = i;
+    data_b[i] = 2;
+  }
+
+  auto run_and_check = [&](std::shared_ptr<InterpreterCore> core) {
+    FetchList fetch_list = core->Run({"a", "b"}, {tensor_a, tensor_b});
+    ASSERT_EQ(fetch_list.size(), static_cast<size_t>(width));
+    for (auto& fetch : fetch_list) {
+      const float* out =
+          PADDLE_GET_CONST(phi::DenseTensor, fetch).data<float>();
+      for (int i = 0; i < numel; ++i) {
+        ASSERT_FLOAT_EQ(out[i], i + depth * 2);
+      }
+    }
+  };
+
+  // the host ops of either core run although the queue of the work-stealing
+  // one has no host threads
+  for (bool src_use_work_stealing : {false, true}) {
+    Scope scope;
+    interpreter::ExecutionConfig src_config;
+    src_config.use_work_stealing = src_use_work_stealing;
+    interpreter::ExecutionConfig dst_config;
+    dst_config.use_work_stealing = !src_use_work_stealing;
+    std::shared_ptr<InterpreterCore> src = CreateInterpreterCore(
+        place, program, &scope, fetch_names, src_config);
+    std::shared_ptr<InterpreterCore> dst = CreateInterpreterCore(
+        place, program, &scope, fetch_names, dst_config);
+    run_and_check(src);
+    dst->ShareWorkQueueFrom(src);
+    for (int step = 0; step < 3; ++step) {
+      run_and_check(src);
+      run_and_check(dst);
+    }
+  }
+}
+
+TEST(InterpreterCore, static_memory_plan) {
+  const int width = 4, depth = 64;
+  std::vector<std::string> fetch_names;
+  ProgramDesc program = GetWideAddProgram(width, depth, &fetch_names);
+  const platform::CPUPlace place = platform::CPUPlace();
+
+  auto run_and_check = [&](std::shared_ptr<InterpreterCore> core, int numel) {
+    phi::DDim dims = phi::make_ddim({numel});
+    phi::DenseTensor tensor_a, tensor_b;
+    float* data_a = tensor_a.mutable_data<float>(dims, place);
+    float* data_b = tensor_b.mutable_data<float>(dims, place);
+    for (int i = 0; i < numel; ++i) {
+      data_a[i] = i;
+      data_b[i] = 0.25;
+    }
+    FetchList fetch_list = core->Run({"a", "b"}, {tensor_a, tensor_b});
+    ASSERT_EQ(fetch_list.size(), static_cast<size_t>(width));
+    for (auto& fetch : fetch_list) {
+      auto& out = PADDLE_GET_CONST(phi::DenseTensor, fetch);
+      ASSERT_EQ(out.numel(), numel);
+      for (int i = 0; i < numel; ++i) {
+        ASSERT_FLOAT_EQ(out.data<float>()[i], i + depth * 0.25);
+      }
+    }
+  };
+
+  for (bool use_static_memory_plan : {false, true}) {
+    Scope scope;
+    interpreter::ExecutionConfig execution_config;
+    execution_config.use_static_memory_plan = use_static_memory_plan;
+    std::shared_ptr<InterpreterCore> core = CreateInterpreterCore(
+        place, program, &scope, fetch_names, execution_config);
+
+    // build, plan and run with one shape, then switch shapes back and forth
+    for (int numel : {4096, 4096, 4096, 1024, 1024, 4096}) {
+      run_and_check(core, numel);
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (int step = 0; step < 50; ++step) {
+      run_and_check(core, 4096);
+    }
+    std::chrono::duration<double> diff =
+        std::chrono::steady_clock::now() - start;
+    VLOG(3) << "use_static_memory_plan " << use_static_memory_plan
+            << ", time cost " << diff.count() << ", host memory allocated "
+            << memory::HostMemoryStatCurrentValue("Allocated", 0) << ", peak "
+            << memory::HostMemoryStatPeakValue("Allocated", 0);
+  }
+
+  // the least recently used plans are freed beyond max_memory_plan_num, and
+  // built again when their shapes come back
+  Scope scope;
+  interpreter::ExecutionConfig execution_config;
+  execution_config.use_static_memory_plan = true;
+  execution_config.max_memory_plan_num = 2;
+  std::shared_ptr<InterpreterCore> core = CreateInterpreterCore(
+      place, program, &scope, fetch_names, execution_config);
+  for (int numel : {256, 256, 512, 512, 256, 1024, 1024, 512, 512, 256}) {
+    run_and_check(core, numel);
+    EXPECT_LE(core->MemoryPlanNum(), 2UL);
+  }
+  EXPECT_EQ(core->MemoryPlanNum(), 2UL);
+}
+
+TEST(InterpreterCore, instruction_profiler) {
+  const int width = 4, depth = 8, numel = 1024;
+  std::vector<std::string> fetch_names;
+  ProgramDesc program = GetWideAddProgram(width, depth, &fetch_names);
+  const platform::CPUPlace place = platform::CPUPlace();
+
+  phi::DDim dims = phi::make_ddim({numel});
+  phi::DenseTensor tensor_a, tensor_b;
+  std::fill_n(tensor_a.mutable_data<float>(dims, place), numel, 1.0);
+  std::fill_n(tensor_b.mutable_data<float>(dims, place), numel, 2.0);
+
+  Scope scope;
+  interpreter::ExecutionConfig execution_config;
+  execution_config.profile_instructions = true;
+  execution_config.use_profiled_priority = true;
+  execution_config.profiled_priority_interval = 2;
+  std::shared_ptr<InterpreterCore> core = CreateInterpreterCore(
+      place, program, &scope, fetch_names, execution_config);
+  // the first run builds the instructions without profiling, the critical
+  // path is computed after the 1st and the 3rd profiled run
+  for (int step = 0; step < 4; ++step) {
+    core->Run({"a", "b"}, {tensor_a, tensor_b});
+  }
+
+  auto* profiler = core->GetInstructionProfiler();
+  ASSERT_NE(profiler, nullptr);
+  ASSERT_GT(profiler->Size(), static_cast<size_t>(width * depth));
+  uint64_t max_critical_path = 0;
+  for (size_t i = 0; i < profiler->Size(); ++i) {
+    const auto& cost = profiler->Cost(i);
+    ASSERT_EQ(cost.runs, 3UL);
+    ASSERT_GE(cost.max_ns, cost.AverageNs());
+    ASSERT_GE(profiler->CriticalPathNs()[i], cost.AverageNs());
+    max_critical_path =
+        std::max(max_critical_path, profiler->CriticalPathNs()[i]);
+  }
+  ASSERT_GT(max_critical_path, 0UL);
+  EXPECT_EQ(profiler->RunNum(), 3UL);
+  // and kept by the 4th
+  std::vector<uint64_t> critical_path = profiler->CriticalPathNs();
+  core->Run({"a", "b"}, {tensor_a, tensor_b});
+  EXPECT_EQ(profiler->CriticalPathNs(), critical_path);
+
+  std::string dir = ::testing::TempDir() + "instruction_profiler_XXXXXX";
+  ASSERT_NE(mkdtemp(&dir[0]), nullptr);
+  std::string trace_path = dir + "/instruction_profile.json";
+  std::string csv_path = dir + "/instruction_profile.csv";
+  core->ExportInstructionProfile(trace_path, csv_path);
+  std::ifstream csv(csv_path);
+  std::string line;
+  size_t line_num = 0;
+  while (std::getline(csv, line)) {
+    ++line_num;
+  }
+  EXPECT_EQ(line_num, profiler->Size() + 1);
+  std::ifstream trace(trace_path);
+  std::string trace_str((std::istreambuf_iterator<char>(trace)),
+                        std::istreambuf_iterator<char>());
+  EXPECT_NE(trace_str.find("\"elementwise_add\""), std::string::npos);
+  EXPECT_NE(trace_str.find("\"queue_wait_us\""), std::string::npos);
+  std::remove(trace_path.c_str());
+  std::remove(csv_path.c_str());
+  rmdir(dir.c_str());
+}
+
 }  // namespace framework
 }  // namespace paddle
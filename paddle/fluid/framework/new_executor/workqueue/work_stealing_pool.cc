@@ -0,0 +1,169 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/new_executor/workqueue/work_stealing_pool.h"
+
+#include "glog/logging.h"
+#include "paddle/fluid/framework/new_executor/workqueue/workqueue_utils.h"
+#include "paddle/fluid/platform/enforce.h"
+#include "paddle/fluid/platform/os_info.h"
+
+namespace paddle {
+namespace framework {
+
+namespace {
+
+// Empty polls before an idle worker goes to sleep.
+constexpr int kSpinCount = 1000;
+
+struct PerThread {
+  const WorkStealingPool* pool{nullptr};
+  int worker_id{-1};
+};
+
+PerThread* GetPerThread() {
+  static thread_local PerThread per_thread;
+  return &per_thread;
+}
+
+}  // namespace
+
+WorkStealingPool::WorkStealingPool(const std::string& name,
+                                   size_t num_threads)
+    : name_(name) {
+  PADDLE_ENFORCE_GT(num_threads,
+                    0UL,
+                    platform::errors::InvalidArgument(
+                        "WorkStealingPool needs at least one thread."));
+  workers_.reserve(num_threads);
+  for (size_t i = 0; i < num_threads; ++i) {
+    void* buffer = AlignedMalloc(sizeof(Worker), alignof(Worker));
+    workers_.push_back(new (buffer) Worker());
+  }
+  // start the threads once every deque exists, workers steal from all
+  for (size_t i = 0; i < num_threads; ++i) {
+    workers_[i]->thread = std::thread([this, i] { WorkerLoop(i); });
+  }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    done_.store(true);
+  }
+  cv_.notify_all();
+  for (auto* worker : workers_) {
+    worker->thread.join();
+  }
+  Cancel();
+  for (auto* worker : workers_) {
+    worker->~Worker();
+    AlignedFree(worker);
+  }
+}
+
+int WorkStealingPool::CurrentWorker() const {
+  const PerThread* per_thread = GetPerThread();
+  return per_thread->pool == this ? per_thread->worker_id : -1;
+}
+
+void WorkStealingPool::Schedule(TaskFn fn, void* ctx, size_t id) {
+  Task task{fn, ctx, id};
+  // count the task before it can be popped, so pending_ never goes negative
+  pending_.fetch_add(1);
+  int self = CurrentWorker();
+  if (self >= 0) {
+    task = workers_[self]->queue.PushFront(task);
+  } else {
+    for (size_t i = 0; i < workers_.size() && task.fn != nullptr; ++i) {
+      size_t idx = next_inject_.fetch_add(1, std::memory_order_relaxed) %
+                   workers_.size();
+      task = workers_[idx]->queue.PushBack(task);
+    }
+  }
+  if (task.fn != nullptr) {
+    // all deques are full
+    pending_.fetch_sub(1);
+    task.fn(task.ctx, task.id);
+    return;
+  }
+  // pairs with the sleeping_ increment in WorkerLoop: either the worker sees
+  // the task or we see the worker
+  if (sleeping_.load() > 0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cv_.notify_one();
+  }
+}
+
+void WorkStealingPool::Cancel() {
+  for (auto* worker : workers_) {
+    while (worker->queue.PopBack().fn != nullptr) {
+      pending_.fetch_sub(1);
+    }
+  }
+}
+
+bool WorkStealingPool::Pop(size_t worker_id, Task* task) {
+  *task = workers_[worker_id]->queue.PopFront();
+  if (task->fn != nullptr) {
+    return true;
+  }
+  size_t num_workers = workers_.size();
+  for (size_t i = 1; i < num_workers; ++i) {
+    *task = workers_[(worker_id + i) % num_workers]->queue.PopBack();
+    if (task->fn != nullptr) {
+      steal_count_.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+  return false;
+}
+
+void WorkStealingPool::WorkerLoop(size_t worker_id) {
+  std::string thread_name = name_ + "_thread_" + std::to_string(worker_id);
+  VLOG(1) << thread_name << " started ";
+  platform::SetCurrentThreadName(thread_name);
+  PerThread* per_thread = GetPerThread();
+  per_thread->pool = this;
+  per_thread->worker_id = static_cast<int>(worker_id);
+
+  Task task;
+  while (true) {
+    bool found = false;
+    for (int spin = 0; spin < kSpinCount && !done_.load(); ++spin) {
+      if (pending_.load(std::memory_order_relaxed) > 0 &&
+          Pop(worker_id, &task)) {
+        found = true;
+        break;
+      }
+      std::this_thread::yield();
+    }
+    if (found) {
+      pending_.fetch_sub(1);
+      task.fn(task.ctx, task.id);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    sleeping_.fetch_add(1);
+    cv_.wait(lock, [this] { return pending_.load() > 0 || done_.load(); });
+    sleeping_.fetch_sub(1);
+    if (done_.load()) {
+      break;
+    }
+  }
+  VLOG(1) << thread_name << " exited ";
+}
+
+}  // namespace framework
+}  // namespace paddle
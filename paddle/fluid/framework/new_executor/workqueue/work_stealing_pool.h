@@ -0,0 +1,100 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "paddle/fluid/framework/new_executor/workqueue/run_queue.h"
+
+namespace paddle {
+namespace framework {
+
+// Thread pool with one deque per worker, used by the work-stealing execution
+// mode of InterpreterCore.
+//
+// A task is a plain function pointer with a context and an id, so that
+// scheduling one is a deque push rather than a std::function allocation.
+// Tasks scheduled from a worker go to the front of that worker's deque and
+// are popped LIFO by their owner, which keeps a successor on the thread
+// whose caches hold its inputs. Idle workers steal from the back of the
+// other deques. Tasks scheduled from any other thread are injected at the
+// back of the deques in round robin order.
+class WorkStealingPool {
+ public:
+  using TaskFn = void (*)(void* ctx, size_t id);
+
+  WorkStealingPool(const std::string& name, size_t num_threads);
+  ~WorkStealingPool();
+
+  WorkStealingPool(const WorkStealingPool&) = delete;
+  WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+  // Runs fn(ctx, id) on some worker. When every deque is full the task runs
+  // on the calling thread.
+  void Schedule(TaskFn fn, void* ctx, size_t id);
+
+  // Drops the tasks that have not been started.
+  void Cancel();
+
+  size_t NumThreads() const { return workers_.size(); }
+
+  // Index of the calling thread in this pool, or -1 for other threads.
+  int CurrentWorker() const;
+
+  // number of tasks taken from another worker's deque so far
+  uint64_t StealCount() const {
+    return steal_count_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct Task {
+    TaskFn fn{nullptr};
+    void* ctx{nullptr};
+    size_t id{0};
+  };
+  static constexpr unsigned kQueueSize = 1024;
+  using Queue = RunQueue<Task, kQueueSize>;
+
+  struct Worker {
+    Queue queue;
+    std::thread thread;
+  };
+
+  void WorkerLoop(size_t worker_id);
+  bool Pop(size_t worker_id, Task* task);
+
+  std::string name_;
+  // Worker holds cache line aligned atomics, so it is allocated with
+  // AlignedMalloc
+  std::vector<Worker*> workers_;
+  // tasks pushed and not yet popped, sleeping workers wait for it to
+  // become positive
+  std::atomic<int64_t> pending_{0};
+  std::atomic<size_t> sleeping_{0};
+  std::atomic<size_t> next_inject_{0};
+  std::atomic<uint64_t> steal_count_{0};
+  std::atomic<bool> done_{false};
+  std::mutex mutex_;
+  std::condition_variable cv_;
+};
+
+}  // namespace framework
+}  // namespace paddle
@@ -15,10 +15,13 @@
 #include "paddle/fluid/framework/new_executor/workqueue/workqueue.h"
 
 #include <atomic>
+#include <chrono>  // NOLINT
 #include <thread>
+#include <vector>
 
 #include "glog/logging.h"
 #include "gtest/gtest.h"
+#include "paddle/fluid/framework/new_executor/workqueue/work_stealing_pool.h"
 #include "paddle/fluid/framework/new_executor/workqueue/workqueue_utils.h"
 
 TEST(WorkQueueUtils, TestEventsWaiter) {
@@ -204,3 +207,66 @@ TEST(WorkQueue, TestWorkQueueGroup) {
   queue_group.reset();
   waiter_thread.join();
 }
+
+namespace {
+
+// Binary fan-out tree: task i schedules 2i+1 and 2i+2 from the worker that
+// ran it, so most tasks are either chained locally or stolen.
+struct FanOutContext {
+  paddle::framework::WorkStealingPool* pool;
+  size_t task_num;
+  std::atomic<size_t> finished{0};
+  std::vector<std::atomic<int>> run_count;
+  std::atomic<bool> on_worker{true};
+
+  FanOutContext(paddle::framework::WorkStealingPool* pool, size_t task_num)
+      : pool(pool), task_num(task_num), run_count(task_num) {
+    for (auto& count : run_count) {
+      count = 0;
+    }
+  }
+
+  static void Run(void* ctx, size_t id) {
+    auto* self = static_cast<FanOutContext*>(ctx);
+    ++self->run_count[id];
+    if (self->pool->CurrentWorker() < 0) {
+      self->on_worker = false;
+    }
+    for (size_t child = 2 * id + 1; child <= 2 * id + 2; ++child) {
+      if (child < self->task_num) {
+        self->pool->Schedule(&FanOutContext::Run, ctx, child);
+      }
+    }
+    ++self->finished;
+  }
+};
+
+}  // namespace
+
+TEST(WorkStealingPool, TestFanOut) {
+  using paddle::framework::WorkStealingPool;
+  WorkStealingPool pool("WorkStealingPoolForTesting", 4);
+  EXPECT_EQ(pool.NumThreads(), 4u);
+  EXPECT_EQ(pool.CurrentWorker(), -1);
+  constexpr size_t kTaskNum = 100000;
+  FanOutContext ctx(&pool, kTaskNum);
+  pool.Schedule(&FanOutContext::Run, &ctx, 0);
+  while (ctx.finished.load() < kTaskNum) {
+    std::this_thread::yield();
+  }
+  for (size_t i = 0; i < kTaskNum; ++i) {
+    ASSERT_EQ(ctx.run_count[i].load(), 1) << "task " << i;
+  }
+  EXPECT_TRUE(ctx.on_worker.load());
+  VLOG(1) << "steal count: " << pool.StealCount();
+
+  // idle workers sleep and wake up for external tasks
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  FanOutContext ctx2(&pool, 1000);
+  pool.Schedule(&FanOutContext::Run, &ctx2, 0);
+  while (ctx2.finished.load() < 1000) {
+    std::this_thread::yield();
+  }
+  // nothing is pending, so Cancel drops nothing
+  pool.Cancel();
+}
@@ -0,0 +1,152 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <random>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+namespace paddle {
+namespace framework {
+
+using ShuffleEngine = std::mt19937_64;
+
+namespace detail {
+
+template <typename Func>
+void RunInThreads(int thread_num, Func func) {
+  std::vector<std::thread> threads;
+  for (int i = 1; i < thread_num; ++i) {
+    threads.emplace_back(func, i);
+  }
+  func(0);
+  for (auto& t : threads) {
+    t.join();
+  }
+}
+
+inline ShuffleEngine MakeShuffleEngine(uint64_t seed, uint64_t stream) {
+  std::seed_seq seq{static_cast<uint32_t>(seed),
+                    static_cast<uint32_t>(seed >> 32),
+                    static_cast<uint32_t>(stream),
+                    static_cast<uint32_t>(stream >> 32)};
+  return ShuffleEngine(seq);
+}
+
+}  // namespace detail
+
+// Moves the records of data into bucket_num buckets with thread_num threads,
+// bucket_fn(record, engine) returns the bucket of a record, e.g. by its hash
+// or by the engine. Afterwards the records of bucket i are in
+// [(*offsets)[i], (*offsets)[i + 1]) of data, in their former order.
+//
+// Each thread counts and then scatters a contiguous part of data, and
+// replays the same engine in both passes, so bucket_fn must draw the same
+// random numbers for a record each time it is called.
+template <typename T, typename BucketFn>
+void ParallelPartition(std::vector<T>* data,
+                       size_t bucket_num,
+                       int thread_num,
+                       uint64_t seed,
+                       BucketFn bucket_fn,
+                       std::vector<size_t>* offsets) {
+  size_t num = data->size();
+  thread_num = std::max(1, thread_num);
+  auto part_begin = [num, thread_num](int part) {
+    return num * part / thread_num;
+  };
+
+  std::vector<std::vector<size_t>> counts(thread_num,
+                                          std::vector<size_t>(bucket_num, 0));
+  detail::RunInThreads(thread_num, [&](int part) {
+    ShuffleEngine engine = detail::MakeShuffleEngine(seed, part);
+    auto& count = counts[part];
+    for (size_t i = part_begin(part); i < part_begin(part + 1); ++i) {
+      ++count[bucket_fn((*data)[i], &engine)];
+    }
+  });
+
+  // bucket major, so each part scatters after the former parts in a bucket
+  offsets->assign(bucket_num + 1, 0);
+  std::vector<std::vector<size_t>> positions(thread_num,
+                                             std::vector<size_t>(bucket_num));
+  size_t offset = 0;
+  for (size_t b = 0; b < bucket_num; ++b) {
+    (*offsets)[b] = offset;
+    for (int part = 0; part < thread_num; ++part) {
+      positions[part][b] = offset;
+      offset += counts[part][b];
+    }
+  }
+  (*offsets)[bucket_num] = offset;
+
+  std::vector<T> result(num);
+  detail::RunInThreads(thread_num, [&](int part) {
+    ShuffleEngine engine = detail::MakeShuffleEngine(seed, part);
+    auto& position = positions[part];
+    for (size_t i = part_begin(part); i < part_begin(part + 1); ++i) {
+      size_t b = bucket_fn((*data)[i], &engine);
+      result[position[b]++] = std::move((*data)[i]);
+    }
+  });
+  data->swap(result);
+}
+
+// Shuffles data with thread_num threads: the records are scattered into
+// random buckets in parallel, then each bucket is shuffled by Fisher-Yates
+// on its own thread. As the bucket of each record is uniform and
+// independent, this is a uniform random permutation like std::shuffle.
+template <typename T>
+void ParallelShuffle(std::vector<T>* data, int thread_num, uint64_t seed) {
+  // a thread shuffles at least this many records
+  constexpr size_t kMinShuffleNum = 1 << 16;
+  thread_num = static_cast<int>(std::max<size_t>(
+      1,
+      std::min<size_t>(std::max(thread_num, 1),
+                       data->size() / kMinShuffleNum)));
+  if (thread_num == 1) {
+    ShuffleEngine engine = detail::MakeShuffleEngine(seed, 0);
+    std::shuffle(data->begin(), data->end(), engine);
+    return;
+  }
+
+  // more buckets than threads to balance the shuffle of the buckets
+  size_t bucket_num = 4 * thread_num;
+  std::vector<size_t> offsets;
+  ParallelPartition(
+      data,
+      bucket_num,
+      thread_num,
+      seed,
+      [bucket_num](const T&, ShuffleEngine* engine) {
+        return std::uniform_int_distribution<size_t>(0, bucket_num - 1)(
+            *engine);
+      },
+      &offsets);
+  detail::RunInThreads(thread_num, [&](int part) {
+    for (size_t b = part; b < bucket_num; b += thread_num) {
+      ShuffleEngine engine =
+          detail::MakeShuffleEngine(seed, thread_num + b);
+      std::shuffle(data->begin() + offsets[b],
+                   data->begin() + offsets[b + 1],
+                   engine);
+    }
+  });
+}
+
+}  // namespace framework
+}  // namespace paddle
@@ -0,0 +1,136 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/parallel_shuffle.h"
+
+#include <chrono>  // NOLINT
+#include <numeric>
+#include <string>
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace paddle {
+namespace framework {
+
+TEST(ParallelShuffle, partition) {
+  std::vector<std::string> data;
+  for (int i = 0; i < 10000; ++i) {
+    data.push_back(std::to_string(i));
+  }
+  std::vector<size_t> offsets;
+  ParallelPartition(
+      &data,
+      7,
+      4,
+      0,
+      [](const std::string& s, ShuffleEngine*) {
+        return static_cast<size_t>(std::stoi(s) % 7);
+      },
+      &offsets);
+  ASSERT_EQ(offsets.size(), 8UL);
+  EXPECT_EQ(offsets[0], 0UL);
+  EXPECT_EQ(offsets[7], data.size());
+  for (size_t b = 0; b < 7; ++b) {
+    int last = -1;
+    for (size_t i = offsets[b]; i < offsets[b + 1]; ++i) {
+      int value = std::stoi(data[i]);
+      EXPECT_EQ(value % 7, static_cast<int>(b));
+      // the records of a bucket keep their order
+      EXPECT_GT(value, last);
+      last = value;
+    }
+  }
+}
+
+TEST(ParallelShuffle, permutation) {
+  const size_t num = 1 << 20;
+  std::vector<uint64_t> data(num);
+  std::iota(data.begin(), data.end(), 0);
+  ParallelShuffle(&data, 8, 2023);
+
+  // the first records are spread over the whole result
+  size_t first_quarter = 0;
+  for (size_t i = 0; i < num / 4; ++i) {
+    first_quarter += data[i] < num / 4;
+  }
+  EXPECT_NEAR(static_cast<double>(first_quarter) / (num / 4), 0.25, 0.01);
+
+  std::sort(data.begin(), data.end());
+  for (size_t i = 0; i < num; ++i) {
+    ASSERT_EQ(data[i], i);
+  }
+}
+
+TEST(ParallelShuffle, position_distribution) {
+  // each of 8 records lands on each position equally often
+  const int num = 8;
+  const int trials = 4000;
+  std::vector<std::vector<int>> hits(num, std::vector<int>(num, 0));
+  for (int t = 0; t < trials; ++t) {
+    std::vector<int> data(num);
+    std::iota(data.begin(), data.end(), 0);
+    std::vector<size_t> offsets;
+    // the partition and bucket shuffle of ParallelShuffle on a small input
+    ParallelPartition(
+        &data,
+        4,
+        2,
+        t,
+        [](const int&, ShuffleEngine* engine) {
+          return std::uniform_int_distribution<size_t>(0, 3)(*engine);
+        },
+        &offsets);
+    for (size_t b = 0; b < 4; ++b) {
+      ShuffleEngine engine(t * 4 + b);
+      std::shuffle(
+          data.begin() + offsets[b], data.begin() + offsets[b + 1], engine);
+    }
+    for (int i = 0; i < num; ++i) {
+      ++hits[data[i]][i];
+    }
+  }
+  for (int v = 0; v < num; ++v) {
+    for (int i = 0; i < num; ++i) {
+      EXPECT_NEAR(hits[v][i], trials / num, trials / num / 4);
+    }
+  }
+}
+
+TEST(ParallelShuffle, throughput) {
+  const size_t num = 8 << 20;
+  std::vector<uint64_t> data(num);
+  std::iota(data.begin(), data.end(), 0);
+  {
+    auto start = std::chrono::steady_clock::now();
+    std::default_random_engine engine(0);
+    std::shuffle(data.begin(), data.end(), engine);
+    double sec = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+    VLOG(3) << "std::shuffle: " << num / sec << " records/s";
+  }
+  for (int thread_num = 1; thread_num <= 64; thread_num *= 2) {
+    auto start = std::chrono::steady_clock::now();
+    ParallelShuffle(&data, thread_num, thread_num);
+    double sec = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+    VLOG(3) << thread_num << " threads: " << num / sec << " records/s";
+  }
+  EXPECT_EQ(data.size(), num);
+}
+
+}  // namespace framework
+}  // namespace paddle
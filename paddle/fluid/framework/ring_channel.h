@@ -0,0 +1,362 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <memory>
+#include <mutex>  // NOLINT
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+namespace paddle {
+namespace framework {
+
+// A bounded multi-producer multi-consumer channel on a ring buffer, with the
+// interface of ChannelObject except GetData().
+//
+// Readers and writers claim a range of cells with one compare-and-swap on
+// the dequeue or enqueue position and then move the records of their cells
+// without a lock. Each cell has a sequence number telling whether it was
+// written in the current round, as in Dmitry Vyukov's bounded MPMC queue, so
+// a reader waits only for the writers of its own cells. The mutex and
+// condition variables are used only when a reader finds the channel empty
+// or a writer finds it full for a while.
+//
+// Unlike ChannelObject the ring has a fixed size, the capacity rounded up
+// to a power of two, which must fit in memory. SetCapacity() can lower the
+// capacity below it but not raise it above.
+template <class T>
+class RingChannelObject {
+ public:
+  explicit RingChannelObject(size_t capacity = 65536) {
+    CHECK(capacity >= 1) << "capacity of ring channel must be >= 1";
+    size_t ring_size = 1;
+    while (ring_size < capacity) {
+      ring_size <<= 1;
+    }
+    mask_ = ring_size - 1;
+    capacity_ = capacity;
+    cells_.reset(new Cell[ring_size]);
+    for (size_t i = 0; i < ring_size; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  RingChannelObject(const RingChannelObject&) = delete;
+  RingChannelObject& operator=(const RingChannelObject&) = delete;
+
+  void Clear() {
+    T val;
+    while (TryRead(1, &val) != 0) {
+    }
+    NotifyWriters();
+  }
+
+  size_t Capacity() { return capacity_; }
+
+  void SetCapacity(size_t x) {
+    CHECK(x >= 1) << "capacity of ring channel must be >= 1";
+    capacity_ = std::min(x, mask_ + 1);
+    NotifyWriters();
+  }
+
+  size_t BlockSize() { return block_size_; }
+
+  void SetBlockSize(size_t x) {
+    CHECK(x >= 1) << "block size must be >= 1";
+    block_size_ = x;
+  }
+
+  template <class Channel>
+  void InheritFrom(const std::shared_ptr<Channel>& other) {
+    SetCapacity(std::min(other->Capacity(), mask_ + 1));
+    SetBlockSize(other->BlockSize());
+  }
+
+  bool Closed() { return closed_; }
+
+  // open channel, then data can be write() to channel
+  void Open() {
+    closed_ = false;
+    NotifyAll();
+  }
+
+  // close channel, then no more data can be write() to channel
+  void Close() {
+    closed_ = true;
+    NotifyAll();
+  }
+
+  // records claimed by the writers and not yet by the readers
+  size_t Size() {
+    size_t head = dequeue_pos_.load(std::memory_order_acquire);
+    size_t tail = enqueue_pos_.load(std::memory_order_acquire);
+    return tail > head ? tail - head : 0;
+  }
+
+  bool Empty() { return Size() == 0; }
+
+  // blocking operation
+  bool Get(T& val) { return Read(1, &val) != 0; }  // NOLINT
+
+  // blocking operation
+  // returns 0 if the channel is closed and empty
+  size_t Read(size_t n, T* p) { return Read(n, p, false); }
+
+  // blocking operation
+  bool Put(T&& val) { return WriteMove(1, &val) != 0; }
+
+  // blocking operation
+  bool Put(const T& val) { return Write(1, &val) != 0; }
+
+  // blocking operation
+  // returns value less than n if the channel is closed
+  size_t Write(size_t n, const T* p) {
+    return WriteImpl(n, [p](size_t i) -> const T& { return p[i]; });
+  }
+
+  // WriteMove() will clear original contents of input array
+  size_t WriteMove(size_t n, T* p) {
+    return WriteImpl(n, [p](size_t i) -> T&& { return std::move(p[i]); });
+  }
+
+  // read data of block size from channel to vector
+  size_t Read(std::vector<T>& p) {  // NOLINT
+    p.resize(block_size_);
+    size_t finished = Read(p.size(), &p[0]);
+    p.resize(finished);
+    return finished;
+  }
+
+  // read once only
+  size_t ReadOnce(std::vector<T>& p, size_t size) {  // NOLINT
+    if (size == 0) {
+      return 0;
+    }
+    p.resize(size);
+    size_t finished = Read(size, &p[0], true);
+    p.resize(finished);
+    return finished;
+  }
+
+  size_t ReadAll(std::vector<T>& p) {  // NOLINT
+    p.clear();
+    size_t finished = 0;
+    size_t n = 0;
+    do {
+      // _block_size may change anytime
+      n = block_size_;
+      p.resize(finished + n);
+      n = Read(n, &p[finished]);
+      finished += n;
+    } while (n != 0);
+    p.resize(finished);
+    return finished;
+  }
+
+  // write data from vector to channel
+  size_t Write(const std::vector<T>& p) { return Write(p.size(), &p[0]); }
+
+  // write data from vector to channel
+  size_t Write(std::vector<T>&& p) { return WriteMove(p.size(), &p[0]); }
+
+ private:
+  // a reader or writer spins this many times before it waits on the
+  // condition variable
+  static constexpr int kSpinNum = 64;
+
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T data;
+  };
+
+  // claims up to n records and moves them to p, returns 0 if empty
+  size_t TryRead(size_t n, T* p) {
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    size_t m = 0;
+    do {
+      size_t tail = enqueue_pos_.load(std::memory_order_acquire);
+      m = tail > pos ? std::min(n, tail - pos) : 0;
+      if (m == 0) {
+        return 0;
+      }
+    } while (!dequeue_pos_.compare_exchange_weak(
+        pos, pos + m, std::memory_order_acq_rel, std::memory_order_relaxed));
+    for (size_t i = 0; i < m; ++i) {
+      Cell& cell = cells_[(pos + i) & mask_];
+      // the writer of the cell may still be moving the record in
+      WaitForSequence(cell, pos + i + 1);
+      p[i] = std::move(cell.data);
+      cell.sequence.store(pos + i + mask_ + 1, std::memory_order_release);
+    }
+    return m;
+  }
+
+  // claims up to n free cells and moves get(i) into them, returns 0 if full
+  template <class Getter>
+  size_t TryWrite(size_t n, Getter get) {
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    size_t m = 0;
+    do {
+      size_t head = dequeue_pos_.load(std::memory_order_acquire);
+      size_t used = pos > head ? pos - head : 0;
+      size_t capacity = capacity_;
+      m = used < capacity ? std::min(n, capacity - used) : 0;
+      if (m == 0) {
+        return 0;
+      }
+    } while (!enqueue_pos_.compare_exchange_weak(
+        pos, pos + m, std::memory_order_acq_rel, std::memory_order_relaxed));
+    for (size_t i = 0; i < m; ++i) {
+      Cell& cell = cells_[(pos + i) & mask_];
+      // the reader of the former round may still be moving the record out
+      WaitForSequence(cell, pos + i);
+      cell.data = get(i);
+      cell.sequence.store(pos + i + 1, std::memory_order_release);
+    }
+    return m;
+  }
+
+  void WaitForSequence(const Cell& cell, size_t sequence) {
+    for (int i = 0;
+         cell.sequence.load(std::memory_order_acquire) != sequence;
+         ++i) {
+      if (i >= kSpinNum) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  size_t Read(size_t n, T* p, bool once) {
+    size_t finished = 0;
+    while (finished < n) {
+      size_t m = TryRead(n - finished, p + finished);
+      if (m > 0) {
+        finished += m;
+        NotifyWriters();
+        if (once) {
+          break;
+        }
+      } else if (!WaitForRead()) {
+        break;
+      }
+    }
+    return finished;
+  }
+
+  template <class Getter>
+  size_t WriteImpl(size_t n, Getter get) {
+    size_t finished = 0;
+    while (finished < n && WaitForWrite()) {
+      size_t m = TryWrite(
+          n - finished, [&get, finished](size_t i) -> decltype(auto) {
+            return get(finished + i);
+          });
+      if (m > 0) {
+        finished += m;
+        NotifyReaders();
+      }
+    }
+    return finished;
+  }
+
+  bool Full() { return Size() >= capacity_; }
+
+  // returns false if the channel is closed and empty
+  bool WaitForRead() {
+    for (int i = 0; i < kSpinNum; ++i) {
+      if (!Empty() || closed_) {
+        return !Empty();
+      }
+      std::this_thread::yield();
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    empty_waiters_.fetch_add(1);
+    empty_cond_.wait(lock, [this] { return !Empty() || closed_; });
+    empty_waiters_.fetch_sub(1);
+    return !Empty();
+  }
+
+  // returns false if the channel is closed
+  bool WaitForWrite() {
+    for (int i = 0; i < kSpinNum; ++i) {
+      if (!Full() || closed_) {
+        return !closed_;
+      }
+      std::this_thread::yield();
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    full_waiters_.fetch_add(1);
+    full_cond_.wait(lock, [this] { return !Full() || closed_; });
+    full_waiters_.fetch_sub(1);
+    return !closed_;
+  }
+
+  // A waiter counts itself and checks the channel under mutex_, a notifier
+  // changes the positions and then reads the count, the fence orders the
+  // two so that either the waiter sees the change or it is notified.
+  void NotifyReaders() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (empty_waiters_.load() != 0) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      empty_cond_.notify_all();
+    }
+  }
+
+  void NotifyWriters() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (full_waiters_.load() != 0) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      full_cond_.notify_all();
+    }
+  }
+
+  void NotifyAll() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    empty_cond_.notify_all();
+    full_cond_.notify_all();
+  }
+
+  size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+  std::atomic<size_t> capacity_;
+  std::atomic<size_t> block_size_{1024};
+  std::atomic<bool> closed_{false};
+  // the positions are on their own cache lines, they are written by all
+  // readers or by all writers
+  alignas(64) std::atomic<size_t> enqueue_pos_{0};
+  alignas(64) std::atomic<size_t> dequeue_pos_{0};
+  alignas(64) std::atomic<int> empty_waiters_{0};
+  std::atomic<int> full_waiters_{0};
+  std::mutex mutex_;
+  std::condition_variable empty_cond_;
+  std::condition_variable full_cond_;
+};
+
+template <class T>
+using RingChannel = std::shared_ptr<RingChannelObject<T>>;
+
+template <class T>
+RingChannel<T> MakeRingChannel(size_t capacity = 65536) {
+  return std::make_shared<RingChannelObject<T>>(capacity);
+}
+
+}  // namespace framework
+}  // namespace paddle
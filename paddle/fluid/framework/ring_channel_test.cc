@@ -0,0 +1,151 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/ring_channel.h"
+
+#include <chrono>  // NOLINT
+#include <string>
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+#include "paddle/fluid/framework/channel.h"
+
+namespace paddle {
+namespace framework {
+
+TEST(RingChannel, read_write) {
+  auto channel = MakeRingChannel<std::string>(8);
+  EXPECT_EQ(channel->Capacity(), 8UL);
+  std::vector<std::string> data = {"a", "b", "c"};
+  EXPECT_EQ(channel->Write(data), 3UL);
+  EXPECT_EQ(data[0], "a");
+  EXPECT_EQ(channel->Write(std::move(data)), 3UL);
+  EXPECT_EQ(channel->Size(), 6UL);
+  EXPECT_TRUE(channel->Put("d"));
+  EXPECT_EQ(channel->Size(), 7UL);
+
+  std::string value;
+  ASSERT_TRUE(channel->Get(value));
+  EXPECT_EQ(value, "a");
+  std::vector<std::string> result;
+  EXPECT_EQ(channel->ReadOnce(result, 4), 4UL);
+  EXPECT_EQ(result, std::vector<std::string>({"b", "c", "a", "b"}));
+
+  channel->Close();
+  EXPECT_FALSE(channel->Put("e"));
+  channel->SetBlockSize(1);
+  EXPECT_EQ(channel->ReadAll(result), 2UL);
+  EXPECT_EQ(result, std::vector<std::string>({"c", "d"}));
+  EXPECT_FALSE(channel->Get(value));
+  EXPECT_TRUE(channel->Empty());
+}
+
+TEST(RingChannel, blocking) {
+  auto channel = MakeRingChannel<int>(4);
+  channel->SetCapacity(2);
+  std::vector<int> data = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+  // the writer blocks at the capacity until the reader takes the records
+  std::thread writer([&] {
+    EXPECT_EQ(channel->Write(data.size(), data.data()), data.size());
+    channel->Close();
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(channel->Size(), 2UL);
+  std::vector<int> result;
+  channel->SetBlockSize(3);
+  channel->ReadAll(result);
+  writer.join();
+  EXPECT_EQ(result, data);
+}
+
+// Every producer writes record_num records in batches of batch_size, the
+// consumers read batches until the channel is closed, checks the records
+// are all read once and returns the records per second.
+template <class Channel>
+double RunChannel(Channel* channel,
+                  int producer_num,
+                  int consumer_num,
+                  size_t record_num,
+                  size_t batch_size) {
+  std::atomic<uint64_t> sum{0};
+  std::atomic<size_t> count{0};
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> consumers;
+  for (int i = 0; i < consumer_num; ++i) {
+    consumers.emplace_back([&] {
+      std::vector<uint64_t> batch(batch_size);
+      uint64_t local_sum = 0;
+      size_t local_count = 0;
+      size_t n = 0;
+      while ((n = channel->Read(batch_size, batch.data())) != 0) {
+        for (size_t j = 0; j < n; ++j) {
+          local_sum += batch[j];
+        }
+        local_count += n;
+      }
+      sum += local_sum;
+      count += local_count;
+    });
+  }
+  std::vector<std::thread> producers;
+  for (int i = 0; i < producer_num; ++i) {
+    producers.emplace_back([&, i] {
+      std::vector<uint64_t> batch(batch_size);
+      for (size_t begin = 0; begin < record_num; begin += batch_size) {
+        size_t n = std::min(batch_size, record_num - begin);
+        for (size_t j = 0; j < n; ++j) {
+          batch[j] = i * record_num + begin + j;
+        }
+        EXPECT_EQ(channel->WriteMove(n, batch.data()), n);
+      }
+    });
+  }
+  for (auto& t : producers) {
+    t.join();
+  }
+  channel->Close();
+  for (auto& t : consumers) {
+    t.join();
+  }
+  double sec = std::chrono::duration<double>(
+                   std::chrono::steady_clock::now() - start)
+                   .count();
+  uint64_t total = producer_num * record_num;
+  EXPECT_EQ(count.load(), total);
+  EXPECT_EQ(sum.load(), total * (total - 1) / 2);
+  return total / sec;
+}
+
+TEST(RingChannel, contention_benchmark) {
+  const size_t total_num = 1 << 20;
+  for (int thread_num : {8, 32, 64}) {
+    for (size_t batch_size : {1, 64}) {
+      size_t record_num = total_num / thread_num;
+      auto channel = MakeChannel<uint64_t>(65536);
+      double channel_rate = RunChannel(
+          channel.get(), thread_num, thread_num, record_num, batch_size);
+      auto ring_channel = MakeRingChannel<uint64_t>(65536);
+      double ring_rate = RunChannel(
+          ring_channel.get(), thread_num, thread_num, record_num, batch_size);
+      VLOG(3) << thread_num << " producers x " << thread_num
+              << " consumers, batch " << batch_size
+              << ": ChannelObject " << channel_rate
+              << " records/s, RingChannelObject " << ring_rate
+              << " records/s";
+    }
+  }
+}
+
+}  // namespace framework
+}  // namespace paddle
@@ -0,0 +1,307 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/sample_binary_file.h"
+
+#ifdef _LINUX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cstring>
+
+#include "paddle/fluid/framework/archive.h"
+#include "paddle/fluid/framework/io/fs.h"
+#include "paddle/fluid/platform/enforce.h"
+
+namespace paddle {
+namespace framework {
+
+namespace {
+
+// the mapped pages read are dropped every this many bytes
+constexpr size_t kReleaseSize = 64 << 20;
+
+template <class T>
+void Append(const T& value, std::string* out) {
+  out->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <class T>
+void AppendValues(const std::vector<T>& values, std::string* out) {
+  Append(static_cast<uint32_t>(values.size()), out);
+  if (!values.empty()) {
+    out->append(reinterpret_cast<const char*>(values.data()),
+                values.size() * sizeof(T));
+  }
+}
+
+class SampleDecoder {
+ public:
+  SampleDecoder(const char* data, size_t size)
+      : cur_(data), end_(data + size) {}
+
+  template <class T>
+  T Get() {
+    T value;
+    Copy(&value, sizeof(T));
+    return value;
+  }
+
+  template <class T>
+  void GetValues(std::vector<T>* values) {
+    values->resize(Get<uint32_t>());
+    if (!values->empty()) {
+      Copy(values->data(), values->size() * sizeof(T));
+    }
+  }
+
+  void GetString(std::string* str) {
+    uint32_t len = Get<uint32_t>();
+    Check(len);
+    str->assign(cur_, len);
+    cur_ += len;
+  }
+
+  bool Finished() const { return cur_ == end_; }
+
+ private:
+  void Check(size_t size) const {
+    PADDLE_ENFORCE_LE(size,
+                      static_cast<size_t>(end_ - cur_),
+                      platform::errors::InvalidArgument(
+                          "The sample is truncated, it has %d bytes left "
+                          "but %d bytes are to be read.",
+                          end_ - cur_,
+                          size));
+  }
+
+  void Copy(void* dst, size_t size) {
+    Check(size);
+    memcpy(dst, cur_, size);
+    cur_ += size;
+  }
+
+  const char* cur_;
+  const char* end_;
+};
+
+}  // namespace
+
+bool IsSampleFile(const std::string& path) {
+  // a byte range of a file is named by the file and the range
+  std::string file = path;
+  int64_t begin = 0;
+  int64_t end = 0;
+  fs_parse_range_path(path, &file, &begin, &end);
+  size_t len = strlen(kSampleFileSuffix);
+  return file.size() >= len &&
+         file.compare(file.size() - len, len, kSampleFileSuffix) == 0;
+}
+
+void SerializeSample(const SlotRecord& rec, std::string* out) {
+  Append(static_cast<uint32_t>(rec->ins_id_.size()), out);
+  out->append(rec->ins_id_);
+  Append(rec->search_id, out);
+  Append(rec->rank, out);
+  Append(rec->cmatch, out);
+  AppendValues(rec->slot_uint64_feasigns_.slot_offsets, out);
+  AppendValues(rec->slot_uint64_feasigns_.slot_values, out);
+  AppendValues(rec->slot_float_feasigns_.slot_offsets, out);
+  AppendValues(rec->slot_float_feasigns_.slot_values, out);
+}
+
+void SerializeSample(const Record& rec, std::string* out) {
+  BinaryArchive ar;
+  ar << rec;
+  out->append(ar.Buffer(), ar.Length());
+}
+
+void DeserializeSample(const char* data, size_t size, SlotRecord* rec) {
+  SlotRecord& r = *rec;
+  SampleDecoder decoder(data, size);
+  decoder.GetString(&r->ins_id_);
+  r->search_id = decoder.Get<uint64_t>();
+  r->rank = decoder.Get<uint32_t>();
+  r->cmatch = decoder.Get<uint32_t>();
+  decoder.GetValues(&r->slot_uint64_feasigns_.slot_offsets);
+  decoder.GetValues(&r->slot_uint64_feasigns_.slot_values);
+  decoder.GetValues(&r->slot_float_feasigns_.slot_offsets);
+  decoder.GetValues(&r->slot_float_feasigns_.slot_values);
+  PADDLE_ENFORCE_EQ(decoder.Finished(),
+                    true,
+                    platform::errors::InvalidArgument(
+                        "The sample has more bytes than a SlotRecord."));
+}
+
+void DeserializeSample(const char* data, size_t size, Record* rec) {
+  BinaryArchive ar;
+  ar.SetReadBuffer(const_cast<char*>(data), size, nullptr);
+  ar >> *rec;
+  PADDLE_ENFORCE_EQ(ar.Cursor() == ar.Finish(),
+                    true,
+                    platform::errors::InvalidArgument(
+                        "The sample has more bytes than a Record."));
+}
+
+SampleFileWriter::SampleFileWriter(const std::string& path,
+                                   uint32_t record_type)
+    : path_(path) {
+  int err_no = 0;
+  fp_ = fs_open_write(path, &err_no, "");
+  PADDLE_ENFORCE_EQ(
+      fp_ != nullptr && err_no == 0,
+      true,
+      platform::errors::Unavailable(
+          "Failed to open sample file to write, path[%s].", path));
+  SampleFileHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic = kSampleFileMagic;
+  header.version = kSampleFileVersion;
+  header.record_type = record_type;
+  WriteBytes(&header, sizeof(header));
+}
+
+void SampleFileWriter::WriteSample(const char* data, size_t size) {
+  uint32_t len = static_cast<uint32_t>(size);
+  WriteBytes(&len, sizeof(len));
+  WriteBytes(data, size);
+}
+
+void SampleFileWriter::WriteBytes(const void* data, size_t size) {
+  PADDLE_ENFORCE_EQ(
+      fwrite(data, 1, size, fp_.get()),
+      size,
+      platform::errors::External("Failed to write sample file, path[%s].",
+                                 path_));
+}
+
+void SampleFileWriter::Close() {
+  // closing the pipe of a remote file waits for the upload
+  fp_ = nullptr;
+}
+
+SampleFileReader::SampleFileReader(const std::string& path) : path_(path) {
+  std::string file;
+  int64_t begin = 0;
+  int64_t end = 0;
+  PADDLE_ENFORCE_EQ(fs_parse_range_path(path, &file, &begin, &end),
+                    false,
+                    platform::errors::InvalidArgument(
+                        "A sample file can not be read by byte ranges, "
+                        "its samples are not aligned to them, path[%s].",
+                        path));
+#ifdef _LINUX
+  if (fs_select_internal(path) == 0) {
+    int fd = open(path.c_str(), O_RDONLY);
+    PADDLE_ENFORCE_GE(fd,
+                      0,
+                      platform::errors::Unavailable(
+                          "Failed to open sample file, path[%s].", path));
+    struct stat buf;
+    int ret = fstat(fd, &buf);
+    void* addr = MAP_FAILED;
+    if (ret == 0 && buf.st_size > 0) {
+      addr = mmap(nullptr, buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    PADDLE_ENFORCE_EQ(ret,
+                      0,
+                      platform::errors::External(
+                          "Failed to get file status, path[%s].", path));
+    // a file which can not be mapped is read as a remote file
+    if (addr != MAP_FAILED) {
+      madvise(addr, buf.st_size, MADV_SEQUENTIAL);
+      data_ = static_cast<const char*>(addr);
+      size_ = buf.st_size;
+      mapped_ = true;
+    }
+  }
+#endif
+  if (!mapped_) {
+    int err_no = 0;
+    auto fp = fs_open_read(path, &err_no, "", true);
+    PADDLE_ENFORCE_EQ(fp != nullptr,
+                      true,
+                      platform::errors::Unavailable(
+                          "Failed to open sample file, path[%s].", path));
+    char buf[1 << 16];
+    size_t n = 0;
+    while ((n = fread(buf, 1, sizeof(buf), fp.get())) > 0) {
+      buffer_.insert(buffer_.end(), buf, buf + n);
+    }
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+  }
+  PADDLE_ENFORCE_GE(
+      size_,
+      sizeof(SampleFileHeader),
+      platform::errors::InvalidArgument(
+          "The sample file has no header, path[%s].", path));
+  memcpy(&header_, data_, sizeof(header_));
+  PADDLE_ENFORCE_EQ(
+      header_.magic == kSampleFileMagic &&
+          header_.version == kSampleFileVersion,
+      true,
+      platform::errors::InvalidArgument(
+          "The file is not a sample file of version %d, path[%s].",
+          kSampleFileVersion,
+          path));
+  pos_ = sizeof(SampleFileHeader);
+}
+
+SampleFileReader::~SampleFileReader() {
+#ifdef _LINUX
+  if (mapped_) {
+    munmap(const_cast<char*>(data_), size_);
+  }
+#endif
+}
+
+bool SampleFileReader::Next(const char** data, size_t* size) {
+  if (pos_ == size_) {
+    return false;
+  }
+  uint32_t len = 0;
+  PADDLE_ENFORCE_LE(pos_ + sizeof(len),
+                    size_,
+                    platform::errors::InvalidArgument(
+                        "The sample file is truncated, path[%s].", path_));
+  memcpy(&len, data_ + pos_, sizeof(len));
+  PADDLE_ENFORCE_LE(pos_ + sizeof(len) + len,
+                    size_,
+                    platform::errors::InvalidArgument(
+                        "The sample file is truncated, path[%s].", path_));
+  *data = data_ + pos_ + sizeof(len);
+  *size = len;
+  pos_ += sizeof(len) + len;
+#ifdef _LINUX
+  if (mapped_ && pos_ - released_ >= 2 * kReleaseSize) {
+    // keep the last block, the caller is decoding the sample in it
+    size_t end = (pos_ - kReleaseSize) & ~(kReleaseSize - 1);
+    if (end > released_) {
+      madvise(const_cast<char*>(data_) + released_,
+              end - released_,
+              MADV_DONTNEED);
+      released_ = end;
+    }
+  }
+#endif
+  return true;
+}
+
+}  // namespace framework
+}  // namespace paddle
@@ -0,0 +1,132 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "paddle/fluid/framework/data_feed.h"
+
+namespace paddle {
+namespace framework {
+
+// A binary file of parsed samples, which the in-memory data feeds load
+// without parsing text again. It is a header followed by records, each of
+// them a uint32 size and the bytes of one sample:
+//
+//   SampleFileHeader [size][sample] [size][sample] ...
+//
+// A SlotRecord sample is
+//   ins_id size, ins_id, search_id, rank, cmatch,
+//   uint64 slot num, uint64 offsets, uint64 value num, uint64 values,
+//   float slot num, float offsets, float value num, float values
+// and a Record sample is its BinaryArchive as sent by GlobalShuffle.
+//
+// The files are named with kSampleFileSuffix, so that a file list can mix
+// them with text files.
+constexpr char kSampleFileSuffix[] = ".pdsample";
+constexpr uint32_t kSampleFileMagic = 0x50445346;  // "PDSF"
+constexpr uint32_t kSampleFileVersion = 1;
+
+enum SampleRecordType : uint32_t {
+  kSlotRecordSample = 1,
+  kMultiSlotRecordSample = 2,
+};
+
+struct SampleFileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t record_type;
+  uint32_t reserved;
+};
+
+// whether path, or the file of the byte range path names, is a sample file
+bool IsSampleFile(const std::string& path);
+
+inline uint32_t GetSampleRecordType(const SlotRecord*) {
+  return kSlotRecordSample;
+}
+
+inline uint32_t GetSampleRecordType(const Record*) {
+  return kMultiSlotRecordSample;
+}
+
+// appends the sample of rec to out
+void SerializeSample(const SlotRecord& rec, std::string* out);
+void SerializeSample(const Record& rec, std::string* out);
+
+// rec of SlotRecord must be allocated, as by SlotRecordPool()
+void DeserializeSample(const char* data, size_t size, SlotRecord* rec);
+void DeserializeSample(const char* data, size_t size, Record* rec);
+
+// Writes a sample file by fs_open_write, so path can be on hdfs/afs too.
+class SampleFileWriter {
+ public:
+  SampleFileWriter(const std::string& path, uint32_t record_type);
+  ~SampleFileWriter() { Close(); }
+
+  template <class T>
+  void Write(const T& rec) {
+    buffer_.clear();
+    SerializeSample(rec, &buffer_);
+    WriteSample(buffer_.data(), buffer_.size());
+  }
+
+  void Close();
+
+ private:
+  void WriteSample(const char* data, size_t size);
+  void WriteBytes(const void* data, size_t size);
+
+  std::string path_;
+  std::shared_ptr<FILE> fp_;
+  std::string buffer_;
+};
+
+// Reads a sample file. A local file is mapped into memory and read
+// sequentially, its pages are loaded as the samples are read and dropped
+// after, so loading runs at memory bandwidth without holding the file in
+// memory. Other files are read whole through fs_open_read.
+class SampleFileReader {
+ public:
+  explicit SampleFileReader(const std::string& path);
+  ~SampleFileReader();
+
+  SampleFileReader(const SampleFileReader&) = delete;
+  SampleFileReader& operator=(const SampleFileReader&) = delete;
+
+  const SampleFileHeader& header() const { return header_; }
+
+  // the next sample, returns false at the end of the file
+  bool Next(const char** data, size_t* size);
+
+ private:
+  std::string path_;
+  SampleFileHeader header_;
+  const char* data_{nullptr};
+  size_t size_{0};
+  size_t pos_{0};
+  // the bytes before it are dropped from the mapping
+  size_t released_{0};
+  bool mapped_{false};
+  std::vector<char> buffer_;
+};
+
+}  // namespace framework
+}  // namespace paddle
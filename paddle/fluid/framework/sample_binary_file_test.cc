@@ -0,0 +1,150 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/sample_binary_file.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/fluid/framework/io/fs.h"
+
+namespace paddle {
+namespace framework {
+
+TEST(SampleBinaryFile, IsSampleFile) {
+  EXPECT_TRUE(IsSampleFile("part-00000.pdsample"));
+  EXPECT_TRUE(IsSampleFile(fs_range_path("part-00000.pdsample", 0, 100)));
+  EXPECT_FALSE(IsSampleFile("part-00000.txt"));
+  EXPECT_FALSE(IsSampleFile(fs_range_path("part-00000.txt", 0, 100)));
+  EXPECT_THROW(SampleFileReader(fs_range_path("a.pdsample", 0, 100)),
+               platform::EnforceNotMet);
+}
+
+TEST(SampleBinaryFile, SlotRecordRoundTrip) {
+  std::mt19937_64 rng(0);
+  std::vector<SlotRecordObject> records(100);
+  for (size_t i = 0; i < records.size(); ++i) {
+    SlotRecord r = &records[i];
+    r->ins_id_ = "ins_" + std::to_string(i);
+    r->search_id = rng();
+    r->rank = i % 7;
+    r->cmatch = i % 3;
+    for (int slot = 0; slot < 3; ++slot) {
+      std::vector<uint64_t> values(rng() % 4);
+      for (auto& v : values) {
+        v = rng();
+      }
+      r->slot_uint64_feasigns_.add_values(values.data(), values.size());
+    }
+    for (int slot = 0; slot < 2; ++slot) {
+      std::vector<float> values(rng() % 3);
+      for (auto& v : values) {
+        v = static_cast<float>(rng() % 1000) / 7.0f;
+      }
+      r->slot_float_feasigns_.add_values(values.data(), values.size());
+    }
+  }
+
+  std::string path = "./sample_binary_file_test_slot_record.pdsample";
+  {
+    SampleFileWriter writer(path, kSlotRecordSample);
+    for (auto& r : records) {
+      writer.Write(SlotRecord(&r));
+    }
+  }
+  SampleFileReader reader(path);
+  EXPECT_EQ(reader.header().record_type,
+            static_cast<uint32_t>(kSlotRecordSample));
+  const char* data = nullptr;
+  size_t size = 0;
+  for (auto& expected : records) {
+    ASSERT_TRUE(reader.Next(&data, &size));
+    SlotRecordObject object;
+    SlotRecord r = &object;
+    DeserializeSample(data, size, &r);
+    EXPECT_EQ(r->ins_id_, expected.ins_id_);
+    EXPECT_EQ(r->search_id, expected.search_id);
+    EXPECT_EQ(r->rank, expected.rank);
+    EXPECT_EQ(r->cmatch, expected.cmatch);
+    EXPECT_EQ(r->slot_uint64_feasigns_.slot_offsets,
+              expected.slot_uint64_feasigns_.slot_offsets);
+    EXPECT_EQ(r->slot_uint64_feasigns_.slot_values,
+              expected.slot_uint64_feasigns_.slot_values);
+    EXPECT_EQ(r->slot_float_feasigns_.slot_offsets,
+              expected.slot_float_feasigns_.slot_offsets);
+    EXPECT_EQ(r->slot_float_feasigns_.slot_values,
+              expected.slot_float_feasigns_.slot_values);
+  }
+  EXPECT_FALSE(reader.Next(&data, &size));
+  fs_remove(path);
+}
+
+TEST(SampleBinaryFile, RecordRoundTrip) {
+  std::mt19937_64 rng(1);
+  std::vector<Record> records(100);
+  for (size_t i = 0; i < records.size(); ++i) {
+    Record& r = records[i];
+    r.ins_id_ = "ins_" + std::to_string(i);
+    for (size_t j = rng() % 5; j > 0; --j) {
+      FeatureFeasign sign;
+      sign.uint64_feasign_ = rng();
+      r.uint64_feasigns_.emplace_back(sign, rng() % 10);
+    }
+    for (size_t j = rng() % 3; j > 0; --j) {
+      FeatureFeasign sign;
+      sign.float_feasign_ = static_cast<float>(rng() % 1000) / 7.0f;
+      r.float_feasigns_.emplace_back(sign, rng() % 10);
+    }
+  }
+
+  std::string path = "./sample_binary_file_test_record.pdsample";
+  {
+    SampleFileWriter writer(path, kMultiSlotRecordSample);
+    for (auto& r : records) {
+      writer.Write(r);
+    }
+  }
+  SampleFileReader reader(path);
+  EXPECT_EQ(reader.header().record_type,
+            static_cast<uint32_t>(kMultiSlotRecordSample));
+  const char* data = nullptr;
+  size_t size = 0;
+  for (auto& expected : records) {
+    ASSERT_TRUE(reader.Next(&data, &size));
+    Record r;
+    DeserializeSample(data, size, &r);
+    EXPECT_EQ(r.ins_id_, expected.ins_id_);
+    ASSERT_EQ(r.uint64_feasigns_.size(), expected.uint64_feasigns_.size());
+    for (size_t j = 0; j < r.uint64_feasigns_.size(); ++j) {
+      EXPECT_EQ(r.uint64_feasigns_[j].sign().uint64_feasign_,
+                expected.uint64_feasigns_[j].sign().uint64_feasign_);
+      EXPECT_EQ(r.uint64_feasigns_[j].slot(),
+                expected.uint64_feasigns_[j].slot());
+    }
+    ASSERT_EQ(r.float_feasigns_.size(), expected.float_feasigns_.size());
+    for (size_t j = 0; j < r.float_feasigns_.size(); ++j) {
+      EXPECT_EQ(r.float_feasigns_[j].sign().float_feasign_,
+                expected.float_feasigns_[j].sign().float_feasign_);
+      EXPECT_EQ(r.float_feasigns_[j].slot(),
+                expected.float_feasigns_[j].slot());
+    }
+  }
+  EXPECT_FALSE(reader.Next(&data, &size));
+  fs_remove(path);
+}
+
+}  // namespace framework
+}  // namespace paddle
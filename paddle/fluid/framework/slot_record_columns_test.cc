@@ -0,0 +1,196 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/fluid/framework/data_feed.h"
+
+namespace paddle {
+namespace framework {
+
+static std::vector<std::unique_ptr<SlotRecordObject>> MakeRecords(
+    size_t num, int uint64_slot_num, int float_slot_num, uint64_t seed) {
+  std::mt19937_64 rng(seed);
+  std::vector<std::unique_ptr<SlotRecordObject>> records;
+  for (size_t i = 0; i < num; ++i) {
+    records.emplace_back(new SlotRecordObject());
+    auto* r = records.back().get();
+    for (int j = 0; j < uint64_slot_num; ++j) {
+      std::vector<uint64_t> values(rng() % 4);
+      for (auto& v : values) {
+        v = rng() % 1000 + 1;
+      }
+      r->slot_uint64_feasigns_.add_values(values.data(), values.size());
+    }
+    for (int j = 0; j < float_slot_num; ++j) {
+      std::vector<float> values(rng() % 3);
+      for (auto& v : values) {
+        v = static_cast<float>(rng() % 1000) / 7.0f;
+      }
+      r->slot_float_feasigns_.add_values(values.data(), values.size());
+    }
+  }
+  return records;
+}
+
+// the values of the slot of the records as the columns give them, an empty
+// uint64 slot filled by 0
+template <typename T>
+static std::vector<T> RecordValues(const std::vector<SlotRecord>& records,
+                                   SlotValues<T> SlotRecordObject::*member,
+                                   int slot) {
+  std::vector<T> out;
+  for (auto* r : records) {
+    auto& values = r->*member;
+    size_t begin = values.slot_offsets[slot];
+    size_t end = values.slot_offsets[slot + 1];
+    out.insert(out.end(),
+               values.slot_values.begin() + begin,
+               values.slot_values.begin() + end);
+    if (std::is_same<T, uint64_t>::value && begin == end) {
+      out.push_back(0);
+    }
+  }
+  return out;
+}
+
+template <typename T>
+static std::vector<T> ColumnValues(const SlotRecordColumns& columns,
+                                   const std::vector<SlotRecord>& records,
+                                   int slot) {
+  std::vector<size_t> lod;
+  std::vector<T> out(
+      columns.GetLoD<T>(slot, records.data(), records.size(), &lod));
+  columns.CopyValues<T>(slot, records.data(), records.size(), out.data());
+  EXPECT_EQ(lod.back(), out.size());
+  return out;
+}
+
+// the values of each slot of the records before the build
+struct ExpectedValues {
+  ExpectedValues(const std::vector<SlotRecord>& records,
+                 int uint64_slot_num,
+                 int float_slot_num) {
+    for (int j = 0; j < uint64_slot_num; ++j) {
+      uint64_slots.push_back(
+          RecordValues(records, &SlotRecordObject::slot_uint64_feasigns_, j));
+    }
+    for (int j = 0; j < float_slot_num; ++j) {
+      float_slots.push_back(
+          RecordValues(records, &SlotRecordObject::slot_float_feasigns_, j));
+    }
+  }
+  std::vector<std::vector<uint64_t>> uint64_slots;
+  std::vector<std::vector<float>> float_slots;
+};
+
+static void CheckColumns(const SlotRecordColumns& columns,
+                         const std::vector<SlotRecord>& records,
+                         const ExpectedValues& expected) {
+  for (size_t j = 0; j < expected.uint64_slots.size(); ++j) {
+    EXPECT_EQ(ColumnValues<uint64_t>(columns, records, j),
+              expected.uint64_slots[j]);
+  }
+  for (size_t j = 0; j < expected.float_slots.size(); ++j) {
+    EXPECT_EQ(ColumnValues<float>(columns, records, j),
+              expected.float_slots[j]);
+  }
+}
+
+TEST(SlotRecordColumns, MoveRecordValues) {
+  const int uint64_slot_num = 3;
+  const int float_slot_num = 2;
+  auto owner = MakeRecords(1000, uint64_slot_num, float_slot_num, 1);
+  std::vector<SlotRecord> records;
+  for (auto& r : owner) {
+    records.push_back(r.get());
+  }
+  ExpectedValues expected(records, uint64_slot_num, float_slot_num);
+  std::vector<SlotRecordObject> copies;
+  for (auto* r : records) {
+    copies.push_back(*r);
+  }
+
+  SlotRecordColumns columns;
+  columns.Build(
+      records.data(), records.size(), uint64_slot_num, float_slot_num, 4);
+  ASSERT_EQ(columns.RecordNum(), records.size());
+  CheckColumns(columns, records, expected);
+  // the values are held once, by the columns
+  for (size_t i = 0; i < records.size(); ++i) {
+    EXPECT_EQ(records[i]->column_row_, static_cast<int64_t>(i));
+    EXPECT_TRUE(records[i]->slot_uint64_feasigns_.slot_values.empty());
+    EXPECT_TRUE(records[i]->slot_float_feasigns_.slot_values.empty());
+  }
+  // and given back to a record, e.g. for the dump
+  for (size_t i = 0; i < records.size(); ++i) {
+    SlotRecordObject object;
+    columns.GetValues(records[i]->column_row_, &object);
+    EXPECT_EQ(object.slot_uint64_feasigns_.slot_offsets,
+              copies[i].slot_uint64_feasigns_.slot_offsets);
+    EXPECT_EQ(object.slot_uint64_feasigns_.slot_values,
+              copies[i].slot_uint64_feasigns_.slot_values);
+    EXPECT_EQ(object.slot_float_feasigns_.slot_offsets,
+              copies[i].slot_float_feasigns_.slot_offsets);
+    EXPECT_EQ(object.slot_float_feasigns_.slot_values,
+              copies[i].slot_float_feasigns_.slot_values);
+  }
+  // a reset record holds its values again
+  records[0]->reset();
+  EXPECT_EQ(records[0]->column_row_, -1);
+}
+
+TEST(SlotRecordColumns, ShuffleAndRebuild) {
+  const int uint64_slot_num = 2;
+  const int float_slot_num = 1;
+  const size_t num = SlotRecordColumns::kChunkRecordNum + 100;
+  auto owner = MakeRecords(num, uint64_slot_num, float_slot_num, 2);
+  std::vector<SlotRecord> records;
+  for (auto& r : owner) {
+    records.push_back(r.get());
+  }
+  // a batch across the two chunks
+  std::vector<SlotRecord> batch(
+      records.begin() + SlotRecordColumns::kChunkRecordNum - 50,
+      records.begin() + SlotRecordColumns::kChunkRecordNum + 50);
+  ExpectedValues expected_batch(batch, uint64_slot_num, float_slot_num);
+
+  // the records are shuffled after the build
+  std::vector<SlotRecord> shuffled = records;
+  std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(3));
+  ExpectedValues expected(shuffled, uint64_slot_num, float_slot_num);
+
+  SlotRecordColumns columns;
+  columns.Build(
+      records.data(), records.size(), uint64_slot_num, float_slot_num, 2);
+  CheckColumns(columns, batch, expected_batch);
+  CheckColumns(columns, shuffled, expected);
+
+  // the columns are built again of the records of a reload
+  auto reload = MakeRecords(num, uint64_slot_num, float_slot_num, 4);
+  for (size_t i = 0; i < num; ++i) {
+    records[i] = reload[i].get();
+  }
+  ExpectedValues expected_reload(records, uint64_slot_num, float_slot_num);
+  columns.Build(
+      records.data(), records.size(), uint64_slot_num, float_slot_num, 2);
+  CheckColumns(columns, records, expected_reload);
+}
+
+}  // namespace framework
+}  // namespace paddle
@@ -0,0 +1,263 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace paddle {
+namespace framework {
+
+// A cursor over one line of the multislot text format, which is
+//   <num> <value> ... <num> <value> ...
+// with the tokens separated by spaces.
+//
+// ParseInt(), ParseUint64() and ParseFloat() return the same values and
+// move the cursor the same way as strtol, strtoull and strtof with base 10
+// from the cursor. The common decimal tokens are decoded here, 16 bytes at
+// a time with SSE2 for the digit runs and 8 digits at a time in a 64-bit
+// word, and the rest, such as signed integers, hex or inf floats and
+// integers out of range, fall back to the libc functions. The line
+// must be terminated by '\0' at end for the fallbacks.
+class SlotTextParser {
+ public:
+  SlotTextParser(const char* str, size_t len, size_t pos = 0)
+      : str_(str), cur_(str + pos), end_(str + len) {}
+
+  size_t offset() const { return cur_ - str_; }
+
+  int ParseInt() {
+    const char* p = SkipSpaces(cur_);
+    size_t n = DigitNum(p);
+    if (n == 0 || n > 9) {
+      char* endptr = nullptr;
+      int value = strtol(cur_, &endptr, 10);
+      cur_ = endptr;
+      return value;
+    }
+    cur_ = p + n;
+    return static_cast<int>(DecodeDigits(p, n));
+  }
+
+  uint64_t ParseUint64() {
+    const char* p = SkipSpaces(cur_);
+    size_t n = DigitNum(p);
+    uint64_t value = 0;
+    if (n == 0 || n > 20 || (n == 20 && !DecodeTwentyDigits(p, &value))) {
+      char* endptr = nullptr;
+      value = strtoull(cur_, &endptr, 10);
+      cur_ = endptr;
+      return value;
+    }
+    cur_ = p + n;
+    return n == 20 ? value : DecodeDigits(p, n);
+  }
+
+  float ParseFloat() {
+    float value = 0;
+    const char* p = ParseDecimalFloat(SkipSpaces(cur_), &value);
+    if (p == nullptr) {
+      char* endptr = nullptr;
+      value = strtof(cur_, &endptr);
+      p = endptr;
+    }
+    cur_ = p;
+    return value;
+  }
+
+  // skips n tokens, as the values of a slot which is not used
+  void SkipTokens(int n) {
+    for (int i = 0; i < n; ++i) {
+      cur_ = FindDelimiter(SkipSpaces(cur_));
+    }
+  }
+
+ private:
+  // isspace of the C locale
+  static bool IsSpace(char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+
+  static bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+  const char* SkipSpaces(const char* p) const {
+    while (p < end_ && IsSpace(*p)) {
+      ++p;
+    }
+    return p;
+  }
+
+  // the first byte from p which is a space or a control character
+  const char* FindDelimiter(const char* p) const {
+#if defined(__SSE2__)
+    const __m128i bound = _mm_set1_epi8(' ' + 1);
+    for (; p + 16 <= end_; p += 16) {
+      __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+      // chars >= bound as unsigned bytes
+      __m128i token = _mm_cmpeq_epi8(_mm_max_epu8(chars, bound), chars);
+      int mask = ~_mm_movemask_epi8(token) & 0xFFFF;
+      if (mask != 0) {
+        return p + __builtin_ctz(mask);
+      }
+    }
+#endif
+    while (p < end_ && static_cast<unsigned char>(*p) > ' ') {
+      ++p;
+    }
+    return p;
+  }
+
+  // the number of decimal digits from p
+  size_t DigitNum(const char* p) const {
+    const char* begin = p;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_set1_epi8('0');
+    const __m128i nine = _mm_set1_epi8(9);
+    for (; p + 16 <= end_; p += 16) {
+      __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+      // chars - '0' <= 9 as unsigned bytes
+      __m128i value = _mm_sub_epi8(chars, zero);
+      __m128i digit = _mm_cmpeq_epi8(_mm_min_epu8(value, nine), value);
+      int mask = ~_mm_movemask_epi8(digit) & 0xFFFF;
+      if (mask != 0) {
+        return p + __builtin_ctz(mask) - begin;
+      }
+    }
+#endif
+    while (p < end_ && IsDigit(*p)) {
+      ++p;
+    }
+    return p - begin;
+  }
+
+  // the value of 8 decimal digits
+  static uint64_t DecodeEightDigits(const char* p) {
+    uint64_t chunk = 0;
+    memcpy(&chunk, p, sizeof(chunk));
+    // the first digit is in the lowest byte on little endian
+    chunk -= 0x3030303030303030ULL;
+    chunk = (chunk * 10 + (chunk >> 8)) & 0x00FF00FF00FF00FFULL;
+    chunk = (chunk * 100 + (chunk >> 16)) & 0x0000FFFF0000FFFFULL;
+    chunk = (chunk * 10000 + (chunk >> 32)) & 0x00000000FFFFFFFFULL;
+    return chunk;
+  }
+
+  // the value of n <= 19 decimal digits
+  static uint64_t DecodeDigits(const char* p, size_t n) {
+    uint64_t value = 0;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    for (; n >= 8; n -= 8, p += 8) {
+      value = value * 100000000ULL + DecodeEightDigits(p);
+    }
+#endif
+    for (; n > 0; --n, ++p) {
+      value = value * 10 + (*p - '0');
+    }
+    return value;
+  }
+
+  // the value of 20 decimal digits, returns false if it overflows uint64
+  static bool DecodeTwentyDigits(const char* p, uint64_t* value) {
+    uint64_t high = DecodeDigits(p, 19);
+    return !__builtin_mul_overflow(high, 10, value) &&
+           !__builtin_add_overflow(*value, p[19] - '0', value);
+  }
+
+  // Parses [+-]digits[.digits][(e|E)[+-]digits] from p if the mantissa has
+  // at most 19 digits without the trailing zeros of the fraction, its value
+  // is at most 2^24, the decimal exponent is in [-10, 10] and a delimiter
+  // follows it. Then the mantissa and the power of ten are exact floats and
+  // the quotient or product is rounded once, to the float nearest to the
+  // token as strtof gives. Rounding to double first and then to float could
+  // round twice the wrong way. Returns nullptr otherwise.
+  const char* ParseDecimalFloat(const char* p, float* value) const {
+    static const float kPowersOfTen[] = {
+        1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+    bool negative = false;
+    if (p < end_ && (*p == '-' || *p == '+')) {
+      negative = *p == '-';
+      ++p;
+    }
+    size_t int_num = DigitNum(p);
+    const char* int_digits = p;
+    p += int_num;
+    size_t frac_num = 0;
+    const char* frac_digits = p;
+    if (p < end_ && *p == '.') {
+      frac_digits = ++p;
+      frac_num = DigitNum(p);
+      p += frac_num;
+    }
+    if (int_num + frac_num == 0) {
+      return nullptr;
+    }
+    // the trailing zeros do not change the value
+    size_t frac_value_num = frac_num;
+    while (frac_value_num > 0 && frac_digits[frac_value_num - 1] == '0') {
+      --frac_value_num;
+    }
+    if (int_num + frac_value_num > 19) {
+      return nullptr;
+    }
+    int exponent = 0;
+    if (p < end_ && (*p == 'e' || *p == 'E')) {
+      const char* q = p + 1;
+      bool exp_negative = false;
+      if (q < end_ && (*q == '-' || *q == '+')) {
+        exp_negative = *q == '-';
+        ++q;
+      }
+      size_t exp_num = DigitNum(q);
+      // an exponent without digits is not a part of the number
+      if (exp_num > 0) {
+        if (exp_num > 4) {
+          return nullptr;
+        }
+        exponent = static_cast<int>(DecodeDigits(q, exp_num));
+        exponent = exp_negative ? -exponent : exponent;
+        p = q + exp_num;
+      }
+    }
+    if (p < end_ && static_cast<unsigned char>(*p) > ' ') {
+      return nullptr;
+    }
+    uint64_t mantissa = DecodeDigits(int_digits, int_num);
+    for (size_t i = 0; i < frac_value_num; ++i) {
+      mantissa = mantissa * 10 + (frac_digits[i] - '0');
+    }
+    exponent -= static_cast<int>(frac_value_num);
+    float result = 0;
+    if (mantissa != 0) {
+      if (mantissa > (1ULL << 24) || exponent < -10 || exponent > 10) {
+        return nullptr;
+      }
+      result = static_cast<float>(mantissa);
+      result = exponent < 0 ? result / kPowersOfTen[-exponent]
+                            : result * kPowersOfTen[exponent];
+    }
+    *value = negative ? -result : result;
+    return p;
+  }
+
+  const char* str_;
+  const char* cur_;
+  const char* end_;
+};
+
+}  // namespace framework
+}  // namespace paddle
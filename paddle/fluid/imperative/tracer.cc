@@ -23,6 +23,7 @@
 #include "paddle/fluid/imperative/execution_context.h"
 #include "paddle/fluid/imperative/layout_autotune.h"
 #include "paddle/fluid/imperative/op_base.h"
+#include "paddle/fluid/memory/allocation/allocation_tracer.h"
 #include "paddle/fluid/operators/ops_extra_info.h"
 #include "paddle/fluid/platform/denormal.h"
 #include "paddle/fluid/platform/device/device_wrapper.h"
@@ -222,6 +223,7 @@ void Tracer::TraceOpImpl(const std::string& type,
                          bool use_default_attr_map) {
   platform::RecordEvent op_type_record_event(
       type, platform::TracerEventType::Operator, 1);
+  memory::allocation::AllocationTraceScope allocation_trace_scope(type);
   platform::ScopedFlushDenormal flush;
   VLOG(4) << "Trace Op: " << type;
   if (FLAGS_use_mkldnn) {
@@ -317,6 +317,7 @@ CpuPassStrategy::CpuPassStrategy() : PassStrategy({}) {
                   "seqconv_eltadd_relu_fuse_pass",  //
                   // "seqpool_concat_fuse_pass",    //
                   "seqpool_cvm_concat_fuse_pass",  //
+                  "embedding_seq_pool_fuse_pass",  //
                   // "embedding_fc_lstm_fuse_pass", //
                   // TODO(wilber): fix correctness problem.
                   // "fc_lstm_fuse_pass",                    //
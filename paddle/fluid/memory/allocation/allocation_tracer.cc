@@ -0,0 +1,243 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/memory/allocation/allocation_tracer.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include "paddle/fluid/string/printf.h"
+#include "paddle/phi/core/flags.h"
+
+PADDLE_DEFINE_EXPORTED_bool(
+    enable_allocation_trace,
+    false,
+    "Whether to record the allocations of AutoGrowthBestFitAllocator and "
+    "NaiveBestFitAllocator, i.e. their size histogram and the op types "
+    "holding memory, which are reported by DumpAllocationTrace.");
+
+namespace paddle {
+namespace memory {
+namespace allocation {
+
+namespace {
+
+const std::string kUnknownTag = "<unknown>";  // NOLINT
+
+thread_local const std::string* current_tag = nullptr;
+
+struct TracerRegistry {
+  std::mutex mutex;
+  std::vector<const AllocationTracer*> tracers;
+};
+
+TracerRegistry* GetTracerRegistry() {
+  static auto* registry = new TracerRegistry();
+  return registry;
+}
+
+std::string SizeString(uint64_t size) {
+  return string::HumanReadableSize(static_cast<double>(size));
+}
+
+}  // namespace
+
+AllocationTracer::AllocationTracer(const std::string& name,
+                                   PoolStatFn pool_stat_fn)
+    : name_(name),
+      pool_stat_fn_(std::move(pool_stat_fn)),
+      buckets_(kBucketNum) {
+  auto* registry = GetTracerRegistry();
+  std::lock_guard<std::mutex> guard(registry->mutex);
+  registry->tracers.push_back(this);
+}
+
+AllocationTracer::~AllocationTracer() {
+  auto* registry = GetTracerRegistry();
+  std::lock_guard<std::mutex> guard(registry->mutex);
+  auto& tracers = registry->tracers;
+  tracers.erase(std::remove(tracers.begin(), tracers.end(), this),
+                tracers.end());
+}
+
+bool AllocationTracer::IsEnabled() { return FLAGS_enable_allocation_trace; }
+
+size_t AllocationTracer::BucketOf(size_t size) {
+  size_t bucket = 0;
+  while (size > 1 && bucket + 1 < kBucketNum) {
+    size >>= 1;
+    ++bucket;
+  }
+  return bucket;
+}
+
+void AllocationTracer::RecordAlloc(const phi::Allocation& allocation) {
+  const std::string& tag =
+      current_tag != nullptr ? *current_tag : kUnknownTag;
+  size_t size = allocation.size();
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (!has_place_) {
+    place_ = allocation.place();
+    has_place_ = true;
+  }
+  ++alloc_num_;
+  live_bytes_ += size;
+  peak_live_bytes_ = std::max(peak_live_bytes_, live_bytes_);
+  Bucket& bucket = buckets_[BucketOf(size)];
+  ++bucket.alloc_num;
+  ++bucket.live_num;
+  bucket.live_bytes += size;
+  TagStat* tag_stat = &tags_[tag];
+  ++tag_stat->live_num;
+  tag_stat->live_bytes += size;
+  live_[allocation.ptr()] = LiveAllocation{size, tag_stat};
+}
+
+void AllocationTracer::RecordFree(const phi::Allocation& allocation) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = live_.find(allocation.ptr());
+  if (it == live_.end()) {
+    return;  // allocated before the trace was enabled
+  }
+  size_t size = it->second.size;
+  ++free_num_;
+  live_bytes_ -= size;
+  Bucket& bucket = buckets_[BucketOf(size)];
+  --bucket.live_num;
+  bucket.live_bytes -= size;
+  --it->second.tag->live_num;
+  it->second.tag->live_bytes -= size;
+  live_.erase(it);
+}
+
+void AllocationTracer::Dump(std::ostream& os, size_t top_tag_num) const {
+  // read the pool before taking mutex_, allocators record under their own
+  // lock
+  MemoryPoolStat pool;
+  if (pool_stat_fn_) {
+    pool_stat_fn_(&pool);
+  }
+
+  std::lock_guard<std::mutex> guard(mutex_);
+  os << name_;
+  if (has_place_) {
+    os << " on " << place_;
+  }
+  os << "\n";
+  os << "  allocations: " << alloc_num_ << " allocated, " << free_num_
+     << " freed, " << live_.size() << " live of " << SizeString(live_bytes_)
+     << ", peak " << SizeString(peak_live_bytes_) << "\n";
+
+  if (alloc_num_ > 0) {
+    os << "  size histogram (allocated, live, live bytes):\n";
+    for (size_t i = 0; i < buckets_.size(); ++i) {
+      const Bucket& bucket = buckets_[i];
+      if (bucket.alloc_num == 0) {
+        continue;
+      }
+      os << "    [" << SizeString(1ULL << i) << ", "
+         << SizeString(1ULL << (i + 1)) << "): " << bucket.alloc_num << ", "
+         << bucket.live_num << ", " << SizeString(bucket.live_bytes) << "\n";
+    }
+  }
+
+  os << "  pool: " << pool.chunk_num << " chunks of "
+     << SizeString(pool.chunk_bytes) << ", "
+     << SizeString(pool.chunk_bytes - pool.free_bytes) << " in use, "
+     << SizeString(pool.free_bytes) << " free in " << pool.free_block_num
+     << " blocks, largest free block " << SizeString(pool.largest_free_block);
+  if (pool.free_bytes > 0) {
+    // share of the free memory that a request as large as it cannot use
+    double fragmentation =
+        1.0 - static_cast<double>(pool.largest_free_block) / pool.free_bytes;
+    os << ", fragmentation " << fragmentation;
+  }
+  os << "\n";
+  if (!pool.chunks.empty()) {
+    constexpr size_t kUtilizationBins = 10;
+    std::vector<size_t> bins(kUtilizationBins, 0);
+    for (auto& chunk : pool.chunks) {
+      double used = chunk.first == 0 ? 0.0
+                                     : 1.0 - static_cast<double>(chunk.second) /
+                                                 chunk.first;
+      size_t bin = std::min(static_cast<size_t>(used * kUtilizationBins),
+                            kUtilizationBins - 1);
+      ++bins[bin];
+    }
+    os << "  chunk utilization (chunks per 10% bin):";
+    for (size_t bin : bins) {
+      os << " " << bin;
+    }
+    os << "\n";
+  }
+
+  std::vector<std::pair<const std::string*, const TagStat*>> tags;
+  for (auto& item : tags_) {
+    if (item.second.live_num > 0) {
+      tags.emplace_back(&item.first, &item.second);
+    }
+  }
+  std::sort(tags.begin(), tags.end(), [](const auto& lhs, const auto& rhs) {
+    return lhs.second->live_bytes > rhs.second->live_bytes;
+  });
+  if (tags.size() > top_tag_num) {
+    tags.resize(top_tag_num);
+  }
+  if (!tags.empty()) {
+    os << "  live memory by tag:\n";
+    for (auto& tag : tags) {
+      os << "    " << *tag.first << ": " << tag.second->live_num
+         << " allocations, " << SizeString(tag.second->live_bytes) << "\n";
+    }
+  }
+}
+
+AllocationTraceScope::AllocationTraceScope(const std::string& tag)
+    : enabled_(AllocationTracer::IsEnabled()) {
+  if (enabled_) {
+    prev_tag_ = current_tag;
+    current_tag = &tag;
+  }
+}
+
+AllocationTraceScope::~AllocationTraceScope() {
+  if (enabled_) {
+    current_tag = prev_tag_;
+  }
+}
+
+std::string DumpAllocationTrace(size_t top_tag_num) {
+  std::ostringstream os;
+  auto* registry = GetTracerRegistry();
+  std::lock_guard<std::mutex> guard(registry->mutex);
+  for (const AllocationTracer* tracer : registry->tracers) {
+    tracer->Dump(os, top_tag_num);
+  }
+  return os.str();
+}
+
+bool DumpAllocationTrace(const std::string& path, size_t top_tag_num) {
+  std::ofstream ofs(path, std::ofstream::out | std::ofstream::trunc);
+  if (!ofs) {
+    LOG(WARNING) << "Unable to open file " << path << " for writing data.";
+    return false;
+  }
+  ofs << DumpAllocationTrace(top_tag_num);
+  return static_cast<bool>(ofs);
+}
+
+}  // namespace allocation
+}  // namespace memory
+}  // namespace paddle
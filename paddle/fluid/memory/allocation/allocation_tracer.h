@@ -0,0 +1,128 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <functional>
+#include <mutex>  // NOLINT
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "paddle/fluid/platform/place.h"
+#include "paddle/phi/core/allocator.h"
+
+namespace paddle {
+namespace memory {
+namespace allocation {
+
+// The free memory of a pool allocator.
+struct MemoryPoolStat {
+  size_t chunk_num{0};
+  size_t chunk_bytes{0};
+  size_t free_block_num{0};
+  size_t free_bytes{0};
+  size_t largest_free_block{0};
+  // size and free bytes of each chunk
+  std::vector<std::pair<size_t, size_t>> chunks;
+};
+
+// Allocation trace of one pool allocator, AutoGrowthBestFitAllocator or
+// NaiveBestFitAllocator.
+//
+// When FLAGS_enable_allocation_trace is set, the allocator records every
+// allocation and free into the size histogram and the live allocations,
+// which are attributed to the tag of the allocating thread, i.e. the type
+// of the op it runs. Allocations made while the flag was off are not
+// counted. The free blocks and chunks of the pool are read when the trace
+// is dumped, so they are reported whether the flag is set or not.
+class AllocationTracer {
+ public:
+  using PoolStatFn = std::function<void(MemoryPoolStat*)>;
+
+  AllocationTracer(const std::string& name, PoolStatFn pool_stat_fn);
+  ~AllocationTracer();
+
+  AllocationTracer(const AllocationTracer&) = delete;
+  AllocationTracer& operator=(const AllocationTracer&) = delete;
+
+  static bool IsEnabled();
+
+  void RecordAlloc(const phi::Allocation& allocation);
+  void RecordFree(const phi::Allocation& allocation);
+
+  void Dump(std::ostream& os, size_t top_tag_num) const;
+
+ private:
+  static constexpr size_t kBucketNum = 48;  // sizes below 2^kBucketNum
+
+  struct Bucket {
+    uint64_t alloc_num{0};
+    uint64_t live_num{0};
+    uint64_t live_bytes{0};
+  };
+  struct TagStat {
+    uint64_t live_num{0};
+    uint64_t live_bytes{0};
+  };
+  struct LiveAllocation {
+    size_t size{0};
+    TagStat* tag{nullptr};
+  };
+
+  static size_t BucketOf(size_t size);
+
+  std::string name_;
+  PoolStatFn pool_stat_fn_;
+
+  mutable std::mutex mutex_;
+  bool has_place_{false};
+  platform::Place place_;
+  uint64_t alloc_num_{0};
+  uint64_t free_num_{0};
+  uint64_t live_bytes_{0};
+  uint64_t peak_live_bytes_{0};
+  std::vector<Bucket> buckets_;
+  std::unordered_map<std::string, TagStat> tags_;
+  std::unordered_map<const void*, LiveAllocation> live_;
+};
+
+// Tags the allocations made by the calling thread in its scope, e.g. with
+// the type of the op being run. Scopes nest, it does nothing when the trace
+// is not enabled.
+class AllocationTraceScope {
+ public:
+  explicit AllocationTraceScope(const std::string& tag);
+  ~AllocationTraceScope();
+
+  AllocationTraceScope(const AllocationTraceScope&) = delete;
+  AllocationTraceScope& operator=(const AllocationTraceScope&) = delete;
+
+ private:
+  bool enabled_;
+  const std::string* prev_tag_{nullptr};
+};
+
+// Report of all pool allocators alive, listing the top_tag_num tags that
+// hold the most memory in each of them.
+std::string DumpAllocationTrace(size_t top_tag_num = 20);
+
+// Writes the report to path as well, returns false if it cannot be opened.
+bool DumpAllocationTrace(const std::string& path, size_t top_tag_num = 20);
+
+}  // namespace allocation
+}  // namespace memory
+}  // namespace paddle
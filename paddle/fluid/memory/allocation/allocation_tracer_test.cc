@@ -0,0 +1,102 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/memory/allocation/allocation_tracer.h"
+
+#include <fstream>
+#include <sstream>
+
+#include "gtest/gtest.h"
+#include "paddle/fluid/memory/allocation/auto_growth_best_fit_allocator.h"
+#include "paddle/fluid/memory/allocation/cpu_allocator.h"
+
+DECLARE_bool(enable_allocation_trace);
+
+namespace paddle {
+namespace memory {
+namespace allocation {
+
+TEST(AllocationTracer, auto_growth) {
+  FLAGS_enable_allocation_trace = true;
+  auto allocator = std::make_shared<AutoGrowthBestFitAllocator>(
+      std::make_shared<CPUAllocator>(), 64, 1 << 20);
+
+  std::string conv2d = "conv2d";
+  std::string matmul = "matmul";
+  std::vector<AllocationPtr> allocations;
+  {
+    AllocationTraceScope scope(conv2d);
+    for (int i = 0; i < 4; ++i) {
+      allocations.emplace_back(allocator->Allocate(1000));
+    }
+    {
+      AllocationTraceScope nested_scope(matmul);
+      allocations.emplace_back(allocator->Allocate(300 << 10));
+    }
+  }
+  allocations.emplace_back(allocator->Allocate(100));
+  // free every other conv2d allocation to leave holes in the chunk
+  allocations[0].reset();
+  allocations[2].reset();
+
+  std::string report = DumpAllocationTrace();
+  EXPECT_NE(report.find("AutoGrowthBestFitAllocator"), std::string::npos);
+  EXPECT_NE(report.find("6 allocated, 2 freed, 4 live"), std::string::npos);
+  EXPECT_NE(report.find("1 chunks"), std::string::npos);
+  EXPECT_NE(report.find("fragmentation"), std::string::npos);
+  EXPECT_NE(report.find("chunk utilization"), std::string::npos);
+  // matmul holds the most, then conv2d, then the untagged allocation
+  size_t matmul_pos = report.find("matmul: 1 allocations");
+  size_t conv2d_pos = report.find("conv2d: 2 allocations");
+  size_t unknown_pos = report.find("<unknown>: 1 allocations");
+  ASSERT_NE(matmul_pos, std::string::npos);
+  ASSERT_NE(conv2d_pos, std::string::npos);
+  ASSERT_NE(unknown_pos, std::string::npos);
+  EXPECT_LT(matmul_pos, conv2d_pos);
+  EXPECT_LT(conv2d_pos, unknown_pos);
+
+  std::string path = "allocation_trace_test.txt";
+  ASSERT_TRUE(DumpAllocationTrace(path, 1));
+  std::ifstream ifs(path);
+  std::stringstream ss;
+  ss << ifs.rdbuf();
+  EXPECT_NE(ss.str().find("matmul"), std::string::npos);
+  EXPECT_EQ(ss.str().find("conv2d:"), std::string::npos);
+
+  allocations.clear();
+  report = DumpAllocationTrace();
+  EXPECT_NE(report.find("6 allocated, 6 freed, 0 live"), std::string::npos);
+  EXPECT_EQ(report.find("live memory by tag"), std::string::npos);
+
+  FLAGS_enable_allocation_trace = false;
+  allocations.emplace_back(allocator->Allocate(100));
+  allocations.clear();
+  report = DumpAllocationTrace();
+  EXPECT_NE(report.find("6 allocated, 6 freed, 0 live"), std::string::npos);
+}
+
+TEST(AllocationTracer, unregister) {
+  {
+    auto allocator = std::make_shared<AutoGrowthBestFitAllocator>(
+        std::make_shared<CPUAllocator>(), 64);
+    EXPECT_NE(DumpAllocationTrace().find("AutoGrowthBestFitAllocator"),
+              std::string::npos);
+  }
+  EXPECT_EQ(DumpAllocationTrace().find("AutoGrowthBestFitAllocator"),
+            std::string::npos);
+}
+
+}  // namespace allocation
+}  // namespace memory
+}  // namespace paddle
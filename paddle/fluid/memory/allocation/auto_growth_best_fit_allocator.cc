@@ -49,7 +49,9 @@ AutoGrowthBestFitAllocator::AutoGrowthBestFitAllocator(
     : underlying_allocator_(underlying_allocator),
       alignment_(alignment),
       chunk_size_(std::max(AlignedSize(chunk_size, alignment), alignment)),
-      allow_free_idle_chunk_(allow_free_idle_chunk) {
+      allow_free_idle_chunk_(allow_free_idle_chunk),
+      tracer_("AutoGrowthBestFitAllocator",
+              [this](MemoryPoolStat *stat) { GetPoolStat(stat); }) {
   total_alloc_times_ = 0;
   total_alloc_size_ = 0;
   total_free_times_ = 0;
@@ -65,6 +67,31 @@ phi::Allocation *AutoGrowthBestFitAllocator::AllocateImpl(
   VLOG(10) << "Allocate " << unaligned_size << " bytes, aligned to " << size;
 
   std::lock_guard<SpinLock> guard(spinlock_);
+  return AllocateBlock(size);
+}
+
+void AutoGrowthBestFitAllocator::AllocateBatch(size_t size,
+                                               size_t num,
+                                               phi::Allocation **allocations) {
+  platform::RecordEvent record("AutoGrowthBestFitAllocator::AllocateBatch",
+                               platform::TracerEventType::UserDefined,
+                               9 /*level*/);
+  size = AlignedSize(size, alignment_);
+  std::lock_guard<SpinLock> guard(spinlock_);
+  size_t i = 0;
+  try {
+    for (; i < num; ++i) {
+      allocations[i] = AllocateBlock(size);
+    }
+  } catch (BadAlloc &ex) {
+    for (size_t j = 0; j < i; ++j) {
+      FreeBlock(allocations[j]);
+    }
+    throw ex;
+  }
+}
+
+phi::Allocation *AutoGrowthBestFitAllocator::AllocateBlock(size_t size) {
   auto iter = free_blocks_.lower_bound(std::make_pair(size, nullptr));
   BlockIt block_it;
   if (iter != free_blocks_.end()) {
@@ -120,7 +147,11 @@ phi::Allocation *AutoGrowthBestFitAllocator::AllocateImpl(
   ++total_alloc_times_;
   total_alloc_size_ += size;
   VLOG(10) << "Alloc " << block_it->size_ << " bytes, ptr = " << block_it->ptr_;
-  return new BlockAllocation(block_it);
+  auto *allocation = new BlockAllocation(block_it);
+  if (UNLIKELY(AllocationTracer::IsEnabled())) {
+    tracer_.RecordAlloc(*allocation);
+  }
+  return allocation;
 }
 
 void AutoGrowthBestFitAllocator::FreeImpl(phi::Allocation *allocation) {
@@ -130,6 +161,30 @@ void AutoGrowthBestFitAllocator::FreeImpl(phi::Allocation *allocation) {
   VLOG(10) << "Free " << allocation->size()
            << " bytes, ptr = " << allocation->ptr();
   std::lock_guard<SpinLock> guard(spinlock_);
+  FreeBlock(allocation);
+  if (FLAGS_free_idle_chunk) {
+    FreeIdleChunks();
+  }
+}
+
+void AutoGrowthBestFitAllocator::FreeBatch(phi::Allocation *const *allocations,
+                                           size_t num) {
+  platform::RecordEvent record("AutoGrowthBestFitAllocator::FreeBatch",
+                               platform::TracerEventType::UserDefined,
+                               9 /*level*/);
+  std::lock_guard<SpinLock> guard(spinlock_);
+  for (size_t i = 0; i < num; ++i) {
+    FreeBlock(allocations[i]);
+  }
+  if (FLAGS_free_idle_chunk) {
+    FreeIdleChunks();
+  }
+}
+
+void AutoGrowthBestFitAllocator::FreeBlock(phi::Allocation *allocation) {
+  if (UNLIKELY(AllocationTracer::IsEnabled())) {
+    tracer_.RecordFree(*allocation);
+  }
   auto block_it = static_cast<BlockAllocation *>(allocation)->block_it_;
   auto &blocks = block_it->chunk_->blocks_;
 
@@ -163,10 +218,6 @@ void AutoGrowthBestFitAllocator::FreeImpl(phi::Allocation *allocation) {
                        block_it);
 
   delete allocation;
-
-  if (FLAGS_free_idle_chunk) {
-    FreeIdleChunks();
-  }
 }
 
 uint64_t AutoGrowthBestFitAllocator::FreeIdleChunks() {
@@ -191,6 +242,26 @@ uint64_t AutoGrowthBestFitAllocator::FreeIdleChunks() {
   return bytes;
 }
 
+void AutoGrowthBestFitAllocator::GetPoolStat(MemoryPoolStat *stat) {
+  std::lock_guard<SpinLock> guard(spinlock_);
+  for (auto &chunk : chunks_) {
+    size_t free_bytes = 0;
+    for (auto &block : chunk.blocks_) {
+      if (block.is_free_) {
+        free_bytes += block.size_;
+        ++stat->free_block_num;
+        stat->largest_free_block =
+            std::max(stat->largest_free_block, block.size_);
+      }
+    }
+    size_t chunk_size = chunk.allocation_->size();
+    ++stat->chunk_num;
+    stat->chunk_bytes += chunk_size;
+    stat->free_bytes += free_bytes;
+    stat->chunks.emplace_back(chunk_size, free_bytes);
+  }
+}
+
 void AutoGrowthBestFitAllocator::Trace() const {
   size_t cur_idle_bytes = 0;
   auto it = free_blocks_.begin();
@@ -20,6 +20,7 @@
 #include <mutex>  // NOLINT
 #include <utility>
 
+#include "paddle/fluid/memory/allocation/allocation_tracer.h"
 #include "paddle/fluid/memory/allocation/allocator.h"
 #include "paddle/fluid/memory/allocation/spin_lock.h"
 
@@ -37,6 +38,13 @@ class AutoGrowthBestFitAllocator : public Allocator {
 
   bool IsAllocThreadSafe() const override { return true; }
 
+  // Allocates num blocks of size bytes, or frees num blocks, under one lock.
+  // They are meant for allocators caching blocks of this one: the blocks
+  // are not decorated by this allocator, so they must be returned with
+  // FreeBatch rather than Free.
+  void AllocateBatch(size_t size, size_t num, phi::Allocation **allocations);
+  void FreeBatch(phi::Allocation *const *allocations, size_t num);
+
  protected:
   phi::Allocation *AllocateImpl(size_t size) override;
 
@@ -48,7 +56,12 @@ class AutoGrowthBestFitAllocator : public Allocator {
   }
 
  private:
+  // the spinlock must be held
+  phi::Allocation *AllocateBlock(size_t size);
+  void FreeBlock(phi::Allocation *allocation);
+
   uint64_t FreeIdleChunks();
+  void GetPoolStat(MemoryPoolStat *stat);
   void Trace() const;
 
   template <typename T>
@@ -101,6 +114,9 @@ class AutoGrowthBestFitAllocator : public Allocator {
   size_t total_free_size_;
 
   SpinLock spinlock_;
+
+  // destroyed first, so that it stops reading the pool before the pool dies
+  AllocationTracer tracer_;
 };
 
 }  // namespace allocation
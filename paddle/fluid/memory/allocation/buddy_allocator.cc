@@ -227,6 +227,30 @@ uint64_t BuddyAllocator::Release() {
   return bytes;
 }
 
+void BuddyAllocator::GetPoolStat(allocation::MemoryPoolStat* stat) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // chunks ordered by address, to find the chunk of each free block
+  std::map<uintptr_t, size_t> chunk_index;
+  for (auto& chunk : chunks_) {
+    chunk_index.emplace(reinterpret_cast<uintptr_t>(chunk.first.second),
+                        stat->chunks.size());
+    stat->chunks.emplace_back(chunk.first.first, 0);
+    ++stat->chunk_num;
+    stat->chunk_bytes += chunk.first.first;
+  }
+  for (auto& block : pool_) {
+    size_t size = std::get<1>(block);
+    ++stat->free_block_num;
+    stat->free_bytes += size;
+    stat->largest_free_block = std::max(stat->largest_free_block, size);
+    auto it = chunk_index.upper_bound(
+        reinterpret_cast<uintptr_t>(std::get<2>(block)));
+    if (it != chunk_index.begin()) {
+      stat->chunks[(--it)->second].second += size;
+    }
+  }
+}
+
 size_t BuddyAllocator::Used() { return total_used_; }
 size_t BuddyAllocator::GetMinChunkSize() { return min_chunk_size_; }
 size_t BuddyAllocator::GetMaxChunkSize() { return max_chunk_size_; }
@@ -25,6 +25,7 @@ limitations under the License. */
 #include <utility>
 #include <vector>
 
+#include "paddle/fluid/memory/allocation/allocation_tracer.h"
 #include "paddle/fluid/memory/allocation/memory_block.h"
 #include "paddle/fluid/memory/allocation/system_allocator.h"
 #include "paddle/fluid/platform/device/gpu/gpu_info.h"
@@ -51,6 +52,9 @@ class BuddyAllocator {
   // Release the unused memory pool, a real free operation for the OS.
   uint64_t Release();
   size_t Used();
+  // Free blocks and chunks of the pool, huge chunks allocated for a single
+  // request are not included.
+  void GetPoolStat(allocation::MemoryPoolStat* stat);
   size_t GetMinChunkSize();
   size_t GetMaxChunkSize();
 
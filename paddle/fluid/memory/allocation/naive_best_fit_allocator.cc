@@ -927,6 +927,32 @@ struct ReleaseVisitor : std::unary_function<const Place, uint64_t> {
   }
 };
 
+struct PoolStatVisitor : std::unary_function<const Place, void> {
+  inline explicit PoolStatVisitor(allocation::MemoryPoolStat *stat)
+      : stat_(stat) {}
+
+  // the pools of the other places are not reported
+  template <typename Place>
+  inline void operator()(const Place &place) const {}
+
+  inline void operator()(const platform::CPUPlace &place) const {
+    GetCPUBuddyAllocator()->GetPoolStat(stat_);
+  }
+
+#if defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP)
+  inline void operator()(const platform::CUDAPlace &place) const {
+    GetGPUBuddyAllocator(place.device)->GetPoolStat(stat_);
+  }
+
+  inline void operator()(const platform::CUDAPinnedPlace &place) const {
+    GetCUDAPinnedBuddyAllocator()->GetPoolStat(stat_);
+  }
+#endif
+
+ private:
+  allocation::MemoryPoolStat *stat_;
+};
+
 size_t Usage::operator()(const platform::CPUPlace &cpu) const {
   return Used(cpu);
 }
@@ -955,10 +981,16 @@ namespace allocation {
 phi::Allocation *NaiveBestFitAllocator::AllocateImpl(size_t size) {
   void *ptr = paddle::platform::VisitPlace(place_, legacy::AllocVisitor(size));
   auto *tmp_alloc = new Allocation(ptr, size, place_);
+  if (UNLIKELY(AllocationTracer::IsEnabled())) {
+    tracer_.RecordAlloc(*tmp_alloc);
+  }
   return tmp_alloc;
 }
 
 void NaiveBestFitAllocator::FreeImpl(phi::Allocation *allocation) {
+  if (UNLIKELY(AllocationTracer::IsEnabled())) {
+    tracer_.RecordFree(*allocation);
+  }
   paddle::platform::VisitPlace(
       allocation->place(),
       legacy::FreeVisitor(allocation->ptr(), allocation->size()));
@@ -969,6 +1001,10 @@ uint64_t NaiveBestFitAllocator::ReleaseImpl(const platform::Place &place) {
   return paddle::platform::VisitPlace(place, legacy::ReleaseVisitor());
 }
 
+void NaiveBestFitAllocator::GetPoolStat(MemoryPoolStat *stat) {
+  paddle::platform::VisitPlace(place_, legacy::PoolStatVisitor(stat));
+}
+
 }  // namespace allocation
 }  // namespace memory
 }  // namespace paddle
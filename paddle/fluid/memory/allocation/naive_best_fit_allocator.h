@@ -21,6 +21,7 @@
 #include <utility>
 #include <vector>
 
+#include "paddle/fluid/memory/allocation/allocation_tracer.h"
 #include "paddle/fluid/memory/allocation/allocator.h"
 #include "paddle/fluid/platform/place.h"
 
@@ -30,7 +31,10 @@ namespace allocation {
 
 class NaiveBestFitAllocator : public Allocator {
  public:
-  explicit NaiveBestFitAllocator(const platform::Place &p) : place_(p) {}
+  explicit NaiveBestFitAllocator(const platform::Place &p)
+      : place_(p),
+        tracer_("NaiveBestFitAllocator",
+                [this](MemoryPoolStat *stat) { GetPoolStat(stat); }) {}
 
   bool IsAllocThreadSafe() const override { return true; }
 
@@ -40,7 +44,10 @@ class NaiveBestFitAllocator : public Allocator {
   uint64_t ReleaseImpl(const platform::Place &place) override;
 
  private:
+  void GetPoolStat(MemoryPoolStat *stat);
+
   platform::Place place_;
+  AllocationTracer tracer_;
 };
 
 }  // namespace allocation
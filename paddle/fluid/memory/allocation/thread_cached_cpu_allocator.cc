@@ -0,0 +1,251 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/memory/allocation/thread_cached_cpu_allocator.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+#include "paddle/fluid/memory/allocation/cpu_allocator.h"
+
+namespace paddle {
+namespace memory {
+namespace allocation {
+
+namespace {
+
+// Classes are 64 bytes apart up to 1KB, and four per power of two above.
+constexpr size_t kSmallStep = 64;
+constexpr size_t kSmallSize = 1024;
+constexpr size_t kClassesPerDoubling = 4;
+
+// A batch moves about kBatchBytes between a thread and the pool, and at
+// most kMaxBatchNum blocks.
+constexpr size_t kBatchBytes = 64 << 10;
+constexpr size_t kMaxBatchNum = 32;
+
+constexpr size_t kPoolAlignment = 64;
+constexpr size_t kPoolChunkSize = 1 << 20;
+
+// Set when the thread cache holder of the thread is destroyed, blocks freed
+// later on the thread, e.g. by other thread local objects, go to the pool.
+thread_local bool thread_cache_destroyed = false;
+
+}  // namespace
+
+struct ThreadCachedCPUAllocator::ThreadCacheHolder {
+  ~ThreadCacheHolder() {
+    thread_cache_destroyed = true;
+    for (auto& item : caches) {
+      item.second->Detach();
+    }
+  }
+
+  uint64_t last_id{0};
+  ThreadCache* last_cache{nullptr};
+  std::unordered_map<uint64_t, std::shared_ptr<ThreadCache>> caches;
+};
+
+std::atomic<uint64_t> ThreadCachedCPUAllocator::next_id_{1};
+
+ThreadCachedCPUAllocator::ThreadCachedCPUAllocator(size_t max_cached_size,
+                                                   size_t thread_cache_size)
+    : id_(next_id_.fetch_add(1)),
+      thread_cache_size_(thread_cache_size),
+      system_allocator_(std::make_shared<CPUAllocator>()) {
+  for (size_t size = kSmallStep; size <= kSmallSize; size += kSmallStep) {
+    class_sizes_.push_back(size);
+    if (size >= max_cached_size) break;
+  }
+  for (size_t base = kSmallSize; class_sizes_.back() < max_cached_size;
+       base *= 2) {
+    size_t step = base / kClassesPerDoubling;
+    for (size_t i = 1; i <= kClassesPerDoubling; ++i) {
+      class_sizes_.push_back(base + i * step);
+      if (class_sizes_.back() >= max_cached_size) break;
+    }
+  }
+  max_cached_size_ = class_sizes_.back();
+  for (size_t size : class_sizes_) {
+    batch_nums_.push_back(
+        std::max<size_t>(1, std::min(kBatchBytes / size, kMaxBatchNum)));
+  }
+  pool_ = std::make_shared<AutoGrowthBestFitAllocator>(
+      system_allocator_, kPoolAlignment, kPoolChunkSize);
+  VLOG(4) << "ThreadCachedCPUAllocator: " << class_sizes_.size()
+          << " size classes up to " << max_cached_size_ << " bytes";
+}
+
+ThreadCachedCPUAllocator::~ThreadCachedCPUAllocator() {
+  std::vector<std::shared_ptr<ThreadCache>> caches;
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    caches.swap(thread_caches_);
+  }
+  for (auto& cache : caches) {
+    std::lock_guard<std::mutex> guard(cache->mutex);
+    if (cache->owner != nullptr) {
+      FlushThreadCache(cache.get());
+      cache->owner = nullptr;
+    }
+  }
+}
+
+void ThreadCachedCPUAllocator::ThreadCache::Detach() {
+  std::lock_guard<std::mutex> guard(mutex);
+  if (owner != nullptr) {
+    owner->FlushThreadCache(this);
+    owner->UnregisterThreadCache(this);
+    owner = nullptr;
+  }
+}
+
+size_t ThreadCachedCPUAllocator::SizeClass(size_t size) const {
+  if (size <= kSmallSize) {
+    return size == 0 ? 0 : (size - 1) / kSmallStep;
+  }
+  return std::lower_bound(class_sizes_.begin(), class_sizes_.end(), size) -
+         class_sizes_.begin();
+}
+
+size_t ThreadCachedCPUAllocator::RoundedSize(size_t size) const {
+  return size > max_cached_size_ ? size : class_sizes_[SizeClass(size)];
+}
+
+size_t ThreadCachedCPUAllocator::ThreadCacheNum() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return thread_caches_.size();
+}
+
+ThreadCachedCPUAllocator::ThreadCache*
+ThreadCachedCPUAllocator::GetThreadCache() {
+  static thread_local ThreadCacheHolder holder;
+  if (holder.last_id == id_) {
+    return holder.last_cache;
+  }
+  auto& cache = holder.caches[id_];
+  if (cache == nullptr) {
+    cache = std::make_shared<ThreadCache>();
+    cache->owner = this;
+    cache->free_lists.resize(class_sizes_.size());
+    for (size_t i = 0; i < class_sizes_.size(); ++i) {
+      cache->free_lists[i].reserve(2 * batch_nums_[i] + 1);
+    }
+    std::lock_guard<std::mutex> guard(mutex_);
+    thread_caches_.push_back(cache);
+  }
+  holder.last_id = id_;
+  holder.last_cache = cache.get();
+  return cache.get();
+}
+
+phi::Allocation* ThreadCachedCPUAllocator::AllocateImpl(size_t size) {
+  if (size > max_cached_size_) {
+    return system_allocator_->Allocate(size).release();
+  }
+  size_t size_class = SizeClass(size);
+  size_t class_size = class_sizes_[size_class];
+  phi::Allocation* allocation = nullptr;
+  if (UNLIKELY(thread_cache_destroyed)) {
+    pool_->AllocateBatch(class_size, 1, &allocation);
+    return allocation;
+  }
+
+  ThreadCache* cache = GetThreadCache();
+  auto& free_list = cache->free_lists[size_class];
+  if (free_list.empty()) {
+    size_t num = batch_nums_[size_class];
+    free_list.resize(num);
+    try {
+      pool_->AllocateBatch(class_size, num, free_list.data());
+    } catch (...) {
+      free_list.clear();
+      throw;
+    }
+    cache->cached_bytes += num * class_size;
+  }
+  allocation = free_list.back();
+  free_list.pop_back();
+  cache->cached_bytes -= class_size;
+  return allocation;
+}
+
+void ThreadCachedCPUAllocator::FreeImpl(phi::Allocation* allocation) {
+  size_t size = allocation->size();
+  if (size > max_cached_size_) {
+    system_allocator_->Free(allocation);
+    return;
+  }
+  if (UNLIKELY(thread_cache_destroyed)) {
+    pool_->FreeBatch(&allocation, 1);
+    return;
+  }
+
+  size_t size_class = SizeClass(size);
+  ThreadCache* cache = GetThreadCache();
+  auto& free_list = cache->free_lists[size_class];
+  free_list.push_back(allocation);
+  cache->cached_bytes += size;
+  if (free_list.size() > 2 * batch_nums_[size_class]) {
+    ReturnBlocks(cache, size_class, batch_nums_[size_class]);
+  }
+  if (cache->cached_bytes > thread_cache_size_) {
+    for (size_t i = 0; i < cache->free_lists.size(); ++i) {
+      ReturnBlocks(cache, i, (cache->free_lists[i].size() + 1) / 2);
+    }
+  }
+}
+
+uint64_t ThreadCachedCPUAllocator::ReleaseImpl(const platform::Place& place) {
+  if (!thread_cache_destroyed) {
+    FlushThreadCache(GetThreadCache());
+  }
+  return pool_->Release(place);
+}
+
+void ThreadCachedCPUAllocator::ReturnBlocks(ThreadCache* cache,
+                                            size_t size_class,
+                                            size_t num) {
+  if (num == 0) {
+    return;
+  }
+  // the blocks at the front were freed first, they are the coldest ones
+  auto& free_list = cache->free_lists[size_class];
+  pool_->FreeBatch(free_list.data(), num);
+  free_list.erase(free_list.begin(), free_list.begin() + num);
+  cache->cached_bytes -= num * class_sizes_[size_class];
+}
+
+void ThreadCachedCPUAllocator::FlushThreadCache(ThreadCache* cache) {
+  for (size_t i = 0; i < cache->free_lists.size(); ++i) {
+    ReturnBlocks(cache, i, cache->free_lists[i].size());
+  }
+}
+
+void ThreadCachedCPUAllocator::UnregisterThreadCache(ThreadCache* cache) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = std::find_if(
+      thread_caches_.begin(),
+      thread_caches_.end(),
+      [cache](const std::shared_ptr<ThreadCache>& item) {
+        return item.get() == cache;
+      });
+  if (it != thread_caches_.end()) {
+    thread_caches_.erase(it);
+  }
+}
+
+}  // namespace allocation
+}  // namespace memory
+}  // namespace paddle
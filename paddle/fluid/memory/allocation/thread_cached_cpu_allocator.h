@@ -0,0 +1,101 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <vector>
+
+#include "paddle/fluid/memory/allocation/allocator.h"
+#include "paddle/fluid/memory/allocation/auto_growth_best_fit_allocator.h"
+
+namespace paddle {
+namespace memory {
+namespace allocation {
+
+// CPU allocator of FLAGS_allocator_strategy=thread_cached.
+//
+// Requests up to max_cached_size bytes are rounded up to a size class and
+// served from a free list of the calling thread, so the common case takes
+// no lock. An empty free list is refilled with a batch of blocks from a
+// shared AutoGrowthBestFitAllocator, and a free list grown past twice its
+// batch returns a batch of blocks to it, each under a single lock. When the
+// blocks cached by a thread exceed thread_cache_size bytes, half of each of
+// its free lists goes back to the pool. Larger requests go straight to the
+// system allocator.
+//
+// A block freed by another thread than the one that allocated it is cached
+// by the freeing thread. The blocks cached by a thread go back to the pool
+// when the thread exits.
+class ThreadCachedCPUAllocator : public Allocator {
+ public:
+  explicit ThreadCachedCPUAllocator(size_t max_cached_size = 256 << 10,
+                                    size_t thread_cache_size = 4 << 20);
+  ~ThreadCachedCPUAllocator();
+
+  bool IsAllocThreadSafe() const override { return true; }
+
+  // the size a request of size bytes is rounded up to
+  size_t RoundedSize(size_t size) const;
+
+  size_t ThreadCacheNum() const;
+
+ protected:
+  phi::Allocation* AllocateImpl(size_t size) override;
+  void FreeImpl(phi::Allocation* allocation) override;
+  // Returns the blocks cached by the calling thread and the idle chunks of
+  // the pool. The caches of the other threads are left alone.
+  uint64_t ReleaseImpl(const platform::Place& place) override;
+
+ private:
+  struct ThreadCache {
+    // Guards owner against the exit of the thread racing with the
+    // destruction of the allocator, the free lists are only touched by the
+    // owning thread otherwise.
+    std::mutex mutex;
+    ThreadCachedCPUAllocator* owner{nullptr};
+    std::vector<std::vector<phi::Allocation*>> free_lists;
+    size_t cached_bytes{0};
+
+    // called when the thread exits
+    void Detach();
+  };
+  struct ThreadCacheHolder;
+
+  size_t SizeClass(size_t size) const;
+  ThreadCache* GetThreadCache();
+  void ReturnBlocks(ThreadCache* cache, size_t size_class, size_t num);
+  void FlushThreadCache(ThreadCache* cache);
+  void UnregisterThreadCache(ThreadCache* cache);
+
+  static std::atomic<uint64_t> next_id_;
+  const uint64_t id_;  // tells the allocators apart in the thread caches
+
+  size_t max_cached_size_;
+  size_t thread_cache_size_;
+  std::vector<size_t> class_sizes_;
+  std::vector<size_t> batch_nums_;
+
+  std::shared_ptr<Allocator> system_allocator_;
+  std::shared_ptr<AutoGrowthBestFitAllocator> pool_;
+
+  mutable std::mutex mutex_;
+  std::vector<std::shared_ptr<ThreadCache>> thread_caches_;
+};
+
+}  // namespace allocation
+}  // namespace memory
+}  // namespace paddle
@@ -0,0 +1,152 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/memory/allocation/thread_cached_cpu_allocator.h"
+
+#include <chrono>  // NOLINT
+#include <cstring>
+#include <random>
+#include <thread>  // NOLINT
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+#include "paddle/fluid/memory/allocation/cpu_allocator.h"
+
+namespace paddle {
+namespace memory {
+namespace allocation {
+
+TEST(ThreadCachedCPUAllocator, size_class) {
+  ThreadCachedCPUAllocator allocator(256 << 10);
+  EXPECT_EQ(allocator.RoundedSize(1), 64UL);
+  EXPECT_EQ(allocator.RoundedSize(64), 64UL);
+  EXPECT_EQ(allocator.RoundedSize(65), 128UL);
+  EXPECT_EQ(allocator.RoundedSize(1024), 1024UL);
+  EXPECT_EQ(allocator.RoundedSize(1025), 1280UL);
+  EXPECT_EQ(allocator.RoundedSize(2048), 2048UL);
+  EXPECT_EQ(allocator.RoundedSize(2049), 2560UL);
+  EXPECT_EQ(allocator.RoundedSize(256 << 10), 256UL << 10);
+  // not cached
+  EXPECT_EQ(allocator.RoundedSize((256 << 10) + 1), (256UL << 10) + 1);
+
+  for (size_t size : {1, 100, 1000, 3000, 100000, 300000}) {
+    auto allocation = allocator.Allocate(size);
+    ASSERT_NE(allocation->ptr(), nullptr);
+    EXPECT_EQ(allocation->size(), allocator.RoundedSize(size));
+    EXPECT_TRUE(platform::is_cpu_place(allocation->place()));
+    memset(allocation->ptr(), 0xff, size);
+  }
+}
+
+TEST(ThreadCachedCPUAllocator, reuse_in_thread) {
+  ThreadCachedCPUAllocator allocator;
+  void* ptr = nullptr;
+  {
+    auto allocation = allocator.Allocate(500);
+    ptr = allocation->ptr();
+  }
+  // the block freed last is handed out first
+  auto allocation = allocator.Allocate(450);
+  EXPECT_EQ(allocation->ptr(), ptr);
+  EXPECT_EQ(allocator.ThreadCacheNum(), 1UL);
+}
+
+TEST(ThreadCachedCPUAllocator, cross_thread_free) {
+  ThreadCachedCPUAllocator allocator;
+  const size_t thread_num = 4;
+  const size_t alloc_num = 1000;
+  std::vector<std::vector<AllocationPtr>> allocations(thread_num);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < thread_num; ++i) {
+    threads.emplace_back([&, i] {
+      for (size_t j = 0; j < alloc_num; ++j) {
+        allocations[i].emplace_back(allocator.Allocate(64 * (j % 32 + 1)));
+        *static_cast<size_t*>(allocations[i].back()->ptr()) = i;
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  // the caches of the exited threads are returned to the pool
+  EXPECT_EQ(allocator.ThreadCacheNum(), 0UL);
+
+  threads.clear();
+  for (size_t i = 0; i < thread_num; ++i) {
+    threads.emplace_back([&, i] {
+      auto& others = allocations[(i + 1) % thread_num];
+      for (auto& allocation : others) {
+        EXPECT_EQ(*static_cast<size_t*>(allocation->ptr()),
+                  (i + 1) % thread_num);
+        allocation.reset();
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(allocator.ThreadCacheNum(), 0UL);
+  allocator.Release(platform::CPUPlace());
+}
+
+// Each thread keeps a window of live allocations of random sizes and
+// replaces one of them per step, which mixes allocations and frees of all
+// size classes the way operators of a model do.
+static double StressTest(Allocator* allocator,
+                         size_t thread_num,
+                         size_t step_num) {
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < thread_num; ++i) {
+    threads.emplace_back([=] {
+      constexpr size_t kWindow = 64;
+      std::mt19937 engine(i);
+      std::uniform_int_distribution<size_t> dist(1, 16 << 10);
+      std::vector<AllocationPtr> window(kWindow);
+      for (size_t step = 0; step < step_num; ++step) {
+        size_t size = dist(engine);
+        auto& slot = window[step % kWindow];
+        slot = allocator->Allocate(size);
+        static_cast<uint8_t*>(slot->ptr())[size - 1] = 1;
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+TEST(ThreadCachedCPUAllocator, multi_thread_stress) {
+  const size_t step_num = 100000;
+  size_t max_thread_num =
+      std::max<size_t>(2, std::min(std::thread::hardware_concurrency(), 16U));
+  for (size_t thread_num = 1; thread_num <= max_thread_num; thread_num *= 2) {
+    auto best_fit = std::make_shared<AutoGrowthBestFitAllocator>(
+        std::make_shared<CPUAllocator>(), 64, 1 << 20);
+    ThreadCachedCPUAllocator thread_cached;
+    double best_fit_ms = StressTest(best_fit.get(), thread_num, step_num);
+    double thread_cached_ms = StressTest(&thread_cached, thread_num, step_num);
+    VLOG(3) << thread_num << " threads x " << step_num
+            << " alloc/free: auto_growth " << best_fit_ms
+            << " ms, thread_cached " << thread_cached_ms << " ms";
+    EXPECT_EQ(thread_cached.ThreadCacheNum(), 0UL);
+  }
+}
+
+}  // namespace allocation
+}  // namespace memory
+}  // namespace paddle
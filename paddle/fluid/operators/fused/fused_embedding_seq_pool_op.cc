@@ -48,12 +48,13 @@ class FusedEmbeddingSeqPoolOp : public framework::OperatorWithKernel {
             "The last dimension of the input tensor 'Ids' should be 1. "
             "But received Ids's size in the last dimension = %d.",
             ids_dims[ids_dims.size() - 1]));
-    // we only support sum now
-    PADDLE_ENFORCE_EQ(combiner,
-                      "sum",
-                      platform::errors::Unimplemented(
-                          "The pooling type of sequence_pool only support sum "
-                          "now. So the 'combiner' must be 'sum'."));
+    PADDLE_ENFORCE_EQ(
+        combiner == "sum" || combiner == "mean" || combiner == "sqrt",
+        true,
+        platform::errors::Unimplemented(
+            "The pooling type of sequence_pool only support sum, mean and "
+            "sqrt. But received combiner = %s.",
+            combiner));
 
     int64_t last_dim = FusedEmbeddingSeqPoolLastDim(table_dims, ids_dims);
     // in compile time, the lod level of ids must be 1
@@ -92,9 +93,11 @@ class FusedEmbeddingSeqPoolOpMaker : public framework::OpProtoAndCheckerMaker {
     AddOutput("Out", "The lookup results, which have the same type as W.");
     AddAttr<std::string>("combiner",
                          "(string, default sum) "
-                         "A string specifying the reduction op. Currently sum "
-                         "are supported, sum computes the weighted sum of the "
-                         "embedding results for each row.")
+                         "A string specifying the reduction op. Currently sum, "
+                         "mean and sqrt are supported, sum computes the sum of "
+                         "the embedding results for each row, mean divides it "
+                         "by the number of ids, and sqrt by the square root "
+                         "of it. The ids of padding_idx are not counted.")
         .SetDefault("sum");
     AddAttr<int64_t>("padding_idx",
                      "(int64, default -1) "
@@ -121,8 +124,9 @@ FusedEmbeddingSeqPool Operator.
 Computes embeddings for the given ids and weights.
 
 This operator is used to perform lookups on the parameter W,
-then computes the weighted sum of the lookups results for each row
-and concatenated into a dense tensor.
+then pools the lookups results of each sequence by the combiner
+and concatenated into a dense tensor. The rows are pooled as they
+are looked up, by the threads over the sequences.
 
 The input Ids should carry the LoD (Level of Details) information.
 And the output will change the LoD information with input Ids.
@@ -200,10 +204,3 @@ REGISTER_OPERATOR(
 REGISTER_OPERATOR(fused_embedding_seq_pool_grad,
                   ops::FusedEmbeddingSeqPoolOpGrad,
                   ops::FusedEmbeddingSeqPoolOpGradVarTypeInference);
-
-REGISTER_OP_CPU_KERNEL(fused_embedding_seq_pool,
-                       ops::FusedEmbeddingSeqPoolKernel<float>,
-                       ops::FusedEmbeddingSeqPoolKernel<double>);
-REGISTER_OP_CPU_KERNEL(fused_embedding_seq_pool_grad,
-                       ops::FusedEmbeddingSeqPoolGradKernel<float>,
-                       ops::FusedEmbeddingSeqPoolGradKernel<double>);
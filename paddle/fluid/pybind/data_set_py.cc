@@ -380,6 +380,9 @@ void BindDataset(py::module *m) {
            py::call_guard<py::gil_scoped_release>())
       .def("dump_walk_path",
            &framework::Dataset::DumpWalkPath,
+           py::call_guard<py::gil_scoped_release>())
+      .def("dump_samples",
+           &framework::Dataset::DumpSamples,
            py::call_guard<py::gil_scoped_release>());
 
   py::class_<IterableDatasetWrapper>(*m, "IterableDatasetWrapper")
@@ -70,6 +70,7 @@ limitations under the License. */
 #include "paddle/fluid/framework/version.h"
 #include "paddle/fluid/imperative/amp_auto_cast.h"
 #include "paddle/fluid/imperative/layer.h"
+#include "paddle/fluid/memory/allocation/allocation_tracer.h"
 #include "paddle/fluid/memory/allocation/allocator_strategy.h"
 #include "paddle/fluid/platform/bfloat16.h"
 #include "paddle/fluid/platform/float16.h"
@@ -2070,6 +2071,16 @@ All parameter, weight, gradient are variables in Paddle.
   m.def("device_memory_stat_current_value",
         memory::DeviceMemoryStatCurrentValue);
   m.def("device_memory_stat_peak_value", memory::DeviceMemoryStatPeakValue);
+  m.def(
+      "dump_allocation_trace",
+      [](const std::string &path, size_t top_tag_num) {
+        if (!path.empty()) {
+          memory::allocation::DumpAllocationTrace(path, top_tag_num);
+        }
+        return memory::allocation::DumpAllocationTrace(top_tag_num);
+      },
+      py::arg("path") = "",
+      py::arg("top_tag_num") = 20);
   m.def(
       "run_cmd",
       [](const std::string &cmd,
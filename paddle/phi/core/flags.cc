@@ -376,6 +376,21 @@ PADDLE_DEFINE_EXPORTED_bool(
     true,
     "gradient sent to the server is the sum of the gradients "
     "calculated by each thread if optimizer is sgd");
+/**
+ * Distributed related FLAG
+ * Name: FLAGS_communicator_adaptive_merge
+ * Since Version: 2.5.0
+ * Value Range: bool, default=false
+ * Example:
+ * Note: If set true, the async communicator merges the gradients of a
+ *       sparse table by radix sort, waits for a number of gradients to
+ *       merge which adapts to the queue and the push latency, and pushes
+ *       a table without waiting for its last push.
+ */
+PADDLE_DEFINE_EXPORTED_bool(
+    communicator_adaptive_merge,
+    false,
+    "merge sparse gradients adaptively and pipeline their pushes");
 /**
  * Distributed related FLAG
  * Name: FLAGS_communicator_send_queue_size
@@ -481,8 +496,8 @@ PADDLE_DEFINE_EXPORTED_double(
  * Allocator related FLAG
  * Name: FLAGS_allocator_strategy
  * Since Version: 1.2
- * Value Range: string, {naive_best_fit, auto_growth, thread_local},
- * default=auto_growth
+ * Value Range: string, {naive_best_fit, auto_growth, thread_local,
+ *              thread_cached}, default=auto_growth
  * Example:
  * Note: For selecting allocator policy of PaddlePaddle.
  */
@@ -500,7 +515,10 @@ PADDLE_DEFINE_EXPORTED_string(
     "size of models may be larger). auto_growth strategy would allocate "
     "GPU memory on demand, which allows users to start several Paddle jobs "
     "on the same GPU card but may lead to more memory fragmentation "
-    "(i.e., maximum batch size of models may be smaller).");
+    "(i.e., maximum batch size of models may be smaller). thread_cached "
+    "serves small CPU allocations from per-thread caches of size classed "
+    "free lists, which avoids the allocator lock of many-threaded CPU "
+    "inference, and allocates on other devices as naive_best_fit does.");
 
 /**
  * Memory related FLAG
@@ -1032,6 +1050,10 @@ DEFINE_bool(enable_slotpool_wait_release,
 DEFINE_bool(enable_slotrecord_reset_shrink,
             false,
             "enable slotrecord obejct reset shrink memory, default false");
+DEFINE_bool(enable_slotrecord_columnar,
+            false,
+            "enable SlotRecordDataset to store slot values in columns and "
+            "assemble batches from them, default false");
 DEFINE_bool(enable_ins_parser_file,
             false,
             "enable parser ins file, default false");
@@ -0,0 +1,96 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/phi/kernels/embedding_bag_grad_kernel.h"
+
+#include <memory>
+
+#include "paddle/phi/backends/cpu/cpu_context.h"
+#include "paddle/phi/core/kernel_registry.h"
+#include "paddle/phi/kernels/funcs/embedding_bag.h"
+
+namespace phi {
+
+template <typename T>
+std::unique_ptr<funcs::EmbeddingBagGrad<T>> MakeEmbeddingBagGrad(
+    const DenseTensor& ids,
+    const DenseTensor& weight,
+    const std::string& combiner,
+    int64_t padding_idx) {
+  funcs::EmbeddingBagLayout layout(ids);
+  auto pool = funcs::GetEmbeddingBagPoolType(combiner);
+  int64_t height = weight.dims()[0];
+  if (ids.dtype() == phi::DataType::INT32) {
+    return std::unique_ptr<funcs::EmbeddingBagGrad<T>>(
+        new funcs::EmbeddingBagGrad<T>(
+            ids.data<int>(), layout, height, padding_idx, pool));
+  } else if (ids.dtype() == phi::DataType::INT64) {
+    return std::unique_ptr<funcs::EmbeddingBagGrad<T>>(
+        new funcs::EmbeddingBagGrad<T>(
+            ids.data<int64_t>(), layout, height, padding_idx, pool));
+  }
+  PADDLE_THROW(phi::errors::Unimplemented(
+      "embedding_bag ids only support int32 and int64"));
+}
+
+template <typename T, typename Context>
+void EmbeddingBagGradKernel(const Context& ctx,
+                            const DenseTensor& ids,
+                            const DenseTensor& weight,
+                            const DenseTensor& out_grad,
+                            const std::string& combiner,
+                            int64_t padding_idx,
+                            DenseTensor* weight_grad) {
+  auto grad = MakeEmbeddingBagGrad<T>(ids, weight, combiner, padding_idx);
+  weight_grad->Resize(weight.dims());
+  T* weight_grad_data = ctx.template Alloc<T>(weight_grad);
+  // the rows of no ids are 0, and the others are written once
+  memset(weight_grad_data, 0, weight_grad->numel() * sizeof(T));
+  grad->Compute(
+      out_grad.data<T>(), weight.dims()[1], true, weight_grad_data);
+}
+
+template <typename T, typename Context>
+void EmbeddingBagSparseGradKernel(const Context& ctx,
+                                  const DenseTensor& ids,
+                                  const DenseTensor& weight,
+                                  const DenseTensor& out_grad,
+                                  const std::string& combiner,
+                                  int64_t padding_idx,
+                                  SelectedRows* weight_grad) {
+  auto grad = MakeEmbeddingBagGrad<T>(ids, weight, combiner, padding_idx);
+  int64_t row_width = weight.dims()[1];
+  weight_grad->set_height(weight.dims()[0]);
+  weight_grad->set_rows(grad->rows());
+  auto* value = weight_grad->mutable_value();
+  value->Resize({static_cast<int64_t>(grad->rows().size()), row_width});
+  T* value_data = ctx.template Alloc<T>(value);
+  grad->Compute(out_grad.data<T>(), row_width, false, value_data);
+}
+
+}  // namespace phi
+
+PD_REGISTER_KERNEL(embedding_bag_grad,
+                   CPU,
+                   ALL_LAYOUT,
+                   phi::EmbeddingBagGradKernel,
+                   float,
+                   double) {}
+
+PD_REGISTER_KERNEL(embedding_bag_sparse_grad,
+                   CPU,
+                   ALL_LAYOUT,
+                   phi::EmbeddingBagSparseGradKernel,
+                   float,
+                   double) {}
@@ -0,0 +1,63 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/phi/kernels/embedding_bag_kernel.h"
+
+#include "paddle/phi/backends/cpu/cpu_context.h"
+#include "paddle/phi/core/kernel_registry.h"
+#include "paddle/phi/kernels/funcs/embedding_bag.h"
+
+namespace phi {
+
+template <typename T, typename Context>
+void EmbeddingBagKernel(const Context& ctx,
+                        const DenseTensor& ids,
+                        const DenseTensor& weight,
+                        const std::string& combiner,
+                        int64_t padding_idx,
+                        DenseTensor* out) {
+  funcs::EmbeddingBagLayout layout(ids);
+  auto pool = funcs::GetEmbeddingBagPoolType(combiner);
+  int64_t height = weight.dims()[0];
+  int64_t row_width = weight.dims()[1];
+  out->Resize({layout.bags(), layout.width * row_width});
+  T* out_data = ctx.template Alloc<T>(out);
+  if (ids.dtype() == phi::DataType::INT32) {
+    funcs::EmbeddingBagCompute(weight.data<T>(),
+                               height,
+                               row_width,
+                               ids.data<int>(),
+                               layout,
+                               padding_idx,
+                               pool,
+                               out_data);
+  } else if (ids.dtype() == phi::DataType::INT64) {
+    funcs::EmbeddingBagCompute(weight.data<T>(),
+                               height,
+                               row_width,
+                               ids.data<int64_t>(),
+                               layout,
+                               padding_idx,
+                               pool,
+                               out_data);
+  } else {
+    PADDLE_THROW(phi::errors::Unimplemented(
+        "embedding_bag ids only support int32 and int64"));
+  }
+}
+
+}  // namespace phi
+
+PD_REGISTER_KERNEL(
+    embedding_bag, CPU, ALL_LAYOUT, phi::EmbeddingBagKernel, float, double) {}
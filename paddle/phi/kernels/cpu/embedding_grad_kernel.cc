@@ -18,6 +18,7 @@
 #include "paddle/phi/common/data_type.h"
 #include "paddle/phi/core/kernel_registry.h"
 #include "paddle/phi/kernels/funcs/embedding_util.h"
+#include "paddle/phi/kernels/funcs/radix_sort.h"
 
 namespace phi {
 
@@ -146,31 +147,52 @@ struct EmbeddingSparseGradCPUFunctor {
     // paddings makes no sense and we don't deal with it in backward.
     auto* d_table = weight_grad_;
     auto* d_output = &out_grad_;
-    d_table->set_rows(ids);
-
-    auto* d_table_value = d_table->mutable_value();
-    d_table_value->Resize({ids_num, table_dim[1]});
-
-    dev_ctx_.template Alloc<T>(d_table_value);
-
-    d_table->set_height(table_dim[0]);
-
-    auto* d_output_data = d_output->template data<T>();
-    auto* d_table_data = d_table_value->template data<T>();
 
     auto d_output_dims = d_output->dims();
     auto d_output_dims_2d =
         flatten_to_2d(d_output_dims, d_output_dims.size() - 1);
-    PADDLE_ENFORCE_EQ(d_table_value->dims(),
+    PADDLE_ENFORCE_EQ(phi::make_ddim({ids_num, table_dim[1]}),
                       d_output_dims_2d,
                       phi::errors::InvalidArgument(
                           "ShapeError: The shape of lookup_table@Grad and "
                           "output@Grad should be same. "
                           "But received lookup_table@Grad's shape = [%s], "
                           "output@Grad's shape = [%s].",
-                          d_table_value->dims(),
+                          phi::make_ddim({ids_num, table_dim[1]}),
                           d_output_dims_2d));
-    memcpy(d_table_data, d_output_data, sizeof(T) * d_output->numel());
+
+    // the rows of duplicated ids are added, so the grad holds each id once
+    std::vector<int64_t> rows;
+    std::vector<int64_t> row_ids(ids_num);
+    funcs::RadixSortUnique<int64_t, int64_t>(
+        ids.data(), ids_num, &rows, row_ids.data(), nullptr, nullptr);
+    auto rows_num = static_cast<int64_t>(rows.size());
+
+    auto* d_table_value = d_table->mutable_value();
+    d_table_value->Resize({rows_num, table_dim[1]});
+
+    dev_ctx_.template Alloc<T>(d_table_value);
+
+    d_table->set_height(table_dim[0]);
+
+    auto* d_output_data = d_output->template data<T>();
+    auto* d_table_data = d_table_value->template data<T>();
+
+    if (rows_num == ids_num) {
+      d_table->set_rows(ids);
+      memcpy(d_table_data, d_output_data, sizeof(T) * d_output->numel());
+      return;
+    }
+    d_table->set_rows(rows);
+    int64_t D = table_dim[1];
+    memset(d_table_data, 0, sizeof(T) * rows_num * D);
+    for (int64_t i = 0; i < ids_num; ++i) {
+      T* d_table_row = d_table_data + row_ids[i] * D;
+      const T* d_output_row = d_output_data + i * D;
+      for (int64_t j = 0; j < D; ++j) {
+        d_table_row[j] += d_output_row[j];
+      }
+    }
   }
 
  private:
@@ -16,118 +16,11 @@
 
 #include "paddle/phi/backends/cpu/cpu_context.h"
 #include "paddle/phi/core/kernel_registry.h"
-#include "paddle/phi/kernels/funcs/eigen/common.h"
+#include "paddle/phi/kernels/funcs/cpu_top_k.h"
 #include "paddle/phi/kernels/funcs/math_function.h"
 
 namespace phi {
 
-template <typename T, typename Type>
-static void FullTopK(Type input_height,
-                     Type input_width,
-                     int input_dim,
-                     const DenseTensor* input,
-                     T* t_out,
-                     Type* t_indices,
-                     const int& k,
-                     const bool& largest,
-                     const bool& sorted) {
-  PADDLE_ENFORCE_LE(
-      k,
-      input_width,
-      errors::InvalidArgument("The rank (%d) of the input 'k' for "
-                              "topk op must be less than or equal to %d.",
-                              k,
-                              input_width));
-
-  // when the k is small, will the partial sort
-  bool partial_sort_flag = (k * 64) < input_width;
-
-#ifdef PADDLE_WITH_MKLML
-#pragma omp parallel for
-#endif
-  for (Type i = 0; i < input_height; ++i) {
-    std::vector<std::pair<T, Type>> col_vec;
-    col_vec.reserve(input_width);
-    if (input_dim == 1) {
-      auto e_input = EigenVector<T>::Flatten(*input);
-      for (Type j = 0; j < input_width; ++j) {
-        col_vec.emplace_back(std::pair<T, Type>(e_input(j), j));
-      }
-    } else {
-      auto e_input = EigenMatrix<T>::Reshape(*input, input_dim - 1);
-      for (Type j = 0; j < input_width; ++j) {
-        col_vec.emplace_back(std::pair<T, Type>(e_input(i, j), j));
-      }
-    }
-    if (partial_sort_flag) {
-      std::partial_sort(
-          col_vec.begin(),
-          col_vec.begin() + k,
-          col_vec.end(),
-          [&largest](const std::pair<T, Type>& l, const std::pair<T, Type>& r) {
-            if (largest) {
-              return (std::isnan(static_cast<double>(l.first)) &&
-                      !std::isnan(static_cast<double>(r.first))) ||
-                     (l.first > r.first);
-            } else {
-              return (!std::isnan(static_cast<double>(l.first)) &&
-                      std::isnan(static_cast<double>(r.first))) ||
-                     (l.first < r.first);
-            }
-          });
-    } else {
-      // use the nth-element to get the K-larger or K-small element
-      if (largest) {
-        std::nth_element(
-            col_vec.begin(),
-            col_vec.begin() + k - 1,
-            col_vec.end(),
-            [](const std::pair<T, Type>& l, const std::pair<T, Type>& r) {
-              return (std::isnan(static_cast<double>(l.first)) &&
-                      !std::isnan(static_cast<double>(r.first))) ||
-                     (l.first > r.first);
-            });
-        // the nth-element will get the unorder elements, sort the element
-        if (sorted) {
-          std::sort(col_vec.begin(),
-                    col_vec.begin() + k - 1,
-                    [&largest](const std::pair<T, Type>& l,
-                               const std::pair<T, Type>& r) {
-                      return (std::isnan(static_cast<double>(l.first)) &&
-                              !std::isnan(static_cast<double>(r.first))) ||
-                             (l.first > r.first);
-                    });
-        }
-      } else {
-        std::nth_element(
-            col_vec.begin(),
-            col_vec.begin() + k - 1,
-            col_vec.end(),
-            [](const std::pair<T, Type>& l, const std::pair<T, Type>& r) {
-              return (!std::isnan(static_cast<double>(l.first)) &&
-                      std::isnan(static_cast<double>(r.first))) ||
-                     (l.first < r.first);
-            });
-        // the nth-element will get the unorder elements, sort the element
-        if (sorted) {
-          std::sort(
-              col_vec.begin(),
-              col_vec.begin() + k - 1,
-              [](const std::pair<T, Type>& l, const std::pair<T, Type>& r) {
-                return (!std::isnan(static_cast<double>(l.first)) &&
-                        std::isnan(static_cast<double>(r.first))) ||
-                       (l.first < r.first);
-              });
-        }
-      }
-    }
-    for (Type j = 0; j < k; ++j) {
-      t_out[i * k + j] = col_vec[j].first;
-      t_indices[i * k + j] = col_vec[j].second;
-    }
-  }
-}
-
 template <typename T, typename Context>
 void TopkKernel(const Context& dev_ctx,
                 const DenseTensor& x,
@@ -161,6 +54,14 @@ void TopkKernel(const Context& dev_ctx,
     indices->Resize(out_dims);
   }
 
+  PADDLE_ENFORCE_LE(
+      k,
+      in_dims[axis],
+      errors::InvalidArgument("The rank (%d) of the input 'k' for "
+                              "topk op must be less than or equal to %d.",
+                              k,
+                              in_dims[axis]));
+
   T* out_data = dev_ctx.template Alloc<T>(out);
   int64_t* indices_data = dev_ctx.template Alloc<int64_t>(indices);
   const auto& out_dims = out->dims();
@@ -168,15 +69,14 @@ void TopkKernel(const Context& dev_ctx,
     const int64_t& input_height =
         phi::product(phi::slice_ddim(in_dims, 0, in_dims.size() - 1));
     const int64_t& input_width = in_dims[in_dims.size() - 1];
-    FullTopK<T, int64_t>(input_height,
-                         input_width,
-                         in_dims.size(),
-                         input,
-                         out_data,
-                         indices_data,
-                         k,
-                         largest,
-                         sorted);
+    funcs::TopKCompute(input->data<T>(),
+                       input_height,
+                       input_width,
+                       static_cast<int64_t>(k),
+                       largest,
+                       sorted,
+                       out_data,
+                       indices_data);
   } else {
     // if the topk dims is not last dim, will tranpose and do topk
     std::vector<int> trans;
@@ -221,15 +121,14 @@ void TopkKernel(const Context& dev_ctx,
     auto* t_ind = dev_ctx.template Alloc<int64_t>(&tmp_indices);
 
     // get the TopK value
-    FullTopK<T, int64_t>(input_height,
-                         input_width,
-                         in_dims.size(),
-                         &trans_inp,
-                         t_out,
-                         t_ind,
-                         k,
-                         largest,
-                         sorted);
+    funcs::TopKCompute(trans_inp.data<T>(),
+                       input_height,
+                       input_width,
+                       static_cast<int64_t>(k),
+                       largest,
+                       sorted,
+                       t_out,
+                       t_ind);
     // transpose back
     funcs::TransCompute<phi::CPUContext, int64_t>(
         ndims, dev_ctx, tmp_indices, indices, trans);
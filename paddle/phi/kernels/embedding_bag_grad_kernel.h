@@ -0,0 +1,43 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <string>
+
+#include "paddle/phi/core/dense_tensor.h"
+#include "paddle/phi/core/selected_rows.h"
+
+namespace phi {
+
+template <typename T, typename Context>
+void EmbeddingBagGradKernel(const Context& ctx,
+                            const DenseTensor& ids,
+                            const DenseTensor& weight,
+                            const DenseTensor& out_grad,
+                            const std::string& combiner,
+                            int64_t padding_idx,
+                            DenseTensor* weight_grad);
+
+// The grad of each looked up id once, sorted by the ids.
+template <typename T, typename Context>
+void EmbeddingBagSparseGradKernel(const Context& ctx,
+                                  const DenseTensor& ids,
+                                  const DenseTensor& weight,
+                                  const DenseTensor& out_grad,
+                                  const std::string& combiner,
+                                  int64_t padding_idx,
+                                  SelectedRows* weight_grad);
+
+}  // namespace phi
@@ -0,0 +1,35 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <string>
+
+#include "paddle/phi/core/dense_tensor.h"
+
+namespace phi {
+
+// Looks up the rows of ids in weight and pools those of each bag by
+// combiner, one of sum, mean and sqrt. The bags are the sequences of the LoD
+// of ids, or else the rows of ids of [bags, length]. The ids of padding_idx
+// are skipped, and not counted by mean and sqrt.
+template <typename T, typename Context>
+void EmbeddingBagKernel(const Context& ctx,
+                        const DenseTensor& ids,
+                        const DenseTensor& weight,
+                        const std::string& combiner,
+                        int64_t padding_idx,
+                        DenseTensor* out);
+
+}  // namespace phi
@@ -0,0 +1,443 @@
+/* Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#ifdef PADDLE_WITH_MKLML
+#include <omp.h>
+#endif
+
+#include <algorithm>
+#include <vector>
+
+#include "paddle/phi/backends/cpu/cpu_context.h"
+#include "paddle/phi/core/dense_tensor.h"
+#include "paddle/phi/kernels/funcs/common_shape.h"
+#include "paddle/phi/kernels/funcs/dims_simplifier.h"
+
+namespace phi {
+namespace funcs {
+
+// The broadcast of binary elementwise ops and their grads on CPU.
+//
+// The dims of the inputs are collapsed by BroadcastDimsSimplifier, so the
+// output is walked as rows of its innermost dim. In a row an input is
+// either contiguous or a single broadcast value, which are plain loops the
+// compiler vectorizes for the inlined functors. The rows are split into
+// ranges of the output run on the OpenMP threads.
+
+// the least output elements of a thread
+constexpr int64_t kCPUBroadcastMinNumelPerTask = 32768;
+// the elements of a grad computed at a time
+constexpr int64_t kCPUBroadcastGradBlockSize = 256;
+
+// The strides of two inputs broadcast to an output, innermost dim first.
+// A stride of 0 broadcasts the dim, the dims of 1 in the output keep theirs
+// so an inner dim of 1 is still a contiguous run.
+struct CPUBroadcastLayout {
+  // axis is that of the input of the lower rank, as in the elementwise ops
+  CPUBroadcastLayout(const DDim &x_dims, const DDim &y_dims, int axis) {
+    int max_dim = std::max(x_dims.size(), y_dims.size());
+    if (x_dims.size() == y_dims.size()) {
+      axis = 0;
+    }
+    std::vector<int> x_dims_array(max_dim);
+    std::vector<int> y_dims_array(max_dim);
+    std::vector<int> out_dims_array(max_dim);
+    GetBroadcastDimsArrays(x_dims,
+                           y_dims,
+                           x_dims_array.data(),
+                           y_dims_array.data(),
+                           out_dims_array.data(),
+                           max_dim,
+                           axis);
+    numel = 1;
+    for (int i = 0; i < max_dim; ++i) {
+      // a dim of 0 is -1 in the output
+      numel *= std::max(out_dims_array[i], 0);
+    }
+    if (numel == 0) {
+      rank = 0;
+      return;
+    }
+    BroadcastDimsSimplifier simplifier({phi::make_ddim(x_dims_array),
+                                        phi::make_ddim(y_dims_array)},
+                                       phi::make_ddim(out_dims_array),
+                                       0);
+    rank = std::max(simplifier.rank, 1);
+    dims.assign(rank, 1);
+    std::copy(simplifier.out_dims.begin(),
+              simplifier.out_dims.begin() + simplifier.rank,
+              dims.begin());
+    for (int j = 0; j < 2; ++j) {
+      strides[j].assign(rank, 1);
+      int64_t stride = 1;
+      for (int i = 0; i < simplifier.rank; ++i) {
+        int64_t dim = simplifier.in_dims[j][i];
+        strides[j][i] = dim == 1 && dims[i] != 1 ? 0 : stride;
+        stride *= dim;
+      }
+    }
+  }
+
+  int64_t inner() const { return dims[0]; }
+
+  int64_t numel;
+  int rank;
+  std::vector<int64_t> dims;
+  std::vector<int64_t> strides[2];
+};
+
+// The input offsets of the rows of the output, from a row on.
+class CPUBroadcastRowIterator {
+ public:
+  CPUBroadcastRowIterator(const CPUBroadcastLayout &layout, int64_t row)
+      : layout_(layout), index_(layout.rank, 0) {
+    for (int i = 1; i < layout.rank; ++i) {
+      index_[i] = row % layout.dims[i];
+      row /= layout.dims[i];
+      offset_[0] += index_[i] * layout.strides[0][i];
+      offset_[1] += index_[i] * layout.strides[1][i];
+    }
+  }
+
+  int64_t offset(int j) const { return offset_[j]; }
+
+  void Next() {
+    for (int i = 1; i < layout_.rank; ++i) {
+      offset_[0] += layout_.strides[0][i];
+      offset_[1] += layout_.strides[1][i];
+      if (++index_[i] < layout_.dims[i]) {
+        return;
+      }
+      offset_[0] -= index_[i] * layout_.strides[0][i];
+      offset_[1] -= index_[i] * layout_.strides[1][i];
+      index_[i] = 0;
+    }
+  }
+
+ private:
+  const CPUBroadcastLayout &layout_;
+  std::vector<int64_t> index_;
+  int64_t offset_[2] = {0, 0};
+};
+
+inline int CPUBroadcastTaskNum(int64_t numel) {
+#ifdef PADDLE_WITH_MKLML
+  return static_cast<int>(
+      std::max<int64_t>(std::min<int64_t>(omp_get_max_threads(),
+                                          numel / kCPUBroadcastMinNumelPerTask),
+                        1));
+#else
+  return 1;
+#endif
+}
+
+// Runs fn(task, begin, end) over task_num ranges of [0, numel).
+template <typename Fn>
+void CPUBroadcastParallelFor(int64_t numel, int task_num, Fn fn) {
+  if (task_num <= 1) {
+    fn(0, 0, numel);
+    return;
+  }
+  int64_t step = (numel + task_num - 1) / task_num;
+#ifdef PADDLE_WITH_MKLML
+#pragma omp parallel for num_threads(task_num)
+#endif
+  for (int task = 0; task < task_num; ++task) {
+    int64_t begin = std::min(task * step, numel);
+    fn(task, begin, std::min(begin + step, numel));
+  }
+}
+
+// Runs fn(row iterator, col, n, pos) on the parts of the rows of the output
+// in [begin, end), n elements of the row from col, at pos of the output.
+template <typename Fn>
+void CPUBroadcastForRows(const CPUBroadcastLayout &layout,
+                         int64_t begin,
+                         int64_t end,
+                         Fn fn) {
+  if (begin >= end) {
+    return;
+  }
+  int64_t inner = layout.inner();
+  CPUBroadcastRowIterator row(layout, begin / inner);
+  int64_t col = begin % inner;
+  for (int64_t pos = begin; pos < end;) {
+    int64_t n = std::min(inner - col, end - pos);
+    fn(row, col, n, pos);
+    pos += n;
+    col = 0;
+    row.Next();
+  }
+}
+
+template <bool XContiguous,
+          bool YContiguous,
+          typename Functor,
+          typename T,
+          typename OutType>
+inline void CPUBroadcastRun(
+    const T *x, const T *y, OutType *out, int64_t n, Functor func) {
+  for (int64_t i = 0; i < n; ++i) {
+    out[i] = func(x[XContiguous ? i : 0], y[YContiguous ? i : 0]);
+  }
+}
+
+// out = func(x, y) with x and y broadcast to each other.
+template <typename Functor, typename T, typename OutType = T>
+void CPUBroadcastCompute(const CPUContext &ctx,
+                         const DenseTensor &x,
+                         const DenseTensor &y,
+                         int axis,
+                         Functor func,
+                         DenseTensor *out) {
+  const T *x_data = x.data<T>();
+  const T *y_data = y.data<T>();
+  OutType *out_data = ctx.Alloc<OutType>(out);
+  CPUBroadcastLayout layout(x.dims(), y.dims(), axis);
+  int64_t numel = layout.numel;
+  if (numel == 0) {
+    return;
+  }
+  bool x_contiguous = layout.strides[0][0] != 0;
+  bool y_contiguous = layout.strides[1][0] != 0;
+  CPUBroadcastParallelFor(
+      numel,
+      CPUBroadcastTaskNum(numel),
+      [&](int task, int64_t begin, int64_t end) {
+        CPUBroadcastForRows(
+            layout,
+            begin,
+            end,
+            [&](const CPUBroadcastRowIterator &row,
+                int64_t col,
+                int64_t n,
+                int64_t pos) {
+              const T *x_row =
+                  x_data + row.offset(0) + (x_contiguous ? col : 0);
+              const T *y_row =
+                  y_data + row.offset(1) + (y_contiguous ? col : 0);
+              OutType *out_row = out_data + pos;
+              if (x_contiguous && y_contiguous) {
+                CPUBroadcastRun<true, true>(x_row, y_row, out_row, n, func);
+              } else if (x_contiguous) {
+                CPUBroadcastRun<true, false>(x_row, y_row, out_row, n, func);
+              } else if (y_contiguous) {
+                CPUBroadcastRun<false, true>(x_row, y_row, out_row, n, func);
+              } else {
+                CPUBroadcastRun<false, false>(x_row, y_row, out_row, n, func);
+              }
+            });
+      });
+}
+
+template <bool XContiguous,
+          bool YContiguous,
+          typename OP,
+          typename T,
+          typename Tout>
+inline void CPUBroadcastGradRun(const T *x,
+                                const T *y,
+                                const Tout *out,
+                                const Tout *dout,
+                                T *grad,
+                                int64_t n,
+                                OP op) {
+  for (int64_t i = 0; i < n; ++i) {
+    grad[i] =
+        op(x[XContiguous ? i : 0], y[YContiguous ? i : 0], out[i], dout[i]);
+  }
+}
+
+// The grads of a run of the output, taken in blocks which are all computed
+// before any is stored, since a grad which is not reduced may share dout.
+template <typename T, typename DX_OP, typename DY_OP, typename Tout>
+struct CPUBroadcastGradRows {
+  const CPUBroadcastLayout &layout;
+  const T *x;
+  const T *y;
+  const Tout *out;
+  const Tout *dout;
+  // the grads of the task, or nullptr
+  T *grads[2];
+  bool reduce[2];
+  DX_OP dx_op;
+  DY_OP dy_op;
+
+  template <typename OP>
+  void Compute(const T *x_run,
+               const T *y_run,
+               const Tout *out_run,
+               const Tout *dout_run,
+               T *grad,
+               int64_t n,
+               OP op) const {
+    bool x_contiguous = layout.strides[0][0] != 0;
+    bool y_contiguous = layout.strides[1][0] != 0;
+    if (x_contiguous && y_contiguous) {
+      CPUBroadcastGradRun<true, true>(
+          x_run, y_run, out_run, dout_run, grad, n, op);
+    } else if (x_contiguous) {
+      CPUBroadcastGradRun<true, false>(
+          x_run, y_run, out_run, dout_run, grad, n, op);
+    } else if (y_contiguous) {
+      CPUBroadcastGradRun<false, true>(
+          x_run, y_run, out_run, dout_run, grad, n, op);
+    } else {
+      CPUBroadcastGradRun<false, false>(
+          x_run, y_run, out_run, dout_run, grad, n, op);
+    }
+  }
+
+  void Store(int j, const T *block, T *grad, int64_t n) const {
+    if (layout.strides[j][0] == 0) {
+      T sum = 0;
+      for (int64_t i = 0; i < n; ++i) {
+        sum += block[i];
+      }
+      grad[0] += sum;
+    } else if (reduce[j]) {
+      for (int64_t i = 0; i < n; ++i) {
+        grad[i] += block[i];
+      }
+    } else {
+      std::copy(block, block + n, grad);
+    }
+  }
+
+  void operator()(const CPUBroadcastRowIterator &row,
+                  int64_t col,
+                  int64_t n,
+                  int64_t pos) const {
+    int64_t offsets[2];
+    for (int j = 0; j < 2; ++j) {
+      offsets[j] = row.offset(j) + (layout.strides[j][0] != 0 ? col : 0);
+    }
+    T blocks[2][kCPUBroadcastGradBlockSize];
+    for (int64_t i = 0; i < n; i += kCPUBroadcastGradBlockSize) {
+      int64_t size = std::min(kCPUBroadcastGradBlockSize, n - i);
+      bool x_contiguous = layout.strides[0][0] != 0;
+      bool y_contiguous = layout.strides[1][0] != 0;
+      const T *x_run = x + offsets[0] + (x_contiguous ? i : 0);
+      const T *y_run = y + offsets[1] + (y_contiguous ? i : 0);
+      const Tout *out_run = out + pos + i;
+      const Tout *dout_run = dout + pos + i;
+      if (grads[0] != nullptr) {
+        Compute(x_run, y_run, out_run, dout_run, blocks[0], size, dx_op);
+      }
+      if (grads[1] != nullptr) {
+        Compute(x_run, y_run, out_run, dout_run, blocks[1], size, dy_op);
+      }
+      if (grads[0] != nullptr) {
+        Store(0, blocks[0], grads[0] + (x_run - x), size);
+      }
+      if (grads[1] != nullptr) {
+        Store(1, blocks[1], grads[1] + (y_run - y), size);
+      }
+    }
+  }
+};
+
+// dx = dx_op(x, y, out, dout) and dy = dy_op(x, y, out, dout), summed over
+// the broadcast dims of x and y. x and y may be stand-ins of other shapes,
+// e.g. dout for the explicit grads, so their dims are given.
+template <typename T, typename DX_OP, typename DY_OP, typename Tout = T>
+void CPUBroadcastGradCompute(const CPUContext &ctx,
+                             const DDim &x_dims,
+                             const DDim &y_dims,
+                             const DenseTensor &x,
+                             const DenseTensor &y,
+                             const DenseTensor &out,
+                             const DenseTensor &dout,
+                             int axis,
+                             DenseTensor *dx,
+                             DenseTensor *dy,
+                             DX_OP dx_op,
+                             DY_OP dy_op) {
+  CPUBroadcastLayout layout(x_dims, y_dims, axis);
+  int64_t numel = layout.numel;
+  DenseTensor *grads[2] = {dx, dy};
+  const DDim *grad_dims[2] = {&x_dims, &y_dims};
+  T *grad_data[2] = {nullptr, nullptr};
+  bool reduce[2] = {false, false};
+  int64_t grad_numel[2] = {0, 0};
+  int task_num = CPUBroadcastTaskNum(numel);
+  for (int j = 0; j < 2; ++j) {
+    if (grads[j] == nullptr) {
+      continue;
+    }
+    grad_numel[j] = phi::product(*grad_dims[j]);
+    reduce[j] = grad_numel[j] != numel;
+    // for inplace strategy, a reduced grad must not share dout
+    if (reduce[j] && grads[j]->IsSharedBufferWith(dout)) {
+      grads[j]->clear();
+      grads[j]->Resize(*grad_dims[j]);
+    }
+    grad_data[j] = ctx.Alloc<T>(grads[j]);
+    if (reduce[j]) {
+      std::fill(grad_data[j], grad_data[j] + grad_numel[j], static_cast<T>(0));
+      // the partial sums of the tasks take at most the size of dout
+      task_num = static_cast<int>(std::max<int64_t>(
+          std::min<int64_t>(task_num, numel / std::max<int64_t>(
+                                                  grad_numel[j], 1)),
+          1));
+    }
+  }
+  if (numel == 0) {
+    return;
+  }
+
+  // the partial sums of the reduced grads by task, the first task sums into
+  // the grad itself
+  std::vector<T> partials[2];
+  for (int j = 0; j < 2; ++j) {
+    if (reduce[j]) {
+      partials[j].assign((task_num - 1) * grad_numel[j], static_cast<T>(0));
+    }
+  }
+  CPUBroadcastParallelFor(
+      numel, task_num, [&](int task, int64_t begin, int64_t end) {
+        CPUBroadcastGradRows<T, DX_OP, DY_OP, Tout> rows{layout,
+                                                        x.data<T>(),
+                                                        y.data<T>(),
+                                                        out.data<Tout>(),
+                                                        dout.data<Tout>(),
+                                                        {nullptr, nullptr},
+                                                        {reduce[0], reduce[1]},
+                                                        dx_op,
+                                                        dy_op};
+        for (int j = 0; j < 2; ++j) {
+          if (grad_data[j] != nullptr) {
+            rows.grads[j] =
+                task == 0 || !reduce[j]
+                    ? grad_data[j]
+                    : partials[j].data() + (task - 1) * grad_numel[j];
+          }
+        }
+        CPUBroadcastForRows(layout, begin, end, rows);
+      });
+
+  for (int j = 0; j < 2; ++j) {
+    for (int task = 1; task < task_num && reduce[j]; ++task) {
+      const T *partial = partials[j].data() + (task - 1) * grad_numel[j];
+      for (int64_t i = 0; i < grad_numel[j]; ++i) {
+        grad_data[j][i] += partial[i];
+      }
+    }
+  }
+}
+
+}  // namespace funcs
+}  // namespace phi
@@ -0,0 +1,477 @@
+/* Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "paddle/phi/backends/cpu/cpu_context.h"
+#include "paddle/phi/common/amp_type_traits.h"
+#include "paddle/phi/core/dense_tensor.h"
+#include "paddle/phi/kernels/funcs/cpu_broadcast_function.h"
+#include "paddle/phi/kernels/funcs/reduce_functor.h"
+
+namespace phi {
+namespace funcs {
+
+// The reduce kernels on CPU without Eigen.
+//
+// The dims of the input are merged into groups of reduced and kept dims, and
+// each group of reduced dims is a pass over (outer, reduce, inner), from the
+// innermost one. A pass reduces either a contiguous row (inner == 1) or the
+// rows of columns, with independent accumulators the compiler vectorizes,
+// and sums pairwise over blocks for accuracy. The outputs are split over the
+// OpenMP threads, or the reduced dim when there are too few outputs.
+
+// the elements of a row, or rows of columns, accumulated in order
+constexpr int64_t kCPUReduceBlockSize = 128;
+// the accumulators of a row
+constexpr int kCPUReduceLanes = 8;
+// the columns taken at a time
+constexpr int64_t kCPUReduceColumnTile = 512;
+
+// The native reducer of a Functor of reduce_functor.h, Functors without one
+// keep the Eigen kernels, as do the sums of bools, which saturate there. The
+// accumulators are not bool, as std::vector<bool> packs them.
+template <typename Functor, typename T>
+struct CPUReducer {
+  static constexpr bool kNative = false;
+};
+
+template <typename T>
+struct CPUReducer<SumFunctor, T> {
+  static constexpr bool kNative = !std::is_same<T, bool>::value;
+  using AccT = typename phi::dtype::MPTypeTrait<T>::Type;
+  static AccT Init() { return static_cast<AccT>(0); }
+  static AccT Reduce(AccT a, AccT b) { return a + b; }
+  static T Finalize(AccT acc, int64_t n) { return static_cast<T>(acc); }
+};
+
+template <typename T>
+struct CPUReducer<MeanFunctor, T> : public CPUReducer<SumFunctor, T> {
+  using AccT = typename phi::dtype::MPTypeTrait<T>::Type;
+  static T Finalize(AccT acc, int64_t n) {
+    if (n == 0) {
+      return std::numeric_limits<AccT>::has_quiet_NaN
+                 ? static_cast<T>(std::numeric_limits<AccT>::quiet_NaN())
+                 : static_cast<T>(0);
+    }
+    return static_cast<T>(acc / static_cast<AccT>(n));
+  }
+};
+
+template <typename T>
+struct CPUReducer<ProdFunctor, T> {
+  static constexpr bool kNative = !std::is_same<T, bool>::value;
+  using AccT = typename phi::dtype::MPTypeTrait<T>::Type;
+  static AccT Init() { return static_cast<AccT>(1); }
+  static AccT Reduce(AccT a, AccT b) { return a * b; }
+  static T Finalize(AccT acc, int64_t n) { return static_cast<T>(acc); }
+};
+
+template <typename T>
+struct CPUReducer<MaxFunctor, T> {
+  static constexpr bool kNative = !std::is_same<T, bool>::value;
+  using AccT = typename phi::dtype::MPTypeTrait<T>::Type;
+  static AccT Init() { return std::numeric_limits<AccT>::lowest(); }
+  static AccT Reduce(AccT a, AccT b) { return a > b ? a : b; }
+  static T Finalize(AccT acc, int64_t n) { return static_cast<T>(acc); }
+};
+
+template <typename T>
+struct CPUReducer<MinFunctor, T> {
+  static constexpr bool kNative = !std::is_same<T, bool>::value;
+  using AccT = typename phi::dtype::MPTypeTrait<T>::Type;
+  static AccT Init() { return (std::numeric_limits<AccT>::max)(); }
+  static AccT Reduce(AccT a, AccT b) { return a < b ? a : b; }
+  static T Finalize(AccT acc, int64_t n) { return static_cast<T>(acc); }
+};
+
+template <typename T>
+struct CPUReducer<AllFunctor, T> {
+  static constexpr bool kNative = true;
+  using AccT = uint8_t;
+  static AccT Init() { return true; }
+  static AccT Reduce(AccT a, AccT b) { return a && b; }
+  static T Finalize(AccT acc, int64_t n) { return static_cast<T>(acc); }
+};
+
+template <typename T>
+struct CPUReducer<AnyFunctor, T> {
+  static constexpr bool kNative = true;
+  using AccT = uint8_t;
+  static AccT Init() { return false; }
+  static AccT Reduce(AccT a, AccT b) { return a || b; }
+  static T Finalize(AccT acc, int64_t n) { return static_cast<T>(acc); }
+};
+
+// The dims of a reduce, merged into groups of reduced and kept dims.
+struct CPUReduceDims {
+  CPUReduceDims(const DDim &x_dims,
+                const std::vector<int64_t> &dims,
+                bool reduce_all) {
+    int rank = x_dims.size();
+    std::vector<bool> is_reduced(rank, reduce_all);
+    for (auto dim : dims) {
+      is_reduced[dim < 0 ? dim + rank : dim] = true;
+    }
+    for (int i = 0; i < rank; ++i) {
+      // a dim of 1 joins any group
+      if (x_dims[i] == 1) {
+        continue;
+      }
+      if (!sizes.empty() && reduced.back() == is_reduced[i]) {
+        sizes.back() *= x_dims[i];
+      } else {
+        sizes.push_back(x_dims[i]);
+        reduced.push_back(is_reduced[i]);
+      }
+    }
+    reduce_numel = 1;
+    for (size_t i = 0; i < sizes.size(); ++i) {
+      reduce_numel *= reduced[i] ? sizes[i] : 1;
+    }
+  }
+
+  // the (outer, reduce, inner) of the innermost reduced group, which is
+  // removed, or false if there is none
+  bool NextPass(int64_t *outer, int64_t *reduce, int64_t *inner) {
+    int k = static_cast<int>(sizes.size()) - 1;
+    while (k >= 0 && !reduced[k]) {
+      --k;
+    }
+    if (k < 0) {
+      return false;
+    }
+    *outer = 1;
+    *inner = 1;
+    for (int i = 0; i < k; ++i) {
+      *outer *= sizes[i];
+    }
+    for (size_t i = k + 1; i < sizes.size(); ++i) {
+      *inner *= sizes[i];
+    }
+    *reduce = sizes[k];
+    sizes.erase(sizes.begin() + k);
+    reduced.erase(reduced.begin() + k);
+    // the kept groups around it are one now
+    if (k > 0 && k < static_cast<int>(sizes.size())) {
+      sizes[k - 1] *= sizes[k];
+      sizes.erase(sizes.begin() + k);
+      reduced.erase(reduced.begin() + k);
+    }
+    return true;
+  }
+
+  std::vector<int64_t> sizes;
+  std::vector<bool> reduced;
+  int64_t reduce_numel;
+};
+
+// Reduces a contiguous row, pairwise over blocks.
+template <typename Reducer, typename InT, typename AccT>
+AccT CPUReduceRow(const InT *x, int64_t n) {
+  if (n > kCPUReduceBlockSize) {
+    int64_t half = n / 2;
+    half -= half % kCPUReduceLanes;
+    AccT low = CPUReduceRow<Reducer, InT, AccT>(x, half);
+    AccT high = CPUReduceRow<Reducer, InT, AccT>(x + half, n - half);
+    return Reducer::Reduce(low, high);
+  }
+  AccT lanes[kCPUReduceLanes];
+  std::fill(lanes, lanes + kCPUReduceLanes, Reducer::Init());
+  int64_t i = 0;
+  for (; i + kCPUReduceLanes <= n; i += kCPUReduceLanes) {
+    for (int k = 0; k < kCPUReduceLanes; ++k) {
+      lanes[k] = Reducer::Reduce(lanes[k], static_cast<AccT>(x[i + k]));
+    }
+  }
+  AccT acc = Reducer::Init();
+  for (int k = 0; k < kCPUReduceLanes; ++k) {
+    acc = Reducer::Reduce(acc, lanes[k]);
+  }
+  for (; i < n; ++i) {
+    acc = Reducer::Reduce(acc, static_cast<AccT>(x[i]));
+  }
+  return acc;
+}
+
+// Reduces the rows [0, n) of cols columns, stride apart, into out. The blocks
+// of rows are merged pairwise as in a binary counter, so levels holds the
+// partial sums of at most one block count of each power of 2.
+template <typename Reducer, typename InT, typename AccT>
+void CPUReduceColumns(const InT *x,
+                      int64_t n,
+                      int64_t stride,
+                      int64_t cols,
+                      AccT *out,
+                      std::vector<AccT> *levels) {
+  std::vector<int> counts;
+  for (int64_t begin = 0; begin < n; begin += kCPUReduceBlockSize) {
+    int64_t end = std::min(begin + kCPUReduceBlockSize, n);
+    levels->resize((counts.size() + 1) * cols);
+    AccT *block = levels->data() + counts.size() * cols;
+    std::fill(block, block + cols, Reducer::Init());
+    for (int64_t r = begin; r < end; ++r) {
+      const InT *row = x + r * stride;
+      for (int64_t c = 0; c < cols; ++c) {
+        block[c] = Reducer::Reduce(block[c], static_cast<AccT>(row[c]));
+      }
+    }
+    counts.push_back(1);
+    while (counts.size() > 1 &&
+           counts[counts.size() - 2] == counts[counts.size() - 1]) {
+      AccT *low = levels->data() + (counts.size() - 2) * cols;
+      AccT *high = low + cols;
+      for (int64_t c = 0; c < cols; ++c) {
+        low[c] = Reducer::Reduce(low[c], high[c]);
+      }
+      counts.pop_back();
+      counts.back() *= 2;
+    }
+  }
+  std::fill(out, out + cols, Reducer::Init());
+  for (size_t l = counts.size(); l > 0; --l) {
+    const AccT *level = levels->data() + (l - 1) * cols;
+    for (int64_t c = 0; c < cols; ++c) {
+      out[c] = Reducer::Reduce(out[c], level[c]);
+    }
+  }
+}
+
+// Reduces x of (outer, reduce, inner) into out of (outer, inner).
+template <typename Reducer, typename InT, typename AccT>
+void CPUReducePass(const InT *x,
+                   int64_t outer,
+                   int64_t reduce,
+                   int64_t inner,
+                   AccT *out) {
+  int64_t tiles = (inner + kCPUReduceColumnTile - 1) / kCPUReduceColumnTile;
+  int64_t units = outer * tiles;
+  int task_num = CPUBroadcastTaskNum(outer * reduce * inner);
+  if (units >= task_num) {
+    // split the outputs
+    CPUBroadcastParallelFor(
+        units, task_num, [&](int task, int64_t begin, int64_t end) {
+          std::vector<AccT> levels;
+          for (int64_t unit = begin; unit < end; ++unit) {
+            int64_t o = unit / tiles;
+            if (inner == 1) {
+              out[o] = CPUReduceRow<Reducer, InT, AccT>(x + o * reduce, reduce);
+              continue;
+            }
+            int64_t col = (unit % tiles) * kCPUReduceColumnTile;
+            int64_t cols = std::min(kCPUReduceColumnTile, inner - col);
+            CPUReduceColumns<Reducer, InT, AccT>(x + o * reduce * inner + col,
+                                                 reduce,
+                                                 inner,
+                                                 cols,
+                                                 out + o * inner + col,
+                                                 &levels);
+          }
+        });
+    return;
+  }
+  // split the reduced dim, into partial outputs of the tasks
+  task_num = static_cast<int>(std::min<int64_t>(task_num, reduce));
+  int64_t step = (reduce + task_num - 1) / task_num;
+  std::vector<AccT> partials(task_num * outer * inner);
+  CPUBroadcastParallelFor(
+      task_num, task_num, [&](int unused, int64_t begin, int64_t end) {
+        std::vector<AccT> levels;
+        for (int64_t task = begin; task < end; ++task) {
+          int64_t r_begin = std::min(task * step, reduce);
+          int64_t n = std::min(r_begin + step, reduce) - r_begin;
+          AccT *partial = partials.data() + task * outer * inner;
+          for (int64_t o = 0; o < outer; ++o) {
+            const InT *x_o = x + (o * reduce + r_begin) * inner;
+            if (inner == 1) {
+              partial[o] = CPUReduceRow<Reducer, InT, AccT>(x_o, n);
+            } else {
+              CPUReduceColumns<Reducer, InT, AccT>(
+                  x_o, n, inner, inner, partial + o * inner, &levels);
+            }
+          }
+        }
+      });
+  std::copy(partials.begin(), partials.begin() + outer * inner, out);
+  for (int task = 1; task < task_num; ++task) {
+    const AccT *partial = partials.data() + task * outer * inner;
+    for (int64_t i = 0; i < outer * inner; ++i) {
+      out[i] = Reducer::Reduce(out[i], partial[i]);
+    }
+  }
+}
+
+// Whether the reduce of Functor on DeviceContext has a native kernel, the
+// others keep the Eigen kernels.
+template <typename DeviceContext, typename Functor, typename T>
+struct IsCPUNativeReduce
+    : public std::integral_constant<
+          bool,
+          std::is_same<DeviceContext, CPUContext>::value &&
+              CPUReducer<Functor, T>::kNative> {};
+
+// Reduces input into output with the native reducer of Functor.
+template <typename T, typename Functor>
+void CPUReduceCompute(const CPUContext &dev_ctx,
+                      const DenseTensor &input,
+                      DenseTensor *output,
+                      const std::vector<int64_t> &dims,
+                      bool reduce_all) {
+  using Reducer = CPUReducer<Functor, T>;
+  using AccT = typename Reducer::AccT;
+  CPUReduceDims reduce_dims(input.dims(), dims, reduce_all);
+  const T *x = input.data<T>();
+  T *out = dev_ctx.template Alloc<T>(output);
+  int64_t out_numel = output->numel();
+  if (input.numel() == 0) {
+    std::fill(out,
+              out + out_numel,
+              Reducer::Finalize(Reducer::Init(), reduce_dims.reduce_numel));
+    return;
+  }
+  // the passes after the first read the partial results of the one before
+  std::vector<AccT> acc;
+  std::vector<AccT> next;
+  int64_t outer, reduce, inner;
+  bool first = true;
+  while (reduce_dims.NextPass(&outer, &reduce, &inner)) {
+    next.resize(outer * inner);
+    if (first) {
+      CPUReducePass<Reducer, T, AccT>(x, outer, reduce, inner, next.data());
+    } else {
+      CPUReducePass<Reducer, AccT, AccT>(
+          acc.data(), outer, reduce, inner, next.data());
+    }
+    acc.swap(next);
+    first = false;
+  }
+  if (first) {
+    // nothing is reduced but dims of 1
+    acc.assign(x, x + out_numel);
+  }
+  for (int64_t i = 0; i < out_numel; ++i) {
+    out[i] = Reducer::Finalize(acc[i], reduce_dims.reduce_numel);
+  }
+}
+
+// The native grad of a Functor of reduce_functor.h, dx of x, the reduced y
+// and its grad dy, and size the reduced elements of each y.
+template <typename Functor, typename T>
+struct CPUReduceGrad {
+  static constexpr bool kNative = false;
+};
+
+template <typename T>
+struct CPUReduceGrad<SumGradFunctor, T> {
+  static constexpr bool kNative = true;
+  static T Compute(T x, T y, T dy, int64_t size) { return dy; }
+};
+
+template <typename T>
+struct CPUReduceGrad<MeanGradFunctor, T> {
+  static constexpr bool kNative = true;
+  static T Compute(T x, T y, T dy, int64_t size) {
+    return dy / static_cast<T>(size);
+  }
+};
+
+template <typename T>
+struct CPUReduceGrad<ProdGradFunctor, T> {
+  static constexpr bool kNative = true;
+  static T Compute(T x, T y, T dy, int64_t size) {
+    return dy * y * (static_cast<T>(1) / x);
+  }
+};
+
+template <typename T>
+struct CPUReduceGrad<MaxOrMinGradFunctor, T> {
+  static constexpr bool kNative = true;
+  static T Compute(T x, T y, T dy, int64_t size) {
+    return dy * static_cast<T>(x == y);
+  }
+};
+
+template <typename DeviceContext, typename Functor, typename T>
+struct IsCPUNativeReduceGrad
+    : public std::integral_constant<
+          bool,
+          std::is_same<DeviceContext, CPUContext>::value &&
+              CPUReduceGrad<Functor, T>::kNative> {};
+
+// Computes dx from x, the reduced y and dy with the native grad of Functor.
+template <typename T, typename Functor>
+void CPUReduceGradCompute(const CPUContext &dev_ctx,
+                          const DenseTensor &x,
+                          const DenseTensor &y,
+                          const DenseTensor &dy,
+                          DenseTensor *dx,
+                          const std::vector<int> &dims,
+                          bool reduce_all) {
+  using Grad = CPUReduceGrad<Functor, T>;
+  DDim x_dims = x.dims();
+  // y and dy as x with the reduced dims kept as 1
+  std::vector<int64_t> y_shape = phi::vectorize(x_dims);
+  int64_t size = 1;
+  for (int i = 0; i < x_dims.size(); ++i) {
+    bool is_reduced = reduce_all ||
+                      std::find(dims.begin(), dims.end(), i) != dims.end() ||
+                      std::find(dims.begin(), dims.end(), i - x_dims.size()) !=
+                          dims.end();
+    if (is_reduced) {
+      size *= y_shape[i];
+      y_shape[i] = 1;
+    }
+  }
+  // x may be a stand-in of dx, so it is read before dx is written
+  const T *x_data = x.data<T>();
+  T *dx_data = dev_ctx.template Alloc<T>(dx);
+  CPUBroadcastLayout layout(x_dims, phi::make_ddim(y_shape), 0);
+  int64_t numel = layout.numel;
+  if (numel == 0) {
+    return;
+  }
+  const T *y_data = y.data<T>();
+  const T *dy_data = dy.data<T>();
+  bool y_contiguous = layout.strides[1][0] != 0;
+  CPUBroadcastParallelFor(
+      numel,
+      CPUBroadcastTaskNum(numel),
+      [&](int task, int64_t begin, int64_t end) {
+        CPUBroadcastForRows(
+            layout,
+            begin,
+            end,
+            [&](const CPUBroadcastRowIterator &row,
+                int64_t col,
+                int64_t n,
+                int64_t pos) {
+              int64_t y_offset = row.offset(1) + (y_contiguous ? col : 0);
+              const T *y_row = y_data + y_offset;
+              const T *dy_row = dy_data + y_offset;
+              for (int64_t i = 0; i < n; ++i) {
+                int64_t j = y_contiguous ? i : 0;
+                dx_data[pos + i] =
+                    Grad::Compute(x_data[pos + i], y_row[j], dy_row[j], size);
+              }
+            });
+      });
+}
+
+}  // namespace funcs
+}  // namespace phi
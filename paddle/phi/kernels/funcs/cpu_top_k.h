@@ -0,0 +1,442 @@
+/* Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#ifdef PADDLE_WITH_MKLML
+#include <omp.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include "paddle/phi/kernels/funcs/radix_sort.h"
+
+namespace phi {
+namespace funcs {
+
+// The selection and sort of the rows of a tensor on CPU, for topk,
+// kthvalue, argsort and mode.
+//
+// The top k of a row are kept in a heap of k, whose root is the worst of
+// them, or for a large k in a buffer cut back to the top k by nth_element
+// when it doubles, whose root is the k-th of the last cut. Most of a long
+// row cannot enter, so the row is checked a block at a time against the
+// root, by a branch-free loop the compiler vectorizes, and only the blocks
+// of an element better than the root are pushed one by one. The rows run
+// on the OpenMP threads, and a row too long for the threads to be busy is
+// split into chunks, whose top k are merged.
+//
+// The sort maps the values to unsigned keys of the same order and sorts
+// them by the radix sort. NaN is the largest value everywhere, and the
+// equal values are in the order of their indices.
+
+// the elements checked against the root of the heap at once
+constexpr int64_t kTopKFilterBlock = 32;
+// the row is filtered if k is at most the width over it, or else selected
+// by nth_element
+constexpr int64_t kTopKHeapRatio = 16;
+// the largest k of a heap, and a larger one is a buffer of candidates
+constexpr int64_t kTopKMaxHeap = 128;
+// the least elements of a chunk of a row split across the threads
+constexpr int64_t kTopKMinChunk = 1 << 15;
+
+template <typename T, typename IndexT>
+struct TopKPair {
+  T value;
+  IndexT index;
+};
+
+template <typename T>
+inline bool TopKIsNan(T x) {
+  return x != x;
+}
+
+// Whether a comes before b in the top k: the larger if Largest, or else the
+// smaller, and the smaller index of equal values.
+template <bool Largest, typename T, typename IndexT>
+struct TopKBefore {
+  bool operator()(const TopKPair<T, IndexT>& a,
+                  const TopKPair<T, IndexT>& b) const {
+    bool a_nan = TopKIsNan(a.value);
+    bool b_nan = TopKIsNan(b.value);
+    if (a_nan || b_nan) {
+      return a_nan == b_nan ? a.index < b.index : (Largest ? a_nan : b_nan);
+    }
+    if (a.value != b.value) {
+      return Largest ? a.value > b.value : a.value < b.value;
+    }
+    return a.index < b.index;
+  }
+};
+
+// Whether x may come before root, whatever their indices.
+template <bool Largest, typename T>
+inline bool TopKMayEnter(T x, T root) {
+  // no value comes before a NaN root when Largest, but all others do if not
+  return (Largest ? x > root : x < root) || TopKIsNan(x) ||
+         (!Largest && TopKIsNan(root));
+}
+
+// Whether an element of x[0, kTopKFilterBlock) may come before root.
+template <bool Largest, typename T>
+inline bool TopKBlockMayEnter(const T* x, T root) {
+  if (!Largest && TopKIsNan(root)) {
+    return true;
+  }
+  int hit = 0;
+  for (int64_t i = 0; i < kTopKFilterBlock; ++i) {
+    hit |= static_cast<int>(Largest ? x[i] > root : x[i] < root) |
+           static_cast<int>(TopKIsNan(x[i]));
+  }
+  return hit != 0;
+}
+
+// Replaces the root of heap, the last of it, by pair before it.
+template <typename Pair, typename Before>
+inline void TopKReplaceRoot(std::vector<Pair>* heap,
+                            const Pair& pair,
+                            Before before) {
+  int64_t n = static_cast<int64_t>(heap->size());
+  Pair* h = heap->data();
+  int64_t i = 0;
+  for (int64_t c = 1; c < n; c = 2 * i + 1) {
+    if (c + 1 < n && before(h[c], h[c + 1])) {
+      ++c;
+    }
+    if (!before(pair, h[c])) {
+      break;
+    }
+    h[i] = h[c];
+    i = c;
+  }
+  h[i] = pair;
+}
+
+// Runs fn(j, pair) with each element j of x[k, n), of indices from base,
+// that may come before the root returned by root(), in order.
+template <bool Largest, typename T, typename IndexT, typename Root, typename Fn>
+inline void TopKScan(
+    const T* x, int64_t n, IndexT base, int64_t k, Root root, Fn fn) {
+  int64_t j = k;
+  while (j < n) {
+    int64_t end = std::min(j + kTopKFilterBlock, n);
+    if (end - j == kTopKFilterBlock &&
+        !TopKBlockMayEnter<Largest>(x + j, root().value)) {
+      j = end;
+      continue;
+    }
+    for (; j < end; ++j) {
+      if (TopKMayEnter<Largest>(x[j], root().value)) {
+        fn(TopKPair<T, IndexT>{x[j], static_cast<IndexT>(base + j)});
+      }
+    }
+  }
+}
+
+// Selects the top k of x[0, n), of indices from base, into top, unordered.
+template <bool Largest, typename T, typename IndexT>
+void TopKSelect(const T* x,
+                int64_t n,
+                IndexT base,
+                int64_t k,
+                std::vector<TopKPair<T, IndexT>>* top) {
+  using Pair = TopKPair<T, IndexT>;
+  TopKBefore<Largest, T, IndexT> before;
+  k = std::min(k, n);
+  top->clear();
+  if (k <= 0) {
+    return;
+  }
+  bool few = k * kTopKHeapRatio > n;
+  top->reserve(few ? n : (k > kTopKMaxHeap ? 2 * k : k));
+  for (int64_t j = 0; j < (few ? n : k); ++j) {
+    top->push_back(Pair{x[j], static_cast<IndexT>(base + j)});
+  }
+  if (few) {
+    std::nth_element(top->begin(), top->begin() + k - 1, top->end(), before);
+    top->resize(k);
+  } else if (k <= kTopKMaxHeap) {
+    std::make_heap(top->begin(), top->end(), before);
+    TopKScan<Largest>(
+        x,
+        n,
+        base,
+        k,
+        [&]() -> const Pair& { return top->front(); },
+        [&](const Pair& pair) {
+          if (before(pair, top->front())) {
+            TopKReplaceRoot(top, pair, before);
+          }
+        });
+  } else {
+    // the candidates, cut back to the top k of them when they are 2k, so
+    // the k-th of the last cut is the root
+    Pair root = *std::max_element(top->begin(), top->end(), before);
+    auto cut = [&]() {
+      std::nth_element(top->begin(), top->begin() + k - 1, top->end(), before);
+      top->resize(k);
+      root = top->back();
+    };
+    TopKScan<Largest>(
+        x,
+        n,
+        base,
+        k,
+        [&]() -> const Pair& { return root; },
+        [&](const Pair& pair) {
+          if (before(pair, root)) {
+            top->push_back(pair);
+            if (static_cast<int64_t>(top->size()) == 2 * k) {
+              cut();
+            }
+          }
+        });
+    if (static_cast<int64_t>(top->size()) > k) {
+      cut();
+    }
+  }
+}
+
+inline int TopKMaxThreads() {
+#ifdef PADDLE_WITH_MKLML
+  return omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
+// Runs fn(row, top) with the unordered top k of each row of x, of [rows,
+// width], on the threads.
+template <bool Largest, typename T, typename IndexT, typename Fn>
+void TopKRows(const T* x, int64_t rows, int64_t width, int64_t k, Fn fn) {
+  using Pair = TopKPair<T, IndexT>;
+  int threads = TopKMaxThreads();
+  int64_t chunks = 1;
+  if (rows < threads && k > 0) {
+    int64_t min_chunk = std::max(kTopKMinChunk, k * kTopKHeapRatio * 2);
+    chunks = std::max<int64_t>(
+        std::min<int64_t>((threads + rows - 1) / rows, width / min_chunk), 1);
+  }
+  if (chunks == 1) {
+#ifdef PADDLE_WITH_MKLML
+    int task_num = static_cast<int>(
+        std::max<int64_t>(std::min<int64_t>(threads, rows), 1));
+#pragma omp parallel for num_threads(task_num) if (task_num > 1)
+#endif
+    for (int64_t i = 0; i < rows; ++i) {
+      std::vector<Pair> top;
+      TopKSelect<Largest>(x + i * width, width, IndexT(0), k, &top);
+      fn(i, &top);
+    }
+    return;
+  }
+  // the top k of each chunk, then the top k of them of each row
+  int64_t step = (width + chunks - 1) / chunks;
+  std::vector<std::vector<Pair>> parts(rows * chunks);
+#ifdef PADDLE_WITH_MKLML
+#pragma omp parallel for num_threads(threads)
+#endif
+  for (int64_t t = 0; t < rows * chunks; ++t) {
+    int64_t begin = std::min(t % chunks * step, width);
+    int64_t end = std::min(begin + step, width);
+    TopKSelect<Largest>(x + t / chunks * width + begin,
+                        end - begin,
+                        static_cast<IndexT>(begin),
+                        k,
+                        &parts[t]);
+  }
+  for (int64_t i = 0; i < rows; ++i) {
+    std::vector<Pair> top;
+    for (int64_t c = 0; c < chunks; ++c) {
+      const auto& part = parts[i * chunks + c];
+      top.insert(top.end(), part.begin(), part.end());
+    }
+    int64_t top_k = std::min(k, width);
+    std::nth_element(top.begin(),
+                     top.begin() + top_k - 1,
+                     top.end(),
+                     TopKBefore<Largest, T, IndexT>());
+    top.resize(top_k);
+    fn(i, &top);
+  }
+}
+
+// The top k of each row of x, of [rows, width], into out and indices of
+// [rows, k], in order if sorted.
+template <bool Largest, typename T, typename IndexT>
+void TopKCompute(const T* x,
+                 int64_t rows,
+                 int64_t width,
+                 int64_t k,
+                 bool sorted,
+                 T* out,
+                 IndexT* indices) {
+  using Pair = TopKPair<T, IndexT>;
+  TopKRows<Largest, T, IndexT>(
+      x, rows, width, k, [&](int64_t i, std::vector<Pair>* top) {
+        if (sorted) {
+          std::sort(
+              top->begin(), top->end(), TopKBefore<Largest, T, IndexT>());
+        }
+        for (size_t j = 0; j < top->size(); ++j) {
+          out[i * k + j] = (*top)[j].value;
+          indices[i * k + j] = (*top)[j].index;
+        }
+      });
+}
+
+template <typename T, typename IndexT>
+void TopKCompute(const T* x,
+                 int64_t rows,
+                 int64_t width,
+                 int64_t k,
+                 bool largest,
+                 bool sorted,
+                 T* out,
+                 IndexT* indices) {
+  if (largest) {
+    TopKCompute<true>(x, rows, width, k, sorted, out, indices);
+  } else {
+    TopKCompute<false>(x, rows, width, k, sorted, out, indices);
+  }
+}
+
+// The k-th smallest of each row of x, of [rows, width], into out and
+// indices of [rows].
+template <typename T, typename IndexT>
+void KthvalueCompute(const T* x,
+                     int64_t rows,
+                     int64_t width,
+                     int64_t k,
+                     T* out,
+                     IndexT* indices) {
+  using Pair = TopKPair<T, IndexT>;
+  TopKRows<false, T, IndexT>(
+      x, rows, width, k, [&](int64_t i, std::vector<Pair>* top) {
+        auto kth = std::max_element(
+            top->begin(), top->end(), TopKBefore<false, T, IndexT>());
+        out[i] = kth->value;
+        indices[i] = kth->index;
+      });
+}
+
+// The unsigned key of x, of the order of x, NaN the largest.
+template <typename T>
+struct TopKSortKey {
+  using Type = typename std::make_unsigned<T>::type;
+  static Type Of(T x) { return RadixSortKeyOf(x); }
+};
+
+template <typename T, typename KeyT>
+struct TopKFloatSortKey {
+  using Type = KeyT;
+  static Type Of(T x) {
+    if (std::isnan(x)) {
+      return ~KeyT(0);
+    }
+    // -0 is equal to 0
+    if (x == T(0)) {
+      x = T(0);
+    }
+    KeyT bits;
+    std::memcpy(&bits, &x, sizeof(T));
+    KeyT sign = KeyT(1) << (sizeof(T) * 8 - 1);
+    return (bits & sign) ? ~bits : (bits | sign);
+  }
+};
+
+template <>
+struct TopKSortKey<float> : public TopKFloatSortKey<float, uint32_t> {};
+
+template <>
+struct TopKSortKey<double> : public TopKFloatSortKey<double, uint64_t> {};
+
+// Runs fn(row, index) with the indices of each row of x, of [rows, width],
+// in the order of its values, on the threads.
+template <typename T, typename IndexT, typename Fn>
+void SortRows(const T* x, int64_t rows, int64_t width, bool descending, Fn fn) {
+  using KeyT = typename TopKSortKey<T>::Type;
+  // a single row is sorted by the threads of the radix sort
+#ifdef PADDLE_WITH_MKLML
+  int task_num = static_cast<int>(
+      std::max<int64_t>(std::min<int64_t>(TopKMaxThreads(), rows), 1));
+#pragma omp parallel for num_threads(task_num) if (task_num > 1)
+#endif
+  for (int64_t i = 0; i < rows; ++i) {
+    const T* row = x + i * width;
+    std::vector<KeyT> keys(width);
+    for (int64_t j = 0; j < width; ++j) {
+      KeyT key = TopKSortKey<T>::Of(row[j]);
+      keys[j] = descending ? ~key : key;
+    }
+    std::vector<KeyT> sorted(width);
+    std::vector<IndexT> index(width);
+    RadixSortWithIndex(keys.data(), width, sorted.data(), index.data());
+    fn(i, index.data());
+  }
+}
+
+// The sorted rows of x, of [rows, width], into out, and their indices.
+template <typename T, typename IndexT>
+void SortCompute(const T* x,
+                 int64_t rows,
+                 int64_t width,
+                 bool descending,
+                 T* out,
+                 IndexT* indices) {
+  SortRows<T, IndexT>(
+      x, rows, width, descending, [&](int64_t i, const IndexT* index) {
+        const T* row = x + i * width;
+        for (int64_t j = 0; j < width; ++j) {
+          out[i * width + j] = row[index[j]];
+          indices[i * width + j] = index[j];
+        }
+      });
+}
+
+// The most frequent value of each row of x, of [rows, width], the smallest
+// of them if many, into out, and its last index into indices.
+template <typename T, typename IndexT>
+void ModeCompute(
+    const T* x, int64_t rows, int64_t width, T* out, IndexT* indices) {
+  SortRows<T, IndexT>(
+      x, rows, width, false, [&](int64_t i, const IndexT* index) {
+        const T* row = x + i * width;
+        T mode = 0;
+        IndexT mode_index = 0;
+        int64_t cur_freq = 0;
+        int64_t max_freq = 0;
+        for (int64_t j = 0; j < width; ++j) {
+          ++cur_freq;
+          if (j == width - 1 || row[index[j + 1]] != row[index[j]]) {
+            if (cur_freq > max_freq) {
+              max_freq = cur_freq;
+              mode = row[index[j]];
+              mode_index = index[j];
+            }
+            cur_freq = 0;
+          }
+        }
+        out[i] = mode;
+        indices[i] = mode_index;
+      });
+}
+
+}  // namespace funcs
+}  // namespace phi
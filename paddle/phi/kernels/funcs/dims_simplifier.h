@@ -34,18 +34,37 @@ struct BroadcastDimsSimplifier {
   BroadcastDimsSimplifier(const std::vector<const DenseTensor *> &ins,
                           const phi::DDim &dims,
                           int axis) {
-    N = std::max(static_cast<int>(ins.size()), 2);
+    std::vector<phi::DDim> ins_dims;
+    for (auto *in : ins) {
+      ins_dims.push_back(in->dims());
+    }
+    Simplify(ins_dims, dims, axis);
+  }
+
+  // For callers which only have the dims of the inputs, e.g. the CPU
+  // elementwise grads, whose inputs may be stand-ins of other shapes.
+  BroadcastDimsSimplifier(const std::vector<phi::DDim> &ins_dims,
+                          const phi::DDim &dims,
+                          int axis) {
+    Simplify(ins_dims, dims, axis);
+  }
+
+ private:
+  void Simplify(const std::vector<phi::DDim> &ins_dims,
+                const phi::DDim &dims,
+                int axis) {
+    N = std::max(static_cast<int>(ins_dims.size()), 2);
     in_dims.resize(N);
     rank = dims.size();
     out_dims = phi::vectorize<int64_t>(dims);
-    if (ins.size() == 1) {
+    if (ins_dims.size() == 1) {
       // When ins.size() = 1, broadcast input to output.
-      in_dims[0] = phi::vectorize<int64_t>(ins[0]->dims());
+      in_dims[0] = phi::vectorize<int64_t>(ins_dims[0]);
       // Add out_dims to in_dims to avoid errors in dims merging.
       in_dims[1] = out_dims;
     } else {
       for (int j = 0; j < N; ++j) {
-        in_dims[j] = phi::vectorize<int64_t>(ins[j]->dims());
+        in_dims[j] = phi::vectorize<int64_t>(ins_dims[j]);
       }
     }
     ExtendInputDimensions(N, axis);
@@ -99,7 +118,6 @@ struct BroadcastDimsSimplifier {
     }
   }
 
- private:
   // To compensate the lackage of input_tensors' dimension with axis.
   void ExtendInputDimensions(int N, int axis) {
     for (auto &in_dim : in_dims) {
@@ -19,6 +19,7 @@ limitations under the License. */
 #include "paddle/phi/core/dense_tensor.h"
 #include "paddle/phi/kernels/empty_kernel.h"
 #include "paddle/phi/kernels/funcs/common_shape.h"
+#include "paddle/phi/kernels/funcs/cpu_broadcast_function.h"
 #include "paddle/phi/kernels/funcs/elementwise_utils.h"
 #include "paddle/phi/kernels/funcs/math_function.h"
 
@@ -272,90 +273,6 @@ class TransformFunctor {
   bool is_xsize_larger_;
 };
 
-template <typename Functor, typename T, typename OutType = T>
-void CommonForwardBroadcastCPU(const DenseTensor &x,
-                               const DenseTensor &y,
-                               DenseTensor *z,
-                               int *x_dims_array,
-                               int *y_dims_array,
-                               int *out_dims_array,
-                               int max_dim,
-                               const CPUContext &ctx,
-                               Functor func,
-                               const bool is_xsize_larger = true) {
-  std::vector<int> index_array(max_dim, 0);
-  const T *x_data = x.data<T>();
-  const T *y_data = y.data<T>();
-  PADDLE_ENFORCE_NOT_NULL(
-      x_data, errors::InvalidArgument("The input X should not be empty."));
-  PADDLE_ENFORCE_NOT_NULL(
-      y_data, errors::InvalidArgument("The input Y should not be empty."));
-  OutType *out_data = ctx.Alloc<OutType>(z);
-
-  const int out_size = std::accumulate(
-      out_dims_array, out_dims_array + max_dim, 1, std::multiplies<int>());
-  int x_index, y_index;
-  for (int out_index = 0; out_index < out_size; ++out_index) {
-    x_index = GetElementwiseIndex(x_dims_array, max_dim, index_array.data());
-    y_index = GetElementwiseIndex(y_dims_array, max_dim, index_array.data());
-    if (is_xsize_larger) {
-      out_data[out_index] = func(x_data[x_index], y_data[y_index]);
-    } else {
-      out_data[out_index] = func(y_data[y_index], x_data[x_index]);
-    }
-
-    UpdateElementwiseIndexArray(out_dims_array, max_dim, index_array.data());
-  }
-}
-
-template <typename Functor, typename T, typename OutType = T>
-void CommonElementwiseBroadcastForward(const CPUContext &dev_ctx,
-                                       const DenseTensor &x,
-                                       const DenseTensor &y,
-                                       DenseTensor *z,
-                                       const DDim &x_dims,
-                                       const DDim &y_dims,
-                                       Functor func,
-                                       int axis,
-                                       const bool is_xsize_larger = true) {
-  int max_dim = (std::max)(x_dims.size(), y_dims.size());
-  axis = (axis == -1 ? std::abs(x_dims.size() - y_dims.size()) : axis);
-  PADDLE_ENFORCE_GE(
-      axis,
-      0,
-      phi::errors::InvalidArgument(
-          "Axis should be great than or equal to 0, but received axis is %d.",
-          axis));
-  PADDLE_ENFORCE_LE(
-      axis,
-      max_dim,
-      phi::errors::InvalidArgument(
-          "Axis should be less than or equal to %d, but received axis is %d.",
-          max_dim,
-          axis));
-  std::vector<int> x_dims_array(max_dim);
-  std::vector<int> y_dims_array(max_dim);
-  std::vector<int> out_dims_array(max_dim);
-  GetBroadcastDimsArrays(x_dims,
-                         y_dims,
-                         x_dims_array.data(),
-                         y_dims_array.data(),
-                         out_dims_array.data(),
-                         max_dim,
-                         axis);
-
-  CommonForwardBroadcastCPU<Functor, T, OutType>(x,
-                                                 y,
-                                                 z,
-                                                 x_dims_array.data(),
-                                                 y_dims_array.data(),
-                                                 out_dims_array.data(),
-                                                 max_dim,
-                                                 dev_ctx,
-                                                 func,
-                                                 is_xsize_larger);
-}
-
 // It is a common CPU implementation to compute binary calculation with the
 // support of broadcast. Note:
 // 1. CPU implementation cannot support the case when x needs broadcast, thus
@@ -363,6 +280,7 @@ void CommonElementwiseBroadcastForward(const CPUContext &dev_ctx,
 //    like AddFunctor and InverseAddFunctor.
 // 2. The corresponding GPU implementation supports all the broadcast cases,
 //    thus there is no need to define and call with XxxInverseFunctor.
+// 3. The broadcast runs on CPUBroadcastCompute, with the larger input first.
 // TODO(liuyiqun): optimize the CPU implementation to support all broadcast
 // cases and avoid the need of XxxInverseFunctor.
 template <typename Functor, typename T, typename OutType = T>
@@ -381,10 +299,8 @@ void ElementwiseCompute(const CPUContext &dev_ctx,
     is_xsize_larger = false;
     max_dim = y_dims.size();
   }
-  TransformFunctor<Functor, T, CPUContext, OutType> functor(
-      x, y, z, dev_ctx, func, is_xsize_larger);
   if (x_dims == y_dims) {
-    functor.Run();
+    CPUBroadcastCompute<Functor, T, OutType>(dev_ctx, x, y, 0, func, z);
     return;
   }
 
@@ -403,43 +319,10 @@ void ElementwiseCompute(const CPUContext &dev_ctx,
           max_dim,
           axis));
 
-  int pre, n, post, is_run_common_broadcast, axis_trim = 0;
   if (is_xsize_larger) {
-    auto y_dims_trimed = TrimTrailingSingularDims(y_dims);
-    axis_trim = (y_dims_trimed.size() == 0) ? x_dims.size() : axis;
-    GetMidDims(x_dims,
-               y_dims_trimed,
-               axis_trim,
-               &pre,
-               &n,
-               &post,
-               &is_run_common_broadcast);
+    CPUBroadcastCompute<Functor, T, OutType>(dev_ctx, x, y, axis, func, z);
   } else {
-    auto x_dims_trimed = TrimTrailingSingularDims(x_dims);
-    axis_trim = (x_dims_trimed.size() == 0) ? y_dims.size() : axis;
-    GetMidDims(y_dims,
-               x_dims_trimed,
-               axis_trim,
-               &pre,
-               &n,
-               &post,
-               &is_run_common_broadcast);
-  }
-  // special case for common implementation.
-  // case 1: x=[2,3,1,5], y=[2,1,4,1]
-  // case 2: x=[2,3,4], y=[1,1,4]
-  if (is_run_common_broadcast == 1) {
-    CommonElementwiseBroadcastForward<Functor, T, OutType>(
-        dev_ctx, x, y, z, x_dims, y_dims, func, axis, is_xsize_larger);
-    return;
-  }
-
-  if (post == 1) {
-    functor.RunRowWise(n, pre);
-    return;
-  } else {
-    functor.RunMidWise(n, pre, post);
-    return;
+    CPUBroadcastCompute<Functor, T, OutType>(dev_ctx, y, x, axis, func, z);
   }
 }
 
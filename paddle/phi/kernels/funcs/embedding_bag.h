@@ -0,0 +1,297 @@
+/* Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#ifdef PADDLE_WITH_MKLML
+#include <omp.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "paddle/phi/core/dense_tensor.h"
+#include "paddle/phi/core/enforce.h"
+#include "paddle/phi/kernels/funcs/radix_sort.h"
+
+namespace phi {
+namespace funcs {
+
+// The embedding bag on CPU: the rows of the ids of each bag are looked up
+// and pooled at once, without the rows of all the ids in between.
+//
+// The bags are the sequences of the LoD of the ids, or the rows of padded
+// ids. Ids of a width of k are k bags side by side, pooled into k slots of
+// the output. The bags run on the OpenMP threads, and the rows a few ids
+// ahead are prefetched, as the lookups are random reads of the table. The
+// grad sorts the ids by a radix sort, so each unique id sums its rows alone.
+
+// the ids ahead of the one added whose rows are prefetched
+constexpr int64_t kEmbeddingBagPrefetchDistance = 4;
+// the least ids of a thread
+constexpr int64_t kEmbeddingBagMinIdsPerTask = 4096;
+
+enum class EmbeddingBagPoolType {
+  kSum,
+  // the sum over the number of ids
+  kMean,
+  // the sum over the square root of the number of ids
+  kSqrt,
+};
+
+inline EmbeddingBagPoolType GetEmbeddingBagPoolType(
+    const std::string& combiner) {
+  if (combiner == "sum") {
+    return EmbeddingBagPoolType::kSum;
+  } else if (combiner == "mean") {
+    return EmbeddingBagPoolType::kMean;
+  } else if (combiner == "sqrt") {
+    return EmbeddingBagPoolType::kSqrt;
+  }
+  PADDLE_THROW(phi::errors::InvalidArgument(
+      "The combiner of embedding bag should be sum, mean or sqrt, but "
+      "received %s.",
+      combiner));
+}
+
+// the scale of the sum of the n rows of a bag, padding ids not counted
+template <typename T>
+inline T EmbeddingBagScale(EmbeddingBagPoolType pool, int64_t n) {
+  if (n == 0 || pool == EmbeddingBagPoolType::kSum) {
+    return static_cast<T>(1);
+  }
+  return pool == EmbeddingBagPoolType::kMean
+             ? static_cast<T>(1) / static_cast<T>(n)
+             : static_cast<T>(1) / std::sqrt(static_cast<T>(n));
+}
+
+// The bags of ids: bag b takes the ids of the rows [offsets[b],
+// offsets[b + 1]) of ids, of width ids each.
+struct EmbeddingBagLayout {
+  explicit EmbeddingBagLayout(const DenseTensor& ids) {
+    const auto& lod = ids.lod();
+    if (!lod.empty()) {
+      PADDLE_ENFORCE_EQ(lod.size(),
+                        1UL,
+                        phi::errors::InvalidArgument(
+                            "The LoD level of Input(Ids) should be 1. But "
+                            "received Ids's LoD level = %d.",
+                            lod.size()));
+      offsets.assign(lod[0].begin(), lod[0].end());
+      width = offsets.back() > 0 ? ids.numel() / offsets.back() : 1;
+    } else {
+      // ids of [bags, length], padded by padding_idx
+      PADDLE_ENFORCE_GE(ids.dims().size(),
+                        2,
+                        phi::errors::InvalidArgument(
+                            "The Input(Ids) without LoD should be padded "
+                            "bags of at least 2 dims. But received Ids's "
+                            "dims = [%s].",
+                            ids.dims()));
+      int64_t bags = ids.dims()[0];
+      int64_t length = bags > 0 ? ids.numel() / bags : 0;
+      offsets.resize(bags + 1);
+      for (int64_t b = 0; b <= bags; ++b) {
+        offsets[b] = b * length;
+      }
+      width = 1;
+    }
+  }
+
+  int64_t bags() const { return static_cast<int64_t>(offsets.size()) - 1; }
+
+  std::vector<int64_t> offsets;
+  int64_t width;
+};
+
+template <typename T>
+inline void EmbeddingBagPrefetch(const T* row, int64_t row_width) {
+#if defined(__GNUC__) || defined(__clang__)
+  const char* begin = reinterpret_cast<const char*>(row);
+  const char* end = reinterpret_cast<const char*>(row + row_width);
+  for (const char* line = begin; line < end; line += 64) {
+    __builtin_prefetch(line);
+  }
+#endif
+}
+
+template <typename IdT>
+void CheckEmbeddingBagIds(const IdT* ids,
+                          int64_t ids_num,
+                          int64_t height,
+                          int64_t padding_idx) {
+  for (int64_t i = 0; i < ids_num; ++i) {
+    if (ids[i] == padding_idx) {
+      continue;
+    }
+    PADDLE_ENFORCE_EQ(
+        ids[i] >= 0 && ids[i] < height,
+        true,
+        phi::errors::InvalidArgument(
+            "Variable value (input) of OP(embedding_bag) expected >= 0 and "
+            "< %ld, but got %ld. Please check input value.",
+            height,
+            static_cast<int64_t>(ids[i])));
+  }
+}
+
+// Pools the rows of table, of row_width, of each bag of ids into out, of
+// [bags, layout.width * row_width].
+template <typename T, typename IdT>
+void EmbeddingBagCompute(const T* table,
+                         int64_t height,
+                         int64_t row_width,
+                         const IdT* ids,
+                         const EmbeddingBagLayout& layout,
+                         int64_t padding_idx,
+                         EmbeddingBagPoolType pool,
+                         T* out) {
+  int64_t width = layout.width;
+  int64_t ids_num = layout.offsets.back() * width;
+  CheckEmbeddingBagIds(ids, ids_num, height, padding_idx);
+  int64_t bag_num = layout.bags() * width;
+#ifdef PADDLE_WITH_MKLML
+  int task_num = static_cast<int>(std::max<int64_t>(
+      std::min<int64_t>(omp_get_max_threads(),
+                        ids_num / kEmbeddingBagMinIdsPerTask),
+      1));
+#pragma omp parallel for schedule(dynamic, 16) num_threads(task_num)
+#endif
+  for (int64_t k = 0; k < bag_num; ++k) {
+    int64_t b = k / width;
+    int64_t c = k % width;
+    int64_t begin = layout.offsets[b];
+    int64_t end = layout.offsets[b + 1];
+    T* dst = out + k * row_width;
+    std::fill(dst, dst + row_width, static_cast<T>(0));
+    int64_t n = 0;
+    for (int64_t j = begin; j < end; ++j) {
+      if (j + kEmbeddingBagPrefetchDistance < end) {
+        IdT ahead = ids[(j + kEmbeddingBagPrefetchDistance) * width + c];
+        if (ahead != padding_idx) {
+          EmbeddingBagPrefetch(table + ahead * row_width, row_width);
+        }
+      }
+      IdT id = ids[j * width + c];
+      if (id == padding_idx) {
+        continue;
+      }
+      const T* row = table + id * row_width;
+      for (int64_t i = 0; i < row_width; ++i) {
+        dst[i] += row[i];
+      }
+      ++n;
+    }
+    T scale = EmbeddingBagScale<T>(pool, n);
+    if (scale != static_cast<T>(1)) {
+      for (int64_t i = 0; i < row_width; ++i) {
+        dst[i] *= scale;
+      }
+    }
+  }
+}
+
+// The grad of the table of an embedding bag, by its unique ids.
+template <typename T>
+class EmbeddingBagGrad {
+ public:
+  template <typename IdT>
+  EmbeddingBagGrad(const IdT* ids,
+                   const EmbeddingBagLayout& layout,
+                   int64_t height,
+                   int64_t padding_idx,
+                   EmbeddingBagPoolType pool) {
+    int64_t width = layout.width;
+    CheckEmbeddingBagIds(
+        ids, layout.offsets.back() * width, height, padding_idx);
+    // the ids but the padding ones, with the output slot and scale of their
+    // bags
+    std::vector<int64_t> valid_ids;
+    std::vector<int64_t> slots;
+    std::vector<T> scales;
+    for (int64_t b = 0; b < layout.bags(); ++b) {
+      for (int64_t c = 0; c < width; ++c) {
+        int64_t n = 0;
+        for (int64_t j = layout.offsets[b]; j < layout.offsets[b + 1]; ++j) {
+          n += ids[j * width + c] != padding_idx;
+        }
+        T scale = EmbeddingBagScale<T>(pool, n);
+        for (int64_t j = layout.offsets[b]; j < layout.offsets[b + 1]; ++j) {
+          if (ids[j * width + c] != padding_idx) {
+            valid_ids.push_back(ids[j * width + c]);
+            slots.push_back(b * width + c);
+            scales.push_back(scale);
+          }
+        }
+      }
+    }
+    int64_t valid_num = static_cast<int64_t>(valid_ids.size());
+    std::vector<int64_t> sorted(valid_num);
+    std::vector<int64_t> index(valid_num);
+    RadixSortWithIndex(
+        valid_ids.data(), valid_num, sorted.data(), index.data());
+    slots_.resize(valid_num);
+    scales_.resize(valid_num);
+    for (int64_t i = 0; i < valid_num; ++i) {
+      if (i == 0 || sorted[i] != sorted[i - 1]) {
+        rows_.push_back(sorted[i]);
+        starts_.push_back(i);
+      }
+      slots_[i] = slots[index[i]];
+      scales_[i] = scales[index[i]];
+    }
+    starts_.push_back(valid_num);
+  }
+
+  // the unique ids, sorted
+  const std::vector<int64_t>& rows() const { return rows_; }
+
+  // Sums the scaled rows of dout, of row_width, of each unique id into its
+  // row of out, the row of the id in the table if dense, or else its
+  // position in rows().
+  void Compute(const T* dout, int64_t row_width, bool dense, T* out) const {
+    int64_t row_num = static_cast<int64_t>(rows_.size());
+#ifdef PADDLE_WITH_MKLML
+    int task_num = static_cast<int>(std::max<int64_t>(
+        std::min<int64_t>(omp_get_max_threads(),
+                          starts_.back() / kEmbeddingBagMinIdsPerTask),
+        1));
+#pragma omp parallel for schedule(dynamic, 16) num_threads(task_num)
+#endif
+    for (int64_t g = 0; g < row_num; ++g) {
+      T* dst = out + (dense ? rows_[g] : g) * row_width;
+      std::fill(dst, dst + row_width, static_cast<T>(0));
+      for (int64_t i = starts_[g]; i < starts_[g + 1]; ++i) {
+        const T* src = dout + slots_[i] * row_width;
+        T scale = scales_[i];
+        for (int64_t k = 0; k < row_width; ++k) {
+          dst[k] += scale * src[k];
+        }
+      }
+    }
+  }
+
+ private:
+  std::vector<int64_t> rows_;
+  // the ids of each row are [starts_[g], starts_[g + 1]) of the sorted ids
+  std::vector<int64_t> starts_;
+  std::vector<int64_t> slots_;
+  std::vector<T> scales_;
+};
+
+}  // namespace funcs
+}  // namespace phi
@@ -0,0 +1,195 @@
+/* Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#ifdef PADDLE_WITH_MKLML
+#include <omp.h>
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+namespace phi {
+namespace funcs {
+
+// The stable LSD radix sort of integer ids on CPU, and the unique of ids on
+// it, which replace the sets and hash maps of the ids of sparse ops.
+//
+// A pass sorts a byte of the keys, and is skipped when the byte is the same
+// in all of them. The keys are split into a range per OpenMP thread, each
+// counts its digits and scatters them to its offsets, so the sort is stable.
+
+// fewer keys are sorted by comparison
+constexpr int64_t kRadixSortMinNum = 64;
+// the least keys of a thread
+constexpr int64_t kRadixSortMinNumPerTask = 1 << 16;
+
+// Whether T is sorted by RadixSortWithIndex.
+template <typename T>
+struct IsRadixSortable
+    : public std::integral_constant<bool,
+                                    std::is_integral<T>::value &&
+                                        !std::is_same<T, bool>::value> {};
+
+// the unsigned key of x, in the order of x
+template <typename T>
+inline typename std::make_unsigned<T>::type RadixSortKeyOf(T x) {
+  using KeyT = typename std::make_unsigned<T>::type;
+  KeyT sign = std::is_signed<T>::value ? KeyT(1) << (sizeof(T) * 8 - 1) : 0;
+  return static_cast<KeyT>(x) ^ sign;
+}
+
+template <typename T, typename IndexT>
+struct RadixSortPair {
+  typename std::make_unsigned<T>::type key;
+  IndexT index;
+};
+
+inline int RadixSortTaskNum(int64_t n) {
+#ifdef PADDLE_WITH_MKLML
+  return static_cast<int>(std::max<int64_t>(
+      std::min<int64_t>(omp_get_max_threads(), n / kRadixSortMinNumPerTask),
+      1));
+#else
+  return 1;
+#endif
+}
+
+// Runs fn(task, begin, end) over task_num ranges of [0, n).
+template <typename Fn>
+void RadixSortParallelFor(int64_t n, int task_num, Fn fn) {
+  int64_t step = (n + task_num - 1) / task_num;
+#ifdef PADDLE_WITH_MKLML
+#pragma omp parallel for num_threads(task_num) if (task_num > 1)
+#endif
+  for (int task = 0; task < task_num; ++task) {
+    int64_t begin = std::min(task * step, n);
+    fn(task, begin, std::min(begin + step, n));
+  }
+}
+
+// Sorts x[0, n) stably into sorted, and its indices into index, so that
+// sorted[i] is x[index[i]].
+template <typename T, typename IndexT>
+void RadixSortWithIndex(const T* x, int64_t n, T* sorted, IndexT* index) {
+  using KeyT = typename std::make_unsigned<T>::type;
+  using Pair = RadixSortPair<T, IndexT>;
+  std::vector<Pair> pairs(n);
+  KeyT all_and = ~KeyT(0);
+  KeyT all_or = 0;
+  for (int64_t i = 0; i < n; ++i) {
+    KeyT key = RadixSortKeyOf(x[i]);
+    pairs[i].key = key;
+    pairs[i].index = static_cast<IndexT>(i);
+    all_and &= key;
+    all_or |= key;
+  }
+  if (n < kRadixSortMinNum) {
+    std::stable_sort(
+        pairs.begin(), pairs.end(), [](const Pair& a, const Pair& b) {
+          return a.key < b.key;
+        });
+  } else {
+    std::vector<Pair> tmp(n);
+    Pair* src = pairs.data();
+    Pair* dst = tmp.data();
+    int task_num = RadixSortTaskNum(n);
+    std::vector<int64_t> counts(task_num * 256);
+    KeyT varying = all_and ^ all_or;
+    for (size_t shift = 0; shift < sizeof(KeyT) * 8; shift += 8) {
+      // a byte of the same value in all keys leaves the order as it is
+      if (((varying >> shift) & 0xFF) == 0) {
+        continue;
+      }
+      std::fill(counts.begin(), counts.end(), 0);
+      RadixSortParallelFor(
+          n, task_num, [&](int task, int64_t begin, int64_t end) {
+            int64_t* count = counts.data() + task * 256;
+            for (int64_t i = begin; i < end; ++i) {
+              ++count[(src[i].key >> shift) & 0xFF];
+            }
+          });
+      // the offsets of the digits, in the order of the tasks in a digit
+      int64_t sum = 0;
+      for (int d = 0; d < 256; ++d) {
+        for (int task = 0; task < task_num; ++task) {
+          int64_t c = counts[task * 256 + d];
+          counts[task * 256 + d] = sum;
+          sum += c;
+        }
+      }
+      RadixSortParallelFor(
+          n, task_num, [&](int task, int64_t begin, int64_t end) {
+            int64_t* offset = counts.data() + task * 256;
+            for (int64_t i = begin; i < end; ++i) {
+              dst[offset[(src[i].key >> shift) & 0xFF]++] = src[i];
+            }
+          });
+      std::swap(src, dst);
+    }
+    if (src != pairs.data()) {
+      pairs.swap(tmp);
+    }
+  }
+  for (int64_t i = 0; i < n; ++i) {
+    index[i] = pairs[i].index;
+    sorted[i] = static_cast<T>(pairs[i].key ^ RadixSortKeyOf(T(0)));
+  }
+}
+
+// The sorted unique values of x[0, n). Each of the outputs but unique may
+// be null: inverse, of n, takes the position in unique of each x, counts
+// the number of each unique value in x, and first_index its first index.
+template <typename T, typename IndexT>
+void RadixSortUnique(const T* x,
+                     int64_t n,
+                     std::vector<T>* unique,
+                     IndexT* inverse,
+                     std::vector<IndexT>* counts,
+                     std::vector<IndexT>* first_index) {
+  std::vector<T> sorted(n);
+  std::vector<IndexT> index(n);
+  RadixSortWithIndex(x, n, sorted.data(), index.data());
+  unique->clear();
+  if (counts) {
+    counts->clear();
+  }
+  if (first_index) {
+    first_index->clear();
+  }
+  for (int64_t i = 0; i < n; ++i) {
+    if (i == 0 || sorted[i] != sorted[i - 1]) {
+      unique->push_back(sorted[i]);
+      if (counts) {
+        counts->push_back(0);
+      }
+      // the sort is stable, so the first of equal values is the first in x
+      if (first_index) {
+        first_index->push_back(index[i]);
+      }
+    }
+    if (inverse) {
+      inverse[index[i]] = static_cast<IndexT>(unique->size() - 1);
+    }
+    if (counts) {
+      ++counts->back();
+    }
+  }
+}
+
+}  // namespace funcs
+}  // namespace phi
@@ -61,6 +61,7 @@ using dim3 = phi::kps::dim3;
 #include "paddle/phi/core/enforce.h"
 #include "paddle/phi/core/kernel_utils.h"
 #include "paddle/phi/core/utils/array.h"
+#include "paddle/phi/kernels/funcs/cpu_reduce_function.h"
 #include "paddle/phi/kernels/funcs/eigen/common.h"
 #include "paddle/phi/kernels/funcs/eigen/eigen_function.h"
 #include "paddle/phi/kernels/funcs/math_function.h"
@@ -1273,15 +1274,25 @@ void HandleLargeDim(const DeviceContext& dev_ctx,
 
 ////////////// ReduceKernel
 
-template <typename DeviceContext, typename T, typename OutT, typename Functor>
+template <typename DeviceContext, typename OutT, typename Functor>
 void ReduceKernelImpl(const DeviceContext& dev_ctx,
                       const phi::DenseTensor& input,
                       phi::DenseTensor* output,
                       const std::vector<int64_t>& dims,
                       bool keep_dim,
-                      bool reduce_all) {
-  dev_ctx.template Alloc<OutT>(output);
+                      bool reduce_all,
+                      std::true_type) {
+  CPUReduceCompute<OutT, Functor>(dev_ctx, input, output, dims, reduce_all);
+}
 
+template <typename DeviceContext, typename OutT, typename Functor>
+void ReduceKernelImpl(const DeviceContext& dev_ctx,
+                      const phi::DenseTensor& input,
+                      phi::DenseTensor* output,
+                      const std::vector<int64_t>& dims,
+                      bool keep_dim,
+                      bool reduce_all,
+                      std::false_type) {
   if (reduce_all) {
     // Flatten and reduce 1-D tensor
     auto x = EigenVector<OutT>::Flatten(input);
@@ -1319,6 +1330,25 @@ void ReduceKernelImpl(const DeviceContext& dev_ctx,
   }
 }
 
+template <typename DeviceContext, typename T, typename OutT, typename Functor>
+void ReduceKernelImpl(const DeviceContext& dev_ctx,
+                      const phi::DenseTensor& input,
+                      phi::DenseTensor* output,
+                      const std::vector<int64_t>& dims,
+                      bool keep_dim,
+                      bool reduce_all) {
+  dev_ctx.template Alloc<OutT>(output);
+  // the reduces of CPUContext with a native reducer skip Eigen
+  ReduceKernelImpl<DeviceContext, OutT, Functor>(
+      dev_ctx,
+      input,
+      output,
+      dims,
+      keep_dim,
+      reduce_all,
+      IsCPUNativeReduce<DeviceContext, Functor, OutT>());
+}
+
 }  // namespace funcs
 
 }  // namespace phi
@@ -17,6 +17,7 @@
 #include "paddle/phi/backends/cpu/cpu_context.h"
 #include "paddle/phi/core/dense_tensor.h"
 #include "paddle/phi/kernels/cpu/reduce.h"
+#include "paddle/phi/kernels/funcs/cpu_reduce_function.h"
 #include "paddle/phi/kernels/funcs/eigen/common.h"
 #include "paddle/phi/kernels/funcs/eigen/eigen_function.h"
 namespace phi {
@@ -133,7 +134,22 @@ void LaunchReduceGradKernel(const Context& dev_ctx,
                             DenseTensor* output,
                             Functor functor,
                             const std::vector<int>& dims,
-                            bool reduce_all = false) {
+                            bool reduce_all,
+                            std::true_type) {
+  CPUReduceGradCompute<T, Functor>(
+      dev_ctx, *input0, *input1, *input2, output, dims, reduce_all);
+}
+
+template <typename Context, typename T, typename Functor>
+void LaunchReduceGradKernel(const Context& dev_ctx,
+                            const DenseTensor* input0,
+                            const DenseTensor* input1,
+                            const DenseTensor* input2,
+                            DenseTensor* output,
+                            Functor functor,
+                            const std::vector<int>& dims,
+                            bool reduce_all,
+                            std::false_type) {
   if (reduce_all) {
     auto x = phi::EigenVector<T>::Flatten(*input0);
     auto x_reduce = phi::EigenVector<T>::Flatten(*input1);
@@ -185,6 +201,28 @@ void LaunchReduceGradKernel(const Context& dev_ctx,
   }
 }
 
+template <typename Context, typename T, typename Functor>
+void LaunchReduceGradKernel(const Context& dev_ctx,
+                            const DenseTensor* input0,
+                            const DenseTensor* input1,
+                            const DenseTensor* input2,
+                            DenseTensor* output,
+                            Functor functor,
+                            const std::vector<int>& dims,
+                            bool reduce_all = false) {
+  // the grads of CPUContext with a native kernel skip Eigen
+  LaunchReduceGradKernel<Context, T, Functor>(
+      dev_ctx,
+      input0,
+      input1,
+      input2,
+      output,
+      functor,
+      dims,
+      reduce_all,
+      IsCPUNativeReduceGrad<Context, Functor, T>());
+}
+
 }  // namespace funcs
 
 }  // namespace phi
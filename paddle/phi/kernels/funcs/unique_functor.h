@@ -19,6 +19,7 @@
 #include "paddle/phi/core/utils/data_type.h"
 #include "paddle/phi/kernels/funcs/concat_and_split_functor.h"
 #include "paddle/phi/kernels/funcs/math_function.h"
+#include "paddle/phi/kernels/funcs/radix_sort.h"
 
 namespace phi {
 namespace funcs {
@@ -43,10 +44,6 @@ struct UniqueOpFunctor {
     auto* in_data = in_->data<InT>();
     auto* index_data = context_.template Alloc<IndexT>(index_);
 
-    int64_t j = 0;
-
-    // TODO(fangzeyang): Should optimize performance here.
-    std::unordered_map<InT, int64_t> dict;
     std::vector<InT> uniq;
 
     PADDLE_ENFORCE_LT(
@@ -57,17 +54,7 @@ struct UniqueOpFunctor {
             "but received num is %d.",
             in_->numel()));
 
-    for (auto i = 0; i < in_->numel(); i++) {
-      auto it = dict.find(in_data[i]);
-      if (it == dict.end()) {
-        dict.emplace(std::make_pair(in_data[i], j));
-        uniq.emplace_back(in_data[i]);
-        index_data[i] = static_cast<IndexT>(j);
-        j++;
-      } else {
-        index_data[i] = static_cast<IndexT>(it->second);
-      }
-    }
+    Dedup(in_data, index_data, &uniq, IsRadixSortable<InT>());
 
     if (count_ != nullptr) {
       // Resize the count tensor dims to allocate the memory
@@ -105,6 +92,58 @@ struct UniqueOpFunctor {
     auto* out_data = context_.template Alloc<InT>(out_);
     std::memcpy(out_data, uniq.data(), uniq.size() * sizeof(InT));
   }
+
+  // The unique values of in in the order they first appear, and the one of
+  // each value in index, from the radix sort of the ids.
+  template <typename IndexT>
+  void Dedup(const InT* in_data,
+             IndexT* index_data,
+             std::vector<InT>* uniq,
+             std::true_type) const {
+    int64_t numel = in_->numel();
+    std::vector<InT> sorted_uniq;
+    std::vector<int64_t> sorted_index(numel);
+    std::vector<int64_t> first_index;
+    RadixSortUnique<InT, int64_t>(in_data,
+                                  numel,
+                                  &sorted_uniq,
+                                  sorted_index.data(),
+                                  nullptr,
+                                  &first_index);
+    // renumber the sorted unique values by their first index
+    std::vector<int64_t> first_of(numel, -1);
+    for (size_t k = 0; k < first_index.size(); ++k) {
+      first_of[first_index[k]] = static_cast<int64_t>(k);
+    }
+    std::vector<IndexT> order(sorted_uniq.size());
+    for (int64_t i = 0; i < numel; ++i) {
+      if (first_of[i] >= 0) {
+        order[first_of[i]] = static_cast<IndexT>(uniq->size());
+        uniq->push_back(sorted_uniq[first_of[i]]);
+      }
+      index_data[i] = order[sorted_index[i]];
+    }
+  }
+
+  template <typename IndexT>
+  void Dedup(const InT* in_data,
+             IndexT* index_data,
+             std::vector<InT>* uniq,
+             std::false_type) const {
+    int64_t j = 0;
+    std::unordered_map<InT, int64_t> dict;
+    for (auto i = 0; i < in_->numel(); i++) {
+      auto it = dict.find(in_data[i]);
+      if (it == dict.end()) {
+        dict.emplace(std::make_pair(in_data[i], j));
+        uniq->emplace_back(in_data[i]);
+        index_data[i] = static_cast<IndexT>(j);
+        j++;
+      } else {
+        index_data[i] = static_cast<IndexT>(it->second);
+      }
+    }
+  }
 };
 
 static std::vector<DenseTensor> Unbind(const DenseTensor& in) {
@@ -138,7 +177,50 @@ static void UniqueFlattendTensor(const Context& context,
                                  DenseTensor* count,
                                  bool return_index,
                                  bool return_inverse,
-                                 bool return_counts) {
+                                 bool return_counts,
+                                 std::true_type) {
+  std::vector<InT> unique;
+  std::vector<IndexT> counts;
+  std::vector<IndexT> first_index;
+  IndexT* inverse_data = nullptr;
+  if (return_inverse) {
+    index->Resize(phi::make_ddim({in.numel()}));
+    inverse_data = context.template Alloc<IndexT>(index);
+  }
+  RadixSortUnique<InT, IndexT>(in.data<InT>(),
+                               in.numel(),
+                               &unique,
+                               inverse_data,
+                               return_counts ? &counts : nullptr,
+                               return_index ? &first_index : nullptr);
+  out->Resize(phi::make_ddim({static_cast<int64_t>(unique.size())}));
+  auto* out_data = context.template Alloc<InT>(out);
+  std::copy(unique.begin(), unique.end(), out_data);
+
+  if (return_index) {
+    indices->Resize(phi::make_ddim({out->numel()}));
+    auto indices_data = context.template Alloc<IndexT>(indices);
+    std::copy(first_index.begin(), first_index.end(), indices_data);
+  }
+
+  if (return_counts) {
+    count->Resize(phi::make_ddim({out->numel()}));
+    auto count_data = context.template Alloc<IndexT>(count);
+    std::copy(counts.begin(), counts.end(), count_data);
+  }
+}
+
+template <typename Context, typename InT, typename IndexT>
+static void UniqueFlattendTensor(const Context& context,
+                                 const DenseTensor& in,
+                                 DenseTensor* out,
+                                 DenseTensor* indices,
+                                 DenseTensor* index,
+                                 DenseTensor* count,
+                                 bool return_index,
+                                 bool return_inverse,
+                                 bool return_counts,
+                                 std::false_type) {
   const InT* in_data = in.data<InT>();
   std::set<InT> unique(in_data, in_data + in.numel());
   out->Resize(phi::make_ddim({static_cast<int64_t>(unique.size())}));
@@ -189,6 +271,29 @@ static void UniqueFlattendTensor(const Context& context,
   }
 }
 
+// The integer ids are deduped by a radix sort, the others by a set.
+template <typename Context, typename InT, typename IndexT>
+static void UniqueFlattendTensor(const Context& context,
+                                 const DenseTensor& in,
+                                 DenseTensor* out,
+                                 DenseTensor* indices,
+                                 DenseTensor* index,
+                                 DenseTensor* count,
+                                 bool return_index,
+                                 bool return_inverse,
+                                 bool return_counts) {
+  UniqueFlattendTensor<Context, InT, IndexT>(context,
+                                             in,
+                                             out,
+                                             indices,
+                                             index,
+                                             count,
+                                             return_index,
+                                             return_inverse,
+                                             return_counts,
+                                             IsRadixSortable<InT>());
+}
+
 template <typename Context, typename ForwardIt, typename InT, typename IndexT>
 static ForwardIt UniqueDimImpl(const Context& context,
                                ForwardIt first,
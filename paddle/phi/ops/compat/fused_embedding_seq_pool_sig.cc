@@ -0,0 +1,51 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/phi/core/compat/op_utils.h"
+
+namespace phi {
+
+KernelSignature FusedEmbeddingSeqPoolOpArgumentMapping(
+    const ArgumentMappingContext& ctx) {
+  return KernelSignature(
+      "embedding_bag", {"Ids", "W"}, {"combiner", "padding_idx"}, {"Out"});
+}
+
+KernelSignature FusedEmbeddingSeqPoolGradOpArgumentMapping(
+    const ArgumentMappingContext& ctx) {
+  if ((paddle::any_cast<bool>(ctx.Attr("is_sparse"))) == true) {
+    return KernelSignature("embedding_bag_sparse_grad",
+                           {"Ids", "W", "Out@GRAD"},
+                           {"combiner", "padding_idx"},
+                           {"W@GRAD"});
+  } else {
+    return KernelSignature("embedding_bag_grad",
+                           {"Ids", "W", "Out@GRAD"},
+                           {"combiner", "padding_idx"},
+                           {"W@GRAD"});
+  }
+}
+
+}  // namespace phi
+
+PD_REGISTER_BASE_KERNEL_NAME(fused_embedding_seq_pool, embedding_bag);
+PD_REGISTER_BASE_KERNEL_NAME(fused_embedding_seq_pool_grad,
+                             embedding_bag_grad);
+PD_REGISTER_BASE_KERNEL_NAME(fused_embedding_seq_pool_grad,
+                             embedding_bag_sparse_grad);
+
+PD_REGISTER_ARG_MAPPING_FN(fused_embedding_seq_pool,
+                           phi::FusedEmbeddingSeqPoolOpArgumentMapping);
+PD_REGISTER_ARG_MAPPING_FN(fused_embedding_seq_pool_grad,
+                           phi::FusedEmbeddingSeqPoolGradOpArgumentMapping);
@@ -0,0 +1,188 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "paddle/phi/backends/context_pool.h"
+#include "paddle/phi/kernels/funcs/cpu_broadcast_function.h"
+
+namespace phi {
+namespace tests {
+
+struct SubTwiceFunctor {
+  float operator()(float a, float b) const { return a - 2 * b; }
+};
+
+struct DxFunctor {
+  float operator()(float x, float y, float out, float dout) const {
+    return dout * y;
+  }
+};
+
+struct DyFunctor {
+  float operator()(float x, float y, float out, float dout) const {
+    return dout * x + 1;
+  }
+};
+
+static void FillTensor(const CPUContext& dev_ctx,
+                       const DDim& dims,
+                       int seed,
+                       DenseTensor* tensor) {
+  tensor->Resize(dims);
+  float* data = dev_ctx.Alloc<float>(tensor);
+  for (int64_t i = 0; i < tensor->numel(); ++i) {
+    data[i] = static_cast<float>((i * 7 + seed) % 13) / 4;
+  }
+}
+
+// the offset in an input of the same rank as the output
+static int64_t OffsetOf(const DDim& in_dims, const std::vector<int64_t>& idx) {
+  int64_t offset = 0;
+  for (int i = 0; i < in_dims.size(); ++i) {
+    offset = offset * in_dims[i] + (in_dims[i] == 1 ? 0 : idx[i]);
+  }
+  return offset;
+}
+
+// Checks the engine against a walk of the output by its indices.
+static void TestBroadcast(const DDim& x_dims, const DDim& y_dims) {
+  auto* dev_ctx = reinterpret_cast<CPUContext*>(
+      DeviceContextPool::Instance().Get(CPUPlace()));
+  std::vector<int64_t> out_shape(x_dims.size());
+  for (int i = 0; i < x_dims.size(); ++i) {
+    out_shape[i] = std::max(x_dims[i], y_dims[i]);
+  }
+  DDim out_dims = make_ddim(out_shape);
+  DenseTensor x, y, out, dout, dx, dy;
+  FillTensor(*dev_ctx, x_dims, 1, &x);
+  FillTensor(*dev_ctx, y_dims, 2, &y);
+  FillTensor(*dev_ctx, out_dims, 3, &dout);
+  out.Resize(out_dims);
+  funcs::CPUBroadcastCompute<SubTwiceFunctor, float>(
+      *dev_ctx, x, y, 0, SubTwiceFunctor(), &out);
+  funcs::CPUBroadcastGradCompute<float>(*dev_ctx,
+                                        x_dims,
+                                        y_dims,
+                                        x,
+                                        y,
+                                        out,
+                                        dout,
+                                        0,
+                                        &dx,
+                                        &dy,
+                                        DxFunctor(),
+                                        DyFunctor());
+
+  std::vector<double> dx_ref(x.numel()), dy_ref(y.numel());
+  std::vector<int64_t> idx(out_dims.size());
+  for (int64_t i = 0; i < out.numel(); ++i) {
+    int64_t rest = i;
+    for (int d = out_dims.size() - 1; d >= 0; --d) {
+      idx[d] = rest % out_dims[d];
+      rest /= out_dims[d];
+    }
+    int64_t x_offset = OffsetOf(x_dims, idx);
+    int64_t y_offset = OffsetOf(y_dims, idx);
+    float x_value = x.data<float>()[x_offset];
+    float y_value = y.data<float>()[y_offset];
+    float dout_value = dout.data<float>()[i];
+    ASSERT_EQ(out.data<float>()[i], SubTwiceFunctor()(x_value, y_value));
+    dx_ref[x_offset] += DxFunctor()(x_value, y_value, 0, dout_value);
+    dy_ref[y_offset] += DyFunctor()(x_value, y_value, 0, dout_value);
+  }
+  for (int64_t i = 0; i < x.numel(); ++i) {
+    EXPECT_NEAR(dx.data<float>()[i], dx_ref[i], 1e-3 * (1 + dx_ref[i]));
+  }
+  for (int64_t i = 0; i < y.numel(); ++i) {
+    EXPECT_NEAR(dy.data<float>()[i], dy_ref[i], 1e-3 * (1 + dy_ref[i]));
+  }
+}
+
+TEST(CPUBroadcast, same_dims) {
+  TestBroadcast({7, 9}, {7, 9});
+  TestBroadcast({2000, 300}, {2000, 300});
+}
+
+TEST(CPUBroadcast, row_and_column) {
+  TestBroadcast({64, 1000}, {1, 1000});
+  TestBroadcast({64, 1000}, {64, 1});
+  TestBroadcast({300, 1000}, {1, 1});
+}
+
+TEST(CPUBroadcast, both_broadcast) {
+  TestBroadcast({2, 3, 1, 5}, {2, 1, 4, 1});
+  TestBroadcast({1, 300, 1000}, {5, 300, 1});
+  TestBroadcast({17, 1, 33, 1}, {1, 19, 1, 2000});
+}
+
+TEST(CPUBroadcast, axis) {
+  auto* dev_ctx = reinterpret_cast<CPUContext*>(
+      DeviceContextPool::Instance().Get(CPUPlace()));
+  DenseTensor x, y, out;
+  FillTensor(*dev_ctx, {4, 5, 6}, 1, &x);
+  FillTensor(*dev_ctx, {5}, 2, &y);
+  out.Resize({4, 5, 6});
+  funcs::CPUBroadcastCompute<SubTwiceFunctor, float>(
+      *dev_ctx, x, y, 1, SubTwiceFunctor(), &out);
+  for (int64_t i = 0; i < out.numel(); ++i) {
+    EXPECT_EQ(out.data<float>()[i],
+              SubTwiceFunctor()(x.data<float>()[i],
+                                y.data<float>()[(i / 6) % 5]));
+  }
+}
+
+TEST(CPUBroadcast, grad_shares_dout) {
+  auto* dev_ctx = reinterpret_cast<CPUContext*>(
+      DeviceContextPool::Instance().Get(CPUPlace()));
+  DenseTensor x, y, out, dout, dx, dy;
+  FillTensor(*dev_ctx, {400, 300}, 1, &x);
+  FillTensor(*dev_ctx, {300}, 2, &y);
+  FillTensor(*dev_ctx, {400, 300}, 3, &dout);
+  FillTensor(*dev_ctx, {400, 300}, 4, &out);
+  std::vector<float> dout_value(dout.data<float>(),
+                                dout.data<float>() + dout.numel());
+  dx.ShareBufferWith(dout);
+  dx.Resize(dout.dims());
+  funcs::CPUBroadcastGradCompute<float>(*dev_ctx,
+                                        x.dims(),
+                                        y.dims(),
+                                        x,
+                                        y,
+                                        out,
+                                        dout,
+                                        1,
+                                        &dx,
+                                        &dy,
+                                        DxFunctor(),
+                                        DyFunctor());
+  for (int64_t i = 0; i < dx.numel(); ++i) {
+    ASSERT_EQ(dx.data<float>()[i],
+              dout_value[i] * y.data<float>()[i % 300]);
+  }
+  for (int64_t j = 0; j < 300; ++j) {
+    double sum = 0;
+    for (int64_t i = 0; i < 400; ++i) {
+      sum += dout_value[i * 300 + j] * x.data<float>()[i * 300 + j] + 1;
+    }
+    EXPECT_NEAR(dy.data<float>()[j], sum, 1e-3 * (1 + sum));
+  }
+}
+
+}  // namespace tests
+}  // namespace phi
@@ -0,0 +1,199 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "glog/logging.h"
+#include "paddle/phi/backends/context_pool.h"
+#include "paddle/phi/kernels/funcs/cpu_reduce_function.h"
+#include "paddle/phi/kernels/funcs/reduce_function.h"
+#include "paddle/phi/kernels/funcs/reduce_grad_functions.h"
+
+namespace phi {
+namespace tests {
+
+inline double GetCurrentUS() {
+  struct timeval time;
+  gettimeofday(&time, NULL);
+  return 1e+6 * time.tv_sec + time.tv_usec;
+}
+constexpr int repeat = 20;
+
+static const CPUContext& GetCPUContext() {
+  return *reinterpret_cast<CPUContext*>(
+      DeviceContextPool::Instance().Get(CPUPlace()));
+}
+
+static void RandomTensor(const DDim& dims, DenseTensor* tensor) {
+  static unsigned int seed = 100;
+  std::mt19937 rng(seed++);
+  std::uniform_real_distribution<float> uniform_dist(0.5f, 1.5f);
+  tensor->Resize(dims);
+  float* data = GetCPUContext().Alloc<float>(tensor);
+  for (int64_t i = 0; i < tensor->numel(); ++i) {
+    data[i] = uniform_dist(rng);
+  }
+}
+
+static DDim ReducedDims(const DDim& x_dims, const std::vector<int64_t>& dims) {
+  std::vector<int64_t> out_shape;
+  for (int i = 0; i < x_dims.size(); ++i) {
+    if (std::find(dims.begin(), dims.end(), i) == dims.end()) {
+      out_shape.push_back(x_dims[i]);
+    }
+  }
+  return make_ddim(out_shape);
+}
+
+// Checks the native reduce against the Eigen one of the same Functor, and
+// reports the time of both.
+template <typename Functor, size_t D, size_t R_D>
+void TestAndBench(const DDim& x_dims, const std::vector<int64_t>& dims) {
+  const auto& dev_ctx = GetCPUContext();
+  DenseTensor x, out, out_ref;
+  RandomTensor(x_dims, &x);
+  out.Resize(ReducedDims(x_dims, dims));
+  out_ref.Resize(out.dims());
+  dev_ctx.Alloc<float>(&out_ref);
+
+  auto st = GetCurrentUS();
+  for (int i = 0; i < repeat; ++i) {
+    funcs::CPUReduceCompute<float, Functor>(dev_ctx, x, &out, dims, false);
+  }
+  auto mt = GetCurrentUS();
+  for (int i = 0; i < repeat; ++i) {
+    funcs::ReduceFunctor<CPUContext, float, D, R_D, Functor>(
+        dev_ctx, x, &out_ref, dims, false);
+  }
+  auto et = GetCurrentUS();
+
+  VLOG(3) << "Reduce " << x_dims << " over " << make_ddim(dims)
+          << ": eigen takes: " << (et - mt) / repeat
+          << " us, native takes: " << (mt - st) / repeat;
+  for (int64_t i = 0; i < out.numel(); ++i) {
+    float ref = out_ref.data<float>()[i];
+    EXPECT_NEAR(out.data<float>()[i], ref, 1e-4 * (1 + std::fabs(ref)));
+  }
+}
+
+template <typename Functor>
+void TestAndBenchShapes() {
+  TestAndBench<Functor, 2, 1>({1024, 1024}, {0});
+  TestAndBench<Functor, 2, 1>({1024, 1024}, {1});
+  TestAndBench<Functor, 2, 1>({4, 1000000}, {1});
+  TestAndBench<Functor, 2, 1>({1000000, 4}, {0});
+  TestAndBench<Functor, 3, 1>({64, 256, 128}, {0});
+  TestAndBench<Functor, 3, 1>({64, 256, 128}, {1});
+  TestAndBench<Functor, 3, 1>({64, 256, 128}, {2});
+  TestAndBench<Functor, 3, 2>({64, 256, 128}, {0, 2});
+  TestAndBench<Functor, 4, 2>({8, 3, 64, 64}, {2, 3});
+  TestAndBench<Functor, 4, 3>({8, 3, 64, 64}, {0, 2, 3});
+  TestAndBench<Functor, 1, 1>({1 << 22}, {0});
+}
+
+TEST(CPUReduce, sum) { TestAndBenchShapes<funcs::SumFunctor>(); }
+
+TEST(CPUReduce, mean) { TestAndBenchShapes<funcs::MeanFunctor>(); }
+
+TEST(CPUReduce, max) { TestAndBenchShapes<funcs::MaxFunctor>(); }
+
+TEST(CPUReduce, min) { TestAndBenchShapes<funcs::MinFunctor>(); }
+
+TEST(CPUReduce, reduce_all_and_empty) {
+  const auto& dev_ctx = GetCPUContext();
+  DenseTensor x, out;
+  RandomTensor({3000, 7, 5}, &x);
+  out.Resize({1});
+  funcs::CPUReduceCompute<float, funcs::SumFunctor>(
+      dev_ctx, x, &out, {}, true);
+  double sum = 0;
+  for (int64_t i = 0; i < x.numel(); ++i) {
+    sum += x.data<float>()[i];
+  }
+  EXPECT_NEAR(out.data<float>()[0], sum, 1e-5 * sum);
+
+  // the reduce of no elements is the initial value
+  x.Resize({0, 3});
+  dev_ctx.Alloc<float>(&x);
+  out.Resize({3});
+  funcs::CPUReduceCompute<float, funcs::SumFunctor>(
+      dev_ctx, x, &out, {0}, false);
+  funcs::CPUReduceCompute<float, funcs::MeanFunctor>(
+      dev_ctx, x, &out, {0}, false);
+  EXPECT_TRUE(std::isnan(out.data<float>()[0]));
+}
+
+// Checks the native grad against the Eigen one of the same Functor, and
+// reports the time of both.
+template <typename Functor, size_t D>
+void TestAndBenchGrad(const DDim& x_dims, const std::vector<int64_t>& dims) {
+  const auto& dev_ctx = GetCPUContext();
+  DenseTensor x, out, dout, dx, dx_ref;
+  RandomTensor(x_dims, &x);
+  out.Resize(ReducedDims(x_dims, dims));
+  funcs::CPUReduceCompute<float, funcs::MaxFunctor>(
+      dev_ctx, x, &out, dims, false);
+  RandomTensor(out.dims(), &dout);
+  dx.Resize(x_dims);
+  dx_ref.Resize(x_dims);
+  dev_ctx.Alloc<float>(&dx_ref);
+  std::vector<int> int_dims(dims.begin(), dims.end());
+
+  auto st = GetCurrentUS();
+  for (int i = 0; i < repeat; ++i) {
+    funcs::CPUReduceGradCompute<float, Functor>(
+        dev_ctx, x, out, dout, &dx, int_dims, false);
+  }
+  auto mt = GetCurrentUS();
+  for (int i = 0; i < repeat; ++i) {
+    funcs::ReduceGradFunctor<CPUContext, float, D, Functor>(
+        dev_ctx, x, out, dout, &dx_ref, Functor(), int_dims);
+  }
+  auto et = GetCurrentUS();
+
+  VLOG(3) << "Reduce grad " << x_dims << " over " << make_ddim(dims)
+          << ": eigen takes: " << (et - mt) / repeat
+          << " us, native takes: " << (mt - st) / repeat;
+  for (int64_t i = 0; i < dx.numel(); ++i) {
+    float ref = dx_ref.data<float>()[i];
+    EXPECT_NEAR(dx.data<float>()[i], ref, 1e-5 * (1 + std::fabs(ref)));
+  }
+}
+
+template <typename Functor>
+void TestAndBenchGradShapes() {
+  TestAndBenchGrad<Functor, 2>({1024, 1024}, {0});
+  TestAndBenchGrad<Functor, 2>({1024, 1024}, {1});
+  TestAndBenchGrad<Functor, 3>({64, 256, 128}, {1});
+  TestAndBenchGrad<Functor, 3>({64, 256, 128}, {0, 2});
+}
+
+TEST(CPUReduceGrad, sum) { TestAndBenchGradShapes<funcs::SumGradFunctor>(); }
+
+TEST(CPUReduceGrad, mean) {
+  TestAndBenchGradShapes<funcs::MeanGradFunctor>();
+}
+
+TEST(CPUReduceGrad, max_or_min) {
+  TestAndBenchGradShapes<funcs::MaxOrMinGradFunctor>();
+}
+
+}  // namespace tests
+}  // namespace phi
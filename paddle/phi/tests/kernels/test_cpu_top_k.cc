@@ -0,0 +1,267 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "glog/logging.h"
+#include "paddle/phi/kernels/funcs/cpu_top_k.h"
+
+namespace phi {
+namespace tests {
+
+inline double GetCurrentUS() {
+  struct timeval time;
+  gettimeofday(&time, NULL);
+  return 1e+6 * time.tv_sec + time.tv_usec;
+}
+constexpr int repeat = 10;
+
+template <typename T>
+static std::vector<T> RandomRows(int64_t numel, int64_t range) {
+  std::mt19937 rng(100);
+  std::vector<T> x(numel);
+  for (auto& v : x) {
+    v = static_cast<T>(static_cast<int64_t>(rng() % range) - range / 2);
+  }
+  return x;
+}
+
+// The indices of a row of x in the order of the top k, ties and NaN as in
+// funcs, by a full stable sort.
+template <typename T>
+static std::vector<int64_t> SortedIndices(const T* x,
+                                          int64_t width,
+                                          bool largest) {
+  std::vector<int64_t> index(width);
+  std::iota(index.begin(), index.end(), 0);
+  std::stable_sort(index.begin(), index.end(), [&](int64_t a, int64_t b) {
+    bool a_nan = std::isnan(static_cast<double>(x[a]));
+    bool b_nan = std::isnan(static_cast<double>(x[b]));
+    if (a_nan || b_nan) {
+      return largest ? a_nan && !b_nan : !a_nan && b_nan;
+    }
+    return largest ? x[a] > x[b] : x[a] < x[b];
+  });
+  return index;
+}
+
+// The top k of each row by a partial sort or nth_element of a copy of it,
+// as the kernel did before funcs::TopKCompute.
+template <typename T>
+static void PartialSortTopK(const T* x,
+                            int64_t rows,
+                            int64_t width,
+                            int64_t k,
+                            T* out,
+                            int64_t* indices) {
+  auto greater = [](const std::pair<T, int64_t>& l,
+                    const std::pair<T, int64_t>& r) {
+    return (std::isnan(static_cast<double>(l.first)) &&
+            !std::isnan(static_cast<double>(r.first))) ||
+           (l.first > r.first);
+  };
+  for (int64_t i = 0; i < rows; ++i) {
+    std::vector<std::pair<T, int64_t>> col_vec;
+    col_vec.reserve(width);
+    for (int64_t j = 0; j < width; ++j) {
+      col_vec.emplace_back(x[i * width + j], j);
+    }
+    if (k * 64 < width) {
+      std::partial_sort(
+          col_vec.begin(), col_vec.begin() + k, col_vec.end(), greater);
+    } else {
+      std::nth_element(
+          col_vec.begin(), col_vec.begin() + k - 1, col_vec.end(), greater);
+      std::sort(col_vec.begin(), col_vec.begin() + k - 1, greater);
+    }
+    for (int64_t j = 0; j < k; ++j) {
+      out[i * k + j] = col_vec[j].first;
+      indices[i * k + j] = col_vec[j].second;
+    }
+  }
+}
+
+template <typename T>
+void TestTopK(const std::vector<T>& x,
+              int64_t rows,
+              int64_t width,
+              int64_t k,
+              bool largest) {
+  std::vector<T> out(rows * k);
+  std::vector<int64_t> indices(rows * k);
+  funcs::TopKCompute(x.data(),
+                     rows,
+                     width,
+                     k,
+                     largest,
+                     true,
+                     out.data(),
+                     indices.data());
+  for (int64_t i = 0; i < rows; ++i) {
+    auto ref = SortedIndices(x.data() + i * width, width, largest);
+    for (int64_t j = 0; j < k; ++j) {
+      ASSERT_EQ(indices[i * k + j], ref[j]);
+      T value = x[i * width + ref[j]];
+      if (!std::isnan(static_cast<double>(value))) {
+        ASSERT_EQ(out[i * k + j], value);
+      }
+    }
+  }
+}
+
+TEST(CPUTopK, small) {
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  std::vector<float> x = {3, nan, -1, 3, 0, nan, 7, -1, 2, 5};
+  for (int64_t k = 1; k <= 10; ++k) {
+    TestTopK(x, 2, 5, std::min<int64_t>(k, 5), true);
+    TestTopK(x, 2, 5, std::min<int64_t>(k, 5), false);
+    TestTopK(x, 1, 10, k, true);
+    TestTopK(x, 1, 10, k, false);
+  }
+}
+
+TEST(CPUTopK, random) {
+  // few values, so many ties, in rows of the heap, the chunks and
+  // nth_element
+  for (int64_t width : {100, 5000, 200000}) {
+    for (int64_t rows : {1, 3}) {
+      auto x = RandomRows<float>(rows * width, 1000);
+      for (int64_t k : {1, 5, 50, 1000}) {
+        if (k <= width) {
+          TestTopK(x, rows, width, k, true);
+          TestTopK(x, rows, width, k, false);
+        }
+      }
+    }
+  }
+  auto x = RandomRows<int64_t>(4 * 70000, int64_t(1) << 40);
+  TestTopK(x, 4, 70000, 20, true);
+  TestTopK(x, 4, 70000, 20, false);
+}
+
+TEST(CPUTopK, kthvalue) {
+  for (int64_t width : {1, 10, 3000, 100000}) {
+    auto x = RandomRows<double>(2 * width, 500);
+    x[width / 2] = std::numeric_limits<double>::quiet_NaN();
+    for (int64_t k : {int64_t(1), width / 3 + 1, width}) {
+      std::vector<double> out(2);
+      std::vector<int64_t> indices(2);
+      funcs::KthvalueCompute(
+          x.data(), 2, width, k, out.data(), indices.data());
+      for (int64_t i = 0; i < 2; ++i) {
+        auto ref = SortedIndices(x.data() + i * width, width, false);
+        ASSERT_EQ(indices[i], ref[k - 1]);
+      }
+    }
+  }
+}
+
+TEST(CPUTopK, argsort_and_mode) {
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  std::vector<float> x = {2, -0.f, nan, 0, 2, -3, nan, 2, 0, 1};
+  for (int64_t width : {10, 100000}) {
+    if (width > 10) {
+      x = RandomRows<float>(3 * width, 200);
+      x[7] = nan;
+    }
+    int64_t rows = static_cast<int64_t>(x.size()) / width;
+    for (bool descending : {false, true}) {
+      std::vector<float> out(x.size());
+      std::vector<int64_t> indices(x.size());
+      funcs::SortCompute(
+          x.data(), rows, width, descending, out.data(), indices.data());
+      for (int64_t i = 0; i < rows; ++i) {
+        auto ref = SortedIndices(x.data() + i * width, width, descending);
+        for (int64_t j = 0; j < width; ++j) {
+          ASSERT_EQ(indices[i * width + j], ref[j]);
+        }
+      }
+    }
+
+    std::vector<float> mode(rows);
+    std::vector<int64_t> mode_indices(rows);
+    funcs::ModeCompute(
+        x.data(), rows, width, mode.data(), mode_indices.data());
+    for (int64_t i = 0; i < rows; ++i) {
+      const float* row = x.data() + i * width;
+      auto ref = SortedIndices(row, width, false);
+      int64_t max_freq = 0;
+      int64_t ref_index = 0;
+      for (int64_t j = 0, begin = 0; j < width; ++j) {
+        if (j == width - 1 || row[ref[j + 1]] != row[ref[j]]) {
+          if (j + 1 - begin > max_freq) {
+            max_freq = j + 1 - begin;
+            ref_index = ref[j];
+          }
+          begin = j + 1;
+        }
+      }
+      ASSERT_EQ(mode_indices[i], ref_index);
+      ASSERT_EQ(mode[i], row[ref_index]);
+    }
+  }
+}
+
+// Reports the time of the top k of rows of a vocabulary against the partial
+// sort of each row.
+TEST(CPUTopK, bench) {
+  for (int64_t width : {50000, 250000}) {
+    for (int64_t rows : {1, 8, 64}) {
+      std::mt19937 rng(100);
+      std::normal_distribution<float> dist;
+      std::vector<float> x(rows * width);
+      for (auto& v : x) {
+        v = dist(rng);
+      }
+      for (int64_t k : {1, 5, 50, 1000}) {
+        std::vector<float> out(rows * k);
+        std::vector<float> out_ref(rows * k);
+        std::vector<int64_t> indices(rows * k);
+        auto st = GetCurrentUS();
+        for (int i = 0; i < repeat; ++i) {
+          funcs::TopKCompute(x.data(),
+                             rows,
+                             width,
+                             k,
+                             true,
+                             true,
+                             out.data(),
+                             indices.data());
+        }
+        auto mt = GetCurrentUS();
+        for (int i = 0; i < repeat; ++i) {
+          PartialSortTopK(
+              x.data(), rows, width, k, out_ref.data(), indices.data());
+        }
+        auto et = GetCurrentUS();
+        VLOG(3) << "TopK of [" << rows << ", " << width << "], k " << k
+                << ": partial sort takes: " << (et - mt) / repeat
+                << " us, funcs takes: " << (mt - st) / repeat;
+        ASSERT_EQ(out, out_ref);
+      }
+    }
+  }
+}
+
+}  // namespace tests
+}  // namespace phi
@@ -0,0 +1,204 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "paddle/phi/core/dense_tensor.h"
+#include "paddle/phi/kernels/funcs/embedding_bag.h"
+
+namespace phi {
+namespace tests {
+
+// The ids of bags of a random length each, in a LoD of width ids, or padded
+// to the longest bag by padding_idx if not lod.
+static void RandomIds(int64_t bags,
+                      int64_t width,
+                      int64_t height,
+                      int64_t padding_idx,
+                      bool lod,
+                      std::vector<int64_t>* ids,
+                      DenseTensor* ids_tensor) {
+  std::mt19937 rng(100);
+  std::vector<int64_t> lengths(bags);
+  int64_t max_length = 0;
+  int64_t total = 0;
+  for (auto& length : lengths) {
+    length = rng() % 9;
+    max_length = std::max(max_length, length);
+    total += length;
+  }
+  ids->clear();
+  LoD ids_lod(1, {0});
+  for (int64_t b = 0; b < bags; ++b) {
+    int64_t length = lod ? lengths[b] : max_length;
+    for (int64_t j = 0; j < length * width; ++j) {
+      bool padded = j >= lengths[b] * width || rng() % 5 == 0;
+      ids->push_back(padded && padding_idx >= 0 ? padding_idx
+                                                : rng() % height);
+    }
+    ids_lod[0].push_back(ids_lod[0].back() + length);
+  }
+  if (lod) {
+    ids_tensor->Resize({total, width});
+    ids_tensor->set_lod(ids_lod);
+  } else {
+    ids_tensor->Resize({bags, max_length});
+  }
+}
+
+// The pooled rows of each bag, by a naive loop.
+static std::vector<float> NaiveEmbeddingBag(
+    const std::vector<float>& table,
+    int64_t row_width,
+    const std::vector<int64_t>& ids,
+    const funcs::EmbeddingBagLayout& layout,
+    int64_t padding_idx,
+    funcs::EmbeddingBagPoolType pool) {
+  int64_t width = layout.width;
+  std::vector<float> out(layout.bags() * width * row_width, 0.f);
+  for (int64_t b = 0; b < layout.bags(); ++b) {
+    for (int64_t c = 0; c < width; ++c) {
+      float* dst = out.data() + (b * width + c) * row_width;
+      int64_t n = 0;
+      for (int64_t j = layout.offsets[b]; j < layout.offsets[b + 1]; ++j) {
+        int64_t id = ids[j * width + c];
+        if (id == padding_idx) {
+          continue;
+        }
+        for (int64_t i = 0; i < row_width; ++i) {
+          dst[i] += table[id * row_width + i];
+        }
+        ++n;
+      }
+      float scale = 1.f;
+      if (n > 0 && pool == funcs::EmbeddingBagPoolType::kMean) {
+        scale = 1.f / n;
+      } else if (n > 0 && pool == funcs::EmbeddingBagPoolType::kSqrt) {
+        scale = 1.f / std::sqrt(static_cast<float>(n));
+      }
+      for (int64_t i = 0; i < row_width; ++i) {
+        dst[i] *= scale;
+      }
+    }
+  }
+  return out;
+}
+
+void TestEmbeddingBag(int64_t bags,
+                      int64_t width,
+                      int64_t padding_idx,
+                      bool lod,
+                      const std::string& combiner) {
+  const int64_t height = 1000;
+  const int64_t row_width = 24;
+  auto pool = funcs::GetEmbeddingBagPoolType(combiner);
+  std::vector<int64_t> ids;
+  DenseTensor ids_tensor;
+  RandomIds(bags, width, height, padding_idx, lod, &ids, &ids_tensor);
+  funcs::EmbeddingBagLayout layout(ids_tensor);
+  ASSERT_EQ(layout.bags(), bags);
+  ASSERT_EQ(layout.width, lod ? width : 1);
+
+  std::mt19937 rng(200);
+  std::uniform_real_distribution<float> dist(-1.f, 1.f);
+  std::vector<float> table(height * row_width);
+  for (auto& x : table) {
+    x = dist(rng);
+  }
+  std::vector<float> out(bags * layout.width * row_width);
+  funcs::EmbeddingBagCompute(table.data(),
+                             height,
+                             row_width,
+                             ids.data(),
+                             layout,
+                             padding_idx,
+                             pool,
+                             out.data());
+  auto ref =
+      NaiveEmbeddingBag(table, row_width, ids, layout, padding_idx, pool);
+  for (size_t i = 0; i < out.size(); ++i) {
+    ASSERT_NEAR(out[i], ref[i], 1e-5);
+  }
+
+  // the grad of each row of each bag is added to the rows of its ids
+  std::vector<float> dout(out.size());
+  for (auto& x : dout) {
+    x = dist(rng);
+  }
+  std::vector<float> dtable_ref(height * row_width, 0.f);
+  for (int64_t b = 0; b < bags; ++b) {
+    for (int64_t c = 0; c < layout.width; ++c) {
+      int64_t begin = layout.offsets[b];
+      int64_t end = layout.offsets[b + 1];
+      int64_t n = 0;
+      for (int64_t j = begin; j < end; ++j) {
+        n += ids[j * layout.width + c] != padding_idx;
+      }
+      float scale = funcs::EmbeddingBagScale<float>(pool, n);
+      const float* src = dout.data() + (b * layout.width + c) * row_width;
+      for (int64_t j = begin; j < end; ++j) {
+        int64_t id = ids[j * layout.width + c];
+        if (id == padding_idx) {
+          continue;
+        }
+        for (int64_t k = 0; k < row_width; ++k) {
+          dtable_ref[id * row_width + k] += scale * src[k];
+        }
+      }
+    }
+  }
+
+  funcs::EmbeddingBagGrad<float> grad(
+      ids.data(), layout, height, padding_idx, pool);
+  std::vector<float> dtable(height * row_width, 0.f);
+  grad.Compute(dout.data(), row_width, true, dtable.data());
+  for (size_t i = 0; i < dtable.size(); ++i) {
+    ASSERT_NEAR(dtable[i], dtable_ref[i], 1e-4);
+  }
+
+  const auto& rows = grad.rows();
+  ASSERT_TRUE(std::is_sorted(rows.begin(), rows.end()));
+  ASSERT_TRUE(std::adjacent_find(rows.begin(), rows.end()) == rows.end());
+  std::vector<float> value(rows.size() * row_width);
+  grad.Compute(dout.data(), row_width, false, value.data());
+  for (size_t g = 0; g < rows.size(); ++g) {
+    ASSERT_NE(rows[g], padding_idx);
+    for (int64_t k = 0; k < row_width; ++k) {
+      ASSERT_EQ(value[g * row_width + k], dtable[rows[g] * row_width + k]);
+    }
+  }
+}
+
+TEST(EmbeddingBag, lod) {
+  for (auto& combiner : {"sum", "mean", "sqrt"}) {
+    TestEmbeddingBag(50, 1, -1, true, combiner);
+    TestEmbeddingBag(50, 1, 7, true, combiner);
+    TestEmbeddingBag(50, 3, 7, true, combiner);
+  }
+}
+
+TEST(EmbeddingBag, padded) {
+  for (auto& combiner : {"sum", "mean", "sqrt"}) {
+    TestEmbeddingBag(50, 1, 7, false, combiner);
+  }
+}
+
+TEST(EmbeddingBag, many_bags) { TestEmbeddingBag(3000, 2, 7, true, "mean"); }
+
+}  // namespace tests
+}  // namespace phi
@@ -0,0 +1,102 @@
+// Copyright (c) 2023 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "paddle/phi/kernels/funcs/radix_sort.h"
+
+namespace phi {
+namespace tests {
+
+template <typename T>
+void TestSort(const std::vector<T>& x) {
+  int64_t n = static_cast<int64_t>(x.size());
+  std::vector<T> sorted(n);
+  std::vector<int64_t> index(n);
+  funcs::RadixSortWithIndex(x.data(), n, sorted.data(), index.data());
+
+  std::vector<int64_t> ref(n);
+  std::iota(ref.begin(), ref.end(), 0);
+  std::stable_sort(ref.begin(), ref.end(), [&x](int64_t a, int64_t b) {
+    return x[a] < x[b];
+  });
+  ASSERT_EQ(index, ref);
+  for (int64_t i = 0; i < n; ++i) {
+    ASSERT_EQ(sorted[i], x[ref[i]]);
+  }
+}
+
+template <typename T>
+void TestUnique(const std::vector<T>& x) {
+  int64_t n = static_cast<int64_t>(x.size());
+  std::vector<T> unique;
+  std::vector<int> inverse(n);
+  std::vector<int> counts;
+  std::vector<int> first_index;
+  funcs::RadixSortUnique(
+      x.data(), n, &unique, inverse.data(), &counts, &first_index);
+
+  std::map<T, int> ref_counts;
+  std::map<T, int> ref_first;
+  for (int64_t i = 0; i < n; ++i) {
+    ++ref_counts[x[i]];
+    ref_first.emplace(x[i], static_cast<int>(i));
+  }
+  ASSERT_EQ(unique.size(), ref_counts.size());
+  size_t k = 0;
+  for (auto& kv : ref_counts) {
+    EXPECT_EQ(unique[k], kv.first);
+    EXPECT_EQ(counts[k], kv.second);
+    EXPECT_EQ(first_index[k], ref_first[kv.first]);
+    ++k;
+  }
+  for (int64_t i = 0; i < n; ++i) {
+    EXPECT_EQ(unique[inverse[i]], x[i]);
+  }
+}
+
+TEST(RadixSort, small) {
+  TestSort<int64_t>({});
+  TestSort<int64_t>({3, -1, 3, 0, -1, 7});
+  TestUnique<int>({5, 5, -2, 9, -2, 5});
+}
+
+TEST(RadixSort, random) {
+  std::mt19937_64 rng(100);
+  for (int64_t n : {100, 5000, 1 << 20}) {
+    // ids of a few high bits in common, and ones of the full range
+    std::vector<int64_t> ids(n);
+    std::vector<int64_t> wide(n);
+    std::vector<int32_t> narrow(n);
+    for (int64_t i = 0; i < n; ++i) {
+      ids[i] = (int64_t(7) << 40) + static_cast<int64_t>(rng() % (n / 4 + 1));
+      wide[i] = static_cast<int64_t>(rng());
+      narrow[i] = static_cast<int32_t>(rng() % 1000) - 500;
+    }
+    TestSort(ids);
+    TestSort(wide);
+    TestSort(narrow);
+    TestUnique(ids);
+    TestUnique(narrow);
+  }
+}
+
+}  // namespace tests
+}  // namespace phi
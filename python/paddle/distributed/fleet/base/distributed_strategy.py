@@ -571,6 +571,7 @@ class DistributedStrategy:
         support_sparse_key_list = [
             'sparse_table_class',
             'sparse_compress_in_save',
+            'sparse_binary_checkpoint',
             'sparse_shard_num',
             'sparse_accessor_class',
             'sparse_learning_rate',
@@ -619,6 +620,7 @@ class DistributedStrategy:
         support_sparse_table_class = [
             'DownpourSparseTable',
             'DownpourSparseSSDTable',
+            'DownpourSparseFlatTable',
         ]
         support_sparse_accessor_class = [
             'DownpourSparseValueAccessor',
@@ -739,11 +741,13 @@ class DistributedStrategy:
             )
             if table_class not in support_sparse_table_class:
                 raise ValueError(
-                    "support sparse_table_class: ['DownpourSparseTable, DownpourSparseSSDTable'], but actual %s"
+                    "support sparse_table_class: ['DownpourSparseTable, DownpourSparseSSDTable, DownpourSparseFlatTable'], but actual %s"
                     % (table_class)
                 )
             if table_class == "DownpourSparseSSDTable":
                 table_data.table_class = 'SSDSparseTable'
+            elif table_class == "DownpourSparseFlatTable":
+                table_data.table_class = 'MemoryFlatSparseTable'
             else:
                 table_data.table_class = 'MemorySparseTable'
             table_data.shard_num = config.get('sparse_shard_num', 1000)
@@ -756,6 +760,9 @@ class DistributedStrategy:
             table_data.sparse_table_cache_file_num = config.get(
                 'sparse_cache_file_num', 16
             )
+            table_data.binary_checkpoint = config.get(
+                'sparse_binary_checkpoint', False
+            )
 
             accessor_class = config.get(
                 "sparse_accessor_class", "DownpourCtrAccessor"
@@ -1175,6 +1175,27 @@ class InMemoryDataset(DatasetBase):
         """
         self.dataset.dump_walk_path(path, dump_rate)
 
+    def dump_samples(self, path):
+        """
+        Dump the samples loaded in memory to path as binary sample files,
+        named part-xxxxx.pdsample. A later pass can set them as the filelist
+        and load them without parsing the text again.
+
+        Args:
+            path(str): the directory to dump to, local or on hdfs/afs.
+
+        Examples:
+            .. code-block:: python
+
+              # required: skiptest
+              import paddle.fluid as fluid
+              dataset = fluid.DatasetFactory().create_dataset("InMemoryDataset")
+              dataset.set_filelist(["a.txt", "b.txt"])
+              dataset.load_into_memory()
+              dataset.dump_samples("./samples")
+        """
+        self.dataset.dump_samples(path)
+
 
 class QueueDataset(DatasetBase):
     """